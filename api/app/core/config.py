@@ -94,6 +94,24 @@ class Settings(BaseSettings):
     PINECONE_UPSERT_TIMEOUT: float = float(os.environ.get("PINECONE_UPSERT_TIMEOUT", "60.0"))  # 60 seconds default
     PINECONE_INDEX_STATS_TIMEOUT: float = float(os.environ.get("PINECONE_INDEX_STATS_TIMEOUT", "15.0"))  # 15 seconds default
     
+    # PDFs of at least this many bytes are ingested page by page, storing
+    # chunks while later pages are still being extracted
+    PDF_STREAMING_MIN_BYTES: int = int(os.environ.get("PDF_STREAMING_MIN_BYTES", str(32 * 1024 * 1024)))  # 32 MB default
+    
+    # Native job queue PDF uploads are extracted and chunked on: worker
+    # threads (0 = one per core) and uploads queued or running at once, beyond
+    # which an upload is turned away instead of waiting
+    INGEST_JOB_THREADS: int = int(os.environ.get("INGEST_JOB_THREADS", "0"))
+    INGEST_JOB_MAX_PENDING: int = int(os.environ.get("INGEST_JOB_MAX_PENDING", "64"))
+    
+    # File the IDs of upserted chunks are kept in, so unchanged chunks are
+    # not re-embedded after a restart; empty keeps them in memory only
+    CHUNK_INDEX_PATH: str = os.environ.get("CHUNK_INDEX_PATH", "")
+    
+    # tiktoken merge-ranks file of cl100k_base (cl100k_base.tiktoken); when
+    # set, upserts are split into embedding requests by token count
+    BPE_RANKS_PATH: str = os.environ.get("BPE_RANKS_PATH", "")
+    
     # Query cache settings
     QUERY_CACHE_SIZE: int = int(os.environ.get("QUERY_CACHE_SIZE", "100"))  # 100 entries default
     QUERY_CACHE_TTL: int = int(os.environ.get("QUERY_CACHE_TTL", "300"))  # 5 minutes TTL default
@@ -7,6 +7,7 @@ import logging
 from typing import Optional, AsyncGenerator
 from langchain_pinecone import Pinecone
 from langchain_openai import OpenAIEmbeddings
+from langchain_core.vectorstores import VectorStore
 import os
 from functools import lru_cache
 
@@ -37,10 +38,28 @@ def get_embeddings_singleton():
             return None
     return _embeddings_instance
 
-def get_vector_store_singleton() -> Optional[Pinecone]:
-    """Returns a singleton instance of the Pinecone vector store."""
+def get_vector_store_singleton() -> Optional[VectorStore]:
+    """Returns a singleton instance of the Pinecone vector store, or with
+    LOCAL_VECTOR_STORE_PATH set (development / offline mode) of a
+    LocalVectorStore persisted under that directory."""
     global _vector_store_instance
     if _vector_store_instance is None:
+        local_path = os.getenv("LOCAL_VECTOR_STORE_PATH")
+        if local_path:
+            try:
+                # The connector has put the COSMOS core on sys.path
+                from core.local_vector_store import LocalVectorStore
+                embeddings = get_embeddings_singleton()
+                if not embeddings:
+                    logger.error("Failed to get embeddings instance")
+                    return None
+                logger.info(f"Initializing local vector store singleton at {local_path}")
+                _vector_store_instance = LocalVectorStore(embeddings, path=local_path)
+            except Exception as e:
+                logger.exception(f"Failed to open local vector store at {local_path}: {e}")
+                return None
+            return _vector_store_instance
+
         try:
             # Get configuration
             index_name = os.getenv("PINECONE_INDEX_NAME")
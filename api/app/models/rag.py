@@ -14,13 +14,13 @@ class QueryRequest(BaseModel):
     is_system_message: Optional[bool] = Field(False, description="Flag to indicate if this is a system message for topic reset")
 
 class ProcessDocumentRequest(BaseModel):
-    chunk_size: int = Field(512, description="The size of each text chunk")
-    chunk_overlap: int = Field(50, description="The overlap between adjacent chunks")
+    chunk_size: int = Field(512, description="The size of each text chunk in words")
+    chunk_overlap: int = Field(50, description="The overlap between adjacent chunks in words")
 
 class URLRequest(BaseModel):
     url: str = Field(..., description="The URL to process")
-    chunk_size: int = Field(512, description="The size of each text chunk")
-    chunk_overlap: int = Field(50, description="The overlap between adjacent chunks")
+    chunk_size: int = Field(512, description="The size of each text chunk in words")
+    chunk_overlap: int = Field(50, description="The overlap between adjacent chunks in words")
 
 # Timing info model
 class TimingInfo(BaseModel):
@@ -41,6 +41,7 @@ class ProcessDocumentResponse(BaseModel):
     success: bool = Field(..., description="Whether the document was processed successfully")
     document_id: Optional[str] = Field(None, description="The ID of the processed document")
     chunk_count: Optional[int] = Field(None, description="The number of chunks created")
+    skipped_chunks: Optional[int] = Field(None, description="The number of empty chunks that were not stored")
     message: Optional[str] = Field(None, description="Error message if processing failed")
 
 # Add response model for URL processing
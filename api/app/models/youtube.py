@@ -4,12 +4,13 @@ from pydantic import BaseModel, Field, HttpUrl
 # Request Models
 class YouTubeRequest(BaseModel):
     url: str = Field(..., description="The YouTube video URL")
-    chunk_size: int = Field(512, description="The size of each text chunk")
-    chunk_overlap: int = Field(50, description="The overlap between adjacent chunks")
+    chunk_size: int = Field(512, description="The size of each text chunk in words")
+    chunk_overlap: int = Field(50, description="The overlap between adjacent chunks in words")
 
 # Response Models
 class YouTubeResponse(BaseModel):
     success: bool = Field(..., description="Whether the video transcript was processed successfully")
     video_id: Optional[str] = Field(None, description="The YouTube video ID")
     chunk_count: Optional[int] = Field(None, description="The number of chunks created")
+    skipped_chunks: Optional[int] = Field(None, description="The number of empty chunks that were not stored")
     message: Optional[str] = Field(None, description="Error message if processing failed") 
\ No newline at end of file
@@ -519,11 +519,12 @@ async def clear_cache(
     cosmos: CosmosConnector = Depends(get_cosmos_connector)
 ) -> Dict[str, Any]:
     """
-    Clear the query response cache.
+    Clear the query response cache and the semantic retrieval cache.
     This is an administrative endpoint to use when content is updated or for troubleshooting.
     """
     try:
         cosmos.query_cache.clear()
+        cosmos.chain.clear_semantic_cache()
         logger.info("Query cache cleared via API request")
         return {
             "success": True, 
@@ -71,6 +71,7 @@ async def process_youtube(
             "success": True,
             "video_id": result.get("video_id"),
             "chunk_count": result.get("chunk_count", 0),
+            "skipped_chunks": result.get("skipped_chunks", 0),
             "message": result.get("message", "Successfully processed YouTube transcript")
         }
     except HTTPException as he:
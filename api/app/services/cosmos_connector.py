@@ -1,3 +1,4 @@
+import os
 import sys
 from pathlib import Path
 from typing import Dict, Optional, Any
@@ -138,6 +139,38 @@ class CosmosConnector:
         except (ImportError, ModuleNotFoundError):
             self.use_cpp_hash = False
             logger.info("C++ hash generator not available in connector, using Python implementation.")
+        
+        # IDs of the chunks already upserted, so re-ingesting unchanged
+        # content skips embedding; optionally kept across restarts. Only a
+        # cache: the store confirms the IDs it knows before chunks are skipped
+        self.chunk_index = None
+        if self.use_cpp_hash and hasattr(self.hash_generator_cpp, "ChunkHashIndex"):
+            index_path = settings.CHUNK_INDEX_PATH
+            try:
+                if index_path and os.path.exists(index_path):
+                    self.chunk_index = self.hash_generator_cpp.ChunkHashIndex.load(index_path)
+                    logger.info(f"Loaded {len(self.chunk_index)} stored chunk IDs from {index_path}")
+                else:
+                    self.chunk_index = self.hash_generator_cpp.ChunkHashIndex()
+            except Exception as e:
+                logger.warning(f"Could not load the chunk index from {index_path}, starting empty: {e}")
+                self.chunk_index = self.hash_generator_cpp.ChunkHashIndex()
+        
+        # Queue PDF uploads are extracted and chunked on, so the event loop
+        # awaits them instead of a threadpool thread blocking per upload
+        self.ingest_jobs = None
+        if getattr(self.processing, "USE_CPP_JOB_QUEUE", False):
+            async_jobs = self._import_module("core.async_jobs")
+            self.ingest_jobs = async_jobs.AsyncJobQueue(self.processing.job_queue.JobQueue(
+                num_threads=settings.INGEST_JOB_THREADS, max_pending=settings.INGEST_JOB_MAX_PENDING))
+            logger.info(f"Extracting PDF uploads on a native job queue of "
+                        f"{self.ingest_jobs.queue.num_threads} threads")
+        
+        # Encoder of the embedding model, which packs upserts into
+        # token-budgeted embedding requests; None sends them in one call
+        self.embedding_encoder = self.vector_store.load_embedding_encoder(settings.BPE_RANKS_PATH)
+        if self.embedding_encoder is not None:
+            logger.info(f"Packing upserts by token count with the encoder from {settings.BPE_RANKS_PATH}")
     
     def _import_module(self, module_name: str) -> Any:
         """Dynamically import a module from COSMOS"""
@@ -149,6 +182,46 @@ class CosmosConnector:
             logger.error(f"Failed to import module {module_name} from {settings.COSMOS_CORE_PATH}: {e}")
             raise # Re-raise to indicate a critical setup error
     
+    def _store_chunks(self, vector_store, chunks, chunk_ids, source_id: Optional[str] = None):
+        """Upsert the chunks that are not stored under their ID yet; blocking,
+        run it in a threadpool. With a source_id, chunks are everything that
+        source produced and its older chunks missing from them are deleted:
+        pass one only when re-ingesting the same logical document, a video or
+        a URL, never for uploads keyed by their content hash.
+        Returns (chunks upserted, empty chunks skipped)."""
+        all_chunk_ids = chunk_ids
+        if self.chunk_index is not None:
+            # The index may be stale, so the store confirms what it skips
+            chunks, chunk_ids = self.processing.filter_new_chunks(
+                chunks, chunk_ids, self.chunk_index,
+                lambda ids: self.vector_store.stored_chunk_ids(vector_store, ids))
+        stored_ids, skipped = [], 0
+        if chunks:
+            stored_ids, skipped = self.vector_store.upsert_chunk_batches(vector_store, chunks, chunk_ids,
+                                                                         self.embedding_encoder)
+            if self.chunk_index is not None:
+                self.processing.mark_chunks_stored(stored_ids, self.chunk_index)
+                if settings.CHUNK_INDEX_PATH:
+                    self.chunk_index.save(settings.CHUNK_INDEX_PATH)
+        if source_id is not None:
+            self._delete_stale_chunks(vector_store, source_id, all_chunk_ids)
+        return len(stored_ids), skipped
+
+    def _delete_stale_chunks(self, vector_store, source_id: str, chunk_ids) -> int:
+        """Delete the chunks stored under source_id that are not in chunk_ids,
+        all the IDs of its latest ingest; blocking. The store is searched for
+        them, so no record of earlier ingests is kept. Returns how many
+        chunks were deleted."""
+        stale_ids = self.vector_store.stale_source_chunk_ids(vector_store, source_id, chunk_ids)
+        if stale_ids:
+            vector_store.delete(ids=stale_ids)
+            if self.chunk_index is not None:
+                self.chunk_index.remove(stale_ids)
+                if settings.CHUNK_INDEX_PATH:
+                    self.chunk_index.save(settings.CHUNK_INDEX_PATH)
+            logger.info(f"Deleted {len(stale_ids)} chunks of {source_id} its re-ingest no longer produced")
+        return len(stale_ids)
+    
     # RAG Chatbot Functions
     async def query_documents(self, vector_store, query: str, model_name: str, temperature: float,
                              filter_sources: Optional[Dict[str, bool]] = None) -> Dict[str, Any]:
@@ -198,14 +271,16 @@ class CosmosConnector:
             # Start retrieval timing
             retrieval_start = time.time()
             
-            # Run synchronous retriever.invoke in threadpool with timeout
+            # Run the synchronous (semantically cached) retrieval in threadpool with timeout
             try:
                 # Apply timeout to the Pinecone query operation
                 relevant_docs = await run_with_timeout(
                     run_in_threadpool,
                     settings.PINECONE_QUERY_TIMEOUT,
-                    retriever.invoke, 
-                    query
+                    self.chain.retrieve_documents,
+                    vector_store,
+                    query,
+                    retriever.search_kwargs
                 )
                 retrieval_time = time.time() - retrieval_start
                 logger.info(f"Retrieved {len(relevant_docs)} documents in {retrieval_time:.2f}s")
@@ -256,6 +331,8 @@ class CosmosConnector:
                         source_details = f"VIDEO_ID: {video_id}\nURL: {url}"
                     elif source_type == "pdf":
                         source_details = f"DOC_ID: {source_id}"
+                        if "page_number" in metadata:
+                            source_details += f"\nPAGE: {metadata.get('page_number')}"
                     elif source_type == "image":
                         # Add specific handling for image sources
                         source_details = f"IMAGE_ID: {source_id}"
@@ -385,14 +462,16 @@ class CosmosConnector:
             # Start retrieval timing
             retrieval_start = time.time()
             
-            # Run synchronous retriever.invoke in threadpool with timeout
+            # Run the synchronous (semantically cached) retrieval in threadpool with timeout
             try:
                 # Apply timeout to the Pinecone query operation
                 relevant_docs = await run_with_timeout(
                     run_in_threadpool,
                     settings.PINECONE_QUERY_TIMEOUT,
-                    retriever.invoke, 
-                    query
+                    self.chain.retrieve_documents,
+                    vector_store,
+                    query,
+                    retriever.search_kwargs
                 )
                 retrieval_time = time.time() - retrieval_start
                 logger.info(f"Retrieved {len(relevant_docs)} documents in {retrieval_time:.2f}s")
@@ -425,6 +504,8 @@ class CosmosConnector:
                         source_details = f"VIDEO_ID: {video_id}\nURL: {url}"
                     elif source_type == "pdf":
                         source_details = f"DOC_ID: {source_id}"
+                        if "page_number" in metadata:
+                            source_details += f"\nPAGE: {metadata.get('page_number')}"
                     elif source_type == "image":
                         # Add specific handling for image sources
                         source_details = f"IMAGE_ID: {source_id}"
@@ -490,7 +571,9 @@ class CosmosConnector:
     
     async def process_document(self, vector_store, content: bytes, filename: str, chunk_size: int, 
                               chunk_overlap: int) -> Dict[str, Any]:
-        """Process and store a document in the vector database"""
+        """Process and store a document in the vector database. As everywhere in
+        the API, chunk_size and chunk_overlap count words, as the UI shows
+        them, and every chunker is asked for word-count chunks."""
         try:
             # Use the provided vector_store instead of initializing one
             if not vector_store:
@@ -498,41 +581,65 @@ class CosmosConnector:
                 return {"success": False, "message": "Error: Vector store is not available."}
                 
             source_type = ""
+            # Uploads are keyed by the hash of their bytes: the API has no
+            # identity for a document beyond its content, so two uploads with
+            # one name stay separate sources
             doc_id = None
             text = None
+            processed = None
 
             # Extract based on filename extension
             lower_filename = filename.lower()
             if lower_filename.endswith(".pdf"):
-                # Handle PDF
-                text, doc_id = await run_in_threadpool(self.data_extraction.extract_text_from_pdf, io.BytesIO(content))
+                if len(content) >= settings.PDF_STREAMING_MIN_BYTES:
+                    return await self._process_pdf_streaming(vector_store, content, filename,
+                                                             chunk_size, chunk_overlap)
+                # Handle PDF: extract, chunk and hash in one native call when
+                # available, so every chunk cites the page it came from
                 source_type = "pdf"
+                if self.ingest_jobs is not None:
+                    try:
+                        processed = await self.processing.process_pdf_content_async(
+                            self.ingest_jobs, content, chunk_size, chunk_overlap, unit="words")
+                    except self.processing.job_queue.QueueFullError:
+                        logger.warning(f"Ingestion queue full, turning away {filename}")
+                        return {"success": False, "message": "Too many documents are being processed right now. Please try again shortly."}
+                else:
+                    processed = await run_in_threadpool(
+                        self.processing.process_pdf_content, content, chunk_size, chunk_overlap, unit="words")
+                if processed is None:
+                    text, doc_id = await run_in_threadpool(self.data_extraction.extract_text_from_pdf, io.BytesIO(content))
             elif lower_filename.endswith((".txt", ".md")):
                  try:
                      text = content.decode('utf-8') # Simple text decode
                  except UnicodeDecodeError:
                      text = content.decode('latin-1', errors='ignore') # Fallback encoding
-                 doc_id = self.data_extraction.hash_generator.compute_sha256(content) # Use hash as ID
+                 doc_id = self.data_extraction.compute_document_hash(content)
                  source_type = "text"
             # Add other file types (e.g., .docx, .pptx) if needed in core.data_extraction
             else:
                  return {"success": False, "message": f"Unsupported file type: {filename}"}
             
-            if not text or (isinstance(text, str) and text.startswith("Error")):
-                error_message = text if (isinstance(text, str) and text.startswith("Error")) else "Failed to extract text"
-                return {"success": False, "message": f"{error_message} from document: {filename}"}
-                
-            # Process the document - Call correct function name
-            chunks, chunk_ids = await run_in_threadpool(
-                self.processing.process_content, # Use process_content
-                content=text,
-                source_id=str(doc_id),
-                chunk_size=chunk_size,
-                chunk_overlap=chunk_overlap,
-                # source_type and source_metadata are handled within process_content
-                # source_type=source_type, 
-                # source_metadata={"filename": filename}
-            )
+            if processed is not None:
+                chunks, chunk_ids, doc_id = processed
+            else:
+                if not text or (isinstance(text, str) and text.startswith("Error")):
+                    error_message = text if (isinstance(text, str) and text.startswith("Error")) else "Failed to extract text"
+                    return {"success": False, "message": f"{error_message} from document: {filename}"}
+
+                # Process the document - Call correct function name
+                chunks, chunk_ids = await run_in_threadpool(
+                    self.processing.process_content, # Use process_content
+                    content=text,
+                    source_id=str(doc_id),
+                    document_hash=str(doc_id),
+                    chunk_size=chunk_size,
+                    chunk_overlap=chunk_overlap,
+                    unit="words",
+                    # source_type and source_metadata are handled within process_content
+                    # source_type=source_type, 
+                    # source_metadata={"filename": filename}
+                )
             
             if not chunks:
                  return {"success": False, "message": f"Document processing resulted in no chunks for {filename}."}
@@ -540,14 +647,18 @@ class CosmosConnector:
             # Use the provided vector_store with timeout
             try:
                 # Apply timeout to the Pinecone upsert operation
-                await run_with_timeout(
+                stored, skipped = await run_with_timeout(
                     run_in_threadpool, 
                     settings.PINECONE_UPSERT_TIMEOUT,
-                    vector_store.add_documents, 
+                    self._store_chunks, 
+                    vector_store,
                     chunks, 
-                    ids=chunk_ids
+                    chunk_ids
                 )
-                logger.info(f"Successfully added {len(chunks)} chunks to vector store")
+                logger.info(f"Successfully added {stored} new of {len(chunks)} chunks to vector store, "
+                            f"skipped {skipped} empty chunks")
+                # Cached retrievals predate the new chunks
+                self.chain.clear_semantic_cache()
             except asyncio.TimeoutError:
                 logger.error(f"Vector store update timed out after {settings.PINECONE_UPSERT_TIMEOUT}s")
                 return {"success": False, "message": "Document was processed but could not be stored due to a timeout in the vector database. Please try again."}
@@ -555,12 +666,66 @@ class CosmosConnector:
             return {
                 "success": True,
                 "document_id": str(doc_id),
-                "chunk_count": len(chunks)
+                "chunk_count": len(chunks) - skipped,
+                "skipped_chunks": skipped
             }
         except Exception as e:
             logger.exception(f"Error in process_document for {filename}: {e}")
             return {"success": False, "message": str(e)}
     
+    async def _process_pdf_streaming(self, vector_store, content: bytes, filename: str, chunk_size: int,
+                                     chunk_overlap: int) -> Dict[str, Any]:
+        """Ingest a large PDF page by page: each batch of chunks is stored as
+        soon as its pages are extracted, and the document's whole text is
+        never held in memory"""
+        doc_id = await run_in_threadpool(self.data_extraction.compute_document_hash, content)
+        pages = self.data_extraction.iter_pdf_pages(io.BytesIO(content))
+        batches = self.processing.iter_pdf_page_chunks(pages, doc_id, doc_id, chunk_size, chunk_overlap,
+                                                        unit="words")
+
+        chunk_count = 0
+        skipped_count = 0
+        upserted = False
+        try:
+            while True:
+                # Extraction and chunking of the next pages run off the event loop
+                batch = await run_in_threadpool(next, batches, None)
+                if batch is None:
+                    break
+                chunks, chunk_ids = batch
+                # A timed-out upsert may still land, so it counts as stored
+                upserted = True
+                _, skipped = await run_with_timeout(
+                    run_in_threadpool,
+                    settings.PINECONE_UPSERT_TIMEOUT,
+                    self._store_chunks,
+                    vector_store,
+                    chunks,
+                    chunk_ids
+                )
+                chunk_count += len(chunks) - skipped
+                skipped_count += skipped
+        except asyncio.TimeoutError:
+            logger.error(f"Vector store update timed out after {settings.PINECONE_UPSERT_TIMEOUT}s "
+                         f"with {chunk_count} chunks of {filename} stored")
+            return {"success": False, "message": "Document was processed but could not be stored due to a timeout in the vector database. Please try again."}
+        finally:
+            batches.close()
+            # Cached retrievals predate the stored chunks, even when a later
+            # batch failed
+            if upserted:
+                self.chain.clear_semantic_cache()
+
+        if not chunk_count:
+            return {"success": False, "message": f"Document processing resulted in no chunks for {filename}."}
+        logger.info(f"Successfully added {chunk_count} chunks to vector store, skipped {skipped_count} empty chunks")
+        return {
+            "success": True,
+            "document_id": str(doc_id),
+            "chunk_count": chunk_count,
+            "skipped_chunks": skipped_count
+        }
+
     # YouTube Functions
     async def process_youtube(self, vector_store, url: str, chunk_size: int, 
                              chunk_overlap: int) -> Dict[str, Any]:
@@ -606,31 +771,53 @@ class CosmosConnector:
                 # If there's an error checking, log it but continue processing
                 logger.warning(f"Error checking for existing video {video_id}: {e}")
                 
-            # Extract transcript
-            transcript, video_id = await run_in_threadpool(self.data_extraction.extract_transcript_details, url)
-            
-            if not transcript or transcript.startswith("Error"):
-                return {"success": False, "message": transcript}
-            
-            # Process the transcript
-            chunks, chunk_ids = await run_in_threadpool(
-                self.processing.process_content,
-                content=transcript,
-                source_id=str(video_id),
-                chunk_size=chunk_size,
-                chunk_overlap=chunk_overlap
-            )
+            # Chunk the caption segments natively when available, so every
+            # chunk keeps the time range it covers
+            processed = None
+            if getattr(self.processing, "USE_CPP_TRANSCRIPT", False):
+                segments, video_id = await run_in_threadpool(self.data_extraction.extract_transcript_segments, url)
+                if isinstance(segments, str):
+                    return {"success": False, "message": segments}
+                processed = await run_in_threadpool(
+                    self.processing.process_transcript,
+                    segments=segments,
+                    source_id=str(video_id),
+                    chunk_size=chunk_size,
+                    chunk_overlap=chunk_overlap,
+                    method="words"
+                )
+
+            if processed is not None:
+                chunks, chunk_ids = processed
+            else:
+                # Extract transcript
+                transcript, video_id = await run_in_threadpool(self.data_extraction.extract_transcript_details, url)
+                
+                if not transcript or transcript.startswith("Error"):
+                    return {"success": False, "message": transcript}
+                
+                # Process the transcript
+                chunks, chunk_ids = await run_in_threadpool(
+                    self.processing.process_content,
+                    content=transcript,
+                    source_id=str(video_id),
+                    chunk_size=chunk_size,
+                    chunk_overlap=chunk_overlap,
+                    unit="words"
+                )
             
             if not chunks:
                 return {"success": False, "message": "YouTube processing resulted in no chunks."}
 
             # Add the chunks to the vector store
-            await run_in_threadpool(vector_store.add_documents, chunks, ids=chunk_ids)
+            _, skipped = await run_in_threadpool(self._store_chunks, vector_store, chunks, chunk_ids, str(video_id))
+            self.chain.clear_semantic_cache()
             
             return {
                 "success": True,
                 "video_id": str(video_id),
-                "chunk_count": len(chunks)
+                "chunk_count": len(chunks) - skipped,
+                "skipped_chunks": skipped
             }
         except Exception as e:
             logger.exception(f"Error in process_youtube for {url}: {e}")
@@ -1003,6 +1190,7 @@ class CosmosConnector:
                 source_id=str(url_id),
                 chunk_size=chunk_size,
                 chunk_overlap=chunk_overlap,
+                unit="words",
                 # source_type and source_metadata handled internally by process_content
             )
             
@@ -1010,12 +1198,14 @@ class CosmosConnector:
                 return {"success": False, "message": "URL processing resulted in no chunks."}
 
             # Use the provided vector_store
-            await run_in_threadpool(vector_store.add_documents, chunks, ids=chunk_ids) # Pass chunk_ids
+            _, skipped = await run_in_threadpool(self._store_chunks, vector_store, chunks, chunk_ids, str(url_id))
+            self.chain.clear_semantic_cache()
             
             return {
                 "success": True,
                 "document_id": str(url_id),
-                "chunk_count": len(chunks)
+                "chunk_count": len(chunks) - skipped,
+                "skipped_chunks": skipped
             }
         except Exception as e:
             logger.exception(f"Error in process_url for {url}: {e}")
@@ -1075,7 +1265,8 @@ class CosmosConnector:
                 content=content_with_metadata,
                 source_id=str(doc_id),
                 chunk_size=chunk_size,
-                chunk_overlap=chunk_overlap
+                chunk_overlap=chunk_overlap,
+                unit="words"
             )
             
             # Manually update the metadata for each chunk to ensure source_type is set correctly
@@ -1096,14 +1287,17 @@ class CosmosConnector:
             # Use the provided vector_store with timeout
             try:
                 # Apply timeout to the vector store upsert operation
-                await run_with_timeout(
+                stored, skipped = await run_with_timeout(
                     run_in_threadpool, 
                     settings.PINECONE_UPSERT_TIMEOUT,
-                    vector_store.add_documents, 
+                    self._store_chunks, 
+                    vector_store,
                     chunks, 
-                    ids=chunk_ids
+                    chunk_ids
                 )
-                logger.info(f"Successfully added {len(chunks)} chunks to vector store from image")
+                logger.info(f"Successfully added {stored} new of {len(chunks)} chunks to vector store from image, "
+                            f"skipped {skipped} empty chunks")
+                self.chain.clear_semantic_cache()
             except asyncio.TimeoutError:
                 logger.error(f"Vector store update timed out after {settings.PINECONE_UPSERT_TIMEOUT}s")
                 return {"success": False, "message": "Image was processed but could not be stored due to a timeout in the vector database. Please try again."}
@@ -1111,7 +1305,8 @@ class CosmosConnector:
             return {
                 "success": True,
                 "document_id": str(doc_id),
-                "chunk_count": len(chunks),
+                "chunk_count": len(chunks) - skipped,
+                "skipped_chunks": skipped,
                 "ocr_status": "Completed successfully"
             }
         except Exception as e:
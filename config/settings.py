@@ -20,4 +20,14 @@ DEFAULT_TEMPERATURE = 0.7
 
 # --- Processing Configuration ---
 DEFAULT_CHUNK_SIZE = 300
-DEFAULT_CHUNK_OVERLAP = 50 
\ No newline at end of file
+DEFAULT_CHUNK_OVERLAP = 50 
+
+# --- Semantic Query Cache ---
+# Retrieval results are reused for queries at least SEMANTIC_CACHE_THRESHOLD
+# cosine-similar to a cached one; SEMANTIC_CACHE_SIZE=0 disables the cache.
+# The cache is per process and only this process's ingests clear it, so with
+# several workers a result may cite chunks another worker has since replaced
+# or deleted for up to SEMANTIC_CACHE_TTL seconds.
+SEMANTIC_CACHE_SIZE = int(os.getenv("SEMANTIC_CACHE_SIZE", "1024"))
+SEMANTIC_CACHE_THRESHOLD = float(os.getenv("SEMANTIC_CACHE_THRESHOLD", "0.95"))
+SEMANTIC_CACHE_TTL = float(os.getenv("SEMANTIC_CACHE_TTL", "30"))  # seconds
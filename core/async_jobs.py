@@ -0,0 +1,64 @@
+import asyncio
+
+
+class AsyncJobQueue:
+    """Awaitable wrapper around a native job_queue.JobQueue.
+
+    One loop reader on the queue's completion fd serves every job, so waiting
+    for many concurrent uploads does not tie up a thread per document.
+    Use it from a single event loop.
+    """
+
+    def __init__(self, queue):
+        self.queue = queue
+        self._loop = None
+        self._waiters = {}  # job id -> (job, future)
+
+    def _resolve(self, job, future):
+        if future.done():
+            return
+        try:
+            future.set_result(job.result(timeout=0))
+        except Exception as e:
+            future.set_exception(e)
+
+    def _on_completed(self):
+        for job_id in self.queue.completed_jobs():
+            entry = self._waiters.pop(job_id, None)
+            if entry is not None:
+                self._resolve(*entry)
+
+    async def wait(self, job):
+        """Wait for job without blocking the loop; cancelling the wait cancels the job."""
+        loop = asyncio.get_running_loop()
+        if self._loop is None:
+            self._loop = loop
+            loop.add_reader(self.queue.completion_fd(), self._on_completed)
+
+        future = loop.create_future()
+        self._waiters[job.id] = (job, future)
+        # The job may have finished before its id could be matched
+        if job.done():
+            self._waiters.pop(job.id, None)
+            self._resolve(job, future)
+        try:
+            return await future
+        except asyncio.CancelledError:
+            self._waiters.pop(job.id, None)
+            job.cancel()
+            raise
+
+    async def submit(self, method, *args, **kwargs):
+        """Submit with queue.<method>(*args, **kwargs) and wait for the result.
+
+        A full queue raises QueueFullError straight away instead of
+        blocking the loop, unless a timeout is passed explicitly.
+        """
+        kwargs.setdefault("timeout", 0)
+        job = getattr(self.queue, method)(*args, **kwargs)
+        return await self.wait(job)
+
+    def close(self):
+        if self._loop is not None:
+            self._loop.remove_reader(self.queue.completion_fd())
+            self._loop = None
@@ -1,9 +1,21 @@
 from langchain_groq import ChatGroq
 from langchain.prompts import ChatPromptTemplate
 from langchain_core.output_parsers import StrOutputParser
+from langchain_core.documents import Document
+import json
+import threading
 import config.settings as settings
 import config.prompts as prompts
 
+try:
+    from core.cpp_modules import vector_index
+    USE_SEMANTIC_CACHE = hasattr(vector_index, "SemanticCache")
+except ImportError:
+    USE_SEMANTIC_CACHE = False
+
+_semantic_cache = None
+_semantic_cache_lock = threading.Lock()
+
 def get_chain(model_name=None, temperature=None):
     """
     Creates a RAG chain with the specified model and temperature, using defaults from settings if not provided.
@@ -60,6 +72,69 @@ def get_streaming_chain(model_name=None, temperature=None):
     # Note: we don't add StrOutputParser for streaming as it's handled differently
     return chain
 
+def get_semantic_cache(dim):
+    """
+    Returns the process-wide semantic query cache for dim-dimensional query
+    embeddings, or None when it is disabled or the native module is missing.
+    """
+    global _semantic_cache
+    if not USE_SEMANTIC_CACHE or settings.SEMANTIC_CACHE_SIZE <= 0:
+        return None
+    with _semantic_cache_lock:
+        # A different embedding model invalidates every cached query
+        if _semantic_cache is None or _semantic_cache.dim != dim:
+            _semantic_cache = vector_index.SemanticCache(
+                dim,
+                max_entries=settings.SEMANTIC_CACHE_SIZE,
+                threshold=settings.SEMANTIC_CACHE_THRESHOLD,
+                ttl=settings.SEMANTIC_CACHE_TTL,
+            )
+        return _semantic_cache
+
+def clear_semantic_cache():
+    """
+    Drops every cached retrieval result, e.g. after the indexed content changed.
+    Only this process's cache is cleared: other workers keep their results
+    until SEMANTIC_CACHE_TTL expires them.
+    """
+    with _semantic_cache_lock:
+        if _semantic_cache is not None:
+            _semantic_cache.clear()
+
+def retrieve_documents(vector_store, query, search_kwargs=None):
+    """
+    Retrieves the documents relevant to query, reusing the result of an earlier
+    query that is semantically the same when the semantic cache has one. A
+    cached result is at most SEMANTIC_CACHE_TTL seconds old and may include
+    chunks another worker removed in that time.
+
+    Args:
+        vector_store: A LangChain vector store (Pinecone or LocalVectorStore).
+        query: The user's question.
+        search_kwargs: Arguments of similarity_search_by_vector such as k and
+                       filter. Only queries with equal arguments share results.
+
+    Returns:
+        A list of Documents, as retriever.invoke(query) would return.
+    """
+    search_kwargs = dict(search_kwargs or {})
+    embedding = vector_store.embeddings.embed_query(query)
+    cache = get_semantic_cache(len(embedding))
+    if cache is None:
+        return vector_store.similarity_search_by_vector(embedding, **search_kwargs)
+
+    scope = json.dumps(search_kwargs, sort_keys=True, default=str)
+    hit = cache.lookup(embedding, scope=scope)
+    if hit is not None:
+        return [Document(page_content=entry["page_content"], metadata=entry["metadata"])
+                for entry in json.loads(hit.payload)]
+
+    docs = vector_store.similarity_search_by_vector(embedding, **search_kwargs)
+    payload = json.dumps([{"page_content": doc.page_content, "metadata": doc.metadata} for doc in docs],
+                         default=str)
+    cache.insert(embedding, [getattr(doc, "id", None) or "" for doc in docs], payload, scope=scope)
+    return docs
+
 def ask_question(chain, question, context, conversation_history: list = None):
     """
     Generate a response using the provided chain, context, and history.
@@ -9,21 +9,39 @@ sys.path.append(__dir__)
 # Define what's available for import
 __all__ = []
 
-# Try to import the C++ modules
-try:
-    import text_chunker
-    __all__.append('text_chunker')
-except ImportError:
-    print("C++ text_chunker module not found. Using Python implementation.")
+_MODULES = ('text_chunker', 'pdf_extractor', 'hash_generator', 'job_queue', 'vector_index')
 
+# Prefer the combined extension; its submodules are registered under the old
+# module names so `import text_chunker` and `from core.cpp_modules import
+# text_chunker` keep working
 try:
-    import pdf_extractor
-    __all__.append('pdf_extractor')
+    import _cosmos_native
 except ImportError:
-    print("C++ pdf_extractor module not found. Using Python implementation.")
+    _cosmos_native = None
 
-try:
-    import hash_generator
-    __all__.append('hash_generator')
-except ImportError:
-    print("C++ hash_generator module not found. Using Python implementation.") 
\ No newline at end of file
+if _cosmos_native is not None:
+    for _name in _MODULES:
+        _module = getattr(_cosmos_native, _name)
+        globals()[_name] = _module
+        sys.modules[_name] = _module
+        sys.modules[f"{__name__}.{_name}"] = _module
+        __all__.append(_name)
+else:
+    # Fall back to separately built modules
+    try:
+        import text_chunker
+        __all__.append('text_chunker')
+    except ImportError:
+        print("C++ text_chunker module not found. Using Python implementation.")
+
+    try:
+        import pdf_extractor
+        __all__.append('pdf_extractor')
+    except ImportError:
+        print("C++ pdf_extractor module not found. Using Python implementation.")
+
+    try:
+        import hash_generator
+        __all__.append('hash_generator')
+    except ImportError:
+        print("C++ hash_generator module not found. Using Python implementation.")
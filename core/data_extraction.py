@@ -2,6 +2,7 @@ import fitz
 from newspaper import Article
 from time import sleep
 import hashlib
+import io
 from youtube_transcript_api import YouTubeTranscriptApi
 from youtube_transcript_api.proxies import WebshareProxyConfig
 import os
@@ -24,14 +25,37 @@ except ImportError:
     USE_CPP_PDF = False
     print("C++ PDF extractor not available, using Python implementation")
 
+try:
+    from core.cpp_modules import text_chunker
+    USE_CPP_TRANSCRIPT = hasattr(text_chunker, "split_transcript")
+except ImportError:
+    USE_CPP_TRANSCRIPT = False
+
+def compute_document_hash(file_content):
+    """SHA-256 hex digest of a document's bytes, its source_id."""
+    if USE_CPP_HASH:
+        # Use C++ implementation just for hashing
+        return hash_generator.compute_sha256(file_content)
+    # Pure Python implementation for hashing
+    return hashlib.sha256(file_content).hexdigest()
+
 def extract_text_from_pdf(file):
     try:
+        if USE_CPP_PDF and isinstance(file, (io.BufferedReader, io.FileIO)):
+            # Files on disk are memory-mapped by the C++ extractor instead of
+            # being read into Python memory first
+            try:
+                return pdf_extractor.extract_pdf_text_and_hash_fd(file.fileno(), num_threads=0)
+            except Exception as e:
+                print(f"C++ PDF extraction from file failed, falling back to reading it: {e}")
+
         file_content = file.read()
         
         if USE_CPP_PDF:
-            # Use C++ implementation for PDF extraction and hashing
+            # Use C++ implementation for PDF extraction and hashing; large
+            # documents are split into page ranges extracted on all cores
             try:
-                text, pdf_hash = pdf_extractor.extract_pdf_text_and_hash(file_content)
+                text, pdf_hash = pdf_extractor.extract_pdf_text_and_hash(file_content, num_threads=0)
                 return text, pdf_hash
             except Exception as e:
                 print(f"C++ PDF extraction failed, falling back to Python: {e}")
@@ -40,12 +64,7 @@ def extract_text_from_pdf(file):
                 file_content = file.read()
         
         # Python implementation
-        if USE_CPP_HASH:
-            # Use C++ implementation just for hashing
-            pdf_hash = hash_generator.compute_sha256(file_content)
-        else:
-            # Pure Python implementation for hashing
-            pdf_hash = hashlib.sha256(file_content).hexdigest()
+        pdf_hash = compute_document_hash(file_content)
             
         # Use Python implementation for PDF extraction
         pdf_document = fitz.open("pdf", file_content)
@@ -58,6 +77,31 @@ def extract_text_from_pdf(file):
     except Exception as e:
         return f"Error reading PDF: {e}", None
 
+def iter_pdf_pages(file):
+    """Yield (page_number, text) for each page of a PDF, one page at a time.
+
+    Unlike extract_text_from_pdf, the whole document's text is never held in
+    memory, so callers can chunk and embed pages as they arrive.
+    """
+    file_content = file.read()
+
+    if USE_CPP_PDF:
+        try:
+            pages = pdf_extractor.iter_pdf_pages(file_content)
+        except Exception as e:
+            print(f"C++ PDF page iteration failed, falling back to Python: {e}")
+        else:
+            yield from pages
+            return
+
+    # Python implementation
+    pdf_document = fitz.open("pdf", file_content)
+    try:
+        for page_number in range(pdf_document.page_count):
+            yield page_number + 1, pdf_document[page_number].get_text()
+    finally:
+        pdf_document.close()
+
 def extract_text_from_url(url, retries=3):
     for attempt in range(retries):
         try:
@@ -75,38 +119,48 @@ def extract_text_from_url(url, retries=3):
                 continue
             return f"Error processing URL after {retries} attempts: {e}", None
 
+def _youtube_video_id(youtube_video_url):
+    if "v=" in youtube_video_url:
+        return youtube_video_url.split("v=")[1].split("&")[0]
+    if "youtu.be/" in youtube_video_url:
+        return youtube_video_url.split("youtu.be/")[1].split("?")[0]
+    return None
+
+def _fetch_transcript(video_id):
+    # Get Webshare credentials from environment variables
+    proxy_username = os.environ.get("WEBSHARE_USERNAME")
+    proxy_password = os.environ.get("WEBSHARE_PASSWORD")
+    
+    if proxy_username and proxy_password:
+        # Use Webshare's dedicated integration with retries
+        @retry(stop=stop_after_attempt(3), wait=wait_fixed(2))
+        def fetch_with_retry():
+            proxy_config = WebshareProxyConfig(
+                proxy_username=proxy_username,
+                proxy_password=proxy_password
+            )
+            ytt_api = YouTubeTranscriptApi(proxy_config=proxy_config)
+            return ytt_api.fetch(video_id)
+        
+        return fetch_with_retry()
+
+    # Fall back to direct connection (might fail on Heroku)
+    ytt_api = YouTubeTranscriptApi()
+    return ytt_api.fetch(video_id)
+
 def extract_transcript_details(youtube_video_url):
     try:
-        if "v=" in youtube_video_url:
-            video_id = youtube_video_url.split("v=")[1].split("&")[0]
-        elif "youtu.be/" in youtube_video_url:
-            video_id = youtube_video_url.split("youtu.be/")[1].split("?")[0]
-        else:
+        video_id = _youtube_video_id(youtube_video_url)
+        if not video_id:
             return "Error: Invalid YouTube URL format.", None
 
-        # Get Webshare credentials from environment variables
-        proxy_username = os.environ.get("WEBSHARE_USERNAME")
-        proxy_password = os.environ.get("WEBSHARE_PASSWORD")
-        
-        if proxy_username and proxy_password:
-            # Use Webshare's dedicated integration with retries
-            @retry(stop=stop_after_attempt(3), wait=wait_fixed(2))
-            def fetch_with_retry():
-                proxy_config = WebshareProxyConfig(
-                    proxy_username=proxy_username,
-                    proxy_password=proxy_password
-                )
-                ytt_api = YouTubeTranscriptApi(proxy_config=proxy_config)
-                return ytt_api.fetch(video_id)
-            
-            transcript_list = fetch_with_retry()
-        else:
-            # Fall back to direct connection (might fail on Heroku)
-            ytt_api = YouTubeTranscriptApi()
-            transcript_list = ytt_api.fetch(video_id)
+        transcript_list = _fetch_transcript(video_id)
 
         # The returned object is a FetchedTranscript, convert to the format expected by the rest of the code
-        transcript = " ".join([snippet.text for snippet in transcript_list])
+        if USE_CPP_TRANSCRIPT:
+            transcript = text_chunker.normalize_transcript([snippet.text for snippet in transcript_list])
+        else:
+            transcript = " ".join([snippet.text for snippet in transcript_list])
 
         if not transcript:
             return "Error: Could not retrieve transcript (may be disabled for this video).", f"youtube_{video_id}"
@@ -115,6 +169,34 @@ def extract_transcript_details(youtube_video_url):
 
     except Exception as e:
         video_id_on_error = None
-        if 'video_id' in locals():
+        if 'video_id' in locals() and video_id:
+            video_id_on_error = f"youtube_{video_id}"
+        return f"Error retrieving transcript: {e}", video_id_on_error
+
+# Like extract_transcript_details, but keeps the caption segments so chunks
+# can carry timestamps: returns ((texts, starts, durations), source_id), or
+# an error string in place of the segments.
+def extract_transcript_segments(youtube_video_url):
+    try:
+        video_id = _youtube_video_id(youtube_video_url)
+        if not video_id:
+            return "Error: Invalid YouTube URL format.", None
+
+        transcript_list = _fetch_transcript(video_id)
+
+        texts, starts, durations = [], [], []
+        for snippet in transcript_list:
+            texts.append(snippet.text)
+            starts.append(snippet.start)
+            durations.append(snippet.duration)
+
+        if not texts:
+            return "Error: Could not retrieve transcript (may be disabled for this video).", f"youtube_{video_id}"
+
+        return (texts, starts, durations), f"youtube_{video_id}"
+
+    except Exception as e:
+        video_id_on_error = None
+        if 'video_id' in locals() and video_id:
             video_id_on_error = f"youtube_{video_id}"
-        return f"Error retrieving transcript: {e}", video_id_on_error
\ No newline at end of file
+        return f"Error retrieving transcript: {e}", video_id_on_error
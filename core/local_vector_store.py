@@ -0,0 +1,197 @@
+import atexit
+import json
+import logging
+import os
+import tempfile
+import threading
+import uuid
+
+import numpy as np
+from langchain_core.documents import Document
+from langchain_core.vectorstores import VectorStore
+
+from core.cpp_modules import vector_index
+
+logger = logging.getLogger(__name__)
+
+INDEX_FILE = "index.cvix"
+DOCUMENTS_FILE = "documents.json"
+
+
+def _matches(metadata, filter):
+    """Pinecone-style metadata filter: plain values, {"$eq": v} and {"$in": [...]}."""
+    for key, condition in filter.items():
+        value = metadata.get(key)
+        if isinstance(condition, dict):
+            if "$eq" in condition and value != condition["$eq"]:
+                return False
+            if "$in" in condition and value not in condition["$in"]:
+                return False
+        elif value != condition:
+            return False
+    return True
+
+
+class LocalVectorStore(VectorStore):
+    """LangChain vector store over the native vector_index module.
+
+    Stands in for Pinecone in development and offline mode: vectors live in
+    a float16 (or int8) index in process memory, and documents in a dict
+    keyed by the same ids. With a path, save() writes both next to each other
+    and the constructor maps an existing index back in; unless autosave is
+    off, changes are saved at most every save_interval seconds and at exit.
+    Once removed and replaced vectors make up compact_ratio of the index,
+    it is compacted. Safe to share between threads.
+    """
+
+    def __init__(self, embedding, path=None, dim=3072, dtype="float16", autosave=True,
+                 save_interval=5.0, compact_ratio=0.25):
+        self._embedding = embedding
+        self.path = path
+        self.autosave = autosave
+        self.save_interval = save_interval
+        self.compact_ratio = compact_ratio
+        self._documents = {}
+        # Guards index and document changes and saves; searches read without it
+        self._lock = threading.Lock()
+        self._dirty = False
+        self._save_timer = None
+        if path and os.path.exists(os.path.join(path, INDEX_FILE)):
+            self.index = vector_index.VectorIndex.load(os.path.join(path, INDEX_FILE))
+            with open(os.path.join(path, DOCUMENTS_FILE), encoding="utf-8") as f:
+                for doc_id, entry in json.load(f).items():
+                    self._documents[doc_id] = Document(page_content=entry["page_content"],
+                                                       metadata=entry["metadata"])
+            logger.info(f"Loaded {len(self.index)} vectors from local vector store {path}")
+        else:
+            self.index = vector_index.VectorIndex(dim, dtype=dtype)
+        if autosave and path:
+            atexit.register(self.flush)
+
+    @property
+    def embeddings(self):
+        return self._embedding
+
+    def add_texts(self, texts, metadatas=None, *, ids=None, **kwargs):
+        texts = list(texts)
+        if not texts:
+            return []
+        ids = list(ids) if ids else [str(uuid.uuid4()) for _ in texts]
+        metadatas = metadatas or [{} for _ in texts]
+        vectors = np.asarray(self._embedding.embed_documents(texts), dtype=np.float32)
+        with self._lock:
+            self.index.add(ids, vectors)
+            for doc_id, text, metadata in zip(ids, texts, metadatas):
+                self._documents[doc_id] = Document(page_content=text, metadata=dict(metadata))
+            self._changed()
+        return ids
+
+    def delete(self, ids=None, **kwargs):
+        with self._lock:
+            for doc_id in ids or []:
+                self.index.remove(doc_id)
+                self._documents.pop(doc_id, None)
+            self._changed()
+        return True
+
+    def ids(self, filter=None):
+        """IDs of the stored documents whose metadata matches filter."""
+        with self._lock:
+            return [doc_id for doc_id, doc in self._documents.items()
+                    if not filter or _matches(doc.metadata, filter)]
+
+    def similarity_search_by_vector_with_score(self, embedding, k=4, filter=None, mode="auto", **kwargs):
+        query = np.asarray(embedding, dtype=np.float32)
+        # A metadata filter is applied after scoring, so it scans every vector
+        if filter:
+            fetch, mode = len(self.index), "brute_force"
+        else:
+            fetch = k
+        results = []
+        for doc_id, score in self.index.search(query, k=fetch, mode=mode):
+            doc = self._documents.get(doc_id)
+            if doc is None:
+                continue
+            if filter and not _matches(doc.metadata, filter):
+                continue
+            results.append((doc, score))
+            if len(results) == k:
+                break
+        return results
+
+    def similarity_search_with_score(self, query, k=4, filter=None, **kwargs):
+        return self.similarity_search_by_vector_with_score(
+            self._embedding.embed_query(query), k=k, filter=filter, **kwargs)
+
+    def similarity_search_by_vector(self, embedding, k=4, filter=None, **kwargs):
+        return [doc for doc, _ in self.similarity_search_by_vector_with_score(embedding, k, filter, **kwargs)]
+
+    def similarity_search(self, query, k=4, filter=None, **kwargs):
+        return [doc for doc, _ in self.similarity_search_with_score(query, k, filter, **kwargs)]
+
+    def _select_relevance_score_fn(self):
+        # Scores are cosine similarities already
+        return lambda score: score
+
+    def _changed(self):
+        # Caller holds _lock
+        removed = self.index.removed
+        if removed and removed >= self.compact_ratio * (len(self.index) + removed):
+            self.index.compact()
+        self._dirty = True
+        if self.autosave and self.path and self._save_timer is None:
+            # One save covers every change until it runs, so streaming
+            # ingests do not rewrite the whole store per batch
+            self._save_timer = threading.Timer(self.save_interval, self.flush)
+            self._save_timer.daemon = True
+            self._save_timer.start()
+
+    def flush(self):
+        """Save the store to its path if it changed since the last save."""
+        with self._lock:
+            if self._save_timer is not None:
+                self._save_timer.cancel()
+                self._save_timer = None
+            if self._dirty and self.path:
+                self._save(self.path)
+
+    def save(self, path=None):
+        path = path or self.path
+        if not path:
+            raise ValueError("No path to save the local vector store to")
+        with self._lock:
+            self._save(path)
+
+    def _save(self, path):
+        # Caller holds _lock, so the index and documents match
+        os.makedirs(path, exist_ok=True)
+        index_temp = self._temp_file(path)
+        try:
+            self.index.save(index_temp)
+            documents = {doc_id: {"page_content": doc.page_content, "metadata": doc.metadata}
+                         for doc_id, doc in self._documents.items()}
+            documents_temp = self._temp_file(path)
+            try:
+                with open(documents_temp, "w", encoding="utf-8") as f:
+                    json.dump(documents, f)
+                os.replace(index_temp, os.path.join(path, INDEX_FILE))
+                os.replace(documents_temp, os.path.join(path, DOCUMENTS_FILE))
+            finally:
+                if os.path.exists(documents_temp):
+                    os.remove(documents_temp)
+        finally:
+            if os.path.exists(index_temp):
+                os.remove(index_temp)
+        if path == self.path:
+            self._dirty = False
+
+    @staticmethod
+    def _temp_file(directory):
+        with tempfile.NamedTemporaryFile(dir=directory, suffix=".tmp", delete=False) as f:
+            return f.name
+
+    @classmethod
+    def from_texts(cls, texts, embedding, metadatas=None, *, ids=None, path=None, **kwargs):
+        store = cls(embedding, path=path, **kwargs)
+        store.add_texts(texts, metadatas, ids=ids)
+        return store
@@ -1,3 +1,5 @@
+import hashlib
+import re
 import time
 from urllib.parse import urlparse
 from langchain.text_splitter import RecursiveCharacterTextSplitter
@@ -7,13 +9,54 @@ from langchain.schema import Document
 try:
     from core.cpp_modules import text_chunker
     USE_CPP_CHUNKER = True
+    USE_CPP_CHUNK_ARCHIVE = hasattr(text_chunker, "ChunkArchive")
+    USE_CPP_TRANSCRIPT = hasattr(text_chunker, "split_transcript")
     print("Using C++ text chunker for improved performance")
 except ImportError:
     USE_CPP_CHUNKER = False
+    USE_CPP_CHUNK_ARCHIVE = False
+    USE_CPP_TRANSCRIPT = False
     print("C++ text chunker not available, using Python implementation")
 
-# Function to split content into chunks and add metadata/IDs
-def process_content(content, chunk_size, chunk_overlap, source_id):
+try:
+    from core.cpp_modules import hash_generator
+    USE_CPP_CHUNK_HASH = hasattr(hash_generator, "hash_chunks")
+except ImportError:
+    USE_CPP_CHUNK_HASH = False
+
+try:
+    from core.cpp_modules import pdf_extractor
+    USE_CPP_PDF_PIPELINE = hasattr(pdf_extractor, "extract_pdf_chunks")
+except ImportError:
+    USE_CPP_PDF_PIPELINE = False
+
+try:
+    from core.cpp_modules import job_queue
+    USE_CPP_JOB_QUEUE = True
+except ImportError:
+    USE_CPP_JOB_QUEUE = False
+
+# content_hash of each chunk text: SHA-256 of its UTF-8 bytes on every path,
+# the hash the native PDF pipeline stores, so a chunk's ID does not depend on
+# which path chunked it.
+def content_hashes(texts):
+    if USE_CPP_CHUNK_HASH:
+        return hash_generator.hash_chunks(texts, algorithm="sha256")
+    return [hashlib.sha256(text.encode("utf-8")).hexdigest() for text in texts]
+
+# Pinecone ID of a chunk: the source and the chunk's content_hash, so an
+# unchanged chunk keeps its ID when text is inserted or removed before it and
+# filter_new_chunks can skip it. Chunks without a content hash fall back to
+# their position in the source.
+def chunk_id(source_id, metadata):
+    content_hash = metadata.get("content_hash")
+    if content_hash:
+        return f"{source_id}_{content_hash}"
+    return f"{source_id}_{metadata['chunk_sequence']}"
+
+# Function to split content into chunks and add metadata/IDs. unit is what
+# chunk_size and chunk_overlap count, "chars" or "words" (see _split_text).
+def process_content(content, chunk_size, chunk_overlap, source_id, document_hash=None, unit="chars"):
     if not source_id:  # Don't process if we don't have a source identifier
         return [], []
 
@@ -35,6 +78,8 @@ def process_content(content, chunk_size, chunk_overlap, source_id):
         "title": "Untitled Document",
         "ingestion_timestamp": time.time(),  # timestamp for potential sorting/filtering later
     }
+    if document_hash:
+        source_metadata["document_hash"] = document_hash
     
     # Set source_type and specific metadata based on source_id pattern
     if source_id.startswith("youtube_"):
@@ -78,32 +123,11 @@ def process_content(content, chunk_size, chunk_overlap, source_id):
 
     base_document = Document(page_content=content, metadata=source_metadata)
 
-    # Use the C++ chunker if available, otherwise fall back to Python
-    if USE_CPP_CHUNKER:
-        try:
-            # Ensure content is treated as a string.
-            content_str = str(content)
-
-            # Use C++ implementation for text chunking
-            raw_chunks = text_chunker.split_text_with_word_count(content_str, chunk_size, chunk_overlap)
-
-            # Create Document objects with metadata
-            split_chunks = []
-            for chunk_text in raw_chunks:
-                doc = Document(
-                    page_content=chunk_text,
-                    metadata=base_document.metadata.copy() # Use metadata from base_document
-                )
-                split_chunks.append(doc)
-        except Exception as e:
-            print(f"C++ text chunking failed, falling back to Python: {e}")
-            # Fall back to Python implementation on error
-            text_splitter = RecursiveCharacterTextSplitter(chunk_size=chunk_size, chunk_overlap=chunk_overlap)
-            split_chunks = text_splitter.split_documents([base_document])
-    else:
-        # Use the original Python implementation
-        text_splitter = RecursiveCharacterTextSplitter(chunk_size=chunk_size, chunk_overlap=chunk_overlap)
-        split_chunks = text_splitter.split_documents([base_document])
+    split_chunks = [Document(page_content=chunk_text, metadata=base_document.metadata.copy())
+                    for chunk_text in _split_text(str(content), chunk_size, chunk_overlap, unit)]
+
+    # Content hashes let re-ingestion skip chunks that are already embedded
+    hashes = content_hashes([chunk.page_content for chunk in split_chunks])
 
     # Process each chunk: add sequence info and generate final Pinecone IDs
     chunk_ids = []
@@ -112,15 +136,270 @@ def process_content(content, chunk_size, chunk_overlap, source_id):
     for i, chunk in enumerate(split_chunks):
         chunk.metadata["chunk_sequence"] = i
         chunk.metadata["chunk_total"] = len(split_chunks)
+        chunk.metadata["content_hash"] = hashes[i]
         
         # Augment citation text with chunk info for more precise referencing
         if "citation_text" in chunk.metadata:
             # Keep original citation, but add sequence info to a separate field for backend use
             chunk.metadata["citation_text_full"] = f"{chunk.metadata['citation_text']} (section {i+1} of {len(split_chunks)})"
         
-        # Create a unique ID for Pinecone upsert (source + chunk index)
-        pinecone_id = f"{source_id}_{i}"
-        chunk_ids.append(pinecone_id)
+        # Create a unique ID for Pinecone upsert (source + content hash)
+        chunk_ids.append(chunk_id(source_id, chunk.metadata))
         processed_chunks.append(chunk)
 
-    return processed_chunks, chunk_ids
\ No newline at end of file
+    return processed_chunks, chunk_ids
+
+def _pdf_metadata(source_id, pdf_hash):
+    short_id = source_id[:8] + "..."
+    return {
+        "source_id": source_id,
+        "document_hash": pdf_hash,
+        "source_type": "pdf",
+        "title": f"PDF Document (ID: {short_id})",
+        "ingestion_timestamp": time.time(),
+        "citation_text": f"PDF document ({short_id})",
+        "display_name": "PDF document"
+    }
+
+# Extract, chunk and hash a PDF in a single native call. Chunks never span
+# pages, so every chunk's citation can point at the page it came from. unit
+# is "chars" or "words", as for process_content.
+# source_id defaults to the PDF's hash, the SHA-256 of its bytes. Returns
+# (processed_chunks, chunk_ids, source_id), or None when the native pipeline
+# is unavailable or fails so the caller can use extract + process_content.
+def process_pdf_content(file_content, chunk_size, chunk_overlap, source_id=None, unit="chars"):
+    if not USE_CPP_PDF_PIPELINE:
+        return None
+
+    try:
+        pdf_hash, native_chunks = pdf_extractor.extract_pdf_chunks(
+            file_content, chunk_size, chunk_overlap, method=_native_method(unit), num_threads=0)
+    except Exception as e:
+        print(f"C++ PDF pipeline failed, falling back to extract + chunk: {e}")
+        return None
+
+    return _pdf_chunk_documents(pdf_hash, native_chunks, source_id)
+
+
+# process_pdf_content as a job on jobs, a core.async_jobs.AsyncJobQueue: the
+# PDF is extracted on the native pool while the event loop serves other
+# requests, without holding a threadpool thread. Raises
+# job_queue.QueueFullError straight away when the queue is full; returns
+# None when the pipeline fails, like process_pdf_content.
+async def process_pdf_content_async(jobs, file_content, chunk_size, chunk_overlap, source_id=None, unit="chars"):
+    try:
+        pdf_hash, native_chunks = await jobs.submit(
+            "submit_pdf_chunks", file_content, chunk_size, chunk_overlap, method=_native_method(unit))
+    except job_queue.QueueFullError:
+        raise
+    except Exception as e:
+        print(f"C++ PDF pipeline job failed, falling back to extract + chunk: {e}")
+        return None
+
+    return _pdf_chunk_documents(pdf_hash, native_chunks, source_id)
+
+
+def _pdf_chunk_documents(pdf_hash, native_chunks, source_id):
+    source_id = source_id or pdf_hash
+    source_metadata = _pdf_metadata(source_id, pdf_hash)
+
+    chunk_ids = []
+    processed_chunks = []
+    for i, native_chunk in enumerate(native_chunks):
+        metadata = source_metadata.copy()
+        metadata["chunk_sequence"] = i
+        metadata["chunk_total"] = len(native_chunks)
+        metadata["page_number"] = native_chunk.page_number
+        metadata["content_hash"] = native_chunk.content_hash
+        metadata["citation_text_full"] = f"{metadata['citation_text']} (page {native_chunk.page_number}, section {i+1} of {len(native_chunks)})"
+
+        processed_chunks.append(Document(page_content=native_chunk.text, metadata=metadata))
+        chunk_ids.append(chunk_id(source_id, metadata))
+
+    return processed_chunks, chunk_ids, source_id
+
+
+def _native_method(unit):
+    if unit == "words":
+        return "words"
+    if unit == "chars":
+        return "recursive"
+    raise ValueError(f"Unknown chunk size unit: {unit}")
+
+# Whitespace-delimited words, as the native word chunker finds them
+_WORD = re.compile(r"[^ \t\n\v\f\r]+")
+
+# Python version of text_chunker.split_text_with_word_count: chunks of
+# chunk_size words starting every chunk_size - chunk_overlap words, each
+# running from its first word's start to its last word's end.
+def _split_words(text, chunk_size, chunk_overlap):
+    words = [(m.start(), m.end()) for m in _WORD.finditer(text)]
+    step = chunk_size - chunk_overlap
+    chunks = []
+    for first in range(0, len(words), step):
+        last = min(first + chunk_size, len(words)) - 1
+        chunks.append(text[words[first][0]:words[last][1]])
+        if last == len(words) - 1:
+            break
+    return chunks
+
+# Split text into chunks of chunk_size characters (recursively, on the
+# LangChain separators) or words, natively when available.
+def _split_text(text, chunk_size, chunk_overlap, unit="chars"):
+    method = _native_method(unit)
+    if USE_CPP_CHUNKER:
+        try:
+            if method == "words":
+                return text_chunker.split_text_with_word_count(text, chunk_size, chunk_overlap)
+            return text_chunker.split_text_recursive(text, chunk_size, chunk_overlap)
+        except Exception as e:
+            print(f"C++ text chunking failed, falling back to Python: {e}")
+    if method == "words":
+        return _split_words(text, chunk_size, chunk_overlap)
+    text_splitter = RecursiveCharacterTextSplitter(chunk_size=chunk_size, chunk_overlap=chunk_overlap)
+    return text_splitter.split_text(text)
+
+# Chunk the (page_number, text) pages of data_extraction.iter_pdf_pages as
+# they are extracted and yield them in batches of about batch_size chunks, so
+# a large PDF's first chunks can be stored while later pages are still being
+# read and its whole text is never in memory. Chunks never span pages and
+# carry their page_number like process_pdf_content's; chunk_total is unknown
+# until the last page and left out. pdf_hash is stored as document_hash.
+# unit is "chars" or "words", as for process_content. Yields
+# (processed_chunks, chunk_ids).
+def iter_pdf_page_chunks(pages, source_id, pdf_hash, chunk_size, chunk_overlap, batch_size=100, unit="chars"):
+    source_metadata = _pdf_metadata(source_id, pdf_hash)
+    sequence = 0
+    processed_chunks = []
+    for page_number, page_text in pages:
+        for chunk_text in _split_text(page_text, chunk_size, chunk_overlap, unit):
+            metadata = source_metadata.copy()
+            metadata["chunk_sequence"] = sequence
+            metadata["page_number"] = page_number
+            metadata["citation_text_full"] = f"{metadata['citation_text']} (page {page_number}, section {sequence+1})"
+            processed_chunks.append(Document(page_content=chunk_text, metadata=metadata))
+            sequence += 1
+
+        if len(processed_chunks) >= batch_size:
+            _add_content_hashes(processed_chunks)
+            yield processed_chunks, [chunk_id(source_id, chunk.metadata) for chunk in processed_chunks]
+            processed_chunks = []
+
+    if processed_chunks:
+        _add_content_hashes(processed_chunks)
+        yield processed_chunks, [chunk_id(source_id, chunk.metadata) for chunk in processed_chunks]
+
+
+def _add_content_hashes(chunks):
+    for chunk, content_hash in zip(chunks, content_hashes([chunk.page_content for chunk in chunks])):
+        chunk.metadata["content_hash"] = content_hash
+
+
+def _format_timestamp(seconds):
+    minutes, seconds = divmod(int(seconds), 60)
+    hours, minutes = divmod(minutes, 60)
+    if hours:
+        return f"{hours}:{minutes:02d}:{seconds:02d}"
+    return f"{minutes}:{seconds:02d}"
+
+# Normalize and chunk YouTube caption segments in a single native call.
+# segments is the (texts, starts, durations) of
+# data_extraction.extract_transcript_segments; every chunk keeps the time
+# range it covers so its citation can link to that moment of the video.
+# method is a text_chunker.split_transcript method; "recursive" and "words"
+# count like process_content's "chars" and "words" units. Returns (processed_chunks, chunk_ids), or
+# None when the native chunker is unavailable so the caller can use
+# extract_transcript_details + process_content.
+def process_transcript(segments, chunk_size, chunk_overlap, source_id, method="recursive"):
+    if not USE_CPP_TRANSCRIPT or not source_id:
+        return None
+
+    texts, starts, durations = segments
+    native_chunks = text_chunker.split_transcript(
+        texts, starts, durations, chunk_size, chunk_overlap, method=method)
+
+    video_id = source_id.replace("youtube_", "")
+    source_metadata = {
+        "source_id": source_id,
+        "source_type": "youtube",
+        "title": f"YouTube Video: {video_id}",
+        "ingestion_timestamp": time.time(),
+        "url": f"https://www.youtube.com/watch?v={video_id}",
+        "citation_text": f"YouTube video ({video_id})",
+        "display_name": "YouTube"
+    }
+
+    chunk_texts = native_chunks.tolist()
+    hashes = content_hashes(chunk_texts)
+
+    chunk_ids = []
+    processed_chunks = []
+    for i, (chunk_text, start, end) in enumerate(zip(chunk_texts, native_chunks.starts.tolist(),
+                                                     native_chunks.ends.tolist())):
+        metadata = source_metadata.copy()
+        metadata["chunk_sequence"] = i
+        metadata["chunk_total"] = len(chunk_texts)
+        metadata["start_time"] = start
+        metadata["end_time"] = end
+        metadata["timestamp_url"] = f"{source_metadata['url']}&t={int(start)}s"
+        metadata["content_hash"] = hashes[i]
+        metadata["citation_text_full"] = (f"{metadata['citation_text']} ({_format_timestamp(start)}-"
+                                          f"{_format_timestamp(end)}, section {i+1} of {len(chunk_texts)})")
+
+        processed_chunks.append(Document(page_content=chunk_text, metadata=metadata))
+        chunk_ids.append(chunk_id(source_id, metadata))
+
+    return processed_chunks, chunk_ids
+
+
+# Drop chunks already stored under their ID according to chunk_index (a
+# hash_generator.ChunkHashIndex of chunk IDs), so only new chunks are
+# embedded and upserted. Since IDs include content_hash and source_id, a
+# chunk counts as stored only for its own source and unchanged content.
+# The index is only a cache: with stored, a callable taking a list of IDs
+# and returning those the vector store really holds (see
+# vector_store.stored_chunk_ids), the IDs it knows are checked first, and
+# any the store lacks are forgotten and kept as new. Repeats of one chunk
+# within chunks are dropped too. Only chunks whose exact text and source
+# were stored are skipped: after an edit, fixed-size windows shift and
+# everything past it is new (see cpp_extensions/README.md). Nothing is
+# recorded: call mark_chunks_stored once the upsert succeeded. Returns
+# (new_chunks, new_chunk_ids).
+def filter_new_chunks(chunks, chunk_ids, chunk_index, stored=None):
+    known, new_indices = chunk_index.partition(chunk_ids, add=False)
+    if known and stored is not None:
+        present = stored([chunk_ids[i] for i in known])
+        missing = [i for i in known if chunk_ids[i] not in present]
+        if missing:
+            chunk_index.remove([chunk_ids[i] for i in missing])
+            new_indices = sorted(list(new_indices) + missing)
+    seen = set()
+    new_chunks, new_chunk_ids = [], []
+    for i in new_indices:
+        if chunk_ids[i] not in seen:
+            seen.add(chunk_ids[i])
+            new_chunks.append(chunks[i])
+            new_chunk_ids.append(chunk_ids[i])
+    return new_chunks, new_chunk_ids
+
+
+# Record upserted chunk IDs in a filter_new_chunks index.
+def mark_chunks_stored(chunk_ids, chunk_index):
+    chunk_index.add(chunk_ids)
+
+
+# Pack processed chunks and their IDs into one text_chunker.ChunkArchive to
+# hand them to another process or persist them: pickling, save() and
+# ChunkArchive.from_buffer() move a single buffer instead of a Document per
+# chunk. Returns None when the native module is unavailable.
+def pack_chunks(chunks, chunk_ids):
+    if not USE_CPP_CHUNK_ARCHIVE:
+        return None
+    return text_chunker.ChunkArchive([chunk.page_content for chunk in chunks],
+                                     [chunk.metadata for chunk in chunks], ids=chunk_ids)
+
+
+# Rebuild (processed_chunks, chunk_ids) from a pack_chunks archive.
+def unpack_chunks(archive):
+    chunks = [Document(page_content=archive[i], metadata=archive.metadata(i)) for i in range(len(archive))]
+    return chunks, archive.ids() or []
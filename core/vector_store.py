@@ -3,6 +3,12 @@ from langchain_pinecone import Pinecone
 import os
 import logging
 
+try:
+    from core.cpp_modules import text_chunker
+    USE_CPP_BATCHING = hasattr(text_chunker, "pack_embedding_batches")
+except ImportError:
+    USE_CPP_BATCHING = False
+
 # Set up logging
 logger = logging.getLogger(__name__)
 
@@ -36,7 +42,115 @@ def check_document_exists(vector_store, source_id):
         logger.error(f"Error checking existing documents in Pinecone: {e}")
         return False
 
-def add_chunks_to_vector_store(vector_store, chunks, chunk_ids):
+def stale_source_chunk_ids(vector_store, source_id, chunk_ids):
+    """
+    Find the chunks stored under source_id that are not in chunk_ids, all the
+    IDs its latest ingest produced. The store itself is the record of what a
+    source has, so every worker and every restart sees the same chunks.
+
+    A LocalVectorStore is searched by source_id metadata. On Pinecone, chunk
+    IDs start with their source_id (see processing.chunk_id), so the index is
+    listed by that prefix; only the candidates missing from chunk_ids are
+    fetched, to drop those of another source whose ID merely shares the
+    prefix.
+
+    Returns:
+        list: IDs of the stale chunks
+    """
+    current = set(chunk_ids)
+    if hasattr(vector_store, "ids"):
+        return [i for i in vector_store.ids({"source_id": source_id}) if i not in current]
+
+    index = vector_store._index
+    namespace = getattr(vector_store, "_namespace", None)
+    candidates = [i for page in index.list(prefix=f"{source_id}_", namespace=namespace)
+                  for i in page if i not in current]
+    stale_ids = []
+    for start in range(0, len(candidates), 100):
+        fetched = index.fetch(ids=candidates[start:start + 100], namespace=namespace).vectors
+        stale_ids.extend(i for i, vector in fetched.items()
+                         if (vector.metadata or {}).get("source_id") == source_id)
+    return stale_ids
+
+def stored_chunk_ids(vector_store, chunk_ids):
+    """
+    Find which of chunk_ids the vector store actually holds, e.g. to check
+    the IDs a ChunkHashIndex remembers before skipping their chunks: another
+    worker may have deleted them, or a LocalVectorStore may have lost its
+    last unsaved writes.
+
+    Returns:
+        set: the IDs among chunk_ids that are stored
+    """
+    wanted = set(chunk_ids)
+    if hasattr(vector_store, "ids"):
+        return wanted.intersection(vector_store.ids())
+
+    index = vector_store._index
+    namespace = getattr(vector_store, "_namespace", None)
+    wanted = list(wanted)
+    present = set()
+    for start in range(0, len(wanted), 100):
+        present.update(index.fetch(ids=wanted[start:start + 100], namespace=namespace).vectors)
+    return present
+
+def load_embedding_encoder(ranks_path):
+    """
+    Load the BPE encoder of the embedding model (cl100k_base, the encoding of
+    text-embedding-3-large) from a tiktoken merge-ranks file.
+
+    Returns:
+        text_chunker.BpeEncoder, or None without a path, without the C++
+        module, or if the file cannot be loaded
+    """
+    if not ranks_path or not USE_CPP_BATCHING:
+        return None
+    try:
+        return text_chunker.load_bpe_encoder(ranks_path, "cl100k_base")
+    except Exception as e:
+        logger.warning(f"Could not load the cl100k_base encoder from {ranks_path}, batching by count: {e}")
+        return None
+
+def upsert_chunk_batches(vector_store, chunks, chunk_ids, encoder=None):
+    """
+    Upsert chunks, raising on failure. Empty chunks are skipped. With an
+    encoder, chunks are sent in token-budgeted batches (one embedding request
+    each) and chunks over the model's input limit are sent one per call,
+    which OpenAIEmbeddings embeds piecewise; otherwise they go in a single
+    add_documents call.
+
+    Returns:
+        tuple: (IDs of the chunks that were upserted, number of empty chunks skipped)
+    """
+    kept = [i for i, chunk in enumerate(chunks) if chunk.page_content]
+    skipped = len(chunks) - len(kept)
+    if skipped:
+        logger.warning(f"Skipping {skipped} empty chunks")
+    if len(kept) < len(chunks):
+        chunks = [chunks[i] for i in kept]
+        chunk_ids = [chunk_ids[i] for i in kept]
+    if not chunks:
+        return [], skipped
+    if encoder is None or not USE_CPP_BATCHING:
+        vector_store.add_documents(documents=chunks, ids=chunk_ids)
+        return list(chunk_ids), skipped
+
+    plan = text_chunker.pack_embedding_batches(
+        [chunk.page_content for chunk in chunks], encoder,
+        max_request_inputs=1000)  # OpenAIEmbeddings' default chunk_size
+    stored_ids = []
+    for batch in plan.batches:
+        batch_ids = [chunk_ids[i] for i in batch]
+        vector_store.add_documents(documents=[chunks[i] for i in batch], ids=batch_ids)
+        stored_ids.extend(batch_ids)
+    if plan.rejected:
+        logger.info(f"Embedding {len(plan.rejected)} chunks over the input token limit one at a time")
+    for i in plan.rejected:
+        vector_store.add_documents(documents=[chunks[i]], ids=[chunk_ids[i]])
+        stored_ids.append(chunk_ids[i])
+    return stored_ids, skipped
+
+def add_chunks_to_vector_store(vector_store, chunks, chunk_ids, encoder=None):
     """
     Add document chunks to the vector store.
     
@@ -44,6 +158,9 @@ def add_chunks_to_vector_store(vector_store, chunks, chunk_ids):
         vector_store: A Pinecone vector store instance
         chunks: List of document chunks to add
         chunk_ids: List of IDs corresponding to the chunks
+        encoder: Optional text_chunker.BpeEncoder of the embedding model. When
+            given, chunks are sent in token-budgeted batches (one embedding
+            request each), see upsert_chunk_batches
         
     Returns:
         bool: True if successful, False otherwise
@@ -58,10 +175,8 @@ def add_chunks_to_vector_store(vector_store, chunks, chunk_ids):
     try:
         source_info = chunks[0].metadata.get('source_id', 'N/A') if chunks else 'N/A'
         logger.info(f"Adding/updating {len(chunks)} chunks in Pinecone for source ID associated with first chunk: {source_info}")
-        
-        # Add the documents to the vector store
-        vector_store.add_documents(documents=chunks, ids=chunk_ids)
-        logger.info("Successfully added/updated chunks in Pinecone.")
+        stored_ids, skipped = upsert_chunk_batches(vector_store, chunks, chunk_ids, encoder)
+        logger.info(f"Successfully added/updated {len(stored_ids)} chunks in Pinecone, skipped {skipped} empty chunks.")
         return True
     except Exception as e:
         logger.error(f"Error adding documents to Pinecone: {e}")
@@ -75,9 +190,24 @@ def get_pinecone_vector_store():
     For the API layer, prefer using the singleton pattern implemented in
     api/app/dependencies.py to avoid redundant connections.
     
+    With LOCAL_VECTOR_STORE_PATH set (development / offline mode), a
+    core.local_vector_store.LocalVectorStore persisted under that directory is
+    returned instead and Pinecone is not contacted.
+    
     Returns:
         Pinecone: A Pinecone vector store instance, or None if connection fails
     """
+    local_path = os.getenv("LOCAL_VECTOR_STORE_PATH")
+    if local_path:
+        try:
+            from core.local_vector_store import LocalVectorStore
+            embeddings = OpenAIEmbeddings(model="text-embedding-3-large")
+            logger.info(f"Using local vector store at {local_path}")
+            return LocalVectorStore(embeddings, path=local_path)
+        except Exception as e:
+            logger.error(f"Error opening local vector store at {local_path}: {e}")
+            return None
+
     index_name = os.getenv("PINECONE_INDEX_NAME")
     pinecone_api_key = os.getenv("PINECONE_API_KEY")
     openai_api_key = os.getenv("OPENAI_API_KEY") 
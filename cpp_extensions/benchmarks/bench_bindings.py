@@ -0,0 +1,78 @@
+"""pytest-benchmark harness for the Python bindings.
+
+Runs the binding counterparts of the cosmos_benchmarks executable on the
+files of COSMOS_BENCH_CORPUS (for example the synthetic corpora written by
+`cosmos_benchmarks --write_corpus=DIR`). Benchmarks are named like the
+native ones, e.g. "split_text/prose_1MB.txt", so with COSMOS_NATIVE_RESULTS
+pointing at a `--benchmark_out` JSON report each result also gets the share
+of its time spent in pybind conversion. See README.md.
+"""
+import functools
+import os
+
+import pytest
+
+from conftest import CORPUS_DIR, corpus_files, measure_memory, record
+
+try:
+    from core.cpp_modules import text_chunker, pdf_extractor, hash_generator
+except ImportError:
+    text_chunker = pdf_extractor = hash_generator = None
+
+# Same parameters as native_benchmarks.cpp
+CHUNK_SIZE = 1000
+CHUNK_OVERLAP = 200
+CHUNK_SIZE_WORDS = 200
+CHUNK_OVERLAP_WORDS = 50
+
+pytestmark = [
+    pytest.mark.skipif(not CORPUS_DIR, reason="COSMOS_BENCH_CORPUS is not set"),
+    pytest.mark.skipif(text_chunker is None, reason="C++ modules are not built"),
+]
+
+TEXT_FILES = corpus_files(".txt")
+PDF_FILES = corpus_files(".pdf")
+
+
+@functools.lru_cache(maxsize=2)
+def _read(path, as_text):
+    if as_text:
+        with open(path, encoding="utf-8") as f:
+            return f.read()
+    with open(path, "rb") as f:
+        return f.read()
+
+
+def _run(benchmark, function, path, fn, data, *args):
+    name = f"{function}/{os.path.basename(path)}"
+    size = len(data.encode("utf-8")) if isinstance(data, str) else len(data)
+    peak, growth = measure_memory(fn, data, *args)
+    benchmark(fn, data, *args)
+    record(benchmark, name, size, peak, growth)
+
+
+@pytest.mark.benchmark(group="split_text")
+@pytest.mark.parametrize("path", TEXT_FILES, ids=os.path.basename)
+def test_split_text(benchmark, path):
+    _run(benchmark, "split_text", path, text_chunker.split_text,
+         _read(path, True), CHUNK_SIZE, CHUNK_OVERLAP)
+
+
+@pytest.mark.benchmark(group="split_text_with_word_count")
+@pytest.mark.parametrize("path", TEXT_FILES, ids=os.path.basename)
+def test_split_text_with_word_count(benchmark, path):
+    _run(benchmark, "split_text_with_word_count", path, text_chunker.split_text_with_word_count,
+         _read(path, True), CHUNK_SIZE_WORDS, CHUNK_OVERLAP_WORDS)
+
+
+@pytest.mark.benchmark(group="extract_pdf_text_and_hash")
+@pytest.mark.parametrize("path", PDF_FILES, ids=os.path.basename)
+def test_extract_pdf_text_and_hash(benchmark, path):
+    _run(benchmark, "extract_pdf_text_and_hash", path, pdf_extractor.extract_pdf_text_and_hash,
+         _read(path, False))
+
+
+@pytest.mark.benchmark(group="compute_sha256")
+@pytest.mark.parametrize("path", TEXT_FILES + PDF_FILES, ids=os.path.basename)
+def test_compute_sha256(benchmark, path):
+    _run(benchmark, "compute_sha256", path, hash_generator.compute_sha256, _read(path, False))
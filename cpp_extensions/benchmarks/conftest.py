@@ -0,0 +1,115 @@
+"""Shared helpers for the pytest-benchmark harness in bench_bindings.py."""
+import json
+import os
+import resource
+import sys
+
+# Make `core.cpp_modules` importable when pytest runs from cpp_extensions/
+REPO_ROOT = os.path.abspath(os.path.join(os.path.dirname(__file__), "..", ".."))
+if REPO_ROOT not in sys.path:
+    sys.path.insert(0, REPO_ROOT)
+
+CORPUS_DIR = os.environ.get("COSMOS_BENCH_CORPUS")
+NATIVE_RESULTS = os.environ.get("COSMOS_NATIVE_RESULTS")
+
+_TIME_UNITS = {"ns": 1e-9, "us": 1e-6, "ms": 1e-3, "s": 1.0}
+
+# Rows printed in the terminal summary, one per benchmark
+_results = []
+
+
+def corpus_files(*suffixes):
+    """Files of COSMOS_BENCH_CORPUS with one of the suffixes, in name order."""
+    if not CORPUS_DIR or not os.path.isdir(CORPUS_DIR):
+        return []
+    return sorted(
+        os.path.join(CORPUS_DIR, name)
+        for name in os.listdir(CORPUS_DIR)
+        if name.endswith(suffixes)
+    )
+
+
+def _load_native_times():
+    """Seconds per iteration of each cosmos_benchmarks result in COSMOS_NATIVE_RESULTS."""
+    if not NATIVE_RESULTS:
+        return {}
+    with open(NATIVE_RESULTS) as f:
+        report = json.load(f)
+    samples = {}
+    for entry in report.get("benchmarks", []):
+        if entry.get("run_type", "iteration") != "iteration":
+            continue
+        seconds = entry["real_time"] * _TIME_UNITS[entry.get("time_unit", "ns")]
+        samples.setdefault(entry.get("run_name", entry["name"]), []).append(seconds)
+    return {name: sum(values) / len(values) for name, values in samples.items()}
+
+
+_native_times = _load_native_times()
+
+
+def _status_bytes(field):
+    try:
+        with open("/proc/self/status") as f:
+            for line in f:
+                if line.startswith(field + ":"):
+                    return int(line.split()[1]) * 1024
+    except OSError:
+        pass
+    return 0
+
+
+def measure_memory(fn, *args):
+    """Runs fn once and returns (peak RSS, growth over the starting RSS) in bytes.
+
+    The peak is reset through /proc/self/clear_refs where possible (Linux);
+    elsewhere it is the process peak and the growth is unknown (None).
+    """
+    try:
+        with open("/proc/self/clear_refs", "w") as f:
+            f.write("5")
+        reset = True
+    except OSError:
+        reset = False
+    baseline = _status_bytes("VmRSS")
+    fn(*args)
+    peak = _status_bytes("VmHWM")
+    if not peak:
+        maxrss = resource.getrusage(resource.RUSAGE_SELF).ru_maxrss
+        peak = maxrss if sys.platform == "darwin" else maxrss * 1024
+    growth = max(0, peak - baseline) if reset and baseline else None
+    return peak, growth
+
+
+def record(benchmark, name, size, peak, growth):
+    """Attaches throughput, memory and pybind conversion share to the benchmark."""
+    info = benchmark.extra_info
+    info["bytes"] = size
+    info["peak_rss_mb"] = peak / 1e6
+    if growth is not None:
+        info["rss_growth_mb"] = growth / 1e6
+
+    row = {"name": name, "mb_per_s": None, "peak_rss_mb": peak / 1e6, "pybind_share": None}
+    stats = getattr(benchmark.stats, "stats", None) if benchmark.stats else None
+    if stats is not None and stats.mean > 0:
+        info["mb_per_s"] = size / stats.mean / 1e6
+        row["mb_per_s"] = info["mb_per_s"]
+        # Time spent outside the native work: argument and result conversion
+        # plus call overhead, relative to the whole Python call
+        native = _native_times.get(name)
+        if native is not None:
+            info["native_seconds"] = native
+            info["pybind_share"] = max(0.0, 1.0 - native / stats.mean)
+            row["pybind_share"] = info["pybind_share"]
+    _results.append(row)
+
+
+def pytest_terminal_summary(terminalreporter):
+    if not _results:
+        return
+    terminalreporter.section("COSMOS binding throughput")
+    terminalreporter.write_line(f"{'benchmark':<56} {'MB/s':>10} {'peak RSS MB':>12} {'pybind share':>13}")
+    for row in _results:
+        mb_per_s = f"{row['mb_per_s']:.1f}" if row["mb_per_s"] is not None else "-"
+        share = f"{row['pybind_share']:.1%}" if row["pybind_share"] is not None else "-"
+        terminalreporter.write_line(
+            f"{row['name']:<56} {mb_per_s:>10} {row['peak_rss_mb']:>12.1f} {share:>13}")
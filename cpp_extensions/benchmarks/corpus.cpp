@@ -0,0 +1,270 @@
+#include "corpus.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+
+using namespace std;
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr size_t kKiB = size_t(1) << 10;
+constexpr size_t kMiB = size_t(1) << 20;
+
+string size_label(size_t size) {
+    return size >= kMiB ? to_string(size / kMiB) + "MB" : to_string(size / kKiB) + "KB";
+}
+
+/**
+ * Deterministic stream of pseudo-words (splitmix64). Mixes frequent short
+ * function words with longer generated ones, so word lengths and whitespace
+ * density resemble English text.
+ */
+class WordSource {
+public:
+    explicit WordSource(uint64_t seed) : state_(seed) {}
+
+    uint64_t next() {
+        state_ += 0x9E3779B97F4A7C15ULL;
+        uint64_t z = state_;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+
+    size_t uniform(size_t low, size_t high) {
+        return low + static_cast<size_t>(next() % (high - low + 1));
+    }
+
+    /** Next word; ascii_only excludes the occasional accented word. */
+    string word(bool ascii_only) {
+        static const array<const char*, 12> kCommon = {
+            "the", "of", "and", "to", "in", "a", "is", "that", "for", "it", "as", "with"};
+        static const array<const char*, 24> kSyllables = {
+            "ka", "lo", "mi", "ne", "ra", "to", "vi", "su", "de", "an", "el", "or",
+            "is", "um", "pre", "con", "tra", "men", "ti", "on", "ex", "al", "ver", "sta"};
+        static const array<const char*, 4> kAccented = {"café", "naïve", "über", "Zürich"};
+
+        const uint64_t pick = next() % 100;
+        if (pick < 40) {
+            return kCommon[next() % kCommon.size()];
+        }
+        if (!ascii_only && pick < 42) {
+            return kAccented[next() % kAccented.size()];
+        }
+        string word;
+        const size_t syllables = uniform(1, 4);
+        for (size_t i = 0; i < syllables; ++i) {
+            word += kSyllables[next() % kSyllables.size()];
+        }
+        return word;
+    }
+
+private:
+    uint64_t state_;
+};
+
+/** A line of words of about width bytes, without a trailing newline. */
+string generate_line(WordSource& words, size_t width, bool ascii_only) {
+    string line = words.word(ascii_only);
+    while (line.size() < width) {
+        line += ' ';
+        line += words.word(ascii_only);
+    }
+    return line;
+}
+
+} // namespace
+
+const vector<size_t>& synthetic_corpus_sizes() {
+    static const vector<size_t> sizes = {kKiB, 64 * kKiB, kMiB, 16 * kMiB, 100 * kMiB};
+    return sizes;
+}
+
+string generate_prose(size_t size, uint64_t seed) {
+    WordSource words(seed);
+    string text;
+    text.reserve(size);
+
+    size_t line_length = 0;
+    size_t sentence_words = 0;
+    size_t sentence_length = words.uniform(6, 24);
+    size_t paragraph_sentences = 0;
+    size_t paragraph_length = words.uniform(3, 8);
+    bool sentence_start = true;
+
+    while (true) {
+        string word = words.word(false);
+        if (sentence_start && word[0] >= 'a' && word[0] <= 'z') {
+            word[0] = static_cast<char>(word[0] - 'a' + 'A');
+        }
+        sentence_start = false;
+        if (++sentence_words == sentence_length) {
+            word += words.uniform(0, 9) == 0 ? '?' : '.';
+        }
+
+        // Stop on a whole word so the text never ends inside a UTF-8 sequence
+        if (text.size() + word.size() + 1 > size) {
+            break;
+        }
+        if (!text.empty() && text.back() != '\n') {
+            // Wrap lines at about 80 columns
+            if (line_length + word.size() >= 80) {
+                text += '\n';
+                line_length = 0;
+            } else {
+                text += ' ';
+                ++line_length;
+            }
+        }
+        text += word;
+        line_length += word.size();
+
+        if (sentence_words == sentence_length) {
+            sentence_words = 0;
+            sentence_length = words.uniform(6, 24);
+            sentence_start = true;
+            if (++paragraph_sentences == paragraph_length && text.size() + 2 <= size) {
+                text += "\n\n";
+                line_length = 0;
+                paragraph_sentences = 0;
+                paragraph_length = words.uniform(3, 8);
+            }
+        }
+    }
+    return text;
+}
+
+string generate_transcript(size_t size, uint64_t seed) {
+    WordSource words(seed);
+    string text;
+    text.reserve(size);
+    while (true) {
+        string line;
+        const size_t line_words = words.uniform(4, 12);
+        for (size_t i = 0; i < line_words; ++i) {
+            if (i != 0) {
+                line += ' ';
+            }
+            line += words.word(false);
+        }
+        if (text.size() + line.size() + 1 > size) {
+            break;
+        }
+        text += line;
+        text += '\n';
+    }
+    return text;
+}
+
+string generate_pdf(size_t size, uint64_t seed) {
+    constexpr int kLinesPerPage = 50;
+    WordSource words(seed);
+
+    string pdf = "%PDF-1.4\n";
+    vector<size_t> offsets = {0};
+    auto add_object = [&](const string& body) {
+        offsets.push_back(pdf.size());
+        pdf += to_string(offsets.size() - 1) + " 0 obj\n" + body + "\nendobj\n";
+    };
+
+    add_object("<< /Type /Catalog /Pages 2 0 R >>");
+    // The page tree is written last, once every page is known
+    offsets.push_back(0);
+    add_object("<< /Type /Font /Subtype /Type1 /BaseFont /Helvetica /Encoding /WinAnsiEncoding >>");
+
+    string kids;
+    int page_count = 0;
+    while (page_count == 0 || pdf.size() < size) {
+        string content = "BT\n/F1 10 Tf\n12 TL\n50 760 Td\n";
+        for (int line = 0; line < kLinesPerPage && (line == 0 || pdf.size() + content.size() < size); ++line) {
+            // Plain ASCII words need no escaping inside a PDF string
+            content += "(" + generate_line(words, 90, true) + ") Tj T*\n";
+        }
+        content += "ET\n";
+
+        const size_t page_object = offsets.size();
+        add_object("<< /Type /Page /Parent 2 0 R /MediaBox [0 0 612 792] /Resources << /Font << /F1 3 0 R >> >> "
+                   "/Contents " + to_string(page_object + 1) + " 0 R >>");
+        add_object("<< /Length " + to_string(content.size()) + " >>\nstream\n" + content + "endstream");
+        kids += to_string(page_object) + " 0 R ";
+        ++page_count;
+    }
+
+    offsets[2] = pdf.size();
+    pdf += "2 0 obj\n<< /Type /Pages /Kids [" + kids + "] /Count " + to_string(page_count) + " >>\nendobj\n";
+
+    const size_t xref_offset = pdf.size();
+    pdf += "xref\n0 " + to_string(offsets.size()) + "\n0000000000 65535 f \n";
+    char entry[32];
+    for (size_t i = 1; i < offsets.size(); ++i) {
+        snprintf(entry, sizeof(entry), "%010zu 00000 n \n", offsets[i]);
+        pdf += entry;
+    }
+    pdf += "trailer\n<< /Size " + to_string(offsets.size()) + " /Root 1 0 R >>\nstartxref\n" +
+           to_string(xref_offset) + "\n%%EOF\n";
+    return pdf;
+}
+
+vector<unique_ptr<Corpus>> synthetic_corpora() {
+    vector<unique_ptr<Corpus>> corpora;
+    uint64_t seed = 1;
+    for (size_t size : synthetic_corpus_sizes()) {
+        const string label = size_label(size);
+        corpora.push_back(make_unique<Corpus>("prose_" + label + ".txt", CorpusKind::Text,
+                                              [size, seed] { return generate_prose(size, seed); }));
+        corpora.push_back(make_unique<Corpus>("transcript_" + label + ".txt", CorpusKind::Text,
+                                              [size, seed] { return generate_transcript(size, seed + 1); }));
+        corpora.push_back(make_unique<Corpus>("document_" + label + ".pdf", CorpusKind::Pdf,
+                                              [size, seed] { return generate_pdf(size, seed + 2); }));
+        seed += 3;
+    }
+    return corpora;
+}
+
+vector<unique_ptr<Corpus>> load_corpus_directory(const string& path) {
+    vector<fs::path> files;
+    try {
+        for (const fs::directory_entry& entry : fs::directory_iterator(path)) {
+            const string extension = entry.path().extension().string();
+            if (entry.is_regular_file() && (extension == ".txt" || extension == ".pdf")) {
+                files.push_back(entry.path());
+            }
+        }
+    } catch (const fs::filesystem_error& e) {
+        throw runtime_error("Failed to read corpus directory " + path + ": " + e.what());
+    }
+    sort(files.begin(), files.end());
+
+    vector<unique_ptr<Corpus>> corpora;
+    for (const fs::path& file : files) {
+        const CorpusKind kind = file.extension() == ".pdf" ? CorpusKind::Pdf : CorpusKind::Text;
+        corpora.push_back(make_unique<Corpus>(file.filename().string(), kind, [file] {
+            ifstream in(file, ios::binary);
+            if (!in) {
+                throw runtime_error("Failed to open " + file.string());
+            }
+            return string(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+        }));
+    }
+    return corpora;
+}
+
+void write_synthetic_corpora(const string& directory) {
+    fs::create_directories(directory);
+    for (unique_ptr<Corpus>& corpus : synthetic_corpora()) {
+        const fs::path file = fs::path(directory) / corpus->name();
+        ofstream out(file, ios::binary | ios::trunc);
+        const string& data = corpus->data();
+        if (!out.write(data.data(), data.size())) {
+            throw runtime_error("Failed to write " + file.string());
+        }
+        // Only one corpus is held in memory at a time
+        corpus.reset();
+    }
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+enum class CorpusKind {
+    Text,   // prose or transcript text, UTF-8
+    Pdf
+};
+
+/**
+ * One benchmark input. The contents are produced on first use, so corpora
+ * that no selected benchmark touches are never generated or read.
+ */
+class Corpus {
+public:
+    Corpus(std::string name, CorpusKind kind, std::function<std::string()> load)
+        : name_(std::move(name)), kind_(kind), load_(std::move(load)) {}
+
+    const std::string& name() const { return name_; }
+    CorpusKind kind() const { return kind_; }
+
+    /** The corpus bytes; thread-safe, loaded once. */
+    const std::string& data() const {
+        std::call_once(loaded_, [this] { data_ = load_(); });
+        return data_;
+    }
+
+private:
+    std::string name_;
+    CorpusKind kind_;
+    std::function<std::string()> load_;
+    mutable std::once_flag loaded_;
+    mutable std::string data_;
+};
+
+/** Sizes of the synthetic corpora: 1 KB, 64 KB, 1 MB, 16 MB and 100 MB. */
+const std::vector<size_t>& synthetic_corpus_sizes();
+
+/**
+ * Deterministic synthetic inputs of roughly size bytes. Prose has sentences,
+ * line breaks and paragraphs; transcripts are short caption lines without
+ * punctuation, like YouTube transcripts; PDFs are uncompressed Helvetica
+ * text pages that poppler can parse.
+ */
+std::string generate_prose(size_t size, uint64_t seed);
+std::string generate_transcript(size_t size, uint64_t seed);
+std::string generate_pdf(size_t size, uint64_t seed);
+
+/**
+ * Every synthetic corpus, named like "prose_1MB.txt", "transcript_64KB.txt"
+ * or "document_16MB.pdf".
+ */
+std::vector<std::unique_ptr<Corpus>> synthetic_corpora();
+
+/**
+ * The .txt and .pdf files of a directory, named by file name, in name order.
+ * Throws runtime_error if the directory cannot be read.
+ */
+std::vector<std::unique_ptr<Corpus>> load_corpus_directory(const std::string& path);
+
+/**
+ * Writes every synthetic corpus into directory as its own file, creating the
+ * directory if needed, so other harnesses can run on identical inputs.
+ */
+void write_synthetic_corpora(const std::string& directory);
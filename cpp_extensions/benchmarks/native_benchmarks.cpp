@@ -0,0 +1,198 @@
+#include <benchmark/benchmark.h>
+
+#include <cstdio>
+#include <exception>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "corpus.h"
+#include "rss.h"
+#include "boundary_scanner.h"
+#include "char_chunker.h"
+#include "chunk_configs.h"
+#include "word_chunker.h"
+#include "text_span.h"
+#include "packed_chunks.h"
+#include "chunk_archive.h"
+#include "pdf_document.h"
+#include "sha256.h"
+
+using namespace std;
+
+namespace {
+
+// Same parameters as benchmarks/bench_bindings.py, so results are comparable
+constexpr int kChunkSize = 1000;
+constexpr int kChunkOverlap = 200;
+constexpr int kChunkSizeWords = 200;
+constexpr int kChunkOverlapWords = 50;
+
+/**
+ * Runs body over the corpus in the benchmark loop and reports throughput
+ * (bytes_per_second) plus memory: peak_rss_MB is the process peak during the
+ * run and rss_growth_MB how far it rose above the RSS at the start, with the
+ * corpus already loaded.
+ */
+template <class Body>
+void run_on_corpus(benchmark::State& state, const Corpus& corpus, Body&& body) {
+    const string& data = corpus.data();
+    trim_heap();
+    const size_t baseline = current_rss_bytes();
+    const bool peak_was_reset = reset_peak_rss();
+
+    for (auto _ : state) {
+        body(data);
+    }
+
+    const size_t peak = peak_rss_bytes();
+    const double bytes = static_cast<double>(data.size()) * static_cast<double>(state.iterations());
+    state.SetBytesProcessed(static_cast<int64_t>(bytes));
+    state.counters["peak_rss_MB"] = static_cast<double>(peak) / 1e6;
+    if (peak_was_reset) {
+        state.counters["rss_growth_MB"] = static_cast<double>(peak > baseline ? peak - baseline : 0) / 1e6;
+    }
+}
+
+// The native halves of the Python-facing functions; the chunking bindings
+// then build their str chunks straight from the spans
+
+void split_text(benchmark::State& state, const Corpus* corpus) {
+    run_on_corpus(state, *corpus, [](const string& text) {
+        vector<TextSpan> spans = split_text_spans(text, kChunkSize, kChunkOverlap);
+        benchmark::DoNotOptimize(spans.data());
+    });
+}
+
+void split_text_with_word_count(benchmark::State& state, const Corpus* corpus) {
+    run_on_corpus(state, *corpus, [](const string& text) {
+        vector<TextSpan> spans = split_words_spans(BoundaryIndex(text), kChunkSizeWords, kChunkOverlapWords);
+        benchmark::DoNotOptimize(spans.data());
+    });
+}
+
+void split_text_packed(benchmark::State& state, const Corpus* corpus) {
+    run_on_corpus(state, *corpus, [](const string& text) {
+        PackedChunks chunks(text, split_text_spans(text, kChunkSize, kChunkOverlap));
+        benchmark::DoNotOptimize(chunks.bytes().data());
+    });
+}
+
+// Prebuilt chunking configurations; word configurations take the word sizes
+void chunk_config(benchmark::State& state, const Corpus* corpus, const ChunkConfig* config) {
+    const bool words = config->unit == "words";
+    const int chunk_size = words ? kChunkSizeWords : kChunkSize;
+    const int chunk_overlap = words ? kChunkOverlapWords : kChunkOverlap;
+    run_on_corpus(state, *corpus, [&](const string& text) {
+        vector<TextSpan> spans = config->split(text, chunk_size, chunk_overlap);
+        benchmark::DoNotOptimize(spans.data());
+    });
+}
+
+// Encodes the chunks with per-chunk metadata and opens the result, the two
+// ends of a cross-process handoff
+void chunk_archive(benchmark::State& state, const Corpus* corpus) {
+    const PackedChunks chunks(corpus->data(), split_text_spans(corpus->data(), kChunkSize, kChunkOverlap));
+    run_on_corpus(state, *corpus, [&](const string&) {
+        ChunkArchiveBuilder builder;
+        builder.add_texts(chunks);
+        for (size_t row = 0; row < builder.size(); ++row) {
+            builder.set_string("source_id", row, corpus->name());
+            builder.set_int64("chunk_sequence", row, static_cast<int64_t>(row));
+        }
+        ChunkArchive archive(builder.finish());
+        benchmark::DoNotOptimize(archive.text_bytes().data());
+    });
+}
+
+void extract_pdf_text_and_hash(benchmark::State& state, const Corpus* corpus) {
+    run_on_corpus(state, *corpus, [](const string& pdf) {
+        pair<string, string> result = extract_text_and_hash(pdf.data(), pdf.size());
+        benchmark::DoNotOptimize(result.first.data());
+    });
+}
+
+void compute_sha256(benchmark::State& state, const Corpus* corpus) {
+    run_on_corpus(state, *corpus, [](const string& data) {
+        string hash = sha256_hash(reinterpret_cast<const unsigned char*>(data.data()), data.size());
+        benchmark::DoNotOptimize(hash.data());
+    });
+}
+
+void register_corpus_benchmarks(const vector<unique_ptr<Corpus>>& corpora) {
+    for (const unique_ptr<Corpus>& owned : corpora) {
+        const Corpus* corpus = owned.get();
+        if (corpus->kind() == CorpusKind::Text) {
+            benchmark::RegisterBenchmark(("split_text/" + corpus->name()).c_str(), split_text, corpus)
+                ->Unit(benchmark::kMicrosecond);
+            benchmark::RegisterBenchmark(("split_text_with_word_count/" + corpus->name()).c_str(),
+                                         split_text_with_word_count, corpus)
+                ->Unit(benchmark::kMicrosecond);
+            benchmark::RegisterBenchmark(("split_text_packed/" + corpus->name()).c_str(), split_text_packed, corpus)
+                ->Unit(benchmark::kMicrosecond);
+            benchmark::RegisterBenchmark(("chunk_archive/" + corpus->name()).c_str(), chunk_archive, corpus)
+                ->Unit(benchmark::kMicrosecond);
+            for (const ChunkConfig& config : chunk_configs()) {
+                if (!config.needs_encoder) {
+                    benchmark::RegisterBenchmark(("chunk_config/" + config.name + "/" + corpus->name()).c_str(),
+                                                 chunk_config, corpus, &config)
+                        ->Unit(benchmark::kMicrosecond);
+                }
+            }
+        } else {
+            benchmark::RegisterBenchmark(("extract_pdf_text_and_hash/" + corpus->name()).c_str(),
+                                         extract_pdf_text_and_hash, corpus)
+                ->Unit(benchmark::kMicrosecond);
+        }
+        benchmark::RegisterBenchmark(("compute_sha256/" + corpus->name()).c_str(), compute_sha256, corpus)
+            ->Unit(benchmark::kMicrosecond);
+    }
+}
+
+bool take_flag(const string& arg, const string& name, string& value) {
+    const string prefix = "--" + name + "=";
+    if (arg.compare(0, prefix.size(), prefix) != 0) {
+        return false;
+    }
+    value = arg.substr(prefix.size());
+    return true;
+}
+
+} // namespace
+
+/**
+ * Besides the Google Benchmark flags (--benchmark_filter, --benchmark_out, ...):
+ *   --corpus=DIR        benchmark the .txt and .pdf files of DIR instead of
+ *                       the built-in synthetic corpora
+ *   --write_corpus=DIR  write the synthetic corpora to DIR and exit
+ */
+int main(int argc, char** argv) {
+    benchmark::Initialize(&argc, argv);
+
+    string corpus_directory;
+    string write_directory;
+    for (int i = 1; i < argc; ++i) {
+        const string arg = argv[i];
+        if (!take_flag(arg, "corpus", corpus_directory) && !take_flag(arg, "write_corpus", write_directory)) {
+            fprintf(stderr, "Unknown argument: %s\n", arg.c_str());
+            return 1;
+        }
+    }
+
+    try {
+        if (!write_directory.empty()) {
+            write_synthetic_corpora(write_directory);
+            return 0;
+        }
+
+        vector<unique_ptr<Corpus>> corpora =
+            corpus_directory.empty() ? synthetic_corpora() : load_corpus_directory(corpus_directory);
+        register_corpus_benchmarks(corpora);
+        benchmark::RunSpecifiedBenchmarks();
+    } catch (const exception& e) {
+        fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+    benchmark::Shutdown();
+    return 0;
+}
@@ -0,0 +1,63 @@
+"""Profile-guided optimization training run, the cosmos_pgo_train target.
+
+Runs each instrumented cosmos_benchmarks build over the training corpus so
+its profile covers the same chunking, hashing, PDF and vector index paths
+the benchmarks measure. Arguments after the options are PROFILE=EXECUTABLE
+pairs; the build passes baseline=<cosmos_benchmarks>. GCC builds write their
+.gcda files to the profile directory on their own; for Clang builds each
+executable's raw profiles are merged into <profile-dir>/<profile>.profdata.
+Only the per-ISA clones the build host runs are trained; the others are
+optimized without a profile.
+"""
+import argparse
+import glob
+import os
+import subprocess
+import sys
+
+# Every benchmark runs briefly: profiles need coverage of the hot paths,
+# not stable timings
+MIN_TIME = "0.05s"
+
+
+def _train(profile, executable, args):
+    env = dict(os.environ)
+    if args.llvm_profdata:
+        for stale in glob.glob(os.path.join(args.profile_dir, f"{profile}-*.profraw")):
+            os.remove(stale)
+        env["LLVM_PROFILE_FILE"] = os.path.join(args.profile_dir, f"{profile}-%p.profraw")
+
+    command = [executable, f"--benchmark_min_time={MIN_TIME}"]
+    if args.corpus:
+        command.append(f"--corpus={args.corpus}")
+    print(f"pgo_train: {profile}: {' '.join(command)}", flush=True)
+    result = subprocess.run(command, env=env, stdout=subprocess.DEVNULL)
+    if result.returncode != 0:
+        print(f"pgo_train: {profile}: exited with status {result.returncode}", file=sys.stderr)
+        return False
+
+    if args.llvm_profdata:
+        raw = glob.glob(os.path.join(args.profile_dir, f"{profile}-*.profraw"))
+        merged = os.path.join(args.profile_dir, f"{profile}.profdata")
+        subprocess.run([args.llvm_profdata, "merge", f"--output={merged}", *raw], check=True)
+    return True
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--profile-dir", required=True)
+    parser.add_argument("--corpus", help="Corpus directory; the synthetic corpora by default")
+    parser.add_argument("--llvm-profdata", help="llvm-profdata of a Clang toolchain")
+    parser.add_argument("builds", nargs="+", metavar="PROFILE=EXECUTABLE")
+    args = parser.parse_args()
+
+    os.makedirs(args.profile_dir, exist_ok=True)
+    ok = True
+    for build in args.builds:
+        profile, _, executable = build.partition("=")
+        ok = _train(profile, executable, args) and ok
+    return 0 if ok else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,66 @@
+#include "rss.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+
+#include <sys/resource.h>
+
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+using namespace std;
+
+namespace {
+
+// Reads a "Name:   1234 kB" line of /proc/self/status
+size_t read_status_kb(const char* field) {
+    ifstream status("/proc/self/status");
+    string line;
+    const size_t field_length = strlen(field);
+    while (getline(status, line)) {
+        if (line.compare(0, field_length, field) == 0 && line.size() > field_length && line[field_length] == ':') {
+            return stoull(line.substr(field_length + 1)) * 1024;
+        }
+    }
+    return 0;
+}
+
+} // namespace
+
+size_t current_rss_bytes() {
+    return read_status_kb("VmRSS");
+}
+
+size_t peak_rss_bytes() {
+    size_t peak = read_status_kb("VmHWM");
+    if (peak != 0) {
+        return peak;
+    }
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+#ifdef __APPLE__
+    return static_cast<size_t>(usage.ru_maxrss);
+#else
+    return static_cast<size_t>(usage.ru_maxrss) * 1024;
+#endif
+}
+
+bool reset_peak_rss() {
+    FILE* clear_refs = fopen("/proc/self/clear_refs", "w");
+    if (clear_refs == nullptr) {
+        return false;
+    }
+    bool ok = fputs("5", clear_refs) >= 0;
+    return fclose(clear_refs) == 0 && ok;
+}
+
+void trim_heap() {
+#ifdef __GLIBC__
+    malloc_trim(0);
+#endif
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+
+/** Current resident set size of the process in bytes, or 0 if unknown. */
+size_t current_rss_bytes();
+
+/**
+ * Peak resident set size of the process in bytes. Since the last successful
+ * reset_peak_rss() on Linux, otherwise since the process started.
+ */
+size_t peak_rss_bytes();
+
+/**
+ * Resets the kernel's peak RSS counter (Linux 4.0+ through
+ * /proc/self/clear_refs), so the peak of one benchmark can be measured.
+ *
+ * @return false where the counter cannot be reset
+ */
+bool reset_peak_rss();
+
+/**
+ * Returns freed heap memory to the OS where the allocator supports it
+ * (glibc), so memory retained from an earlier run does not hide the
+ * growth of the next one.
+ */
+void trim_heap();
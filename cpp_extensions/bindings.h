@@ -0,0 +1,35 @@
+#pragma once
+
+#include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
+
+#include <utility>
+
+#include "stats.h"
+
+/**
+ * Each function adds one former extension module's API to m. They are all
+ * called from native_module.cpp, which builds the single _cosmos_native
+ * extension with one submodule per API.
+ */
+void register_text_chunker(pybind11::module_& m);
+void register_pdf_extractor(pybind11::module_& m);
+void register_hash_generator(pybind11::module_& m);
+void register_job_queue(pybind11::module_& m);
+void register_vector_index(pybind11::module_& m);
+
+/**
+ * Adds get_stats()/reset_stats() for module's metrics (see stats.h) and the
+ * process-wide tracing functions (see trace.h) to m.
+ */
+void register_stats_api(pybind11::module_& m, const char* module);
+
+/**
+ * Converts a native result to a Python object, timing the conversion into
+ * the module's "marshal" histogram. Requires the GIL.
+ */
+template <typename T>
+pybind11::object marshal(StatHistogram& timing, T&& value) {
+    ScopedTimer timer(timing);
+    return pybind11::cast(std::forward<T>(value));
+}
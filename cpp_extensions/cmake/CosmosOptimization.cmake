@@ -0,0 +1,76 @@
+# Profile-guided optimization of the extension, see the COSMOS_PGO option in
+# the top-level CMakeLists.txt. Newer ISA levels need no separate builds: the
+# hot loops are cloned per level inside the one module (common/multiversion.h).
+
+if(COSMOS_PGO STREQUAL "GENERATE" OR COSMOS_PGO STREQUAL "USE")
+    if(NOT CMAKE_CXX_COMPILER_ID MATCHES "GNU|Clang")
+        message(FATAL_ERROR "COSMOS_PGO needs GCC or Clang, not ${CMAKE_CXX_COMPILER_ID}")
+    endif()
+    if(CMAKE_CXX_COMPILER_ID MATCHES "Clang")
+        get_filename_component(COSMOS_COMPILER_DIR ${CMAKE_CXX_COMPILER} DIRECTORY)
+        find_program(COSMOS_LLVM_PROFDATA llvm-profdata HINTS ${COSMOS_COMPILER_DIR} REQUIRED)
+    endif()
+elseif(NOT COSMOS_PGO STREQUAL "OFF")
+    message(FATAL_ERROR "COSMOS_PGO must be OFF, GENERATE or USE, got '${COSMOS_PGO}'")
+endif()
+
+# Instruments (GENERATE) or optimizes (USE) a core library and everything
+# linking it. GCC keys profiles by object path, so USE builds must reuse the
+# build directory of the training run; Clang reads <profile>.profdata.
+function(cosmos_enable_pgo target profile)
+    if(COSMOS_PGO STREQUAL "GENERATE")
+        if(CMAKE_CXX_COMPILER_ID STREQUAL "GNU")
+            set(flags -fprofile-generate=${COSMOS_PGO_DIR} -fprofile-update=prefer-atomic)
+        else()
+            set(flags -fprofile-instr-generate)
+        endif()
+        target_compile_options(${target} PUBLIC ${flags})
+        target_link_options(${target} PUBLIC ${flags})
+    elseif(COSMOS_PGO STREQUAL "USE")
+        # Code the benchmarks never reach (mostly bindings) is built as usual
+        if(CMAKE_CXX_COMPILER_ID STREQUAL "GNU")
+            target_compile_options(${target} PUBLIC
+                -fprofile-use=${COSMOS_PGO_DIR} -fprofile-partial-training -Wno-missing-profile)
+        else()
+            target_compile_options(${target} PUBLIC
+                -fprofile-instr-use=${COSMOS_PGO_DIR}/${profile}.profdata
+                -Wno-profile-instr-unprofiled -Wno-profile-instr-out-of-date)
+        endif()
+    endif()
+endfunction()
+
+# Records the optimizations in _cosmos_native.build_info
+function(cosmos_describe_build target)
+    if(CMAKE_INTERPROCEDURAL_OPTIMIZATION)
+        set(lto 1)
+    else()
+        set(lto 0)
+    endif()
+    target_compile_definitions(${target} PRIVATE COSMOS_BUILD_LTO=${lto} COSMOS_BUILD_PGO="${COSMOS_PGO}")
+endfunction()
+
+# cosmos_pgo_train runs the instrumented cosmos_benchmarks over the training
+# corpus. Reconfigure with COSMOS_PGO=USE and rebuild afterwards.
+function(cosmos_add_pgo_training)
+    if(NOT COSMOS_PGO STREQUAL "GENERATE")
+        return()
+    endif()
+    if(NOT TARGET cosmos_benchmarks)
+        message(FATAL_ERROR "COSMOS_PGO=GENERATE trains with the benchmarks: add -DCOSMOS_BUILD_BENCHMARKS=ON")
+    endif()
+
+    set(args --profile-dir ${COSMOS_PGO_DIR})
+    if(COSMOS_PGO_CORPUS)
+        list(APPEND args --corpus ${COSMOS_PGO_CORPUS})
+    endif()
+    if(COSMOS_LLVM_PROFDATA)
+        list(APPEND args --llvm-profdata ${COSMOS_LLVM_PROFDATA})
+    endif()
+    add_custom_target(cosmos_pgo_train
+        COMMAND ${Python_EXECUTABLE} ${CMAKE_CURRENT_SOURCE_DIR}/benchmarks/pgo_train.py ${args}
+                baseline=$<TARGET_FILE:cosmos_benchmarks>
+        DEPENDS cosmos_benchmarks
+        COMMENT "Training PGO profiles on the benchmark corpus"
+        VERBATIM
+    )
+endfunction()
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <atomic>
+#include <stdexcept>
+
+/**
+ * Thrown by long-running native work once its CancelToken is triggered.
+ */
+class JobCancelled : public std::runtime_error {
+public:
+    JobCancelled() : std::runtime_error("Job was cancelled") {}
+};
+
+/**
+ * Cooperative cancellation flag. Work polls it at safe points (e.g. between
+ * PDF pages); cancel() may be called from any thread.
+ */
+class CancelToken {
+public:
+    void cancel() { cancelled_.store(true, std::memory_order_relaxed); }
+    bool cancelled() const { return cancelled_.load(std::memory_order_relaxed); }
+
+    void throw_if_cancelled() const {
+        if (cancelled()) {
+            throw JobCancelled();
+        }
+    }
+
+private:
+    std::atomic<bool> cancelled_{false};
+};
@@ -0,0 +1,35 @@
+#include "hex_encoding.h"
+
+#include <array>
+#include <cstring>
+
+using namespace std;
+
+namespace {
+
+// "000102...feff": the two hex digits of every byte value
+constexpr array<char, 512> make_hex_table() {
+    array<char, 512> table{};
+    const char digits[] = "0123456789abcdef";
+    for (size_t i = 0; i < 256; ++i) {
+        table[2 * i] = digits[i >> 4];
+        table[2 * i + 1] = digits[i & 0x0f];
+    }
+    return table;
+}
+
+constexpr array<char, 512> kHexPairs = make_hex_table();
+
+} // namespace
+
+void hex_encode_to(const unsigned char* data, size_t size, char* out) {
+    for (size_t i = 0; i < size; ++i) {
+        memcpy(out + 2 * i, &kHexPairs[2 * data[i]], 2);
+    }
+}
+
+string hex_encode(const unsigned char* data, size_t size) {
+    string hex(size * 2, '\0');
+    hex_encode_to(data, size, &hex[0]);
+    return hex;
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+/**
+ * Lowercase hexadecimal representation of a byte range.
+ *
+ * Table driven: each input byte is written as one precomputed two-character
+ * pair, so digests are encoded without any per-byte formatting calls.
+ */
+std::string hex_encode(const unsigned char* data, size_t size);
+
+/**
+ * Writes 2 * size lowercase hex characters to out (no terminator).
+ */
+void hex_encode_to(const unsigned char* data, size_t size, char* out);
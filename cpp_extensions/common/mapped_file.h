@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * Read-only memory mapping of a whole file, unmapped on destruction.
+ */
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path) {
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            throw std::runtime_error("Failed to open " + path + ": " + std::strerror(errno));
+        }
+
+        try {
+            map(fd, path);
+        } catch (...) {
+            ::close(fd);
+            throw;
+        }
+        ::close(fd);
+    }
+
+    /**
+     * Maps the whole file behind an open descriptor, independent of its
+     * current offset. The descriptor stays owned by the caller and may be
+     * closed as soon as the constructor returns.
+     */
+    explicit MappedFile(int fd) {
+        map(fd, "file descriptor " + std::to_string(fd));
+    }
+
+    ~MappedFile() {
+        if (data_) {
+            ::munmap(data_, size_);
+        }
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const char* data() const { return static_cast<const char*>(data_); }
+    size_t size() const { return size_; }
+    std::string_view view() const { return std::string_view(data(), size_); }
+
+private:
+    void map(int fd, const std::string& name) {
+        struct stat st;
+        if (::fstat(fd, &st) != 0) {
+            int err = errno;
+            throw std::runtime_error("Failed to stat " + name + ": " + std::strerror(err));
+        }
+
+        size_ = static_cast<size_t>(st.st_size);
+        if (size_ > 0) {
+            void* mapping = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapping == MAP_FAILED) {
+                int err = errno;
+                throw std::runtime_error("Failed to map " + name + ": " + std::strerror(err));
+            }
+            data_ = mapping;
+            // Callers read the mapping front to back
+            ::madvise(data_, size_, MADV_SEQUENTIAL);
+        }
+    }
+
+    void* data_ = nullptr;
+    size_t size_ = 0;
+};
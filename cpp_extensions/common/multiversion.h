@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>  // defines __GLIBC__ on glibc systems
+
+/**
+ * Function multiversioning for the plain C++ hot loops. COSMOS_MULTIVERSIONED
+ * compiles a function once per x86-64 ISA level (baseline, v2, v3 and v4) and
+ * the dynamic loader binds each call site to the clone the CPU supports on
+ * first use (target_clones, resolved through an ifunc). The compiler then
+ * vectorizes each clone for its level, so one build runs the wide
+ * instructions on new CPUs and still loads on old ones.
+ *
+ * Calls go through the ifunc and cannot be inlined, so only functions doing
+ * a loop's worth of work per call should be marked. Hand-written intrinsic
+ * kernels keep their own runtime selection. Where ifuncs are unavailable
+ * (non-glibc, non-x86-64 or an older compiler) the macro expands to nothing.
+ */
+#if defined(__x86_64__) && defined(__ELF__) && defined(__GLIBC__) && \
+    ((defined(__clang__) && __clang_major__ >= 14) || (!defined(__clang__) && defined(__GNUC__) && __GNUC__ >= 11))
+#define COSMOS_MULTIVERSIONED \
+    __attribute__((target_clones("default", "arch=x86-64-v2", "arch=x86-64-v3", "arch=x86-64-v4")))
+#define COSMOS_HAS_MULTIVERSIONING 1
+#else
+#define COSMOS_MULTIVERSIONED
+#define COSMOS_HAS_MULTIVERSIONING 0
+#endif
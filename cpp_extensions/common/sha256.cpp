@@ -0,0 +1,55 @@
+#include "sha256.h"
+#include "hex_encoding.h"
+
+#include <openssl/evp.h>
+
+#include <memory>
+#include <stdexcept>
+
+using namespace std;
+
+namespace {
+
+EVP_MD_CTX* thread_digest_context() {
+    thread_local unique_ptr<EVP_MD_CTX, decltype(&EVP_MD_CTX_free)> context(EVP_MD_CTX_new(), &EVP_MD_CTX_free);
+    if (!context) {
+        throw runtime_error("Failed to allocate SHA-256 context");
+    }
+    return context.get();
+}
+
+} // namespace
+
+Sha256Digest sha256_digest(const void* data, size_t size) {
+    Sha256Digest digest;
+    unsigned int digest_len = 0;
+
+    EVP_MD_CTX* context = thread_digest_context();
+    if (EVP_DigestInit_ex(context, EVP_sha256(), nullptr) != 1 ||
+        EVP_DigestUpdate(context, data, size) != 1 ||
+        EVP_DigestFinal_ex(context, digest.data(), &digest_len) != 1) {
+        throw runtime_error("SHA-256 computation failed");
+    }
+    return digest;
+}
+
+Sha256Digest sha256_digest_prefixed(unsigned char prefix, const void* first, size_t first_size,
+                                    const void* second, size_t second_size) {
+    Sha256Digest digest;
+    unsigned int digest_len = 0;
+
+    EVP_MD_CTX* context = thread_digest_context();
+    if (EVP_DigestInit_ex(context, EVP_sha256(), nullptr) != 1 ||
+        EVP_DigestUpdate(context, &prefix, 1) != 1 ||
+        EVP_DigestUpdate(context, first, first_size) != 1 ||
+        (second_size > 0 && EVP_DigestUpdate(context, second, second_size) != 1) ||
+        EVP_DigestFinal_ex(context, digest.data(), &digest_len) != 1) {
+        throw runtime_error("SHA-256 computation failed");
+    }
+    return digest;
+}
+
+string sha256_hash(const unsigned char* data, size_t size) {
+    Sha256Digest digest = sha256_digest(data, size);
+    return hex_encode(digest.data(), digest.size());
+}
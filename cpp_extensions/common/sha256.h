@@ -0,0 +1,36 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <string>
+
+using Sha256Digest = std::array<unsigned char, 32>;
+
+/**
+ * Raw SHA-256 digest of a binary buffer.
+ *
+ * Reuses one OpenSSL digest context per thread, so hashing many small
+ * buffers (e.g. chunks) does not allocate a context for every call.
+ *
+ * @param data The binary data to hash
+ * @param size The size of the data in bytes
+ * @return The 32-byte digest
+ */
+Sha256Digest sha256_digest(const void* data, size_t size);
+
+/**
+ * Raw SHA-256 digest of a one-byte domain prefix followed by up to two byte
+ * ranges, as hash trees combine their nodes; uses the same per-thread
+ * context as sha256_digest.
+ */
+Sha256Digest sha256_digest_prefixed(unsigned char prefix, const void* first, size_t first_size,
+                                    const void* second = nullptr, size_t second_size = 0);
+
+/**
+ * Generate SHA-256 hash of a binary buffer.
+ *
+ * @param data The binary data to hash
+ * @param size The size of the data in bytes
+ * @return Hexadecimal string representation of the hash
+ */
+std::string sha256_hash(const unsigned char* data, size_t size);
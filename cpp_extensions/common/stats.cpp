@@ -0,0 +1,167 @@
+#include "stats.h"
+#include "trace.h"
+
+#include <map>
+#include <memory>
+#include <mutex>
+
+using namespace std;
+
+namespace {
+
+size_t bucket_for(uint64_t ns) {
+    if (ns == 0) {
+        return 0;
+    }
+#if defined(__GNUC__) || defined(__clang__)
+    return 63 - static_cast<size_t>(__builtin_clzll(ns));
+#else
+    size_t bucket = 0;
+    while (ns >>= 1) {
+        ++bucket;
+    }
+    return bucket;
+#endif
+}
+
+uint64_t unix_time_ns() {
+    return static_cast<uint64_t>(
+        chrono::duration_cast<chrono::nanoseconds>(chrono::system_clock::now().time_since_epoch()).count());
+}
+
+/**
+ * Owns every metric. Leaked on purpose: metrics may still be touched by
+ * pool threads while static destructors run at exit.
+ */
+struct StatRegistry {
+    mutex guard;
+    map<pair<string, string>, unique_ptr<StatCounter>> counters;
+    map<pair<string, string>, unique_ptr<StatHistogram>> histograms;
+};
+
+StatRegistry& registry() {
+    static StatRegistry* instance = new StatRegistry();
+    return *instance;
+}
+
+// Metrics are keyed by (module, name), so a module's metrics are contiguous
+template <typename Metrics, typename Visit>
+void for_each_in_module(Metrics& metrics, const string& module, Visit&& visit) {
+    for (auto it = metrics.lower_bound(make_pair(module, string()));
+         it != metrics.end() && it->first.first == module; ++it) {
+        visit(it->first.second, *it->second);
+    }
+}
+
+} // namespace
+
+uint64_t StatHistogram::Snapshot::percentile(double q) const {
+    if (count == 0) {
+        return 0;
+    }
+    const double rank = q * static_cast<double>(count);
+    uint64_t target = rank <= 1.0 ? 1 : static_cast<uint64_t>(rank);
+    if (static_cast<double>(target) < rank) {
+        ++target;
+    }
+    uint64_t seen = 0;
+    for (size_t b = 0; b < kBuckets; ++b) {
+        seen += buckets[b];
+        if (seen >= target) {
+            const uint64_t upper = b == kBuckets - 1 ? UINT64_MAX : (uint64_t(2) << b) - 1;
+            return upper < max ? upper : max;
+        }
+    }
+    return max;
+}
+
+void StatHistogram::record(uint64_t ns) {
+    count_.fetch_add(1, memory_order_relaxed);
+    sum_.fetch_add(ns, memory_order_relaxed);
+    buckets_[bucket_for(ns)].fetch_add(1, memory_order_relaxed);
+
+    uint64_t current = min_.load(memory_order_relaxed);
+    while (ns < current && !min_.compare_exchange_weak(current, ns, memory_order_relaxed)) {
+    }
+    current = max_.load(memory_order_relaxed);
+    while (ns > current && !max_.compare_exchange_weak(current, ns, memory_order_relaxed)) {
+    }
+}
+
+StatHistogram::Snapshot StatHistogram::snapshot() const {
+    Snapshot snapshot;
+    snapshot.count = count_.load(memory_order_relaxed);
+    snapshot.sum = sum_.load(memory_order_relaxed);
+    const uint64_t min = min_.load(memory_order_relaxed);
+    snapshot.min = min == UINT64_MAX ? 0 : min;
+    snapshot.max = max_.load(memory_order_relaxed);
+    for (size_t b = 0; b < kBuckets; ++b) {
+        snapshot.buckets[b] = buckets_[b].load(memory_order_relaxed);
+    }
+    return snapshot;
+}
+
+void StatHistogram::reset() {
+    count_.store(0, memory_order_relaxed);
+    sum_.store(0, memory_order_relaxed);
+    min_.store(UINT64_MAX, memory_order_relaxed);
+    max_.store(0, memory_order_relaxed);
+    for (atomic<uint64_t>& bucket : buckets_) {
+        bucket.store(0, memory_order_relaxed);
+    }
+}
+
+StatCounter& stat_counter(const string& module, const string& name) {
+    StatRegistry& stats = registry();
+    lock_guard<mutex> lock(stats.guard);
+    unique_ptr<StatCounter>& counter = stats.counters[make_pair(module, name)];
+    if (!counter) {
+        counter = make_unique<StatCounter>();
+    }
+    return *counter;
+}
+
+StatHistogram& stat_histogram(const string& module, const string& phase) {
+    StatRegistry& stats = registry();
+    lock_guard<mutex> lock(stats.guard);
+    unique_ptr<StatHistogram>& histogram = stats.histograms[make_pair(module, phase)];
+    if (!histogram) {
+        histogram = make_unique<StatHistogram>(module, phase);
+    }
+    return *histogram;
+}
+
+ModuleStats module_stats(const string& module) {
+    StatRegistry& stats = registry();
+    lock_guard<mutex> lock(stats.guard);
+    ModuleStats result;
+    for_each_in_module(stats.counters, module, [&](const string& name, const StatCounter& counter) {
+        result.counters.emplace_back(name, counter.value());
+    });
+    for_each_in_module(stats.histograms, module, [&](const string& phase, const StatHistogram& histogram) {
+        result.histograms.emplace_back(phase, histogram.snapshot());
+    });
+    return result;
+}
+
+void reset_module_stats(const string& module) {
+    StatRegistry& stats = registry();
+    lock_guard<mutex> lock(stats.guard);
+    for_each_in_module(stats.counters, module, [](const string&, StatCounter& counter) { counter.reset(); });
+    for_each_in_module(stats.histograms, module, [](const string&, StatHistogram& histogram) { histogram.reset(); });
+}
+
+ScopedTimer::ScopedTimer(StatHistogram& histogram)
+    : histogram_(histogram),
+      start_(chrono::steady_clock::now()),
+      trace_start_ns_(tracing_enabled() ? unix_time_ns() : 0) {}
+
+ScopedTimer::~ScopedTimer() {
+    const uint64_t elapsed = static_cast<uint64_t>(
+        chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start_).count());
+    histogram_.record(elapsed);
+    if (trace_start_ns_ != 0) {
+        record_trace_event({histogram_.module().c_str(), histogram_.phase().c_str(), trace_start_ns_, elapsed,
+                            current_trace_thread_id()});
+    }
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * Monotonic count, e.g. bytes processed. Updates are relaxed atomic adds, so
+ * counters can be bumped from any thread on hot paths.
+ */
+class StatCounter {
+public:
+    void add(uint64_t amount = 1) { value_.fetch_add(amount, std::memory_order_relaxed); }
+    uint64_t value() const { return value_.load(std::memory_order_relaxed); }
+    void reset() { value_.store(0, std::memory_order_relaxed); }
+
+private:
+    std::atomic<uint64_t> value_{0};
+};
+
+/**
+ * Distribution of durations in nanoseconds over power-of-two buckets:
+ * bucket b holds values in [2^b, 2^(b+1)), bucket 0 also holds 0.
+ * Recording is a handful of relaxed atomic operations.
+ */
+class StatHistogram {
+public:
+    static constexpr size_t kBuckets = 64;
+
+    struct Snapshot {
+        uint64_t count = 0;
+        uint64_t sum = 0;
+        uint64_t min = 0;
+        uint64_t max = 0;
+        std::array<uint64_t, kBuckets> buckets{};
+
+        /** Upper bound of the bucket holding quantile q (0..1), capped at max. */
+        uint64_t percentile(double q) const;
+    };
+
+    StatHistogram(std::string module, std::string phase)
+        : module_(std::move(module)), phase_(std::move(phase)) {}
+
+    const std::string& module() const { return module_; }
+    const std::string& phase() const { return phase_; }
+
+    void record(uint64_t ns);
+
+    /**
+     * Point-in-time copy; concurrent updates may be partially included, so
+     * count and sum can disagree slightly while work is in flight.
+     */
+    Snapshot snapshot() const;
+    void reset();
+
+private:
+    std::string module_;
+    std::string phase_;
+    std::atomic<uint64_t> count_{0};
+    std::atomic<uint64_t> sum_{0};
+    std::atomic<uint64_t> min_{UINT64_MAX};
+    std::atomic<uint64_t> max_{0};
+    std::array<std::atomic<uint64_t>, kBuckets> buckets_{};
+};
+
+/**
+ * Named metrics of a module ("text_chunker", "pdf_extractor", ...), created
+ * on first use and never destroyed, so hot paths can keep the references in
+ * function-local statics.
+ */
+StatCounter& stat_counter(const std::string& module, const std::string& name);
+StatHistogram& stat_histogram(const std::string& module, const std::string& phase);
+
+struct ModuleStats {
+    std::vector<std::pair<std::string, uint64_t>> counters;
+    std::vector<std::pair<std::string, StatHistogram::Snapshot>> histograms;
+};
+
+/** Current values of every metric of module, in name order. */
+ModuleStats module_stats(const std::string& module);
+
+/** Zeroes every metric of module. */
+void reset_module_stats(const std::string& module);
+
+/**
+ * Times a scope into a histogram and, while tracing is enabled, also records
+ * it as a trace event named after the histogram's phase (see trace.h).
+ */
+class ScopedTimer {
+public:
+    explicit ScopedTimer(StatHistogram& histogram);
+    ~ScopedTimer();
+
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+private:
+    StatHistogram& histogram_;
+    std::chrono::steady_clock::time_point start_;
+    // Wall-clock start in Unix nanoseconds, 0 when not tracing
+    uint64_t trace_start_ns_;
+};
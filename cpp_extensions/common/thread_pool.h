@@ -0,0 +1,158 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Fixed-size pool of worker threads used by the batch entry points.
+ * Work is submitted through parallel_for, which blocks until done and
+ * runs part of the work on the calling thread.
+ */
+class ThreadPool {
+public:
+    explicit ThreadPool(size_t thread_count) {
+        workers_.reserve(thread_count);
+        for (size_t i = 0; i < thread_count; ++i) {
+            workers_.emplace_back([this] { run_worker(); });
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        ready_.notify_all();
+        for (auto& worker : workers_) {
+            worker.join();
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    size_t size() const { return workers_.size(); }
+
+    /**
+     * Calls body(i) for every i in [0, count) using up to max_threads threads
+     * (0 means all workers plus the caller). The first exception thrown by any
+     * call is rethrown here once all started calls have finished.
+     */
+    template <typename Body>
+    void parallel_for(size_t count, Body&& body, size_t max_threads = 0) {
+        if (count == 0) {
+            return;
+        }
+
+        size_t threads = max_threads == 0 ? workers_.size() + 1 : max_threads;
+        threads = std::min(threads, count);
+
+        std::atomic<size_t> next_index{0};
+        std::exception_ptr error;
+        std::mutex error_mutex;
+
+        auto drain = [&] {
+            for (size_t i = next_index.fetch_add(1); i < count; i = next_index.fetch_add(1)) {
+                try {
+                    body(i);
+                } catch (...) {
+                    std::lock_guard<std::mutex> lock(error_mutex);
+                    if (!error) {
+                        error = std::current_exception();
+                    }
+                    // Stop handing out further work
+                    next_index.store(count);
+                }
+            }
+        };
+
+        // Helpers that only get dequeued after the caller has finished draining
+        // see `closed` and return without touching the caller's stack
+        auto state = std::make_shared<ParallelForState>();
+        state->drain = drain;
+
+        size_t helpers = std::min(threads - 1, workers_.size());
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            for (size_t i = 0; i < helpers; ++i) {
+                tasks_.emplace_back([state] {
+                    {
+                        std::lock_guard<std::mutex> state_lock(state->mutex);
+                        if (state->closed) {
+                            return;
+                        }
+                        ++state->active;
+                    }
+                    state->drain();
+                    std::lock_guard<std::mutex> state_lock(state->mutex);
+                    if (--state->active == 0) {
+                        state->idle.notify_all();
+                    }
+                });
+            }
+        }
+        ready_.notify_all();
+
+        drain();
+
+        {
+            std::unique_lock<std::mutex> lock(state->mutex);
+            state->closed = true;
+            state->idle.wait(lock, [&] { return state->active == 0; });
+        }
+
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+
+private:
+    struct ParallelForState {
+        std::mutex mutex;
+        std::condition_variable idle;
+        size_t active = 0;
+        bool closed = false;
+        std::function<void()> drain;
+    };
+
+    void run_worker() {
+        for (;;) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                ready_.wait(lock, [this] { return stopping_ || !tasks_.empty(); });
+                if (stopping_ && tasks_.empty()) {
+                    return;
+                }
+                task = std::move(tasks_.front());
+                tasks_.pop_front();
+            }
+            task();
+        }
+    }
+
+    std::vector<std::thread> workers_;
+    std::deque<std::function<void()>> tasks_;
+    std::mutex mutex_;
+    std::condition_variable ready_;
+    bool stopping_ = false;
+};
+
+/**
+ * Process-wide pool with one worker per hardware thread (minus the caller).
+ * It is intentionally never destroyed so that worker threads are not joined
+ * during interpreter shutdown.
+ */
+inline ThreadPool& shared_thread_pool() {
+    static ThreadPool* pool = new ThreadPool(std::max(1u, std::thread::hardware_concurrency()) - 1);
+    return *pool;
+}
@@ -0,0 +1,201 @@
+#include "trace.h"
+#include "hex_encoding.h"
+
+#include <atomic>
+#include <mutex>
+#include <stdexcept>
+
+#include <unistd.h>
+
+using namespace std;
+
+namespace {
+
+/** Process-wide event buffer; leaked like the stat registry. */
+struct TraceBuffer {
+    atomic<bool> enabled{false};
+    atomic<uint64_t> dropped{0};
+    mutex guard;
+    vector<TraceEvent> events;
+    size_t max_events = 0;
+};
+
+TraceBuffer& trace_buffer() {
+    static TraceBuffer* instance = new TraceBuffer();
+    return *instance;
+}
+
+string to_lower_hex(string value) {
+    for (char& c : value) {
+        if (c >= 'A' && c <= 'F') {
+            c = static_cast<char>(c - 'A' + 'a');
+        }
+    }
+    return value;
+}
+
+bool is_hex(const string& value) {
+    for (char c : value) {
+        if (!((c >= '0' && c <= '9') || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F'))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void append_json_string(string& out, const string& value) {
+    static const char kHex[] = "0123456789abcdef";
+    out += '"';
+    for (char c : value) {
+        const unsigned char byte = static_cast<unsigned char>(c);
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if (byte < 0x20) {
+            out += "\\u00";
+            out += kHex[byte >> 4];
+            out += kHex[byte & 0xf];
+        } else {
+            out += c;
+        }
+    }
+    out += '"';
+}
+
+// Microseconds with nanosecond precision, formatted without going through
+// a double (Unix times in microseconds exceed its exact range)
+void append_microseconds(string& out, uint64_t ns) {
+    const string fraction = to_string(ns % 1000);
+    out += to_string(ns / 1000);
+    out += '.';
+    out.append(3 - fraction.size(), '0');
+    out += fraction;
+}
+
+string span_id_for(const TraceEvent& event, size_t index) {
+    uint64_t z = event.start_ns + 0x9E3779B97F4A7C15ULL * (index + 1);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    z ^= z >> 31;
+    if (z == 0) {
+        z = 1;  // all-zero span ids are invalid
+    }
+    unsigned char bytes[8];
+    for (int i = 7; i >= 0; --i) {
+        bytes[i] = static_cast<unsigned char>(z & 0xff);
+        z >>= 8;
+    }
+    return hex_encode(bytes, sizeof(bytes));
+}
+
+} // namespace
+
+bool tracing_enabled() {
+    return trace_buffer().enabled.load(memory_order_relaxed);
+}
+
+void start_tracing(size_t max_events) {
+    TraceBuffer& buffer = trace_buffer();
+    lock_guard<mutex> lock(buffer.guard);
+    buffer.max_events = max_events;
+    buffer.enabled.store(true, memory_order_relaxed);
+}
+
+void stop_tracing() {
+    trace_buffer().enabled.store(false, memory_order_relaxed);
+}
+
+void record_trace_event(const TraceEvent& event) {
+    TraceBuffer& buffer = trace_buffer();
+    if (!buffer.enabled.load(memory_order_relaxed)) {
+        return;
+    }
+    lock_guard<mutex> lock(buffer.guard);
+    if (buffer.events.size() >= buffer.max_events) {
+        buffer.dropped.fetch_add(1, memory_order_relaxed);
+        return;
+    }
+    buffer.events.push_back(event);
+}
+
+vector<TraceEvent> trace_events(bool clear) {
+    TraceBuffer& buffer = trace_buffer();
+    lock_guard<mutex> lock(buffer.guard);
+    if (!clear) {
+        return buffer.events;
+    }
+    vector<TraceEvent> events;
+    events.swap(buffer.events);
+    buffer.dropped.store(0, memory_order_relaxed);
+    return events;
+}
+
+uint64_t dropped_trace_events() {
+    return trace_buffer().dropped.load(memory_order_relaxed);
+}
+
+uint32_t current_trace_thread_id() {
+    static atomic<uint32_t> next_id{1};
+    thread_local const uint32_t id = next_id.fetch_add(1, memory_order_relaxed);
+    return id;
+}
+
+string chrome_trace_json(const vector<TraceEvent>& events) {
+    const string pid = to_string(getpid());
+    string out = "{\"traceEvents\":[";
+    out.reserve(out.size() + events.size() * 128);
+    for (size_t i = 0; i < events.size(); ++i) {
+        const TraceEvent& event = events[i];
+        if (i != 0) {
+            out += ',';
+        }
+        out += "{\"name\":";
+        append_json_string(out, event.name);
+        out += ",\"cat\":";
+        append_json_string(out, event.category);
+        out += ",\"ph\":\"X\",\"ts\":";
+        append_microseconds(out, event.start_ns);
+        out += ",\"dur\":";
+        append_microseconds(out, event.duration_ns);
+        out += ",\"pid\":" + pid + ",\"tid\":" + to_string(event.thread_id) + "}";
+    }
+    out += "],\"displayTimeUnit\":\"ms\"}";
+    return out;
+}
+
+string otlp_trace_json(const vector<TraceEvent>& events, const string& service_name,
+                       const string& trace_id_hex, const string& parent_span_id_hex) {
+    if (trace_id_hex.size() != 32 || !is_hex(trace_id_hex)) {
+        throw invalid_argument("trace_id must be 32 hex digits, got '" + trace_id_hex + "'");
+    }
+    if (!parent_span_id_hex.empty() && (parent_span_id_hex.size() != 16 || !is_hex(parent_span_id_hex))) {
+        throw invalid_argument("parent_span_id must be 16 hex digits, got '" + parent_span_id_hex + "'");
+    }
+    // OTLP/JSON ids are lowercase hex
+    const string trace_id = to_lower_hex(trace_id_hex);
+    const string parent_span_id = to_lower_hex(parent_span_id_hex);
+
+    string out = "{\"resourceSpans\":[{\"resource\":{\"attributes\":[{\"key\":\"service.name\",\"value\":{\"stringValue\":";
+    append_json_string(out, service_name);
+    out += "}}]},\"scopeSpans\":[{\"scope\":{\"name\":\"cosmos_native\"},\"spans\":[";
+    out.reserve(out.size() + events.size() * 320);
+    for (size_t i = 0; i < events.size(); ++i) {
+        const TraceEvent& event = events[i];
+        if (i != 0) {
+            out += ',';
+        }
+        out += "{\"traceId\":\"" + trace_id + "\",\"spanId\":\"" + span_id_for(event, i) + "\"";
+        if (!parent_span_id.empty()) {
+            out += ",\"parentSpanId\":\"" + parent_span_id + "\"";
+        }
+        out += ",\"name\":";
+        append_json_string(out, string(event.category) + "." + event.name);
+        // kind 1 = SPAN_KIND_INTERNAL; 64-bit integers are strings in OTLP/JSON
+        out += ",\"kind\":1,\"startTimeUnixNano\":\"" + to_string(event.start_ns) +
+               "\",\"endTimeUnixNano\":\"" + to_string(event.start_ns + event.duration_ns) +
+               "\",\"attributes\":[{\"key\":\"thread.id\",\"value\":{\"intValue\":\"" + to_string(event.thread_id) +
+               "\"}}]}";
+    }
+    out += "]}]}]}";
+    return out;
+}
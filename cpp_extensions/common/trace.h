@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * A completed scope, timestamped with the wall clock so it can be joined
+ * with traces recorded by other processes (e.g. the FastAPI request spans).
+ */
+struct TraceEvent {
+    const char* category;   // module, e.g. "pdf_extractor"
+    const char* name;       // phase, e.g. "parse"
+    uint64_t start_ns;      // Unix time in nanoseconds
+    uint64_t duration_ns;
+    uint32_t thread_id;     // small sequential id of the recording thread
+};
+
+/** True while events are being recorded; a relaxed atomic load. */
+bool tracing_enabled();
+
+/**
+ * Starts recording trace events process-wide, keeping at most max_events;
+ * later events are counted as dropped. Events already recorded are kept.
+ */
+void start_tracing(size_t max_events);
+void stop_tracing();
+
+/** Appends an event if tracing is enabled. Thread-safe. */
+void record_trace_event(const TraceEvent& event);
+
+/** Copies the recorded events; with clear, also discards them. */
+std::vector<TraceEvent> trace_events(bool clear);
+uint64_t dropped_trace_events();
+
+/** Small sequential id of the calling thread, stable for its lifetime. */
+uint32_t current_trace_thread_id();
+
+/** Chrome trace event format ("X" complete events), loadable by chrome://tracing and Perfetto. */
+std::string chrome_trace_json(const std::vector<TraceEvent>& events);
+
+/**
+ * OTLP/JSON ExportTraceServiceRequest with one span per event, all in
+ * trace_id (32 hex digits) and children of parent_span_id (16 hex digits,
+ * may be empty). Span ids are derived from the event index and start time.
+ */
+std::string otlp_trace_json(const std::vector<TraceEvent>& events, const std::string& service_name,
+                            const std::string& trace_id, const std::string& parent_span_id);
@@ -0,0 +1,108 @@
+#include "work_stealing_pool.h"
+
+#include <algorithm>
+#include <utility>
+
+using namespace std;
+
+namespace {
+
+// The pool and deque index of the calling worker thread, if any
+thread_local const WorkStealingPool* current_pool = nullptr;
+thread_local size_t current_worker = 0;
+
+}  // namespace
+
+WorkStealingPool::WorkStealingPool(size_t thread_count, StatCounter* steals) : steals_(steals) {
+    thread_count = max<size_t>(thread_count, 1);
+    queues_.reserve(thread_count);
+    for (size_t i = 0; i < thread_count; ++i) {
+        queues_.push_back(make_unique<WorkerQueue>());
+    }
+    workers_.reserve(thread_count);
+    for (size_t i = 0; i < thread_count; ++i) {
+        workers_.emplace_back([this, i] { run_worker(i); });
+    }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    {
+        lock_guard<mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    ready_.notify_all();
+    for (thread& worker : workers_) {
+        worker.join();
+    }
+}
+
+void WorkStealingPool::submit(function<void()> task) {
+    // Counted before it is published: a worker may take the task as soon as
+    // it is queued, and decrementing first would wrap queued_ around
+    {
+        lock_guard<mutex> lock(mutex_);
+        queued_.fetch_add(1);
+    }
+    if (current_pool == this) {
+        WorkerQueue& own = *queues_[current_worker];
+        lock_guard<mutex> lock(own.mutex);
+        own.tasks.push_back(move(task));
+    } else {
+        lock_guard<mutex> lock(injected_mutex_);
+        injected_.push_back(move(task));
+    }
+    ready_.notify_one();
+}
+
+bool WorkStealingPool::take_task(size_t self, function<void()>& task) {
+    {
+        WorkerQueue& own = *queues_[self];
+        lock_guard<mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = move(own.tasks.back());
+            own.tasks.pop_back();
+            queued_.fetch_sub(1);
+            return true;
+        }
+    }
+    {
+        lock_guard<mutex> lock(injected_mutex_);
+        if (!injected_.empty()) {
+            task = move(injected_.front());
+            injected_.pop_front();
+            queued_.fetch_sub(1);
+            return true;
+        }
+    }
+    for (size_t i = 1; i < queues_.size(); ++i) {
+        WorkerQueue& victim = *queues_[(self + i) % queues_.size()];
+        lock_guard<mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = move(victim.tasks.front());
+            victim.tasks.pop_front();
+            queued_.fetch_sub(1);
+            if (steals_) {
+                steals_->add();
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+void WorkStealingPool::run_worker(size_t index) {
+    current_pool = this;
+    current_worker = index;
+    for (;;) {
+        function<void()> task;
+        if (take_task(index, task)) {
+            task();
+            continue;
+        }
+        unique_lock<mutex> lock(mutex_);
+        ready_.wait(lock, [this] { return stopping_ || queued_.load() > 0; });
+        if (stopping_ && queued_.load() == 0) {
+            return;
+        }
+    }
+}
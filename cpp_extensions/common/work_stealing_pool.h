@@ -0,0 +1,67 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "stats.h"
+
+/**
+ * Fixed-size pool of worker threads for independent, fire-and-forget tasks
+ * such as ingestion jobs (ThreadPool only serves blocking parallel_for calls).
+ *
+ * Every worker owns a deque. Tasks submitted from a worker (follow-up work of
+ * a running task) go to the back of its own deque and are taken newest first
+ * while their inputs are still in cache; tasks submitted from other threads go
+ * to a shared FIFO injection queue. A worker with nothing left to do steals
+ * the oldest task of another worker before going to sleep.
+ */
+class WorkStealingPool {
+public:
+    /**
+     * @param thread_count Number of workers (at least one is started)
+     * @param steals Optional counter bumped for every stolen task
+     */
+    explicit WorkStealingPool(size_t thread_count, StatCounter* steals = nullptr);
+
+    /** Runs every task that is still queued, then joins the workers. */
+    ~WorkStealingPool();
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    size_t size() const { return workers_.size(); }
+
+    /** Queues task; it must not throw. Thread-safe. */
+    void submit(std::function<void()> task);
+
+private:
+    struct WorkerQueue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    bool take_task(size_t self, std::function<void()>& task);
+    void run_worker(size_t index);
+
+    std::vector<std::unique_ptr<WorkerQueue>> queues_;
+    std::mutex injected_mutex_;
+    std::deque<std::function<void()>> injected_;
+    StatCounter* steals_;
+
+    // Sleeping workers wait on ready_; queued_ counts the tasks in all queues
+    // and is only incremented while mutex_ is held, so no wakeup is lost. It
+    // is incremented before a task is queued, so it never drops below zero.
+    std::mutex mutex_;
+    std::condition_variable ready_;
+    std::atomic<size_t> queued_{0};
+    bool stopping_ = false;
+
+    std::vector<std::thread> workers_;
+};
@@ -0,0 +1,310 @@
+#include "chunk_hash_index.h"
+#include "xxh64.h"
+#include "hex_encoding.h"
+#include "sha256.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+#include <unistd.h>
+
+using namespace std;
+
+namespace {
+
+// File layout: magic, then little-endian u32 version, u32 algorithm,
+// u64 key count, followed by the raw keys (8 or 32 bytes each)
+const char kIndexMagic[4] = {'C', 'H', 'I', 'X'};
+const uint32_t kIndexVersion = 1;
+
+void write_le(ostream& out, uint64_t value, int bytes) {
+    for (int i = 0; i < bytes; ++i) {
+        out.put(static_cast<char>((value >> (8 * i)) & 0xff));
+    }
+}
+
+uint64_t read_le(istream& in, int bytes) {
+    uint64_t value = 0;
+    for (int i = 0; i < bytes; ++i) {
+        int byte = in.get();
+        if (byte == EOF) {
+            throw runtime_error("Truncated chunk hash index");
+        }
+        value |= static_cast<uint64_t>(byte) << (8 * i);
+    }
+    return value;
+}
+
+int hex_value(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// XXH64 keys are stored big-endian, matching the canonical hex form
+uint64_t xxh64_from_key(const unsigned char* key) {
+    uint64_t value = 0;
+    for (int i = 0; i < 8; ++i) {
+        value = (value << 8) | key[i];
+    }
+    return value;
+}
+
+void xxh64_to_key(uint64_t value, unsigned char* key) {
+    for (int i = 7; i >= 0; --i) {
+        key[i] = static_cast<unsigned char>(value & 0xff);
+        value >>= 8;
+    }
+}
+
+} // namespace
+
+ChunkHashAlgorithm parse_chunk_hash_algorithm(const string& name) {
+    if (name == "xxh64") {
+        return ChunkHashAlgorithm::Xxh64;
+    }
+    if (name == "sha256") {
+        return ChunkHashAlgorithm::Sha256;
+    }
+    throw invalid_argument("Unknown chunk hash algorithm '" + name + "', expected xxh64 or sha256");
+}
+
+const char* chunk_hash_algorithm_name(ChunkHashAlgorithm algorithm) {
+    return algorithm == ChunkHashAlgorithm::Xxh64 ? "xxh64" : "sha256";
+}
+
+ChunkHashIndex::ChunkHashIndex(ChunkHashAlgorithm algorithm) : algorithm_(algorithm) {}
+
+size_t ChunkHashIndex::key_size() const {
+    return algorithm_ == ChunkHashAlgorithm::Xxh64 ? 8 : 32;
+}
+
+ChunkHashIndex::Key ChunkHashIndex::key_for(string_view chunk) const {
+    Key key{};
+    if (algorithm_ == ChunkHashAlgorithm::Xxh64) {
+        xxh64_to_key(xxh64(chunk.data(), chunk.size()), key.data());
+    } else {
+        Sha256Digest digest = sha256_digest(chunk.data(), chunk.size());
+        copy(digest.begin(), digest.end(), key.begin());
+    }
+    return key;
+}
+
+ChunkHashIndex::Key ChunkHashIndex::key_from_hex(const string& hex) const {
+    if (hex.size() != key_size() * 2) {
+        throw invalid_argument("Expected a " + to_string(key_size() * 2) + "-digit " +
+                               chunk_hash_algorithm_name(algorithm_) + " hash, got '" + hex + "'");
+    }
+    Key key{};
+    for (size_t i = 0; i < key_size(); ++i) {
+        int high = hex_value(hex[2 * i]);
+        int low = hex_value(hex[2 * i + 1]);
+        if (high < 0 || low < 0) {
+            throw invalid_argument("Invalid hex digit in hash '" + hex + "'");
+        }
+        key[i] = static_cast<unsigned char>((high << 4) | low);
+    }
+    return key;
+}
+
+bool ChunkHashIndex::insert_key(const Key& key) {
+    if (algorithm_ == ChunkHashAlgorithm::Xxh64) {
+        return xxh64_keys_.insert(xxh64_from_key(key.data())).second;
+    }
+    return sha256_keys_.insert(key).second;
+}
+
+bool ChunkHashIndex::erase_key(const Key& key) {
+    if (algorithm_ == ChunkHashAlgorithm::Xxh64) {
+        return xxh64_keys_.erase(xxh64_from_key(key.data())) != 0;
+    }
+    return sha256_keys_.erase(key) != 0;
+}
+
+bool ChunkHashIndex::has_key(const Key& key) const {
+    if (algorithm_ == ChunkHashAlgorithm::Xxh64) {
+        return xxh64_keys_.count(xxh64_from_key(key.data())) != 0;
+    }
+    return sha256_keys_.count(key) != 0;
+}
+
+size_t ChunkHashIndex::size() const {
+    lock_guard<mutex> lock(mutex_);
+    return xxh64_keys_.size() + sha256_keys_.size();
+}
+
+pair<vector<size_t>, vector<size_t>> ChunkHashIndex::partition(const vector<string_view>& chunks, bool add) {
+    // Hash outside the lock; only set lookups are serialized
+    vector<Key> keys;
+    keys.reserve(chunks.size());
+    for (string_view chunk : chunks) {
+        keys.push_back(key_for(chunk));
+    }
+
+    pair<vector<size_t>, vector<size_t>> result;
+    lock_guard<mutex> lock(mutex_);
+    for (size_t i = 0; i < keys.size(); ++i) {
+        bool is_new = add ? insert_key(keys[i]) : !has_key(keys[i]);
+        (is_new ? result.second : result.first).push_back(i);
+    }
+    return result;
+}
+
+bool ChunkHashIndex::contains(string_view chunk) const {
+    Key key = key_for(chunk);
+    lock_guard<mutex> lock(mutex_);
+    return has_key(key);
+}
+
+size_t ChunkHashIndex::add(const vector<string_view>& chunks) {
+    return partition(chunks, true).second.size();
+}
+
+size_t ChunkHashIndex::add_hashes(const vector<string>& hex_hashes) {
+    vector<Key> keys;
+    keys.reserve(hex_hashes.size());
+    for (const string& hex : hex_hashes) {
+        keys.push_back(key_from_hex(hex));
+    }
+
+    size_t added = 0;
+    lock_guard<mutex> lock(mutex_);
+    for (const Key& key : keys) {
+        added += insert_key(key) ? 1 : 0;
+    }
+    return added;
+}
+
+size_t ChunkHashIndex::remove(const vector<string_view>& chunks) {
+    vector<Key> keys;
+    keys.reserve(chunks.size());
+    for (string_view chunk : chunks) {
+        keys.push_back(key_for(chunk));
+    }
+
+    size_t removed = 0;
+    lock_guard<mutex> lock(mutex_);
+    for (const Key& key : keys) {
+        removed += erase_key(key) ? 1 : 0;
+    }
+    return removed;
+}
+
+void ChunkHashIndex::clear() {
+    lock_guard<mutex> lock(mutex_);
+    xxh64_keys_.clear();
+    sha256_keys_.clear();
+}
+
+void ChunkHashIndex::save(const string& path) const {
+    // The lock is held until the file is in place, so concurrent saves from
+    // this process land in call order and each writes a complete snapshot
+    lock_guard<mutex> lock(mutex_);
+
+    ostringstream out;
+    out.write(kIndexMagic, sizeof(kIndexMagic));
+    write_le(out, kIndexVersion, 4);
+    write_le(out, static_cast<uint32_t>(algorithm_), 4);
+    if (algorithm_ == ChunkHashAlgorithm::Xxh64) {
+        write_le(out, xxh64_keys_.size(), 8);
+        unsigned char key[8];
+        for (uint64_t value : xxh64_keys_) {
+            xxh64_to_key(value, key);
+            out.write(reinterpret_cast<const char*>(key), sizeof(key));
+        }
+    } else {
+        write_le(out, sha256_keys_.size(), 8);
+        for (const Key& key : sha256_keys_) {
+            out.write(reinterpret_cast<const char*>(key.data()), key.size());
+        }
+    }
+    const string data = out.str();
+
+    // Write a uniquely named file next to the target and rename it, so
+    // readers never see a partial file and no other writer shares the temp
+    string temp_path = path + ".XXXXXX";
+    int fd = mkstemp(&temp_path[0]);
+    if (fd < 0) {
+        throw runtime_error("Failed to create a temporary file for " + path + ": " + strerror(errno));
+    }
+    auto fail = [&](const string& what) {
+        int err = errno;
+        ::close(fd);
+        ::unlink(temp_path.c_str());
+        throw runtime_error(what + ": " + strerror(err));
+    };
+
+    for (size_t written = 0; written < data.size();) {
+        ssize_t n = ::write(fd, data.data() + written, data.size() - written);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            fail("Failed to write " + temp_path);
+        }
+        written += static_cast<size_t>(n);
+    }
+    // The data must be on disk before the rename makes it the index
+    if (::fsync(fd) != 0) {
+        fail("Failed to sync " + temp_path);
+    }
+    if (::close(fd) != 0) {
+        int err = errno;
+        ::unlink(temp_path.c_str());
+        throw runtime_error("Failed to write " + temp_path + ": " + strerror(err));
+    }
+    if (rename(temp_path.c_str(), path.c_str()) != 0) {
+        int err = errno;
+        ::unlink(temp_path.c_str());
+        throw runtime_error("Failed to replace " + path + ": " + strerror(err));
+    }
+}
+
+unique_ptr<ChunkHashIndex> ChunkHashIndex::load(const string& path) {
+    ifstream in(path, ios::binary);
+    if (!in) {
+        throw runtime_error("Failed to open " + path);
+    }
+
+    char magic[sizeof(kIndexMagic)];
+    if (!in.read(magic, sizeof(magic)) || memcmp(magic, kIndexMagic, sizeof(magic)) != 0) {
+        throw runtime_error(path + " is not a chunk hash index");
+    }
+    uint64_t version = read_le(in, 4);
+    if (version != kIndexVersion) {
+        throw runtime_error("Unsupported chunk hash index version " + to_string(version) + " in " + path);
+    }
+    uint64_t algorithm = read_le(in, 4);
+    if (algorithm > static_cast<uint64_t>(ChunkHashAlgorithm::Sha256)) {
+        throw runtime_error("Unknown chunk hash algorithm in " + path);
+    }
+
+    auto index = make_unique<ChunkHashIndex>(static_cast<ChunkHashAlgorithm>(algorithm));
+    const uint64_t count = read_le(in, 8);
+    const size_t key_size = index->key_size();
+    Key key{};
+    for (uint64_t i = 0; i < count; ++i) {
+        if (!in.read(reinterpret_cast<char*>(key.data()), key_size)) {
+            throw runtime_error("Truncated chunk hash index " + path);
+        }
+        index->insert_key(key);
+    }
+    return index;
+}
+
+string chunk_content_hash(ChunkHashAlgorithm algorithm, string_view chunk) {
+    if (algorithm == ChunkHashAlgorithm::Xxh64) {
+        unsigned char key[8];
+        xxh64_to_key(xxh64(chunk.data(), chunk.size()), key);
+        return hex_encode(key, sizeof(key));
+    }
+    Sha256Digest digest = sha256_digest(chunk.data(), chunk.size());
+    return hex_encode(digest.data(), digest.size());
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+/**
+ * Content hash used to identify chunks across ingestions.
+ */
+enum class ChunkHashAlgorithm {
+    Xxh64,   // 8-byte XXH64, fast, for dedup within one deployment
+    Sha256   // 32-byte SHA-256, collision resistant
+};
+
+/**
+ * Parses "xxh64" or "sha256", throwing invalid_argument otherwise.
+ */
+ChunkHashAlgorithm parse_chunk_hash_algorithm(const std::string& name);
+
+const char* chunk_hash_algorithm_name(ChunkHashAlgorithm algorithm);
+
+/**
+ * Hex content hash of one chunk (16 digits for XXH64, 64 for SHA-256).
+ */
+std::string chunk_content_hash(ChunkHashAlgorithm algorithm, std::string_view chunk);
+
+/**
+ * Set of known chunk hashes, used to decide which chunks of a re-ingested
+ * document still need to be embedded.
+ *
+ * Only fixed-size binary digests are stored, so the index stays small even
+ * for millions of chunks, and it can be saved to and loaded from a file.
+ * All methods are thread-safe.
+ */
+class ChunkHashIndex {
+public:
+    explicit ChunkHashIndex(ChunkHashAlgorithm algorithm);
+
+    ChunkHashAlgorithm algorithm() const { return algorithm_; }
+    size_t size() const;
+
+    /**
+     * Splits chunks into those whose hash is already known and those that
+     * are new. With add, new hashes are recorded as they are seen, so a
+     * repeated chunk within the same call is reported as known.
+     *
+     * @return Pair of (unchanged indices, new indices) in input order
+     */
+    std::pair<std::vector<size_t>, std::vector<size_t>> partition(const std::vector<std::string_view>& chunks,
+                                                                  bool add);
+
+    bool contains(std::string_view chunk) const;
+
+    /** Records hashes of chunks; returns how many were not yet known. */
+    size_t add(const std::vector<std::string_view>& chunks);
+
+    /** Records hex hashes, e.g. content_hash values stored with existing vectors. */
+    size_t add_hashes(const std::vector<std::string>& hex_hashes);
+
+    /** Forgets the hashes of chunks, e.g. of deleted vectors; returns how many were known. */
+    size_t remove(const std::vector<std::string_view>& chunks);
+
+    void clear();
+
+    /**
+     * Writes the index to path, replacing any existing file. The snapshot is
+     * written to a unique temporary file in the same directory, synced and
+     * renamed over path, so concurrent writers never mix their output.
+     */
+    void save(const std::string& path) const;
+
+    /** Reads an index written by save(). */
+    static std::unique_ptr<ChunkHashIndex> load(const std::string& path);
+
+private:
+    using Key = std::array<unsigned char, 32>;
+
+    struct KeyHash {
+        size_t operator()(const Key& key) const {
+            // Keys are already uniformly distributed digests
+            size_t value;
+            std::memcpy(&value, key.data(), sizeof(value));
+            return value;
+        }
+    };
+
+    Key key_for(std::string_view chunk) const;
+    Key key_from_hex(const std::string& hex) const;
+    size_t key_size() const;
+
+    // Caller holds mutex_
+    bool insert_key(const Key& key);
+    bool erase_key(const Key& key);
+    bool has_key(const Key& key) const;
+
+    ChunkHashAlgorithm algorithm_;
+    // Exactly one of the sets is used, depending on the algorithm
+    std::unordered_set<uint64_t> xxh64_keys_;
+    std::unordered_set<Key, KeyHash> sha256_keys_;
+    mutable std::mutex mutex_;
+};
@@ -1,61 +1,73 @@
 #include <pybind11/pybind11.h>
 #include <pybind11/stl.h>
 #include <openssl/evp.h>
+#include <algorithm>
+#include <array>
 #include <string>
 #include <vector>
-#include <sstream>
-#include <iomanip>
+#include <mutex>
+#include <stdexcept>
+#include <memory>
+#include <string_view>
+#include "hex_encoding.h"
+#include "mapped_file.h"
+#include "sha256.h"
+#include "thread_pool.h"
+#include "chunk_hash_index.h"
+#include "stats.h"
+#include "bindings.h"
 
 namespace py = pybind11;
 using namespace std;
 
 /**
- * Generate SHA-256 hash of a binary buffer.
- * 
- * @param data The binary data to hash
- * @param size The size of the data in bytes
- * @return Hexadecimal string representation of the hash
+ * Metrics reported by hash_generator.get_stats(). "hash" times each
+ * whole-buffer SHA-256, "tree_hash" each tree hash, "chunk_hash" each
+ * batch of chunk hashes and "utf8" borrowing the chunks' bytes.
  */
-string sha256_hash(const unsigned char* data, size_t size) {
-    unsigned char hash[EVP_MAX_MD_SIZE];
-    unsigned int hash_len;
-    
-    // Create and initialize the context
-    EVP_MD_CTX* ctx = EVP_MD_CTX_new();
-    
-    // Initialize digest engine
-    EVP_DigestInit_ex(ctx, EVP_sha256(), nullptr);
-    
-    // Provide the message to be hashed
-    EVP_DigestUpdate(ctx, data, size);
-    
-    // Finalize the hash
-    EVP_DigestFinal_ex(ctx, hash, &hash_len);
-    
-    // Clean up
-    EVP_MD_CTX_free(ctx);
-    
-    stringstream ss;
-    for (unsigned int i = 0; i < hash_len; i++) {
-        ss << hex << setw(2) << setfill('0') << static_cast<int>(hash[i]);
-    }
-    
-    return ss.str();
+struct HashStats {
+    StatCounter& hashes = stat_counter("hash_generator", "hashes");
+    StatCounter& bytes = stat_counter("hash_generator", "bytes");
+    StatHistogram& hash = stat_histogram("hash_generator", "hash");
+    StatHistogram& tree_hash = stat_histogram("hash_generator", "tree_hash");
+    StatHistogram& chunk_hash = stat_histogram("hash_generator", "chunk_hash");
+    StatHistogram& utf8 = stat_histogram("hash_generator", "utf8");
+};
+
+static HashStats& hash_stats() {
+    static HashStats stats;
+    return stats;
+}
+
+/**
+ * sha256_hash recorded in the "hash" histogram and the hash counters.
+ */
+static string timed_sha256_hash(const void* data, size_t size) {
+    HashStats& stats = hash_stats();
+    ScopedTimer timer(stats.hash);
+    stats.hashes.add();
+    stats.bytes.add(size);
+    return sha256_hash(static_cast<const unsigned char*>(data), size);
 }
 
 /**
  * Python-facing function that accepts a bytes-like object and returns its SHA-256 hash.
  * 
+ * bytes objects are immutable, so the digest is computed directly on the
+ * object's storage with the GIL released.
+ * 
  * @param buffer Python bytes-like object
  * @return Hexadecimal string representation of the SHA-256 hash
  */
 string compute_sha256(py::bytes buffer) {
-    // Convert Python bytes to C++ string for processing
-    string str = static_cast<string>(buffer);
-    const unsigned char* data = reinterpret_cast<const unsigned char*>(str.data());
-    size_t size = str.size();
-    
-    return sha256_hash(data, size);
+    char* data = nullptr;
+    py::ssize_t size = 0;
+    if (PyBytes_AsStringAndSize(buffer.ptr(), &data, &size) != 0) {
+        throw py::error_already_set();
+    }
+
+    py::gil_scoped_release release;
+    return timed_sha256_hash(data, static_cast<size_t>(size));
 }
 
 /**
@@ -63,17 +75,314 @@ string compute_sha256(py::bytes buffer) {
  * potentially better performance with large files
  */
 string compute_sha256_buffer(py::buffer buffer) {
-    // Request buffer descriptor
+    // Request buffer descriptor; holding it keeps the exporter from resizing
+    // the memory while the GIL is released
     py::buffer_info info = buffer.request();
     
     // Get pointer to data and size
     const unsigned char* data = static_cast<const unsigned char*>(info.ptr);
     size_t size = info.size * info.itemsize;
     
-    return sha256_hash(data, size);
+    py::gil_scoped_release release;
+    return timed_sha256_hash(data, size);
+}
+
+/**
+ * Raw-digest variant of compute_sha256_buffer, for callers that store binary
+ * keys and do not need the hex form.
+ * 
+ * @param buffer Python bytes-like object
+ * @return The 32-byte SHA-256 digest as bytes
+ */
+py::bytes compute_sha256_digest(py::buffer buffer) {
+    py::buffer_info info = buffer.request();
+    
+    Sha256Digest digest;
+    {
+        py::gil_scoped_release release;
+        HashStats& stats = hash_stats();
+        ScopedTimer timer(stats.hash);
+        stats.hashes.add();
+        stats.bytes.add(static_cast<size_t>(info.size * info.itemsize));
+        digest = sha256_digest(info.ptr, static_cast<size_t>(info.size * info.itemsize));
+    }
+    return py::bytes(reinterpret_cast<const char*>(digest.data()), digest.size());
+}
+
+/**
+ * Hash a file without reading it into Python: the file is memory-mapped and
+ * hashed straight from the mapping.
+ * 
+ * @param path Path of the file to hash
+ * @return Hexadecimal string representation of the SHA-256 hash
+ */
+string compute_sha256_file(const string& path) {
+    MappedFile file(path);
+    return timed_sha256_hash(file.data(), file.size());
+}
+
+/**
+ * Descriptor variant of compute_sha256_file. The whole file is hashed
+ * regardless of the descriptor's current offset; the descriptor is not closed.
+ * 
+ * @param fd Open, readable file descriptor (e.g. file.fileno())
+ * @return Hexadecimal string representation of the SHA-256 hash
+ */
+string compute_sha256_fd(int fd) {
+    MappedFile file(fd);
+    return timed_sha256_hash(file.data(), file.size());
+}
+
+// Tree hash parameters. Both are part of the algorithm definition: changing
+// either changes every tree ID, so a new tag must be introduced instead.
+static const char kTreeHashTag[] = "sha256tree:";
+static const size_t kTreeLeafSize = 1 << 20;
+
+/**
+ * Merkle tree hash over SHA-256, computed in parallel.
+ * 
+ * The input is cut into 1 MiB leaves, hashed as SHA-256(0x00 || leaf) on the
+ * shared thread pool. Adjacent nodes are then combined level by level as
+ * SHA-256(0x01 || left || right); an odd node at the end of a level moves
+ * up unchanged. Empty input has a single empty leaf.
+ * 
+ * @param data The binary data to hash
+ * @param size The size of the data in bytes
+ * @param num_threads Maximum number of threads to use (0 = pool size)
+ * @return Tagged ID of the form "sha256tree:<hex root>"
+ */
+string sha256_tree_hash(const unsigned char* data, size_t size, size_t num_threads) {
+    HashStats& stats = hash_stats();
+    ScopedTimer timer(stats.tree_hash);
+    stats.hashes.add();
+    stats.bytes.add(size);
+    
+    const size_t leaf_count = max<size_t>(1, (size + kTreeLeafSize - 1) / kTreeLeafSize);
+    vector<Sha256Digest> level(leaf_count);
+    
+    shared_thread_pool().parallel_for(leaf_count, [&](size_t i) {
+        const size_t offset = i * kTreeLeafSize;
+        level[i] = sha256_digest_prefixed(0x00, data + offset, min(kTreeLeafSize, size - offset));
+    }, num_threads);
+    
+    while (level.size() > 1) {
+        vector<Sha256Digest> parents((level.size() + 1) / 2);
+        shared_thread_pool().parallel_for(level.size() / 2, [&](size_t i) {
+            parents[i] = sha256_digest_prefixed(0x01, level[2 * i].data(), level[2 * i].size(),
+                                                level[2 * i + 1].data(), level[2 * i + 1].size());
+        }, num_threads);
+        if (level.size() % 2 != 0) {
+            parents.back() = level.back();
+        }
+        level = move(parents);
+    }
+    
+    return kTreeHashTag + hex_encode(level[0].data(), level[0].size());
+}
+
+/**
+ * Python-facing tree hash of a bytes-like object, see sha256_tree_hash.
+ * The tag keeps these IDs distinct from plain compute_sha256 IDs.
+ * 
+ * @param buffer Python bytes-like object
+ * @param num_threads Maximum number of threads to use (0 = pool size)
+ * @return Tagged ID of the form "sha256tree:<hex root>"
+ */
+string compute_tree_hash(const py::buffer& buffer, size_t num_threads) {
+    py::buffer_info info = buffer.request();
+    
+    py::gil_scoped_release release;
+    return sha256_tree_hash(static_cast<const unsigned char*>(info.ptr),
+                            static_cast<size_t>(info.size * info.itemsize), num_threads);
+}
+
+/**
+ * Tree hash of a file read through a memory mapping.
+ * 
+ * @param path Path of the file to hash
+ * @param num_threads Maximum number of threads to use (0 = pool size)
+ * @return Tagged ID of the form "sha256tree:<hex root>"
+ */
+string compute_tree_hash_file(const string& path, size_t num_threads) {
+    MappedFile file(path);
+    return sha256_tree_hash(reinterpret_cast<const unsigned char*>(file.data()), file.size(), num_threads);
+}
+
+/**
+ * Hash a list of bytes-like objects in parallel on the shared thread pool.
+ * 
+ * All buffers are acquired while the GIL is held, then hashed with the GIL
+ * released.
+ * 
+ * @param buffers Python bytes-like objects
+ * @param num_threads Maximum number of threads to use (0 = pool size)
+ * @return Hexadecimal SHA-256 digests in input order
+ */
+vector<string> compute_sha256_many(const vector<py::buffer>& buffers, size_t num_threads) {
+    vector<py::buffer_info> infos;
+    infos.reserve(buffers.size());
+    for (const py::buffer& buffer : buffers) {
+        infos.push_back(buffer.request());
+    }
+
+    vector<string> digests(infos.size());
+    {
+        py::gil_scoped_release release;
+        shared_thread_pool().parallel_for(infos.size(), [&](size_t i) {
+            const py::buffer_info& info = infos[i];
+            digests[i] = timed_sha256_hash(info.ptr, static_cast<size_t>(info.size * info.itemsize));
+        }, num_threads);
+    }
+    return digests;
+}
+
+/**
+ * Incremental SHA-256 hasher with a hashlib-like interface. One EVP context
+ * lives for the whole object, so data can be fed as it arrives (e.g. chunks
+ * of an HTTP upload) without buffering the full input.
+ */
+class Sha256Hasher {
+public:
+    Sha256Hasher() : ctx_(EVP_MD_CTX_new()) {
+        if (!ctx_ || EVP_DigestInit_ex(ctx_, EVP_sha256(), nullptr) != 1) {
+            EVP_MD_CTX_free(ctx_);
+            throw runtime_error("Failed to initialize SHA-256 context");
+        }
+    }
+    
+    ~Sha256Hasher() {
+        EVP_MD_CTX_free(ctx_);
+    }
+    
+    Sha256Hasher(const Sha256Hasher&) = delete;
+    Sha256Hasher& operator=(const Sha256Hasher&) = delete;
+    
+    /**
+     * Feed more data. The GIL is released while hashing; the buffer export
+     * keeps the data from being resized meanwhile.
+     */
+    void update(const py::buffer& buffer) {
+        py::buffer_info info = buffer.request();
+        
+        py::gil_scoped_release release;
+        lock_guard<mutex> lock(mutex_);
+        if (EVP_DigestUpdate(ctx_, info.ptr, static_cast<size_t>(info.size * info.itemsize)) != 1) {
+            throw runtime_error("SHA-256 update failed");
+        }
+        hash_stats().bytes.add(static_cast<size_t>(info.size * info.itemsize));
+    }
+    
+    /**
+     * Raw 32-byte digest of the data fed so far. The hasher stays usable.
+     */
+    py::bytes digest() {
+        unsigned char hash[EVP_MAX_MD_SIZE];
+        unsigned int hash_len = finalize_copy(hash);
+        return py::bytes(reinterpret_cast<const char*>(hash), hash_len);
+    }
+    
+    /**
+     * Hexadecimal digest of the data fed so far, identical to compute_sha256
+     * over the concatenated input. The hasher stays usable.
+     */
+    string hexdigest() {
+        unsigned char hash[EVP_MAX_MD_SIZE];
+        unsigned int hash_len = finalize_copy(hash);
+        return hex_encode(hash, hash_len);
+    }
+    
+    /**
+     * Independent hasher with the same state, for hashing common prefixes once.
+     */
+    unique_ptr<Sha256Hasher> copy() {
+        auto clone = make_unique<Sha256Hasher>();
+        lock_guard<mutex> lock(mutex_);
+        if (EVP_MD_CTX_copy_ex(clone->ctx_, ctx_) != 1) {
+            throw runtime_error("Failed to copy SHA-256 context");
+        }
+        return clone;
+    }
+    
+private:
+    // Finalizes a copy of the context so that update() can continue afterwards
+    unsigned int finalize_copy(unsigned char* hash) {
+        unique_ptr<EVP_MD_CTX, decltype(&EVP_MD_CTX_free)> final_ctx(EVP_MD_CTX_new(), &EVP_MD_CTX_free);
+        unsigned int hash_len = 0;
+        lock_guard<mutex> lock(mutex_);
+        if (!final_ctx || EVP_MD_CTX_copy_ex(final_ctx.get(), ctx_) != 1 ||
+            EVP_DigestFinal_ex(final_ctx.get(), hash, &hash_len) != 1) {
+            throw runtime_error("SHA-256 finalization failed");
+        }
+        return hash_len;
+    }
+    
+    EVP_MD_CTX* ctx_;
+    // update() runs without the GIL, so calls on one hasher are serialized here
+    mutex mutex_;
+};
+
+/**
+ * Borrows the UTF-8 bytes of a sequence of str or bytes-like chunks without
+ * copying them. Must be created and destroyed with the GIL held; the views
+ * stay valid in between, including while the GIL is released.
+ */
+struct BorrowedChunks {
+    explicit BorrowedChunks(const py::sequence& chunks) {
+        ScopedTimer timer(hash_stats().utf8);
+        const size_t count = py::len(chunks);
+        owners.reserve(count);
+        views.reserve(count);
+        for (size_t i = 0; i < count; ++i) {
+            py::object chunk = chunks[i];
+            if (PyUnicode_Check(chunk.ptr())) {
+                py::ssize_t size = 0;
+                const char* data = PyUnicode_AsUTF8AndSize(chunk.ptr(), &size);
+                if (!data) {
+                    throw py::error_already_set();
+                }
+                views.emplace_back(data, static_cast<size_t>(size));
+            } else {
+                buffers.push_back(py::reinterpret_borrow<py::buffer>(chunk).request());
+                const py::buffer_info& info = buffers.back();
+                views.emplace_back(static_cast<const char*>(info.ptr),
+                                   static_cast<size_t>(info.size * info.itemsize));
+            }
+            owners.push_back(move(chunk));
+        }
+    }
+    
+    vector<py::object> owners;
+    vector<py::buffer_info> buffers;
+    vector<string_view> views;
+};
+
+/**
+ * Python-facing per-chunk content hashing.
+ * 
+ * @param chunks Sequence of str (hashed as UTF-8) or bytes-like objects
+ * @param algorithm "xxh64" (fast, 16 hex digits) or "sha256" (64 hex digits)
+ * @return Hex hashes in input order
+ */
+vector<string> hash_chunks(const py::sequence& chunks, const string& algorithm) {
+    ChunkHashAlgorithm parsed = parse_chunk_hash_algorithm(algorithm);
+    BorrowedChunks borrowed(chunks);
+    
+    vector<string> hashes;
+    hashes.reserve(borrowed.views.size());
+    {
+        py::gil_scoped_release release;
+        HashStats& stats = hash_stats();
+        ScopedTimer timer(stats.chunk_hash);
+        for (string_view chunk : borrowed.views) {
+            hashes.push_back(chunk_content_hash(parsed, chunk));
+            stats.bytes.add(chunk.size());
+        }
+        stats.hashes.add(hashes.size());
+    }
+    return hashes;
 }
 
-PYBIND11_MODULE(hash_generator, m) {
+void register_hash_generator(py::module_& m) {
     m.doc() = "C++ implementation of SHA-256 hash generation for improved performance";
     
     m.def("compute_sha256", &compute_sha256, 
@@ -83,4 +392,101 @@ PYBIND11_MODULE(hash_generator, m) {
     m.def("compute_sha256_buffer", &compute_sha256_buffer, 
         py::arg("buffer"),
         "Compute SHA-256 hash using buffer protocol for better performance");
-} 
\ No newline at end of file
+    
+    m.def("compute_sha256_digest", &compute_sha256_digest,
+        py::arg("buffer"),
+        "Compute the raw 32-byte SHA-256 digest of a bytes-like object");
+    
+    m.def("compute_sha256_file", &compute_sha256_file,
+        py::call_guard<py::gil_scoped_release>(),
+        py::arg("path"),
+        "Compute SHA-256 hash of a file by memory-mapping it");
+    
+    m.def("compute_sha256_fd", &compute_sha256_fd,
+        py::call_guard<py::gil_scoped_release>(),
+        py::arg("fd"),
+        "Compute SHA-256 hash of the file behind an open file descriptor by memory-mapping it");
+    
+    py::class_<Sha256Hasher>(m, "Sha256Hasher")
+        .def(py::init<>())
+        .def("update", &Sha256Hasher::update, py::arg("buffer"),
+            "Feed a bytes-like object into the hash")
+        .def("digest", &Sha256Hasher::digest,
+            "Return the 32-byte digest of the data fed so far")
+        .def("hexdigest", &Sha256Hasher::hexdigest,
+            "Return the hexadecimal digest of the data fed so far")
+        .def("copy", &Sha256Hasher::copy,
+            "Return an independent hasher with the same state")
+        .def_property_readonly_static("digest_size", [](py::object) { return 32; })
+        .def_property_readonly_static("name", [](py::object) { return "sha256"; });
+    
+    m.def("compute_tree_hash", &compute_tree_hash,
+        py::arg("buffer"),
+        py::arg("num_threads") = 0,
+        "Compute a parallel SHA-256 Merkle tree hash, returned as 'sha256tree:<hex>'");
+    
+    m.def("compute_tree_hash_file", &compute_tree_hash_file,
+        py::call_guard<py::gil_scoped_release>(),
+        py::arg("path"),
+        py::arg("num_threads") = 0,
+        "Compute a parallel SHA-256 Merkle tree hash of a memory-mapped file, returned as 'sha256tree:<hex>'");
+    
+    m.def("hash_chunks", &hash_chunks,
+        py::arg("chunks"),
+        py::arg("algorithm") = "xxh64",
+        "Compute the content hash of each chunk ('xxh64' or 'sha256')");
+    
+    py::class_<ChunkHashIndex>(m, "ChunkHashIndex")
+        .def(py::init([](const string& algorithm) {
+            return make_unique<ChunkHashIndex>(parse_chunk_hash_algorithm(algorithm));
+        }), py::arg("algorithm") = "xxh64")
+        .def("partition", [](ChunkHashIndex& index, const py::sequence& chunks, bool add) {
+            BorrowedChunks borrowed(chunks);
+            py::gil_scoped_release release;
+            return index.partition(borrowed.views, add);
+        }, py::arg("chunks"), py::arg("add") = true,
+            "Split chunk indices into (unchanged, new); with add, new hashes are recorded")
+        .def("contains", [](const ChunkHashIndex& index, const py::object& chunk) {
+            BorrowedChunks borrowed(py::sequence(py::make_tuple(chunk)));
+            py::gil_scoped_release release;
+            return index.contains(borrowed.views[0]);
+        }, py::arg("chunk"))
+        .def("__contains__", [](const ChunkHashIndex& index, const py::object& chunk) {
+            BorrowedChunks borrowed(py::sequence(py::make_tuple(chunk)));
+            py::gil_scoped_release release;
+            return index.contains(borrowed.views[0]);
+        })
+        .def("add", [](ChunkHashIndex& index, const py::sequence& chunks) {
+            BorrowedChunks borrowed(chunks);
+            py::gil_scoped_release release;
+            return index.add(borrowed.views);
+        }, py::arg("chunks"), "Record the hashes of chunks; returns how many were new")
+        .def("add_hashes", &ChunkHashIndex::add_hashes,
+            py::call_guard<py::gil_scoped_release>(),
+            py::arg("hashes"), "Record hex hashes, e.g. content_hash values of stored vectors")
+        .def("remove", [](ChunkHashIndex& index, const py::sequence& chunks) {
+            BorrowedChunks borrowed(chunks);
+            py::gil_scoped_release release;
+            return index.remove(borrowed.views);
+        }, py::arg("chunks"), "Forget the hashes of chunks; returns how many were known")
+        .def("clear", &ChunkHashIndex::clear)
+        .def("save", &ChunkHashIndex::save,
+            py::call_guard<py::gil_scoped_release>(),
+            py::arg("path"), "Write the index to a file")
+        .def_static("load", &ChunkHashIndex::load,
+            py::call_guard<py::gil_scoped_release>(),
+            py::arg("path"), "Read an index written by save()")
+        .def("__len__", &ChunkHashIndex::size)
+        .def_property_readonly("algorithm", [](const ChunkHashIndex& index) {
+            return chunk_hash_algorithm_name(index.algorithm());
+        });
+    
+    m.def("compute_sha256_many", &compute_sha256_many,
+        py::arg("buffers"),
+        py::arg("num_threads") = 0,
+        "Compute SHA-256 hashes of several bytes-like objects in parallel");
+    
+    // Create the metrics up front so get_stats() lists them before first use
+    hash_stats();
+    register_stats_api(m, "hash_generator");
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * XXH64 (xxHash, 64-bit variant) of a byte range. A fast non-cryptographic
+ * hash, bit-compatible with the reference implementation and python-xxhash's
+ * xxh64_intdigest().
+ *
+ * @param data Bytes to hash
+ * @param size Number of bytes
+ * @param seed Hash seed
+ * @return 64-bit hash value
+ */
+uint64_t xxh64(const void* data, size_t size, uint64_t seed = 0);
@@ -0,0 +1,263 @@
+#include "job_engine.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace std;
+
+JobStats& job_stats() {
+    static JobStats stats;
+    return stats;
+}
+
+const char* job_status_name(JobStatus status) {
+    switch (status) {
+        case JobStatus::Pending: return "pending";
+        case JobStatus::Running: return "running";
+        case JobStatus::Done: return "done";
+        case JobStatus::Failed: return "failed";
+        case JobStatus::Cancelled: return "cancelled";
+    }
+    return "unknown";
+}
+
+namespace {
+
+bool has_finished(JobStatus status) {
+    return status == JobStatus::Done || status == JobStatus::Failed || status == JobStatus::Cancelled;
+}
+
+}  // namespace
+
+// State shared by an engine and its jobs, so a job can release its slot even
+// if it outlives the engine's Python handle
+struct JobTracker {
+    explicit JobTracker(size_t max_pending) : max_in_flight(max_pending) {}
+
+    ~JobTracker() {
+        if (read_fd >= 0) {
+            ::close(read_fd);
+            ::close(write_fd);
+        }
+    }
+
+    void job_finished(uint64_t id, JobStatus status) {
+        JobStats& stats = job_stats();
+        (status == JobStatus::Done ? stats.completed : status == JobStatus::Failed ? stats.failed : stats.cancelled).add();
+        {
+            lock_guard<mutex> lock(state_mutex);
+            --in_flight;
+            jobs.erase(id);
+            if (read_fd >= 0) {
+                // One byte marks a non-empty list; take_completed drains it
+                if (completed.empty()) {
+                    const char byte = 1;
+                    ssize_t written = ::write(write_fd, &byte, 1);
+                    (void)written;
+                }
+                completed.push_back(id);
+            }
+        }
+        changed.notify_all();
+    }
+
+    mutex state_mutex;
+    condition_variable changed;  // a slot was freed or the engine closed
+    const size_t max_in_flight;
+    size_t in_flight = 0;
+    bool closed = false;
+    unordered_map<uint64_t, weak_ptr<Job>> jobs;  // unfinished jobs
+    vector<uint64_t> completed;
+    int read_fd = -1;
+    int write_fd = -1;
+};
+
+Job::Job(uint64_t id, JobBody body, shared_ptr<JobTracker> tracker)
+    : id_(id), submitted_(chrono::steady_clock::now()), tracker_(move(tracker)), body_(move(body)) {}
+
+JobStatus Job::status() const {
+    lock_guard<mutex> lock(mutex_);
+    return status_;
+}
+
+bool Job::finished() const {
+    return has_finished(status());
+}
+
+bool Job::cancel() {
+    unique_lock<mutex> lock(mutex_);
+    if (has_finished(status_)) {
+        return false;
+    }
+    cancel_.cancel();
+    if (status_ == JobStatus::Pending) {
+        finish(lock, JobStatus::Cancelled, nullptr);
+    }
+    return true;
+}
+
+bool Job::wait(chrono::nanoseconds timeout) const {
+    unique_lock<mutex> lock(mutex_);
+    auto done = [this] { return has_finished(status_); };
+    if (timeout == kWaitForever) {
+        finished_.wait(lock, done);
+        return true;
+    }
+    return finished_.wait_for(lock, timeout, done);
+}
+
+exception_ptr Job::error() const {
+    lock_guard<mutex> lock(mutex_);
+    return error_;
+}
+
+void Job::run() {
+    JobStats& stats = job_stats();
+    JobBody body;
+    {
+        lock_guard<mutex> lock(mutex_);
+        if (status_ != JobStatus::Pending) {
+            return;  // cancelled while queued
+        }
+        status_ = JobStatus::Running;
+        body = move(body_);
+    }
+    stats.queue_wait.record(static_cast<uint64_t>(
+        chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - submitted_).count()));
+
+    JobStatus status = JobStatus::Done;
+    exception_ptr error;
+    {
+        ScopedTimer timer(stats.run);
+        try {
+            body(cancel_);
+        } catch (const JobCancelled&) {
+            status = JobStatus::Cancelled;
+        } catch (...) {
+            status = JobStatus::Failed;
+            error = current_exception();
+        }
+    }
+    // Drop the body's captures before anyone waiting on the job wakes up
+    body = nullptr;
+
+    unique_lock<mutex> lock(mutex_);
+    finish(lock, status, move(error));
+}
+
+void Job::finish(unique_lock<mutex>& lock, JobStatus status, exception_ptr error) {
+    status_ = status;
+    error_ = move(error);
+    JobBody body = move(body_);
+    lock.unlock();
+    finished_.notify_all();
+    tracker_->job_finished(id_, status);
+}
+
+JobEngine::JobEngine(size_t thread_count, size_t max_pending)
+    : tracker_(make_shared<JobTracker>(max_pending)),
+      pool_(thread_count == 0 ? max(1u, thread::hardware_concurrency()) : thread_count, &job_stats().steals) {
+    if (max_pending == 0) {
+        throw invalid_argument("max_pending must be positive");
+    }
+}
+
+JobEngine::~JobEngine() {
+    shutdown(true);
+}
+
+shared_ptr<Job> JobEngine::submit(JobBody body, chrono::nanoseconds timeout) {
+    JobTracker& tracker = *tracker_;
+    shared_ptr<Job> job;
+    {
+        unique_lock<mutex> lock(tracker.state_mutex);
+        auto has_slot = [&] { return tracker.closed || tracker.in_flight < tracker.max_in_flight; };
+        if (timeout == kWaitForever) {
+            tracker.changed.wait(lock, has_slot);
+        } else if (!tracker.changed.wait_for(lock, timeout, has_slot)) {
+            job_stats().rejected.add();
+            throw QueueFull("Job queue is full: " + to_string(tracker.max_in_flight) + " jobs pending");
+        }
+        if (tracker.closed) {
+            throw runtime_error("Job queue is shut down");
+        }
+        job.reset(new Job(next_id_++, move(body), tracker_));
+        tracker.jobs.emplace(job->id(), job);
+        ++tracker.in_flight;
+    }
+    job_stats().submitted.add();
+    pool_.submit([job] { job->run(); });
+    return job;
+}
+
+void JobEngine::shutdown(bool cancel_pending) {
+    JobTracker& tracker = *tracker_;
+    vector<shared_ptr<Job>> unfinished;
+    {
+        lock_guard<mutex> lock(tracker.state_mutex);
+        tracker.closed = true;
+        if (cancel_pending) {
+            for (const auto& entry : tracker.jobs) {
+                if (shared_ptr<Job> job = entry.second.lock()) {
+                    unfinished.push_back(move(job));
+                }
+            }
+        }
+    }
+    // Blocked submitters wake up and fail
+    tracker.changed.notify_all();
+    for (const shared_ptr<Job>& job : unfinished) {
+        job->cancel();
+    }
+
+    unique_lock<mutex> lock(tracker.state_mutex);
+    tracker.changed.wait(lock, [&] { return tracker.in_flight == 0; });
+}
+
+int JobEngine::completion_fd() {
+    JobTracker& tracker = *tracker_;
+    lock_guard<mutex> lock(tracker.state_mutex);
+    if (tracker.read_fd < 0) {
+        int fds[2];
+        if (::pipe(fds) != 0) {
+            throw runtime_error(string("Failed to create completion pipe: ") + strerror(errno));
+        }
+        for (int fd : fds) {
+            ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK);
+            ::fcntl(fd, F_SETFD, FD_CLOEXEC);
+        }
+        tracker.read_fd = fds[0];
+        tracker.write_fd = fds[1];
+    }
+    return tracker.read_fd;
+}
+
+vector<uint64_t> JobEngine::take_completed() {
+    JobTracker& tracker = *tracker_;
+    lock_guard<mutex> lock(tracker.state_mutex);
+    vector<uint64_t> ids;
+    ids.swap(tracker.completed);
+    if (tracker.read_fd >= 0) {
+        char buffer[64];
+        while (::read(tracker.read_fd, buffer, sizeof(buffer)) > 0) {
+        }
+    }
+    return ids;
+}
+
+size_t JobEngine::max_pending() const {
+    return tracker_->max_in_flight;
+}
+
+size_t JobEngine::in_flight() const {
+    lock_guard<mutex> lock(tracker_->state_mutex);
+    return tracker_->in_flight;
+}
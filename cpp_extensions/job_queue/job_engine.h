@@ -0,0 +1,161 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+#include "cancellation.h"
+#include "stats.h"
+#include "work_stealing_pool.h"
+
+/**
+ * Metrics reported by job_queue.get_stats(). "queue_wait" times how long
+ * each job waited for a worker, "run" how long it ran and "marshal" the
+ * conversion of results to Python objects. "rejected" counts submissions
+ * that gave up because the queue stayed full.
+ */
+struct JobStats {
+    StatCounter& submitted = stat_counter("job_queue", "submitted");
+    StatCounter& completed = stat_counter("job_queue", "completed");
+    StatCounter& failed = stat_counter("job_queue", "failed");
+    StatCounter& cancelled = stat_counter("job_queue", "cancelled");
+    StatCounter& rejected = stat_counter("job_queue", "rejected");
+    StatCounter& steals = stat_counter("job_queue", "steals");
+    StatHistogram& queue_wait = stat_histogram("job_queue", "queue_wait");
+    StatHistogram& run = stat_histogram("job_queue", "run");
+    StatHistogram& marshal = stat_histogram("job_queue", "marshal");
+};
+
+JobStats& job_stats();
+
+/**
+ * Thrown by JobEngine::submit when the queue stays full for the whole timeout.
+ */
+class QueueFull : public std::runtime_error {
+public:
+    using std::runtime_error::runtime_error;
+};
+
+enum class JobStatus : uint8_t { Pending, Running, Done, Failed, Cancelled };
+
+/** "pending", "running", "done", "failed" or "cancelled". */
+const char* job_status_name(JobStatus status);
+
+using JobBody = std::function<void(const CancelToken& cancel)>;
+
+// Wait without a deadline
+inline constexpr std::chrono::nanoseconds kWaitForever = std::chrono::nanoseconds::max();
+
+struct JobTracker;
+
+/**
+ * One submitted job. Its body runs at most once on a JobEngine worker; a
+ * body that throws JobCancelled finishes the job as Cancelled, any other
+ * exception as Failed.
+ */
+class Job {
+public:
+    uint64_t id() const { return id_; }
+    JobStatus status() const;
+    bool finished() const;
+
+    /**
+     * Requests cancellation. A pending job is cancelled at once and frees its
+     * queue slot; a running job finishes as Cancelled at its body's next
+     * cancellation point, or as Done if it completes first.
+     *
+     * @return false if the job had already finished
+     */
+    bool cancel();
+
+    /** Blocks until the job finished or timeout passed; true if it finished. */
+    bool wait(std::chrono::nanoseconds timeout = kWaitForever) const;
+
+    /** The exception of a Failed job, null otherwise. */
+    std::exception_ptr error() const;
+
+private:
+    friend class JobEngine;
+
+    Job(uint64_t id, JobBody body, std::shared_ptr<JobTracker> tracker);
+
+    void run();
+    void finish(std::unique_lock<std::mutex>& lock, JobStatus status, std::exception_ptr error);
+
+    const uint64_t id_;
+    const std::chrono::steady_clock::time_point submitted_;
+    std::shared_ptr<JobTracker> tracker_;
+    CancelToken cancel_;
+
+    mutable std::mutex mutex_;
+    mutable std::condition_variable finished_;
+    JobStatus status_ = JobStatus::Pending;
+    JobBody body_;
+    std::exception_ptr error_;
+};
+
+/**
+ * Asynchronous job queue on a WorkStealingPool, with backpressure and
+ * per-job cancellation.
+ *
+ * At most max_pending jobs are queued or running at once; submit blocks
+ * until a slot frees up or its timeout passes. For event loops, the
+ * completion descriptor becomes readable whenever jobs have finished since
+ * the last take_completed() call, so one reader can serve every job.
+ */
+class JobEngine {
+public:
+    /**
+     * @param thread_count Worker threads (0 = one per hardware thread)
+     * @param max_pending Jobs that may be queued or running at once
+     */
+    JobEngine(size_t thread_count, size_t max_pending);
+
+    /** Cancels every unfinished job and waits for the running ones. */
+    ~JobEngine();
+
+    JobEngine(const JobEngine&) = delete;
+    JobEngine& operator=(const JobEngine&) = delete;
+
+    /**
+     * Queues body. Submitting from inside a job while the queue is full
+     * blocks that worker, so nested submissions should use a short timeout.
+     *
+     * @throws QueueFull if no slot freed up within timeout
+     * @throws std::runtime_error after shutdown
+     */
+    std::shared_ptr<Job> submit(JobBody body, std::chrono::nanoseconds timeout = kWaitForever);
+
+    /**
+     * Stops accepting jobs and waits until every submitted job finished.
+     *
+     * @param cancel_pending Cancel unfinished jobs instead of running them
+     */
+    void shutdown(bool cancel_pending);
+
+    /**
+     * Read end of a non-blocking pipe that is readable while finished job ids
+     * are waiting in take_completed(). Ids are only recorded from the first
+     * call on; the descriptor is owned by the engine.
+     */
+    int completion_fd();
+
+    /** Ids of the jobs finished since the last call, in completion order. */
+    std::vector<uint64_t> take_completed();
+
+    size_t thread_count() const { return pool_.size(); }
+    size_t max_pending() const;
+    size_t in_flight() const;
+
+private:
+    std::shared_ptr<JobTracker> tracker_;
+    uint64_t next_id_ = 1;  // guarded by the tracker's mutex
+    WorkStealingPool pool_;
+};
@@ -0,0 +1,269 @@
+#include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "cancellation.h"
+#include "chunking_methods.h"
+#include "job_engine.h"
+#include "pdf_document.h"
+#include "sha256.h"
+#include "bindings.h"
+
+namespace py = pybind11;
+using namespace std;
+
+/**
+ * Converts a Python timeout in seconds (None = wait forever) for the engine.
+ */
+static chrono::nanoseconds to_timeout(const py::object& timeout) {
+    if (timeout.is_none()) {
+        return kWaitForever;
+    }
+    double seconds = timeout.cast<double>();
+    if (seconds < 0) {
+        throw invalid_argument("timeout must not be negative");
+    }
+    // Far enough to never expire, close enough not to overflow the clock
+    seconds = min(seconds, 1e9);
+    return chrono::nanoseconds(static_cast<int64_t>(seconds * 1e9));
+}
+
+/**
+ * Python handle of one native job. It owns the Python inputs the job reads
+ * without the GIL, so dropping the last reference to an unfinished job
+ * cancels it and waits for it to stop. The native result is converted to
+ * Python objects on the first result() call.
+ */
+class PyJob {
+public:
+    PyJob(shared_ptr<Job> job, py::object input, py::buffer_info buffer, function<py::object()> to_python)
+        : job_(move(job)), input_(move(input)), buffer_(move(buffer)), to_python_(move(to_python)) {}
+
+    ~PyJob() {
+        if (!job_->finished()) {
+            job_->cancel();
+            py::gil_scoped_release release;
+            job_->wait();
+        }
+    }
+
+    PyJob(const PyJob&) = delete;
+    PyJob& operator=(const PyJob&) = delete;
+
+    uint64_t id() const { return job_->id(); }
+    string status() const { return job_status_name(job_->status()); }
+    bool done() const { return job_->finished(); }
+    bool cancel() { return job_->cancel(); }
+
+    py::object result(const py::object& timeout) {
+        chrono::nanoseconds wait_time = to_timeout(timeout);
+        bool finished;
+        {
+            py::gil_scoped_release release;
+            finished = job_->wait(wait_time);
+        }
+        if (!finished) {
+            PyErr_SetString(PyExc_TimeoutError, ("Job " + to_string(job_->id()) + " is still running").c_str());
+            throw py::error_already_set();
+        }
+        switch (job_->status()) {
+            case JobStatus::Cancelled:
+                throw JobCancelled();
+            case JobStatus::Failed:
+                rethrow_exception(job_->error());
+            default:
+                break;
+        }
+        if (to_python_) {
+            result_ = to_python_();
+            to_python_ = nullptr;
+        }
+        return result_;
+    }
+
+private:
+    shared_ptr<Job> job_;
+    py::object input_;
+    py::buffer_info buffer_;
+    function<py::object()> to_python_;
+    py::object result_;
+};
+
+/**
+ * Submits work(cancel) -> Result with the GIL released and wraps the job.
+ * The result lives in a slot shared by the job body and the PyJob, so it
+ * can be built without the GIL and converted later.
+ */
+template <typename Result, typename Work>
+static unique_ptr<PyJob> submit_job(JobEngine& engine, const py::object& timeout, py::object input,
+                                    py::buffer_info buffer, Work work) {
+    chrono::nanoseconds wait_time = to_timeout(timeout);
+    auto slot = make_shared<Result>();
+    shared_ptr<Job> job;
+    {
+        py::gil_scoped_release release;
+        job = engine.submit([slot, work](const CancelToken& cancel) { *slot = work(cancel); }, wait_time);
+    }
+    return make_unique<PyJob>(move(job), move(input), move(buffer), [slot] {
+        return marshal(job_stats().marshal, move(*slot));
+    });
+}
+
+static string_view buffer_view(const py::buffer_info& info) {
+    return string_view(static_cast<const char*>(info.ptr), static_cast<size_t>(info.size * info.itemsize));
+}
+
+/**
+ * Queues text and hash extraction of a PDF, see extract_pdf_text_and_hash.
+ * The job stops between pages once cancelled.
+ */
+static unique_ptr<PyJob> submit_pdf_text(JobEngine& engine, const py::buffer& buffer, size_t num_threads,
+                                         const py::object& timeout) {
+    py::buffer_info info = buffer.request();
+    string_view data = buffer_view(info);
+    return submit_job<pair<string, string>>(engine, timeout, buffer, move(info),
+        [data, num_threads](const CancelToken& cancel) {
+            return extract_text_and_hash(data.data(), data.size(), num_threads, &cancel);
+        });
+}
+
+/**
+ * Queues the fused extract/chunk/hash pipeline, see extract_pdf_chunks.
+ * The method and chunking parameters are validated before queueing.
+ */
+static unique_ptr<PyJob> submit_pdf_chunks(JobEngine& engine, const py::buffer& buffer, int chunk_size,
+                                           int chunk_overlap, const string& method, size_t num_threads,
+                                           bool layout, const py::object& timeout) {
+    SpanSplitter splitter = span_splitter_for_method(method);
+    splitter(string_view(), chunk_size, chunk_overlap);
+
+    py::buffer_info info = buffer.request();
+    string_view data = buffer_view(info);
+    return submit_job<pair<string, vector<PdfChunk>>>(engine, timeout, buffer, move(info),
+        [data, splitter, chunk_size, chunk_overlap, num_threads, layout](const CancelToken& cancel) {
+            return extract_chunks_and_hash(data.data(), data.size(), splitter, chunk_size, chunk_overlap,
+                                           num_threads, layout, &cancel);
+        });
+}
+
+/**
+ * Queues chunking of a str or UTF-8 buffer with one of the chunking methods.
+ */
+static unique_ptr<PyJob> submit_chunks(JobEngine& engine, const py::object& text, int chunk_size,
+                                       int chunk_overlap, const string& method, const py::object& timeout) {
+    SpanSplitter splitter = span_splitter_for_method(method);
+    splitter(string_view(), chunk_size, chunk_overlap);
+
+    py::buffer_info info;
+    string_view view;
+    if (PyUnicode_Check(text.ptr())) {
+        // The UTF-8 form is cached in the str object, which the job keeps alive
+        Py_ssize_t size = 0;
+        const char* data = PyUnicode_AsUTF8AndSize(text.ptr(), &size);
+        if (!data) {
+            throw py::error_already_set();
+        }
+        view = string_view(data, static_cast<size_t>(size));
+    } else {
+        info = py::reinterpret_borrow<py::buffer>(text).request();
+        view = buffer_view(info);
+    }
+    return submit_job<vector<string>>(engine, timeout, text, move(info),
+        [view, splitter, chunk_size, chunk_overlap](const CancelToken& cancel) {
+            cancel.throw_if_cancelled();
+            vector<TextSpan> spans = splitter(view, chunk_size, chunk_overlap);
+            vector<string> chunks;
+            chunks.reserve(spans.size());
+            for (const TextSpan& span : spans) {
+                chunks.emplace_back(view.substr(span.start, span.end - span.start));
+            }
+            return chunks;
+        });
+}
+
+/**
+ * Queues the SHA-256 of a buffer, as a hexadecimal string.
+ */
+static unique_ptr<PyJob> submit_sha256(JobEngine& engine, const py::buffer& buffer, const py::object& timeout) {
+    py::buffer_info info = buffer.request();
+    string_view data = buffer_view(info);
+    return submit_job<string>(engine, timeout, buffer, move(info),
+        [data](const CancelToken& cancel) {
+            cancel.throw_if_cancelled();
+            return sha256_hash(reinterpret_cast<const unsigned char*>(data.data()), data.size());
+        });
+}
+
+void register_job_queue(py::module_& m) {
+    m.doc() = "Asynchronous native ingestion jobs on a work-stealing thread pool";
+
+    py::register_exception<JobCancelled>(m, "JobCancelledError", PyExc_RuntimeError);
+    py::register_exception<QueueFull>(m, "QueueFullError", PyExc_RuntimeError);
+
+    py::class_<PyJob>(m, "Job", "Handle of a queued native job; dropping the last reference cancels it")
+        .def_property_readonly("id", &PyJob::id)
+        .def_property_readonly("status", &PyJob::status,
+            "\"pending\", \"running\", \"done\", \"failed\" or \"cancelled\"")
+        .def("done", &PyJob::done, "Whether the job finished, successfully or not")
+        .def("cancel", &PyJob::cancel,
+            "Cancel the job: at once if it is still queued, otherwise at its next page; False if it already finished")
+        .def("result", &PyJob::result,
+            py::arg("timeout") = py::none(),
+            "Wait for the job and return its result, raising its error, JobCancelledError or TimeoutError")
+        .def("__repr__", [](const PyJob& job) {
+            return "<Job id=" + to_string(job.id()) + " status=" + job.status() + ">";
+        });
+
+    py::class_<JobEngine>(m, "JobQueue",
+        "Bounded queue of native extraction, chunking and hashing jobs. Jobs never hold the GIL while they run")
+        .def(py::init<size_t, size_t>(),
+            py::arg("num_threads") = 0,
+            py::arg("max_pending") = 64)
+        .def("submit_pdf_text", &submit_pdf_text,
+            py::arg("buffer"),
+            py::arg("num_threads") = 1,
+            py::arg("timeout") = py::none(),
+            "Queue extract_pdf_text_and_hash; the job's result is (text, hash)")
+        .def("submit_pdf_chunks", &submit_pdf_chunks,
+            py::arg("buffer"),
+            py::arg("chunk_size"),
+            py::arg("chunk_overlap"),
+            py::arg("method") = "recursive",
+            py::arg("num_threads") = 1,
+            py::arg("layout") = false,
+            py::arg("timeout") = py::none(),
+            "Queue extract_pdf_chunks; the job's result is (document_hash, chunks)")
+        .def("submit_chunks", &submit_chunks,
+            py::arg("text"),
+            py::arg("chunk_size"),
+            py::arg("chunk_overlap"),
+            py::arg("method") = "recursive",
+            py::arg("timeout") = py::none(),
+            "Queue chunking of a str or UTF-8 buffer; the job's result is a list of str")
+        .def("submit_sha256", &submit_sha256,
+            py::arg("buffer"),
+            py::arg("timeout") = py::none(),
+            "Queue the SHA-256 of a buffer; the job's result is its hexadecimal digest")
+        .def("completion_fd", &JobEngine::completion_fd,
+            "Non-blocking descriptor that is readable while completed_jobs() has ids, for loop.add_reader")
+        .def("completed_jobs", &JobEngine::take_completed,
+            "Ids of the jobs finished since the last call (recorded once completion_fd() was called)")
+        .def("shutdown", &JobEngine::shutdown,
+            py::arg("cancel_pending") = false,
+            py::call_guard<py::gil_scoped_release>(),
+            "Stop accepting jobs and wait for the submitted ones, cancelling them with cancel_pending")
+        .def_property_readonly("num_threads", &JobEngine::thread_count)
+        .def_property_readonly("max_pending", &JobEngine::max_pending)
+        .def_property_readonly("in_flight", &JobEngine::in_flight, "Jobs queued or running");
+
+    // Create the metrics up front so get_stats() lists them before first use
+    job_stats();
+    register_stats_api(m, "job_queue");
+}
@@ -0,0 +1,48 @@
+#include <pybind11/pybind11.h>
+
+#include "bindings.h"
+#include "multiversion.h"
+
+namespace py = pybind11;
+
+// Set by cosmos_describe_build (cmake/CosmosOptimization.cmake)
+#ifndef COSMOS_BUILD_PGO
+#define COSMOS_BUILD_PGO "OFF"
+#endif
+#ifndef COSMOS_BUILD_LTO
+#define COSMOS_BUILD_LTO 0
+#endif
+
+/**
+ * The single native extension. The text_chunker, pdf_extractor,
+ * hash_generator, vector_index and job_queue APIs live in submodules of the
+ * same name, all backed by the cosmos_core library; core/cpp_modules
+ * re-exports them under their old names. build_info records whether the
+ * hot loops carry per-ISA clones (see multiversion.h) and whether the build
+ * used LTO and PGO.
+ */
+PYBIND11_MODULE(_cosmos_native, m) {
+    m.doc() = "C++ implementations of COSMOS text chunking, PDF extraction and hashing";
+
+    py::dict build_info;
+    build_info["multiversioned"] = static_cast<bool>(COSMOS_HAS_MULTIVERSIONING);
+    build_info["pgo"] = COSMOS_BUILD_PGO;
+    build_info["lto"] = static_cast<bool>(COSMOS_BUILD_LTO);
+    m.attr("build_info") = build_info;
+
+    py::module_ text_chunker = m.def_submodule("text_chunker");
+    register_text_chunker(text_chunker);
+
+    py::module_ pdf_extractor = m.def_submodule("pdf_extractor");
+    register_pdf_extractor(pdf_extractor);
+
+    py::module_ hash_generator = m.def_submodule("hash_generator");
+    register_hash_generator(hash_generator);
+
+    py::module_ vector_index = m.def_submodule("vector_index");
+    register_vector_index(vector_index);
+
+    // Registered last: job results use the pdf_extractor types
+    py::module_ job_queue = m.def_submodule("job_queue");
+    register_job_queue(job_queue);
+}
@@ -0,0 +1,218 @@
+#include "pdf_document.h"
+#include "pdf_layout.h"
+#include "sha256.h"
+
+#include <iterator>
+#include <string_view>
+#include <stdexcept>
+
+using namespace std;
+
+PdfStats& pdf_stats() {
+    static PdfStats stats;
+    return stats;
+}
+
+unique_ptr<poppler::document> open_pdf_document(const char* data, size_t size) {
+    ScopedTimer timer(pdf_stats().parse);
+    return unique_ptr<poppler::document>(poppler::document::load_from_raw_data(
+        data, static_cast<int>(size)
+    ));
+}
+
+unique_ptr<poppler::document> load_pdf_document(const char* data, size_t size) {
+    unique_ptr<poppler::document> doc = open_pdf_document(data, size);
+    
+    if (!doc || doc->is_locked()) {
+        throw runtime_error("Failed to load PDF or PDF is encrypted");
+    }
+    return doc;
+}
+
+static string to_utf8_string(const poppler::ustring& text) {
+    poppler::byte_array bytes = text.to_utf8();
+    return string(bytes.begin(), bytes.end());
+}
+
+PdfInfo read_pdf_info(const char* data, size_t size) {
+    // Reject anything that is not a PDF before poppler looks at it; the
+    // header may follow up to 1 KB of leading garbage
+    if (string_view(data, min<size_t>(size, 1024)).find("%PDF-") == string_view::npos) {
+        throw runtime_error("Not a PDF: missing %PDF- header");
+    }
+    unique_ptr<poppler::document> doc = open_pdf_document(data, size);
+    if (!doc) {
+        throw runtime_error("Failed to load PDF");
+    }
+    
+    PdfInfo info;
+    info.page_count = doc->pages();
+    int major = 0;
+    int minor = 0;
+    if (doc->get_pdf_version(&major, &minor)) {
+        info.pdf_version = to_string(major) + "." + to_string(minor);
+    }
+    info.encrypted = doc->is_encrypted();
+    info.locked = doc->is_locked();
+    info.linearized = doc->is_linearized();
+    if (!info.locked) {
+        info.title = to_utf8_string(doc->get_title());
+        info.author = to_utf8_string(doc->get_author());
+        info.subject = to_utf8_string(doc->get_subject());
+        info.keywords = to_utf8_string(doc->get_keywords());
+        info.creator = to_utf8_string(doc->get_creator());
+        info.producer = to_utf8_string(doc->get_producer());
+    }
+    return info;
+}
+
+bool read_page_text(const poppler::document& doc, int index, string& out) {
+    PdfStats& stats = pdf_stats();
+    ScopedTimer timer(stats.page);
+    unique_ptr<poppler::page> page(doc.create_page(index));
+    if (!page) {
+        return false;
+    }
+    stats.pages.add();
+    // Get text and convert to string properly
+    poppler::ustring page_text = page->text();
+    poppler::byte_array utf8_bytes = page_text.to_utf8();
+    out.append(utf8_bytes.begin(), utf8_bytes.end());
+    return true;
+}
+
+void append_page_text(const poppler::document& doc, int index, string& out) {
+    if (read_page_text(doc, index, out)) {
+        out += "\n";  // Add newline after each page
+    }
+}
+
+string extract_text_from_pdf_buffer(const char* data, size_t size, size_t num_threads, const CancelToken* cancel) {
+    vector<string> range_texts = process_pdf_pages<string>(data, size, num_threads,
+        [](const poppler::document& doc, int index, string& out) {
+            append_page_text(doc, index, out);
+        }, 0, -1, cancel);
+    
+    if (range_texts.size() == 1) {
+        return move(range_texts[0]);
+    }
+    
+    size_t total_size = 0;
+    for (const string& text : range_texts) {
+        total_size += text.size();
+    }
+    string all_text;
+    all_text.reserve(total_size);
+    for (const string& text : range_texts) {
+        all_text += text;
+    }
+    return all_text;
+}
+
+vector<pair<int, string>> extract_page_range(const char* data, size_t size, int first_page, int last_page,
+                                            size_t num_threads, bool layout) {
+    PdfStats& stats = pdf_stats();
+    stats.documents.add();
+    stats.bytes.add(size);
+    
+    vector<vector<pair<int, string>>> range_pages;
+    try {
+        range_pages = process_pdf_pages<vector<pair<int, string>>>(data, size, num_threads,
+            [&](const poppler::document& doc, int index, vector<pair<int, string>>& out) {
+                string text;
+                if (layout) {
+                    read_page_layout_text(doc, index, text);
+                } else {
+                    read_page_text(doc, index, text);
+                }
+                out.emplace_back(index + 1, move(text));
+            }, first_page, last_page);
+    } catch (const exception& e) {
+        throw runtime_error(string("Error extracting text from PDF: ") + e.what());
+    }
+    
+    vector<pair<int, string>> pages = move(range_pages[0]);
+    for (size_t i = 1; i < range_pages.size(); ++i) {
+        move(range_pages[i].begin(), range_pages[i].end(), back_inserter(pages));
+    }
+    return pages;
+}
+
+// Counts the document and computes its SHA-256 hash
+static string hash_document(const char* data, size_t size) {
+    PdfStats& stats = pdf_stats();
+    stats.documents.add();
+    stats.bytes.add(size);
+    ScopedTimer timer(stats.hash);
+    return sha256_hash(reinterpret_cast<const unsigned char*>(data), size);
+}
+
+pair<string, string> extract_text_and_hash(const char* data, size_t size, size_t num_threads,
+                                           const CancelToken* cancel) {
+    // Calculate hash using SHA-256
+    string hash_str = hash_document(data, size);
+    
+    // Extract text
+    string text;
+    try {
+        text = extract_text_from_pdf_buffer(data, size, num_threads, cancel);
+    } catch (const JobCancelled&) {
+        throw;
+    } catch (const exception& e) {
+        throw runtime_error(string("Error extracting text from PDF: ") + e.what());
+    }
+    
+    return make_pair(move(text), move(hash_str));
+}
+
+pair<string, vector<PdfChunk>> extract_chunks_and_hash(const char* data, size_t size, SpanSplitter splitter,
+                                                       int chunk_size, int chunk_overlap, size_t num_threads,
+                                                       bool layout, const CancelToken* cancel) {
+    string document_hash = hash_document(data, size);
+    
+    vector<vector<PdfChunk>> range_chunks;
+    try {
+        range_chunks = process_pdf_pages<vector<PdfChunk>>(data, size, num_threads,
+            [&](const poppler::document& doc, int index, vector<PdfChunk>& out) {
+                string page_text;
+                if (layout) {
+                    read_page_layout_text(doc, index, page_text);
+                } else {
+                    read_page_text(doc, index, page_text);
+                }
+                
+                PdfStats& stats = pdf_stats();
+                ScopedTimer timer(stats.chunk);
+                vector<TextSpan> spans = splitter(page_text, chunk_size, chunk_overlap);
+                stats.chunks.add(spans.size());
+                for (const TextSpan& span : spans) {
+                    const char* chunk_data = page_text.data() + span.start;
+                    const size_t chunk_size_bytes = static_cast<size_t>(span.end - span.start);
+                    out.push_back({
+                        string(chunk_data, chunk_size_bytes),
+                        index + 1,
+                        sha256_hash(reinterpret_cast<const unsigned char*>(chunk_data), chunk_size_bytes)
+                    });
+                }
+            }, 0, -1, cancel);
+    } catch (const JobCancelled&) {
+        throw;
+    } catch (const exception& e) {
+        throw runtime_error(string("Error extracting text from PDF: ") + e.what());
+    }
+    
+    vector<PdfChunk> chunks;
+    if (range_chunks.size() == 1) {
+        chunks = move(range_chunks[0]);
+    } else {
+        size_t total = 0;
+        for (const auto& range : range_chunks) {
+            total += range.size();
+        }
+        chunks.reserve(total);
+        for (auto& range : range_chunks) {
+            move(range.begin(), range.end(), back_inserter(chunks));
+        }
+    }
+    return make_pair(move(document_hash), move(chunks));
+}
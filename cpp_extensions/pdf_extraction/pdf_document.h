@@ -0,0 +1,212 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <poppler/cpp/poppler-document.h>
+#include <poppler/cpp/poppler-page.h>
+#include <poppler/cpp/poppler-global.h>
+
+#include "cancellation.h"
+#include "chunking_methods.h"
+#include "stats.h"
+#include "thread_pool.h"
+
+// Smallest page range worth loading a separate document for
+inline constexpr int kMinPagesPerWorker = 8;
+
+/**
+ * Metrics reported by pdf_extractor.get_stats(). "parse" times each poppler
+ * document load (one per worker range), "page" each page's text extraction,
+ * "hash" the document hash, "chunk" the chunking and chunk hashing of a page
+ * and "marshal" the conversion of results to Python objects.
+ */
+struct PdfStats {
+    StatCounter& documents = stat_counter("pdf_extractor", "documents");
+    StatCounter& bytes = stat_counter("pdf_extractor", "bytes");
+    StatCounter& pages = stat_counter("pdf_extractor", "pages");
+    StatCounter& chunks = stat_counter("pdf_extractor", "chunks");
+    StatHistogram& parse = stat_histogram("pdf_extractor", "parse");
+    StatHistogram& page = stat_histogram("pdf_extractor", "page");
+    StatHistogram& hash = stat_histogram("pdf_extractor", "hash");
+    StatHistogram& chunk = stat_histogram("pdf_extractor", "chunk");
+    StatHistogram& marshal = stat_histogram("pdf_extractor", "marshal");
+};
+
+PdfStats& pdf_stats();
+
+/**
+ * Load a PDF document from a buffer, throwing if it cannot be opened.
+ * The buffer must outlive the returned document.
+ */
+std::unique_ptr<poppler::document> load_pdf_document(const char* data, size_t size);
+
+/**
+ * Like load_pdf_document, but also returns documents that are locked by a
+ * password, so their metadata can still be inspected.
+ */
+std::unique_ptr<poppler::document> open_pdf_document(const char* data, size_t size);
+
+/**
+ * Document-level facts that are available without creating any page:
+ * poppler only reads the cross-reference table, trailer, catalog and info
+ * dictionary. Metadata strings are UTF-8 and empty for locked documents.
+ */
+struct PdfInfo {
+    int page_count = 0;
+    std::string pdf_version;  // e.g. "1.7"
+    bool encrypted = false;
+    bool locked = false;      // encrypted and unreadable without a password
+    bool linearized = false;
+    std::string title;
+    std::string author;
+    std::string subject;
+    std::string keywords;
+    std::string creator;
+    std::string producer;
+};
+
+/**
+ * Reads PdfInfo from a PDF buffer. Throws runtime_error if the buffer has
+ * no %PDF- header or poppler cannot parse it; locked documents are
+ * reported, not rejected.
+ */
+PdfInfo read_pdf_info(const char* data, size_t size);
+
+/**
+ * Append the UTF-8 text of one page to out.
+ *
+ * @return false if poppler cannot create the page
+ */
+bool read_page_text(const poppler::document& doc, int index, std::string& out);
+
+/**
+ * Append the text of one page followed by a newline. Pages that poppler
+ * cannot create contribute nothing.
+ */
+void append_page_text(const poppler::document& doc, int index, std::string& out);
+
+/**
+ * Runs page_body(doc, page_index, slot) for every page of a PDF, or for the
+ * 0-based page range [first_page, last_page) clamped to the document,
+ * optionally in parallel.
+ * 
+ * With more than one thread the pages are split into contiguous ranges and
+ * each range is processed by its own worker. Poppler documents are not safe
+ * to share between threads, so every worker loads a private document from
+ * the same buffer and writes into its own preallocated slot.
+ * 
+ * @param num_threads Maximum number of threads to use (0 = pool size, 1 = sequential)
+ * @param last_page One past the last page to process, or -1 for the end of the document
+ * @param cancel Checked before every page; throws JobCancelled once triggered
+ * @return One slot per page range, in page order
+ */
+template <typename Slot, typename PageBody>
+std::vector<Slot> process_pdf_pages(const char* data, size_t size, size_t num_threads, PageBody&& page_body,
+                                    int first_page = 0, int last_page = -1, const CancelToken* cancel = nullptr) {
+    std::unique_ptr<poppler::document> doc = load_pdf_document(data, size);
+    const int end_page = last_page < 0 ? doc->pages() : std::min(last_page, doc->pages());
+    const int begin_page = std::min(std::max(first_page, 0), end_page);
+    const int page_count = end_page - begin_page;
+    
+    size_t workers = num_threads == 0 ? shared_thread_pool().size() + 1 : num_threads;
+    workers = std::min(workers, static_cast<size_t>((page_count + kMinPagesPerWorker - 1) / kMinPagesPerWorker));
+    workers = std::max<size_t>(workers, 1);
+    
+    std::vector<Slot> slots(workers);
+    if (workers == 1) {
+        for (int i = begin_page; i < end_page; ++i) {
+            if (cancel) {
+                cancel->throw_if_cancelled();
+            }
+            page_body(*doc, i, slots[0]);
+        }
+        return slots;
+    }
+    
+    shared_thread_pool().parallel_for(workers, [&](size_t range) {
+        const int first = begin_page + static_cast<int>(range * page_count / workers);
+        const int last = begin_page + static_cast<int>((range + 1) * page_count / workers);
+        
+        // The first range reuses the document that was loaded to count pages
+        std::unique_ptr<poppler::document> own_doc;
+        if (range != 0) {
+            own_doc = load_pdf_document(data, size);
+        }
+        const poppler::document& range_doc = range == 0 ? *doc : *own_doc;
+        
+        for (int i = first; i < last; ++i) {
+            if (cancel) {
+                cancel->throw_if_cancelled();
+            }
+            page_body(range_doc, i, slots[range]);
+        }
+    }, workers);
+    return slots;
+}
+
+/**
+ * Extract text from a PDF file using Poppler.
+ *
+ * @param data The PDF file data
+ * @param size The size of the data in bytes
+ * @param num_threads Maximum number of threads to use (0 = pool size, 1 = sequential)
+ * @param cancel Optional token checked between pages, see process_pdf_pages
+ * @return Text content from the PDF
+ */
+std::string extract_text_from_pdf_buffer(const char* data, size_t size, size_t num_threads = 1,
+                                         const CancelToken* cancel = nullptr);
+
+/**
+ * Extract text and compute the hash of a single PDF. Does not touch any
+ * Python object, so it can run with the GIL released.
+ *
+ * @param data The PDF file data
+ * @param size The size of the data in bytes
+ * @param num_threads Threads used for page extraction, see extract_text_from_pdf_buffer
+ * @param cancel Optional token checked between pages; JobCancelled propagates unchanged
+ * @return Pair of (text, hash)
+ */
+std::pair<std::string, std::string> extract_text_and_hash(const char* data, size_t size, size_t num_threads = 1,
+                                                          const CancelToken* cancel = nullptr);
+
+/**
+ * Extract the text of the 0-based page range [first_page, last_page),
+ * clamped to the document. Only this range's pages are created.
+ *
+ * @param num_threads Threads used to process pages in parallel (0 = pool size, 1 = sequential)
+ * @param layout Assemble page text from text boxes, see read_page_layout_text
+ * @return (1-based page number, text) for every page in the range
+ */
+std::vector<std::pair<int, std::string>> extract_page_range(const char* data, size_t size, int first_page,
+                                                            int last_page, size_t num_threads = 1,
+                                                            bool layout = false);
+
+/**
+ * One chunk produced by the fused extract/chunk/hash pipeline.
+ */
+struct PdfChunk {
+    std::string text;
+    int page_number;           // 1-based page the chunk was cut from
+    std::string content_hash;  // SHA-256 of the chunk's UTF-8 bytes
+};
+
+/**
+ * Fused pipeline: parses a PDF, chunks every page with splitter as soon as
+ * its text is extracted and hashes each chunk. Chunks never span pages.
+ *
+ * @param num_threads Threads used to process pages in parallel (0 = pool size, 1 = sequential)
+ * @param layout Assemble page text from text boxes (see read_page_layout_text)
+ *               rather than poppler's flat text, so blocks are "\n\n"-separated
+ * @param cancel Optional token checked between pages; JobCancelled propagates unchanged
+ * @return Pair of (document hash, chunks in page order)
+ */
+std::pair<std::string, std::vector<PdfChunk>> extract_chunks_and_hash(const char* data, size_t size,
+                                                                      SpanSplitter splitter, int chunk_size,
+                                                                      int chunk_overlap, size_t num_threads,
+                                                                      bool layout = false,
+                                                                      const CancelToken* cancel = nullptr);
@@ -1,110 +1,473 @@
 #include <pybind11/pybind11.h>
 #include <pybind11/stl.h>
+#include <pybind11/numpy.h>
 #include <string>
 #include <vector>
 #include <utility>
+#include <memory>
+#include <string_view>
+#include <mutex>
 #include <stdexcept>
-#include <sstream>
-#include <iomanip>
-#include <poppler/cpp/poppler-document.h>
-#include <poppler/cpp/poppler-page.h>
-#include <poppler/cpp/poppler-global.h>
-#include <openssl/evp.h>
+#include "mapped_file.h"
+#include "thread_pool.h"
+#include "chunking_methods.h"
+#include "chunk_archive.h"
+#include "pdf_document.h"
+#include "pdf_layout.h"
+#include "bindings.h"
 
 namespace py = pybind11;
 using namespace std;
 
 /**
- * Generate SHA-256 hash of a binary buffer.
+ * Python-facing function that accepts PDF data as bytes and returns extracted text and hash.
  * 
- * @param data The binary data to hash
- * @param size The size of the data in bytes
- * @return Hexadecimal string representation of the hash
+ * @param buffer Python bytes-like object containing PDF data
+ * @param num_threads Threads used to extract pages in parallel (0 = all cores, 1 = sequential)
+ * @return Tuple of (text, hash)
  */
-string sha256_hash(const unsigned char* data, size_t size) {
-    unsigned char hash[EVP_MAX_MD_SIZE];
-    unsigned int hash_len;
-    
-    EVP_MD_CTX* context = EVP_MD_CTX_new();
-    EVP_DigestInit_ex(context, EVP_sha256(), NULL);
-    EVP_DigestUpdate(context, data, size);
-    EVP_DigestFinal_ex(context, hash, &hash_len);
-    EVP_MD_CTX_free(context);
+py::object extract_pdf_text_and_hash(py::bytes buffer, size_t num_threads) {
+    // bytes objects are immutable, so their storage can be read without the GIL
+    char* data = nullptr;
+    py::ssize_t size = 0;
+    if (PyBytes_AsStringAndSize(buffer.ptr(), &data, &size) != 0) {
+        throw py::error_already_set();
+    }
     
-    stringstream ss;
-    for (int i = 0; i < hash_len; i++) {
-        ss << hex << setw(2) << setfill('0') << static_cast<int>(hash[i]);
+    pair<string, string> result;
+    {
+        py::gil_scoped_release release;
+        result = extract_text_and_hash(data, static_cast<size_t>(size), num_threads);
+    }
+    return marshal(pdf_stats().marshal, move(result));
+}
+
+/**
+ * Python-facing function that extracts text and hash from a PDF on disk.
+ * The file is memory-mapped and poppler parses it straight from the mapping,
+ * so its contents are never copied into Python memory.
+ * 
+ * @param path Path of the PDF file
+ * @param num_threads Threads used to extract pages in parallel (0 = all cores, 1 = sequential)
+ * @return Tuple of (text, hash)
+ */
+py::object extract_pdf_text_and_hash_file(const string& path, size_t num_threads) {
+    pair<string, string> result;
+    {
+        py::gil_scoped_release release;
+        MappedFile file(path);
+        result = extract_text_and_hash(file.data(), file.size(), num_threads);
+    }
+    return marshal(pdf_stats().marshal, move(result));
+}
+
+/**
+ * Descriptor variant of extract_pdf_text_and_hash_file. The whole file is
+ * read regardless of the descriptor's current offset; the descriptor is not closed.
+ * 
+ * @param fd Open, readable file descriptor (e.g. file.fileno())
+ * @param num_threads Threads used to extract pages in parallel (0 = all cores, 1 = sequential)
+ * @return Tuple of (text, hash)
+ */
+py::object extract_pdf_text_and_hash_fd(int fd, size_t num_threads) {
+    pair<string, string> result;
+    {
+        py::gil_scoped_release release;
+        MappedFile file(fd);
+        result = extract_text_and_hash(file.data(), file.size(), num_threads);
+    }
+    return marshal(pdf_stats().marshal, move(result));
+}
+
+/**
+ * Extract text and hashes from several PDFs in parallel on the shared thread pool.
+ * 
+ * @param buffers Python bytes-like objects containing PDF data
+ * @param num_threads Maximum number of threads to use (0 = pool size)
+ * @return List of (text, hash) tuples in input order
+ */
+py::object extract_pdfs(const vector<py::buffer>& buffers, size_t num_threads) {
+    // Acquire every buffer while the GIL is held; the exports also keep the
+    // underlying memory from being resized while the workers read it
+    vector<py::buffer_info> infos;
+    infos.reserve(buffers.size());
+    for (const py::buffer& buffer : buffers) {
+        infos.push_back(buffer.request());
     }
     
-    return ss.str();
+    vector<pair<string, string>> results(infos.size());
+    {
+        py::gil_scoped_release release;
+        shared_thread_pool().parallel_for(infos.size(), [&](size_t i) {
+            const py::buffer_info& info = infos[i];
+            try {
+                results[i] = extract_text_and_hash(
+                    static_cast<const char*>(info.ptr),
+                    static_cast<size_t>(info.size * info.itemsize)
+                );
+            } catch (const exception& e) {
+                throw runtime_error("PDF " + to_string(i) + ": " + e.what());
+            }
+        }, num_threads);
+    }
+    return marshal(pdf_stats().marshal, move(results));
 }
 
 /**
- * Extract text from a PDF file using Poppler.
+ * Python-facing fused pipeline: parses a PDF, chunks every page as soon as
+ * its text is extracted and hashes each chunk, all in one native call.
+ * Chunks never span pages, so each one carries the page it came from.
  * 
- * @param buffer The PDF file data as a binary buffer
- * @return Text content from the PDF
+ * @param buffer Python bytes-like object containing PDF data
+ * @param chunk_size Chunk size (characters for "recursive"/"chars", words for "words")
+ * @param chunk_overlap Overlap between consecutive chunks of a page, same unit
+ * @param method "recursive", "chars", "words" or "unicode", see span_splitter_for_method
+ * @param num_threads Threads used to process pages in parallel (0 = all cores, 1 = sequential)
+ * @param layout Build page text from text boxes so blocks and columns are "\n\n"-separated
+ * @return Tuple of (document hash, list of PdfChunk in page order)
+ */
+py::object extract_pdf_chunks(py::bytes buffer, int chunk_size, int chunk_overlap,
+                              const string& method, size_t num_threads, bool layout) {
+    SpanSplitter splitter = span_splitter_for_method(method);
+    // Validate the chunking parameters before parsing anything
+    splitter(string_view(), chunk_size, chunk_overlap);
+    
+    char* data = nullptr;
+    py::ssize_t size = 0;
+    if (PyBytes_AsStringAndSize(buffer.ptr(), &data, &size) != 0) {
+        throw py::error_already_set();
+    }
+    
+    pair<string, vector<PdfChunk>> result;
+    {
+        py::gil_scoped_release release;
+        result = extract_chunks_and_hash(data, static_cast<size_t>(size), splitter, chunk_size, chunk_overlap,
+                                         num_threads, layout);
+    }
+    return marshal(pdf_stats().marshal, move(result));
+}
+
+/**
+ * extract_pdf_chunks into a ChunkArchive with page_number and content_hash
+ * columns, so the chunks can be passed on or stored without a Python object
+ * per chunk.
+ *
+ * @return Tuple of (document hash, ChunkArchive of the chunks in page order)
  */
-string extract_text_from_pdf_buffer(const string& buffer) {
-    // Load document from buffer
-    poppler::document* doc = poppler::document::load_from_raw_data(
-        buffer.c_str(), static_cast<int>(buffer.size())
-    );
-    
-    if (!doc || doc->is_locked()) {
-        throw runtime_error("Failed to load PDF or PDF is encrypted");
-    }
-    
-    // Extract text from each page
-    string all_text;
-    for (int i = 0; i < doc->pages(); ++i) {
-        poppler::page* page = doc->create_page(i);
-        if (page) {
-            // Get text and convert to string properly
-            poppler::ustring page_text = page->text();
-            poppler::byte_array utf8_bytes = page_text.to_utf8();
-            string utf8_text(utf8_bytes.begin(), utf8_bytes.end());
-            all_text += utf8_text;
-            all_text += "\n";  // Add newline after each page
-            delete page;
+py::object extract_pdf_archive(py::bytes buffer, int chunk_size, int chunk_overlap,
+                               const string& method, size_t num_threads, bool layout) {
+    SpanSplitter splitter = span_splitter_for_method(method);
+    splitter(string_view(), chunk_size, chunk_overlap);
+
+    char* data = nullptr;
+    py::ssize_t size = 0;
+    if (PyBytes_AsStringAndSize(buffer.ptr(), &data, &size) != 0) {
+        throw py::error_already_set();
+    }
+
+    string hash;
+    unique_ptr<ChunkArchive> archive;
+    {
+        py::gil_scoped_release release;
+        pair<string, vector<PdfChunk>> result = extract_chunks_and_hash(
+            data, static_cast<size_t>(size), splitter, chunk_size, chunk_overlap, num_threads, layout);
+        ChunkArchiveBuilder builder;
+        for (const PdfChunk& chunk : result.second) {
+            const size_t row = builder.add_text(chunk.text);
+            builder.set_int64("page_number", row, chunk.page_number);
+            builder.set_string("content_hash", row, chunk.content_hash);
         }
+        archive = make_unique<ChunkArchive>(builder.finish());
+        hash = move(result.first);
+    }
+    return py::make_tuple(move(hash), move(archive));
+}
+
+/**
+ * Python-facing layout extraction, see PdfLayout.
+ * 
+ * @param buffer Python bytes-like object containing PDF data
+ * @param num_threads Threads used to process pages in parallel (0 = all cores, 1 = sequential)
+ * @return PdfLayout with the text buffer and its word, line, block and page tables
+ */
+py::object extract_pdf_layout_from_buffer(const py::buffer& buffer, size_t num_threads) {
+    py::buffer_info info = buffer.request();
+    PdfLayout layout;
+    {
+        py::gil_scoped_release release;
+        layout = extract_pdf_layout(static_cast<const char*>(info.ptr),
+                                    static_cast<size_t>(info.size * info.itemsize), num_threads);
+    }
+    return marshal(pdf_stats().marshal, move(layout));
+}
+
+/**
+ * Python-facing triage: page count, version, encryption and metadata of a
+ * PDF, read without creating any page.
+ * 
+ * @param buffer Python bytes-like object containing PDF data
+ * @return PdfInfo
+ */
+PdfInfo pdf_info(const py::buffer& buffer) {
+    py::buffer_info info = buffer.request();
+    py::gil_scoped_release release;
+    return read_pdf_info(static_cast<const char*>(info.ptr), static_cast<size_t>(info.size * info.itemsize));
+}
+
+/**
+ * Python-facing page-range extraction; only the requested pages are created.
+ * 
+ * @param buffer Python bytes-like object containing PDF data
+ * @param first First page to extract (1-based)
+ * @param last Last page to extract (inclusive, clamped to the page count)
+ * @param num_threads Threads used to extract pages in parallel (0 = all cores, 1 = sequential)
+ * @param layout Assemble page text from text boxes, separating blocks by blank lines
+ * @return List of (page_number, text) tuples
+ */
+py::object extract_pdf_pages(const py::buffer& buffer, int first, int last, size_t num_threads, bool layout) {
+    if (first < 1) {
+        throw invalid_argument("first must be at least 1");
+    }
+    if (last < first) {
+        throw invalid_argument("last must not be less than first");
     }
     
-    delete doc;
-    return all_text;
+    py::buffer_info info = buffer.request();
+    vector<pair<int, string>> pages;
+    {
+        py::gil_scoped_release release;
+        pages = extract_page_range(static_cast<const char*>(info.ptr), static_cast<size_t>(info.size * info.itemsize),
+                                   first - 1, last, num_threads, layout);
+    }
+    return marshal(pdf_stats().marshal, move(pages));
 }
 
 /**
- * Python-facing function that accepts PDF data as bytes and returns extracted text and hash.
+ * Read-only NumPy view of one PdfLayout table as rows x columns values of T,
+ * like the text buffer. The view keeps the PdfLayout alive.
+ */
+template <typename T, typename Element>
+static auto layout_table(vector<Element> PdfLayout::*table, size_t columns) {
+    return [table, columns](const py::object& self) {
+        const vector<Element>& rows = self.cast<const PdfLayout&>().*table;
+        vector<py::ssize_t> shape{static_cast<py::ssize_t>(rows.size())};
+        vector<py::ssize_t> strides{static_cast<py::ssize_t>(sizeof(Element))};
+        if (columns > 1) {
+            shape.push_back(static_cast<py::ssize_t>(columns));
+            strides.push_back(static_cast<py::ssize_t>(sizeof(T)));
+        }
+        py::array_t<T> result(shape, strides, reinterpret_cast<const T*>(rows.data()), self);
+        result.attr("setflags")(py::arg("write") = false);
+        return result;
+    };
+}
+
+/**
+ * Lazily extracts one page at a time, so only the PDF bytes and the current
+ * page's text are alive at once. Backs the iter_pdf_pages Python iterator.
+ */
+class PdfPageIterator {
+public:
+    explicit PdfPageIterator(const py::buffer& buffer)
+        : buffer_(buffer.request()) {
+        const size_t size = static_cast<size_t>(buffer_.size * buffer_.itemsize);
+        py::gil_scoped_release release;
+        doc_ = load_pdf_document(static_cast<const char*>(buffer_.ptr), size);
+        page_count_ = doc_->pages();
+        pdf_stats().documents.add();
+        pdf_stats().bytes.add(size);
+    }
+    
+    int page_count() const { return page_count_; }
+    
+    /**
+     * Extract the next page.
+     * 
+     * @return Tuple of (1-based page number, text); pages poppler cannot
+     *         create yield empty text so numbering stays aligned
+     */
+    py::object next() {
+        string text;
+        int index;
+        {
+            py::gil_scoped_release release;
+            // The GIL is not held while a page is parsed, so concurrent
+            // next() calls on the same iterator are serialized here
+            lock_guard<mutex> lock(mutex_);
+            if (next_page_ >= page_count_) {
+                // Free the document as soon as iteration finishes
+                doc_.reset();
+                index = -1;
+            } else {
+                index = next_page_++;
+                read_page_text(*doc_, index, text);
+            }
+        }
+        if (index < 0) {
+            throw py::stop_iteration();
+        }
+        return marshal(pdf_stats().marshal, make_pair(index + 1, move(text)));
+    }
+    
+private:
+    // Export of the PDF bytes; keeps them alive and unresized while the
+    // document (which does not copy them) is open
+    py::buffer_info buffer_;
+    unique_ptr<poppler::document> doc_;
+    mutex mutex_;
+    int page_count_ = 0;
+    int next_page_ = 0;
+};
+
+/**
+ * Python-facing function returning an iterator over the pages of a PDF.
  * 
  * @param buffer Python bytes-like object containing PDF data
- * @return Tuple of (text, hash)
+ * @return Iterator yielding (page_number, text) tuples
  */
-pair<string, string> extract_pdf_text_and_hash(py::bytes buffer) {
-    // Convert Python bytes to C++ string for processing
-    string str = static_cast<string>(buffer);
-    
-    // Calculate hash using SHA-256
-    string hash_str = sha256_hash(
-        reinterpret_cast<const unsigned char*>(str.data()), 
-        str.size()
-    );
-    
-    // Extract text
-    string text;
+unique_ptr<PdfPageIterator> iter_pdf_pages(const py::buffer& buffer) {
     try {
-        text = extract_text_from_pdf_buffer(str);
+        return make_unique<PdfPageIterator>(buffer);
+    } catch (const py::error_already_set&) {
+        throw;
     } catch (const exception& e) {
         throw runtime_error(string("Error extracting text from PDF: ") + e.what());
     }
-    
-    return make_pair(text, hash_str);
 }
 
-PYBIND11_MODULE(pdf_extractor, m) {
+void register_pdf_extractor(py::module_& m) {
     m.doc() = "C++ implementation of PDF text extraction for improved performance";
     
     m.def("extract_pdf_text_and_hash", &extract_pdf_text_and_hash, 
         py::arg("buffer"),
+        py::arg("num_threads") = 1,
         "Extract text from a PDF buffer and compute its hash");
+    
+    m.def("extract_pdf_text_and_hash_file", &extract_pdf_text_and_hash_file,
+        py::arg("path"),
+        py::arg("num_threads") = 1,
+        "Extract text from a PDF file and compute its hash, reading it through a memory mapping");
+    
+    m.def("extract_pdf_text_and_hash_fd", &extract_pdf_text_and_hash_fd,
+        py::arg("fd"),
+        py::arg("num_threads") = 1,
+        "Extract text and hash from the PDF behind an open file descriptor, reading it through a memory mapping");
+    
+    m.def("extract_pdfs", &extract_pdfs,
+        py::arg("buffers"),
+        py::arg("num_threads") = 0,
+        "Extract text and hashes from several PDF buffers in parallel");
+    
+    py::class_<PdfPageIterator>(m, "PdfPageIterator")
+        .def("__iter__", [](PdfPageIterator& it) -> PdfPageIterator& { return it; },
+            py::return_value_policy::reference_internal)
+        .def("__next__", &PdfPageIterator::next)
+        .def_property_readonly("page_count", &PdfPageIterator::page_count,
+            "Number of pages in the document");
+    
+    py::class_<PdfChunk>(m, "PdfChunk")
+        .def_readonly("text", &PdfChunk::text)
+        .def_readonly("page_number", &PdfChunk::page_number)
+        .def_readonly("content_hash", &PdfChunk::content_hash)
+        .def("__repr__", [](const PdfChunk& chunk) {
+            return "<PdfChunk page=" + to_string(chunk.page_number) + " hash=" + chunk.content_hash.substr(0, 12) + ">";
+        });
+    
+    m.def("extract_pdf_chunks", &extract_pdf_chunks,
+        py::arg("buffer"),
+        py::arg("chunk_size"),
+        py::arg("chunk_overlap"),
+        py::arg("method") = "recursive",
+        py::arg("num_threads") = 1,
+        py::arg("layout") = false,
+        "Extract, chunk and hash a PDF in one call, returning (document_hash, chunks) with page numbers");
+
+    m.def("extract_pdf_archive", &extract_pdf_archive,
+        py::arg("buffer"),
+        py::arg("chunk_size"),
+        py::arg("chunk_overlap"),
+        py::arg("method") = "recursive",
+        py::arg("num_threads") = 1,
+        py::arg("layout") = false,
+        "Like extract_pdf_chunks, returning (document_hash, text_chunker.ChunkArchive) with page_number and "
+        "content_hash columns");
+    
+    py::class_<PdfLayout>(m, "PdfLayout", py::buffer_protocol(),
+        "Text of a PDF in one UTF-8 buffer (exposed through the buffer protocol) with columnar word, line, "
+        "block and page tables; spans are byte offsets into the buffer, boxes (x0, y0, x1, y1) in points")
+        .def_buffer([](const PdfLayout& layout) {
+            return py::buffer_info(
+                const_cast<char*>(layout.text.data()),
+                1,
+                py::format_descriptor<uint8_t>::format(),
+                1,
+                {static_cast<py::ssize_t>(layout.text.size())},
+                {static_cast<py::ssize_t>(1)},
+                true
+            );
+        })
+        .def_property_readonly("text", [](const PdfLayout& layout) {
+            return py::str(layout.text.data(), layout.text.size());
+        })
+        .def_property_readonly("word_spans", layout_table<uint64_t>(&PdfLayout::word_spans, 2))
+        .def_property_readonly("word_boxes", layout_table<float>(&PdfLayout::word_boxes, 4))
+        .def_property_readonly("word_lines", layout_table<uint32_t>(&PdfLayout::word_lines, 1),
+            "Line id of every word")
+        .def_property_readonly("line_spans", layout_table<uint64_t>(&PdfLayout::line_spans, 2))
+        .def_property_readonly("line_boxes", layout_table<float>(&PdfLayout::line_boxes, 4))
+        .def_property_readonly("line_blocks", layout_table<uint32_t>(&PdfLayout::line_blocks, 1),
+            "Block id of every line")
+        .def_property_readonly("block_spans", layout_table<uint64_t>(&PdfLayout::block_spans, 2))
+        .def_property_readonly("block_boxes", layout_table<float>(&PdfLayout::block_boxes, 4))
+        .def_property_readonly("block_pages", layout_table<uint32_t>(&PdfLayout::block_pages, 1),
+            "1-based page number of every block")
+        .def_property_readonly("page_spans", layout_table<uint64_t>(&PdfLayout::page_spans, 2),
+            "Byte range of every page's text, empty for pages without text")
+        .def("__repr__", [](const PdfLayout& layout) {
+            return "<PdfLayout pages=" + to_string(layout.page_spans.size()) + " blocks=" +
+                   to_string(layout.block_spans.size()) + " lines=" + to_string(layout.line_spans.size()) +
+                   " words=" + to_string(layout.word_spans.size()) + ">";
+        });
+    
+    m.def("extract_pdf_layout", &extract_pdf_layout_from_buffer,
+        py::arg("buffer"),
+        py::arg("num_threads") = 1,
+        "Extract the text of a PDF with its word, line, block and page structure as a PdfLayout");
+    
+    py::class_<PdfInfo>(m, "PdfInfo")
+        .def_readonly("page_count", &PdfInfo::page_count)
+        .def_readonly("pdf_version", &PdfInfo::pdf_version)
+        .def_readonly("encrypted", &PdfInfo::encrypted)
+        .def_readonly("locked", &PdfInfo::locked, "Encrypted and unreadable without a password")
+        .def_readonly("linearized", &PdfInfo::linearized)
+        .def_readonly("title", &PdfInfo::title)
+        .def_readonly("author", &PdfInfo::author)
+        .def_readonly("subject", &PdfInfo::subject)
+        .def_readonly("keywords", &PdfInfo::keywords)
+        .def_readonly("creator", &PdfInfo::creator)
+        .def_readonly("producer", &PdfInfo::producer)
+        .def("__repr__", [](const PdfInfo& info) {
+            return "<PdfInfo pages=" + to_string(info.page_count) + " version=" + info.pdf_version +
+                   (info.locked ? " locked" : info.encrypted ? " encrypted" : "") + ">";
+        });
+    
+    m.def("pdf_info", &pdf_info,
+        py::arg("buffer"),
+        "Read the page count, PDF version, encryption flags and metadata of a PDF without extracting any page");
+    
+    m.def("extract_pdf_pages", &extract_pdf_pages,
+        py::arg("buffer"),
+        py::arg("first"),
+        py::arg("last"),
+        py::arg("num_threads") = 1,
+        py::arg("layout") = false,
+        "Extract the text of pages first..last (1-based, inclusive) as a list of (page_number, text) tuples");
+    
+    m.def("iter_pdf_pages", &iter_pdf_pages,
+        py::arg("buffer"),
+        "Iterate over the pages of a PDF buffer, yielding (page_number, text) tuples");
+    
+    // Create the metrics up front so get_stats() lists them before first use
+    pdf_stats();
+    register_stats_api(m, "pdf_extractor");
 } 
\ No newline at end of file
@@ -0,0 +1,187 @@
+#include "pdf_layout.h"
+#include "pdf_document.h"
+
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+
+using namespace std;
+
+namespace {
+
+// A gap between lines larger than this many line heights starts a new block
+constexpr float kBlockGapLines = 1.0f;
+
+PdfBox to_box(const poppler::rectf& rect) {
+    return {static_cast<float>(rect.left()), static_cast<float>(rect.top()),
+            static_cast<float>(rect.right()), static_cast<float>(rect.bottom())};
+}
+
+void extend(PdfBox& box, const PdfBox& other) {
+    box.x0 = min(box.x0, other.x0);
+    box.y0 = min(box.y0, other.y0);
+    box.x1 = max(box.x1, other.x1);
+    box.y1 = max(box.y1, other.y1);
+}
+
+float height(const PdfBox& box) {
+    return box.y1 - box.y0;
+}
+
+// Whether word continues the line ending in previous: at least half of the
+// shorter box overlaps vertically, and it does not jump back to the left
+bool continues_line(const PdfBox& line, const PdfBox& previous, const PdfBox& word) {
+    float overlap = min(line.y1, word.y1) - max(line.y0, word.y0);
+    return overlap >= 0.5f * min(height(line), height(word)) && word.x0 >= previous.x0;
+}
+
+bool starts_block(const PdfBox& block, const PdfBox& line, const PdfBox& word) {
+    const float line_height = max(height(line), 1.0f);
+    return word.y0 < line.y0 - 0.5f * line_height ||  // moved up: next column
+           word.x0 > block.x1 || word.x1 < block.x0 ||  // beside the block
+           word.y0 - line.y1 > kBlockGapLines * line_height;
+}
+
+void rebase(vector<TextSpan>& spans, size_t from, uint64_t offset) {
+    for (size_t i = from; i < spans.size(); ++i) {
+        spans[i].start += offset;
+        spans[i].end += offset;
+    }
+}
+
+template <typename T>
+void append_all(vector<T>& to, vector<T>&& from) {
+    to.insert(to.end(), make_move_iterator(from.begin()), make_move_iterator(from.end()));
+}
+
+}  // namespace
+
+void PdfLayout::append(PdfLayout&& other) {
+    if (page_spans.empty()) {
+        *this = move(other);
+        return;
+    }
+
+    // Keep the page separator that read_page_layout would have written
+    uint64_t offset = text.size();
+    if (!text.empty() && !other.text.empty()) {
+        text += "\n\n";
+        offset += 2;
+    }
+    text += other.text;
+
+    const size_t words = word_spans.size();
+    const size_t lines = line_spans.size();
+    const size_t blocks = block_spans.size();
+    const size_t pages = page_spans.size();
+    append_all(word_spans, move(other.word_spans));
+    append_all(word_boxes, move(other.word_boxes));
+    append_all(line_spans, move(other.line_spans));
+    append_all(line_boxes, move(other.line_boxes));
+    append_all(block_spans, move(other.block_spans));
+    append_all(block_boxes, move(other.block_boxes));
+    append_all(block_pages, move(other.block_pages));
+    append_all(page_spans, move(other.page_spans));
+    rebase(word_spans, words, offset);
+    rebase(line_spans, lines, offset);
+    rebase(block_spans, blocks, offset);
+    rebase(page_spans, pages, offset);
+    for (uint32_t line : other.word_lines) {
+        word_lines.push_back(line + static_cast<uint32_t>(lines));
+    }
+    for (uint32_t block : other.line_blocks) {
+        line_blocks.push_back(block + static_cast<uint32_t>(blocks));
+    }
+}
+
+bool read_page_layout(const poppler::document& doc, int index, PdfLayout& out) {
+    PdfStats& stats = pdf_stats();
+    ScopedTimer timer(stats.page);
+    unique_ptr<poppler::page> page(doc.create_page(index));
+    if (!page) {
+        return false;
+    }
+    stats.pages.add();
+
+    const uint64_t page_start = out.text.size() + (out.text.empty() ? 0 : 2);
+    bool first = true;
+    bool space_after = false;
+    PdfBox previous{};
+
+    for (const poppler::text_box& box : page->text_list()) {
+        poppler::byte_array utf8 = box.text().to_utf8();
+        if (utf8.empty()) {
+            continue;
+        }
+        const PdfBox word = to_box(box.bbox());
+
+        bool new_line = first || !continues_line(out.line_boxes.back(), previous, word);
+        bool new_block = first || (new_line && starts_block(out.block_boxes.back(), out.line_boxes.back(), word));
+        if (new_block) {
+            if (!out.text.empty()) {
+                out.text += "\n\n";
+            }
+            out.block_spans.push_back({out.text.size(), out.text.size()});
+            out.block_boxes.push_back(word);
+            out.block_pages.push_back(static_cast<uint32_t>(index + 1));
+        } else if (new_line) {
+            out.text += '\n';
+        } else if (space_after) {
+            out.text += ' ';
+        }
+        if (new_line) {
+            out.line_spans.push_back({out.text.size(), out.text.size()});
+            out.line_boxes.push_back(word);
+            out.line_blocks.push_back(static_cast<uint32_t>(out.block_spans.size() - 1));
+        }
+
+        const uint64_t word_start = out.text.size();
+        out.text.append(utf8.begin(), utf8.end());
+        out.word_spans.push_back({word_start, out.text.size()});
+        out.word_boxes.push_back(word);
+        out.word_lines.push_back(static_cast<uint32_t>(out.line_spans.size() - 1));
+
+        out.line_spans.back().end = out.text.size();
+        extend(out.line_boxes.back(), word);
+        out.block_spans.back().end = out.text.size();
+        extend(out.block_boxes.back(), word);
+
+        previous = word;
+        space_after = box.has_space_after();
+        first = false;
+    }
+
+    out.page_spans.push_back(first ? TextSpan{out.text.size(), out.text.size()} : TextSpan{page_start, out.text.size()});
+    return true;
+}
+
+bool read_page_layout_text(const poppler::document& doc, int index, string& out) {
+    PdfLayout layout;
+    if (!read_page_layout(doc, index, layout)) {
+        return false;
+    }
+    out += layout.text;
+    return true;
+}
+
+PdfLayout extract_pdf_layout(const char* data, size_t size, size_t num_threads) {
+    PdfStats& stats = pdf_stats();
+    stats.documents.add();
+    stats.bytes.add(size);
+
+    vector<PdfLayout> ranges;
+    try {
+        ranges = process_pdf_pages<PdfLayout>(data, size, num_threads,
+            [](const poppler::document& doc, int index, PdfLayout& out) {
+                read_page_layout(doc, index, out);
+            });
+    } catch (const exception& e) {
+        throw runtime_error(string("Error extracting layout from PDF: ") + e.what());
+    }
+
+    PdfLayout layout = move(ranges[0]);
+    for (size_t i = 1; i < ranges.size(); ++i) {
+        layout.append(move(ranges[i]));
+    }
+    return layout;
+}
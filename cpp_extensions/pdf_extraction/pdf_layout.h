@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <poppler/cpp/poppler-document.h>
+
+#include "text_span.h"
+
+/**
+ * Axis-aligned box in page coordinates (points, origin at the top-left
+ * corner of the page, as reported by poppler's text boxes).
+ */
+struct PdfBox {
+    float x0;
+    float y0;
+    float x1;
+    float y1;
+};
+static_assert(sizeof(PdfBox) == 4 * sizeof(float), "PdfBox must be densely packed");
+
+/**
+ * Columnar layout of the text of a PDF, built from poppler's text boxes
+ * (words in reading order, which already keeps columns apart).
+ *
+ * All text lives in one UTF-8 buffer: words are joined by a space where
+ * poppler detected one, lines by "\n", and blocks (paragraphs or column
+ * segments) and pages by "\n\n", so separator-based chunkers cut at real
+ * block boundaries. Every level is stored as parallel arrays; spans are
+ * [start, end) byte offsets into text and all ids index the next level up.
+ */
+struct PdfLayout {
+    std::string text;
+
+    std::vector<TextSpan> word_spans;
+    std::vector<PdfBox> word_boxes;
+    std::vector<uint32_t> word_lines;
+
+    std::vector<TextSpan> line_spans;
+    std::vector<PdfBox> line_boxes;
+    std::vector<uint32_t> line_blocks;
+
+    std::vector<TextSpan> block_spans;
+    std::vector<PdfBox> block_boxes;
+    std::vector<uint32_t> block_pages;  // 1-based page numbers
+
+    std::vector<TextSpan> page_spans;  // one per page, empty for pages without text
+
+    /**
+     * Appends a layout covering later pages, rebasing its offsets and ids.
+     */
+    void append(PdfLayout&& other);
+};
+
+/**
+ * Appends the layout of one page to out. Consecutive words are grouped into
+ * a line while they share a baseline and keep moving right; a line starts a
+ * new block when it moves up (the next column), no longer overlaps the
+ * block horizontally, or follows a vertical gap larger than a line height.
+ *
+ * @return false if poppler cannot create the page
+ */
+bool read_page_layout(const poppler::document& doc, int index, PdfLayout& out);
+
+/**
+ * Appends the text of one page as read_page_layout assembles it, to be used
+ * in place of read_page_text where block boundaries matter.
+ *
+ * @return false if poppler cannot create the page
+ */
+bool read_page_layout_text(const poppler::document& doc, int index, std::string& out);
+
+/**
+ * Extracts the layout of every page of a PDF, see PdfLayout.
+ *
+ * @param num_threads Threads used to process pages in parallel (0 = pool size, 1 = sequential)
+ */
+PdfLayout extract_pdf_layout(const char* data, size_t size, size_t num_threads = 1);
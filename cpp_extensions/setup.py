@@ -48,13 +48,30 @@ class CMakeBuild(build_ext):
             build_args += ['--', '/m']
         else:
             cmake_args += ['-DCMAKE_BUILD_TYPE=' + cfg]
-            build_args += ['--', '-j2']
+            build_args += ['--', '-j{}'.format(os.cpu_count() or 2)]
+
+        # LTO unless COSMOS_LTO=0; COSMOS_PGO=1 trains profiles on the
+        # benchmark corpus (COSMOS_PGO_CORPUS, synthetic by default) first
+        cmake_args += ['-DCOSMOS_LTO=' + ('OFF' if os.environ.get('COSMOS_LTO') == '0' else 'ON')]
+        pgo = os.environ.get('COSMOS_PGO') == '1' and not self.debug
+        if os.environ.get('COSMOS_PGO_CORPUS'):
+            cmake_args += ['-DCOSMOS_PGO_CORPUS=' + os.path.abspath(os.environ['COSMOS_PGO_CORPUS'])]
 
         env = os.environ.copy()
         env['CXXFLAGS'] = '{} -DVERSION_INFO=\\"{}\\"'.format(env.get('CXXFLAGS', ''),
                                                               self.distribution.get_version())
         if not os.path.exists(self.build_temp):
             os.makedirs(self.build_temp)
+        if pgo:
+            # Instrumented build and training run, then the optimized build
+            # in the same directory, where GCC looks up the profiles
+            subprocess.check_call(['cmake', ext.sourcedir, '-DCOSMOS_PGO=GENERATE', '-DCOSMOS_BUILD_BENCHMARKS=ON']
+                                  + cmake_args, cwd=self.build_temp, env=env)
+            subprocess.check_call(['cmake', '--build', '.', '--target', 'cosmos_pgo_train'] + build_args,
+                                  cwd=self.build_temp)
+            cmake_args += ['-DCOSMOS_PGO=USE']
+        else:
+            cmake_args += ['-DCOSMOS_PGO=OFF']
         subprocess.check_call(['cmake', ext.sourcedir] + cmake_args, cwd=self.build_temp, env=env)
         subprocess.check_call(['cmake', '--build', '.'] + build_args, cwd=self.build_temp)
 
@@ -67,9 +84,7 @@ setup(
     description='C++ extensions for COSMOS project',
     long_description='',
     ext_modules=[
-        CMakeExtension('text_chunker'),
-        CMakeExtension('pdf_extractor'),
-        CMakeExtension('hash_generator')
+        CMakeExtension('_cosmos_native')
     ],
     cmdclass=dict(build_ext=CMakeBuild),
     zip_safe=False,
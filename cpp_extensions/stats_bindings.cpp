@@ -0,0 +1,99 @@
+#include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
+
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "bindings.h"
+#include "hex_encoding.h"
+#include "stats.h"
+#include "trace.h"
+
+namespace py = pybind11;
+using namespace std;
+
+/**
+ * Metrics of one module as a dict: counters map to ints, each histogram
+ * "<phase>" to "<phase>_ns" with count, total, mean, min, max and
+ * percentile estimates in nanoseconds.
+ */
+static py::dict stats_to_dict(const ModuleStats& stats) {
+    py::dict result;
+    for (const auto& counter : stats.counters) {
+        result[py::str(counter.first)] = counter.second;
+    }
+    for (const auto& entry : stats.histograms) {
+        const StatHistogram::Snapshot& snapshot = entry.second;
+        py::dict histogram;
+        histogram["count"] = snapshot.count;
+        histogram["total"] = snapshot.sum;
+        histogram["mean"] = snapshot.count ? static_cast<double>(snapshot.sum) / static_cast<double>(snapshot.count) : 0.0;
+        histogram["min"] = snapshot.min;
+        histogram["max"] = snapshot.max;
+        histogram["p50"] = snapshot.percentile(0.50);
+        histogram["p90"] = snapshot.percentile(0.90);
+        histogram["p99"] = snapshot.percentile(0.99);
+        result[py::str(entry.first + "_ns")] = histogram;
+    }
+    return result;
+}
+
+static string random_trace_id() {
+    random_device device;
+    unsigned char bytes[16];
+    for (unsigned char& byte : bytes) {
+        byte = static_cast<unsigned char>(device());
+    }
+    return hex_encode(bytes, sizeof(bytes));
+}
+
+/**
+ * Serializes the recorded trace events.
+ *
+ * @param format "chrome" (chrome://tracing / Perfetto JSON) or "otlp" (OTLP/JSON spans)
+ * @param clear Discard the exported events
+ * @param trace_id OTLP trace id (32 hex digits); a random one when empty
+ * @param parent_span_id OTLP parent span id (16 hex digits), e.g. the current request span
+ * @param service_name OTLP service.name resource attribute
+ */
+static string export_trace(const string& format, bool clear, const string& trace_id,
+                           const string& parent_span_id, const string& service_name) {
+    if (format != "chrome" && format != "otlp") {
+        throw invalid_argument("Unknown trace format '" + format + "', expected chrome or otlp");
+    }
+    vector<TraceEvent> events = trace_events(clear);
+    if (format == "chrome") {
+        return chrome_trace_json(events);
+    }
+    return otlp_trace_json(events, service_name, trace_id.empty() ? random_trace_id() : trace_id, parent_span_id);
+}
+
+void register_stats_api(py::module_& m, const char* module) {
+    const string name = module;
+
+    m.def("get_stats", [name]() { return stats_to_dict(module_stats(name)); },
+        "Counters and per-phase timing histograms (nanoseconds) of this module");
+
+    m.def("reset_stats", [name]() { reset_module_stats(name); },
+        "Zero this module's counters and histograms");
+
+    m.def("start_tracing", &start_tracing,
+        py::arg("max_events") = 1000000,
+        "Start recording trace events for every native module, keeping at most max_events");
+
+    m.def("stop_tracing", &stop_tracing,
+        "Stop recording trace events; recorded events are kept until exported with clear=True");
+
+    m.def("dropped_trace_events", &dropped_trace_events,
+        "Number of events not recorded because the trace buffer was full");
+
+    m.def("export_trace", &export_trace,
+        py::arg("format") = "chrome",
+        py::arg("clear") = true,
+        py::arg("trace_id") = "",
+        py::arg("parent_span_id") = "",
+        py::arg("service_name") = "cosmos-native",
+        "Serialize recorded trace events as Chrome trace JSON or OTLP/JSON spans");
+}
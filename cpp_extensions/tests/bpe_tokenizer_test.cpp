@@ -0,0 +1,147 @@
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "bpe_tokenizer.h"
+#include "unicode_classes.h"
+
+using namespace std;
+
+namespace {
+
+vector<string> pretokens(string_view text, PretokenizerPattern pattern) {
+    vector<string> pieces;
+    for (size_t pos = 0; pos < text.length();) {
+        size_t end = next_pretoken_end(text, pos, pattern);
+        pieces.emplace_back(text.substr(pos, end - pos));
+        pos = end;
+    }
+    return pieces;
+}
+
+string base64(string_view bytes) {
+    static const char* alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    string out;
+    for (size_t i = 0; i < bytes.size(); i += 3) {
+        uint32_t group = static_cast<unsigned char>(bytes[i]) << 16;
+        if (i + 1 < bytes.size()) {
+            group |= static_cast<unsigned char>(bytes[i + 1]) << 8;
+        }
+        if (i + 2 < bytes.size()) {
+            group |= static_cast<unsigned char>(bytes[i + 2]);
+        }
+        out += alphabet[(group >> 18) & 63];
+        out += alphabet[(group >> 12) & 63];
+        out += i + 1 < bytes.size() ? alphabet[(group >> 6) & 63] : '=';
+        out += i + 2 < bytes.size() ? alphabet[group & 63] : '=';
+    }
+    return out;
+}
+
+// Every single byte at its own value, then the given merges in rank order
+string write_ranks_file(const vector<string>& merges) {
+    string path = ::testing::TempDir() + "bpe_tokenizer_test.tiktoken";
+    ofstream out(path, ios::binary | ios::trunc);
+    for (int byte = 0; byte < 256; ++byte) {
+        out << base64(string(1, static_cast<char>(byte))) << ' ' << byte << '\n';
+    }
+    for (size_t i = 0; i < merges.size(); ++i) {
+        out << base64(merges[i]) << ' ' << 256 + i << '\n';
+    }
+    return path;
+}
+
+}  // namespace
+
+// General categories of code points outside the hand-checked ASCII range
+TEST(UnicodeClassesTest, FollowsGeneralCategories) {
+    EXPECT_EQ(classify_code_point(0x00E9), UnicodeClass::LowercaseLetter);  // é
+    EXPECT_EQ(classify_code_point(0x0180), UnicodeClass::LowercaseLetter);  // Latin Extended-B ƀ
+    EXPECT_EQ(classify_code_point(0x0181), UnicodeClass::UppercaseLetter);  // Ɓ
+    EXPECT_EQ(classify_code_point(0x01C5), UnicodeClass::UppercaseLetter);  // titlecase ǅ
+    EXPECT_EQ(classify_code_point(0x2C30), UnicodeClass::LowercaseLetter);  // Glagolitic
+    EXPECT_EQ(classify_code_point(0x0A3C), UnicodeClass::Mark);             // Gurmukhi nukta
+    EXPECT_EQ(classify_code_point(0x093F), UnicodeClass::Mark);             // Devanagari vowel sign i
+    EXPECT_EQ(classify_code_point(0x0CF3), UnicodeClass::Mark);             // added in Unicode 15
+    EXPECT_EQ(classify_code_point(0x0A15), UnicodeClass::UncasedLetter);
+    EXPECT_EQ(classify_code_point(0x4E2D), UnicodeClass::UncasedLetter);    // 中
+    EXPECT_EQ(classify_code_point(0x0660), UnicodeClass::Number);           // Arabic-Indic zero
+    EXPECT_EQ(classify_code_point(0x1D7CE), UnicodeClass::Number);
+    EXPECT_EQ(classify_code_point(0x3000), UnicodeClass::Whitespace);
+    EXPECT_EQ(classify_code_point(0x00A0), UnicodeClass::Whitespace);
+    EXPECT_EQ(classify_code_point(0x2014), UnicodeClass::Other);            // em dash
+    EXPECT_EQ(classify_code_point(0x0378), UnicodeClass::Other);            // unassigned
+    EXPECT_EQ(classify_code_point(0x1F600), UnicodeClass::Other);           // emoji
+}
+
+// Pieces tiktoken's cl100k_base regex produces for the same texts
+TEST(PretokenizerTest, Cl100kMatchesTiktokenPieces) {
+    const auto cl100k = PretokenizerPattern::Cl100k;
+    EXPECT_EQ(pretokens("Hello world", cl100k), vector<string>({"Hello", " world"}));
+    EXPECT_EQ(pretokens("I'm 12345 cats!!\n\n", cl100k),
+              vector<string>({"I", "'m", " ", "123", "45", " cats", "!!\n\n"}));
+    EXPECT_EQ(pretokens("don't  stop\n  now", cl100k),
+              vector<string>({"don", "'t", " ", " stop", "\n", " ", " now"}));
+    // A combining mark is not \p{L}, so it starts a new piece
+    EXPECT_EQ(pretokens("\xE0\xA8\x95\xE0\xA8\xBC\xE0\xA8\x96", cl100k),
+              vector<string>({"\xE0\xA8\x95", "\xE0\xA8\xBC\xE0\xA8\x96"}));
+    // An unassigned code point is neither \p{L} nor \p{N}
+    EXPECT_EQ(pretokens("a\xCD\xB8" "b", cl100k), vector<string>({"a", "\xCD\xB8" "b"}));
+}
+
+// Pieces tiktoken's o200k_base regex produces; it splits on case changes
+TEST(PretokenizerTest, O200kMatchesTiktokenPieces) {
+    const auto o200k = PretokenizerPattern::O200k;
+    EXPECT_EQ(pretokens("HelloWorld", o200k), vector<string>({"Hello", "World"}));
+    EXPECT_EQ(pretokens("\xC6\x81" "a\xC6\x81" "a", o200k), vector<string>({"\xC6\x81" "a", "\xC6\x81" "a"}));
+    EXPECT_EQ(pretokens("a\xC7\x85" "b", o200k), vector<string>({"a", "\xC7\x85" "b"}));
+    EXPECT_EQ(pretokens("\xE0\xA8\x95\xE0\xA8\xBC\xE0\xA8\x96", o200k),
+              vector<string>({"\xE0\xA8\x95\xE0\xA8\xBC\xE0\xA8\x96"}));
+    EXPECT_EQ(pretokens("path/to\n", o200k), vector<string>({"path", "/to", "\n"}));
+    EXPECT_EQ(pretokens("I'M here", o200k), vector<string>({"I'M", " here"}));
+}
+
+// tiktoken merges the lowest-ranked adjacent pair until none is ranked
+TEST(BpeEncoderTest, MergesLowestRankedPairsFirst) {
+    string path = write_ranks_file({"he", "ll", "hell", " w", "or", " wor"});
+    BpeEncoder encoder(path, PretokenizerPattern::Cl100k, "toy");
+    remove(path.c_str());
+
+    EXPECT_EQ(encoder.vocab_size(), 262u);
+    EXPECT_EQ(encoder.encode("hello world"), vector<uint32_t>({258, 'o', 261, 'l', 'd'}));
+    EXPECT_EQ(encoder.count_tokens("hello world"), 5u);
+    EXPECT_EQ(encoder.count_piece_tokens("hello"), 2u);
+
+    vector<size_t> ends;
+    encoder.piece_token_ends(" world", ends);
+    EXPECT_EQ(ends, vector<size_t>({4, 5, 6}));
+    EXPECT_TRUE(encoder.encode("").empty());
+}
+
+TEST(BpeEncoderTest, RejectsRanksWithoutEverySingleByte) {
+    string path = ::testing::TempDir() + "bpe_tokenizer_test_partial.tiktoken";
+    ofstream(path) << base64("a") << " 0\n";
+    EXPECT_THROW(BpeEncoder(path, PretokenizerPattern::Cl100k, "partial"), runtime_error);
+    ofstream(path, ios::trunc) << "not base64!\n";
+    EXPECT_THROW(BpeEncoder(path, PretokenizerPattern::Cl100k, "malformed"), runtime_error);
+    remove(path.c_str());
+}
+
+// Token IDs of tiktoken's cl100k_base; set COSMOS_CL100K_RANKS to the
+// cl100k_base.tiktoken file to run it
+TEST(BpeEncoderTest, Cl100kMatchesTiktoken) {
+    const char* ranks_path = getenv("COSMOS_CL100K_RANKS");
+    if (ranks_path == nullptr) {
+        GTEST_SKIP() << "COSMOS_CL100K_RANKS is not set";
+    }
+    auto encoder = BpeEncoder::get(ranks_path, "cl100k_base");
+    EXPECT_EQ(encoder->encode("hello world"), vector<uint32_t>({15339, 1917}));
+    EXPECT_EQ(encoder->encode("tiktoken is great!"), vector<uint32_t>({83, 1609, 5963, 374, 2294, 0}));
+}
@@ -0,0 +1,53 @@
+#include <gtest/gtest.h>
+
+#include <random>
+#include <string>
+#include <vector>
+
+#include "boundary_scanner.h"
+#include "cdc_chunker.h"
+#include "utf8_validation.h"
+
+using namespace std;
+
+namespace {
+
+// Chunks must tile the text and each hold whole characters
+void expect_valid_chunks(const string& text, size_t min_size, size_t avg_size, size_t max_size) {
+    BoundaryIndex index(text);
+    vector<TextSpan> spans = split_content_defined_spans(index, min_size, avg_size, max_size);
+    size_t expected_start = 0;
+    for (const TextSpan& span : spans) {
+        ASSERT_EQ(span.start, expected_start);
+        ASSERT_GT(span.end, span.start);
+        string_view chunk = string_view(text).substr(span.start, span.end - span.start);
+        ASSERT_TRUE(is_valid_utf8(chunk)) << "chunk [" << span.start << ", " << span.end << ") of sizes "
+                                          << min_size << "/" << avg_size << "/" << max_size;
+        expected_start = span.end;
+    }
+    EXPECT_EQ(expected_start, text.size());
+}
+
+}  // namespace
+
+// Text without whitespace falls back to character boundaries; with room for
+// less than one character the chunk must still end after a whole one
+TEST(CdcChunkerTest, NeverSplitsMultiByteCharacters) {
+    const vector<string> characters = {"\xF0\x9F\x99\x82", "\xE6\x97\xA5", "\xE6\x9C\xAC", "\xC3\xA9", "a"};
+    mt19937 rng(3);
+    for (int iteration = 0; iteration < 2000; ++iteration) {
+        string text;
+        size_t count = 1 + rng() % 200;
+        for (size_t i = 0; i < count; ++i) {
+            text += characters[rng() % characters.size()];
+        }
+        size_t avg_size = 1 + rng() % 16;
+        size_t max_size = avg_size + rng() % 16;
+        expect_valid_chunks(text, 1, avg_size, max_size);
+    }
+}
+
+TEST(CdcChunkerTest, SplitsEmojiWithSmallestSizes) {
+    expect_valid_chunks("\xF0\x9F\x99\x82\xF0\x9F\x99\x82\xF0\x9F\x99\x82", 1, 1, 1);
+    expect_valid_chunks("\xE6\x97\xA5\xE6\x9C\xAC\xE8\xAA\x9E", 1, 2, 2);
+}
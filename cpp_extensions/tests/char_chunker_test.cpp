@@ -0,0 +1,58 @@
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#include "char_chunker.h"
+#include "text_span.h"
+#include "utf8_validation.h"
+
+using namespace std;
+
+namespace {
+
+// Every chunk must hold whole characters and overlap its predecessor by at
+// most chunk_overlap bytes
+void expect_whole_characters(const string& text, int chunk_size, int chunk_overlap) {
+    vector<TextSpan> spans = split_text_spans(text, chunk_size, chunk_overlap);
+    ASSERT_FALSE(spans.empty());
+    for (size_t i = 0; i < spans.size(); ++i) {
+        const TextSpan& span = spans[i];
+        ASSERT_GT(span.end, span.start);
+        string_view chunk = string_view(text).substr(span.start, span.end - span.start);
+        ASSERT_TRUE(is_valid_utf8(chunk)) << "chunk " << i << " [" << span.start << ", " << span.end
+                                          << ") with chunk_size=" << chunk_size
+                                          << " chunk_overlap=" << chunk_overlap;
+        if (i > 0 && span.start < spans[i - 1].end) {
+            EXPECT_LE(spans[i - 1].end - span.start, static_cast<uint64_t>(chunk_overlap));
+        }
+    }
+}
+
+string repeat(const string& piece, size_t times) {
+    string text;
+    for (size_t i = 0; i < times; ++i) {
+        text += piece;
+    }
+    return text;
+}
+
+}  // namespace
+
+// Stepping back chunk_overlap bytes from a chunk's end used to land inside
+// a two-byte character
+TEST(CharChunkerTest, LineOverlapStartsOnCharacterBoundary) {
+    expect_whole_characters(repeat("\xC3\xA9\xC3\xA9\xC3\xA9\n", 30), 20, 5);
+}
+
+TEST(CharChunkerTest, ParagraphOverlapStartsOnCharacterBoundary) {
+    expect_whole_characters(repeat("\xE6\x97\xA5\xE6\x9C\xAC\n\n", 20), 16, 7);
+    expect_whole_characters(repeat("\xF0\x9F\x99\x82 a\n", 25), 24, 3);
+}
+
+TEST(CharChunkerTest, OverlapStartsOnCharacterBoundaryForEveryOverlap) {
+    string text = repeat("\xC3\xA9\xE6\x97\xA5\xF0\x9F\x99\x82\n", 20);
+    for (int chunk_overlap = 1; chunk_overlap < 30; ++chunk_overlap) {
+        expect_whole_characters(text, 30, chunk_overlap);
+    }
+}
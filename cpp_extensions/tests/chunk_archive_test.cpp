@@ -0,0 +1,156 @@
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "chunk_archive.h"
+
+using namespace std;
+
+namespace {
+
+string sample_archive() {
+    ChunkArchiveBuilder builder;
+    const vector<string> texts = {"first chunk", "", "caf\xC3\xA9 \xE6\x97\xA5\xE6\x9C\xAC", "last"};
+    for (size_t row = 0; row < texts.size(); ++row) {
+        builder.add_text(texts[row]);
+        builder.set_id(row, "id-" + to_string(row));
+        builder.set_string("source_id", row, "doc_1");
+        builder.set_int64("page", row, static_cast<int64_t>(row) + 1);
+    }
+    builder.set_float64("score", 0, 0.5);
+    builder.set_bool("is_title", 3, true);
+    // An int64 column given a float64 value becomes float64
+    builder.set_int64("start", 0, 3);
+    builder.set_float64("start", 1, 4.5);
+    return builder.finish();
+}
+
+// Reads every text and value, so a corrupt archive that was accepted would
+// have to stay in bounds
+size_t read_everything(const ChunkArchive& archive) {
+    size_t total = archive.text_bytes().size();
+    for (size_t row = 0; row < archive.size(); ++row) {
+        total += archive.text(row).size();
+        if (archive.has_ids() && archive.ids().present(row)) {
+            total += archive.ids().string(row).size();
+        }
+        for (const ChunkColumn& column : archive.columns()) {
+            if (!column.present(row)) {
+                continue;
+            }
+            switch (column.type()) {
+                case ColumnType::String: total += column.string(row).size(); break;
+                case ColumnType::Int64: total += static_cast<size_t>(column.int64(row) & 1); break;
+                case ColumnType::Float64: total += column.float64(row) > 0; break;
+                case ColumnType::Bool: total += column.boolean(row); break;
+            }
+        }
+    }
+    return total;
+}
+
+}  // namespace
+
+TEST(ChunkArchiveTest, RoundTripsTextsIdsAndColumns) {
+    ChunkArchive archive(sample_archive());
+
+    ASSERT_EQ(archive.size(), 4u);
+    EXPECT_EQ(archive.text(0), "first chunk");
+    EXPECT_EQ(archive.text(1), "");
+    EXPECT_EQ(archive.text(2), "caf\xC3\xA9 \xE6\x97\xA5\xE6\x9C\xAC");
+    ASSERT_TRUE(archive.has_ids());
+    EXPECT_EQ(archive.ids().string(3), "id-3");
+
+    const ChunkColumn* source = archive.find_column("source_id");
+    ASSERT_NE(source, nullptr);
+    EXPECT_EQ(source->type(), ColumnType::String);
+    EXPECT_EQ(source->presence(), nullptr);
+    EXPECT_EQ(source->string(2), "doc_1");
+
+    const ChunkColumn* page = archive.find_column("page");
+    ASSERT_NE(page, nullptr);
+    EXPECT_EQ(page->type(), ColumnType::Int64);
+    EXPECT_EQ(page->int64(3), 4);
+
+    const ChunkColumn* score = archive.find_column("score");
+    ASSERT_NE(score, nullptr);
+    EXPECT_TRUE(score->present(0));
+    EXPECT_FALSE(score->present(1));
+    EXPECT_DOUBLE_EQ(score->float64(0), 0.5);
+
+    const ChunkColumn* is_title = archive.find_column("is_title");
+    ASSERT_NE(is_title, nullptr);
+    EXPECT_FALSE(is_title->present(0));
+    EXPECT_TRUE(is_title->boolean(3));
+
+    const ChunkColumn* start = archive.find_column("start");
+    ASSERT_NE(start, nullptr);
+    EXPECT_EQ(start->type(), ColumnType::Float64);
+    EXPECT_DOUBLE_EQ(start->float64(0), 3.0);
+    EXPECT_DOUBLE_EQ(start->float64(1), 4.5);
+    EXPECT_FALSE(start->present(2));
+
+    EXPECT_EQ(archive.find_column("missing"), nullptr);
+}
+
+TEST(ChunkArchiveTest, SaveAndLoadKeepTheBytes) {
+    ChunkArchive archive(sample_archive());
+    string path = ::testing::TempDir() + "chunk_archive_test.archive";
+    archive.save(path);
+    auto loaded = ChunkArchive::load(path);
+    remove(path.c_str());
+
+    EXPECT_EQ(loaded->bytes(), archive.bytes());
+    EXPECT_EQ(loaded->text(2), archive.text(2));
+}
+
+TEST(ChunkArchiveTest, ReadsUnalignedData) {
+    string bytes = sample_archive();
+    string shifted = " " + bytes;
+    ChunkArchive archive(shifted.data() + 1, bytes.size(), nullptr);
+    EXPECT_EQ(archive.text(0), "first chunk");
+}
+
+TEST(ChunkArchiveTest, RejectsMismatchedColumnTypes) {
+    ChunkArchiveBuilder builder;
+    builder.add_text("text");
+    builder.set_string("page", 0, "one");
+    EXPECT_THROW(builder.set_int64("page", 0, 1), invalid_argument);
+    EXPECT_THROW(builder.set_bool("page", 0, true), invalid_argument);
+}
+
+TEST(ChunkArchiveTest, RejectsTruncatedArchives) {
+    const string bytes = sample_archive();
+    for (size_t size = 0; size < bytes.size(); ++size) {
+        EXPECT_THROW(ChunkArchive(bytes.substr(0, size)), runtime_error) << "size=" << size;
+    }
+}
+
+TEST(ChunkArchiveTest, RejectsBadMagic) {
+    string bytes = sample_archive();
+    bytes[0] ^= 0x20;
+    EXPECT_THROW(ChunkArchive(move(bytes)), runtime_error);
+}
+
+// Archives come from other processes and files, so flipped bytes must be
+// rejected or leave every offset in bounds
+TEST(ChunkArchiveTest, CorruptBytesAreRejectedOrStayInBounds) {
+    const string bytes = sample_archive();
+    mt19937 rng(23);
+    for (int iteration = 0; iteration < 20000; ++iteration) {
+        string corrupt = bytes;
+        const int flips = 1 + static_cast<int>(rng() % 4);
+        for (int i = 0; i < flips; ++i) {
+            corrupt[rng() % corrupt.size()] ^= static_cast<char>(1 << (rng() % 8));
+        }
+        try {
+            ChunkArchive archive(move(corrupt));
+            read_everything(archive);
+        } catch (const runtime_error&) {
+        }
+    }
+}
@@ -0,0 +1,94 @@
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "chunk_hash_index.h"
+
+using namespace std;
+
+namespace {
+
+class ChunkHashIndexTest : public ::testing::TestWithParam<ChunkHashAlgorithm> {};
+
+}  // namespace
+
+TEST_P(ChunkHashIndexTest, RemoveForgetsOnlyKnownChunks) {
+    ChunkHashIndex index(GetParam());
+    EXPECT_EQ(index.add({"first", "second", "third"}), 3u);
+
+    EXPECT_EQ(index.remove({"second", "unknown", "second"}), 1u);
+    EXPECT_EQ(index.size(), 2u);
+    EXPECT_TRUE(index.contains("first"));
+    EXPECT_FALSE(index.contains("second"));
+
+    auto [unchanged, fresh] = index.partition({"first", "second"}, false);
+    EXPECT_EQ(unchanged, vector<size_t>({0}));
+    EXPECT_EQ(fresh, vector<size_t>({1}));
+}
+
+TEST_P(ChunkHashIndexTest, SaveAndLoadKeepRemovals) {
+    ChunkHashIndex index(GetParam());
+    index.add({"kept", "removed"});
+    index.remove({"removed"});
+
+    string path = ::testing::TempDir() + "chunk_hash_index_test.idx";
+    index.save(path);
+    auto loaded = ChunkHashIndex::load(path);
+    remove(path.c_str());
+
+    EXPECT_EQ(loaded->algorithm(), GetParam());
+    EXPECT_EQ(loaded->size(), 1u);
+    EXPECT_TRUE(loaded->contains("kept"));
+    EXPECT_FALSE(loaded->contains("removed"));
+}
+
+// Writers saving to the same path, as separate API workers do, each write a
+// temporary file of their own; the survivor is one complete index
+TEST_P(ChunkHashIndexTest, ConcurrentSavesLeaveOneCompleteIndex) {
+    namespace fs = std::filesystem;
+    const fs::path directory = fs::path(::testing::TempDir()) / "chunk_hash_index_concurrent";
+    fs::remove_all(directory);
+    fs::create_directories(directory);
+    const string path = (directory / "chunks.idx").string();
+
+    vector<string> chunks;
+    for (int i = 0; i < 2000; ++i) {
+        chunks.push_back("chunk " + to_string(i));
+    }
+    vector<unique_ptr<ChunkHashIndex>> indexes;
+    for (size_t writer = 0; writer < 4; ++writer) {
+        indexes.push_back(make_unique<ChunkHashIndex>(GetParam()));
+        // Writer w knows the first (w + 1) * 500 chunks
+        indexes.back()->add(vector<string_view>(chunks.begin(), chunks.begin() + (writer + 1) * 500));
+    }
+
+    vector<thread> writers;
+    for (const auto& index : indexes) {
+        writers.emplace_back([&index, &path] {
+            for (int round = 0; round < 20; ++round) {
+                index->save(path);
+            }
+        });
+    }
+    for (thread& writer : writers) {
+        writer.join();
+    }
+
+    auto loaded = ChunkHashIndex::load(path);
+    EXPECT_EQ(loaded->size() % 500, 0u);
+    EXPECT_GT(loaded->size(), 0u);
+    for (size_t i = 0; i < loaded->size(); ++i) {
+        ASSERT_TRUE(loaded->contains(chunks[i]));
+    }
+    EXPECT_EQ(distance(fs::directory_iterator(directory), fs::directory_iterator()), 1);
+    fs::remove_all(directory);
+}
+
+INSTANTIATE_TEST_SUITE_P(Algorithms, ChunkHashIndexTest,
+                         ::testing::Values(ChunkHashAlgorithm::Xxh64, ChunkHashAlgorithm::Sha256));
@@ -0,0 +1,214 @@
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "embedding_index.h"
+
+using namespace std;
+
+namespace {
+
+constexpr size_t kDim = 48;
+
+vector<float> random_vectors(size_t count, uint32_t seed) {
+    mt19937 rng(seed);
+    normal_distribution<float> normal;
+    vector<float> vectors(count * kDim);
+    for (float& value : vectors) {
+        value = normal(rng);
+    }
+    return vectors;
+}
+
+vector<string> row_ids(size_t count) {
+    vector<string> ids;
+    for (size_t i = 0; i < count; ++i) {
+        ids.push_back("chunk-" + to_string(i));
+    }
+    return ids;
+}
+
+unique_ptr<EmbeddingIndex> make_index(VectorType type, size_t count, uint32_t seed, size_t hnsw_m = 16) {
+    EmbeddingIndexOptions options;
+    options.dim = kDim;
+    options.type = type;
+    options.hnsw_m = hnsw_m;
+    auto index = make_unique<EmbeddingIndex>(options);
+    vector<float> vectors = random_vectors(count, seed);
+    index->add(vectors.data(), count, row_ids(count));
+    return index;
+}
+
+vector<string> search_ids(const EmbeddingIndex& index, const float* query, size_t k, SearchMode mode) {
+    vector<string> ids;
+    for (const auto& [id, score] : index.search(query, k, mode, 64, 1)) {
+        ids.push_back(id);
+    }
+    return ids;
+}
+
+string save_to_temp(const EmbeddingIndex& index, const string& name) {
+    string path = ::testing::TempDir() + name;
+    index.save(path);
+    return path;
+}
+
+string read_file(const string& path) {
+    ifstream in(path, ios::binary);
+    return string(istreambuf_iterator<char>(in), {});
+}
+
+void write_file(const string& path, const string& bytes) {
+    ofstream(path, ios::binary | ios::trunc) << bytes;
+}
+
+class EmbeddingIndexTest : public ::testing::TestWithParam<VectorType> {};
+
+}  // namespace
+
+TEST_P(EmbeddingIndexTest, BruteForceFindsStoredVectors) {
+    auto index = make_index(GetParam(), 200, 1, 0);
+    vector<float> vectors = random_vectors(200, 1);
+
+    for (size_t row : {0, 57, 199}) {
+        auto results = index->search(vectors.data() + row * kDim, 3, SearchMode::BruteForce, 64, 1);
+        ASSERT_EQ(results.size(), 3u);
+        EXPECT_EQ(results[0].first, "chunk-" + to_string(row));
+        // Normalized rows, so a vector scores about 1 against itself
+        EXPECT_NEAR(results[0].second, 1.0f, 0.02f);
+        EXPECT_GE(results[0].second, results[1].second);
+        EXPECT_GE(results[1].second, results[2].second);
+    }
+}
+
+TEST_P(EmbeddingIndexTest, HnswRecallsTheExactNeighbours) {
+    auto index = make_index(GetParam(), 3000, 2);
+    vector<float> queries = random_vectors(50, 3);
+
+    size_t found = 0;
+    for (size_t q = 0; q < 50; ++q) {
+        const float* query = queries.data() + q * kDim;
+        vector<string> exact = search_ids(*index, query, 10, SearchMode::BruteForce);
+        vector<string> approximate = search_ids(*index, query, 10, SearchMode::Hnsw);
+        set<string> expected(exact.begin(), exact.end());
+        for (const string& id : approximate) {
+            found += expected.count(id);
+        }
+    }
+    EXPECT_GE(static_cast<double>(found) / (50 * 10), 0.9);
+}
+
+TEST_P(EmbeddingIndexTest, RemoveReplaceAndCompact) {
+    auto index = make_index(GetParam(), 100, 4);
+    vector<float> vectors = random_vectors(100, 4);
+
+    EXPECT_TRUE(index->remove("chunk-5"));
+    EXPECT_FALSE(index->remove("chunk-5"));
+    EXPECT_FALSE(index->contains("chunk-5"));
+    // Re-adding an id replaces its vector
+    index->add(vectors.data() + 7 * kDim, 1, {"chunk-6"});
+    EXPECT_EQ(index->size(), 99u);
+    EXPECT_EQ(index->removed(), 2u);
+
+    auto results = index->search(vectors.data() + 5 * kDim, 1, SearchMode::BruteForce, 64, 1);
+    EXPECT_NE(results[0].first, "chunk-5");
+
+    index->compact();
+    EXPECT_EQ(index->removed(), 0u);
+    EXPECT_EQ(index->size(), 99u);
+    EXPECT_EQ(search_ids(*index, vectors.data() + 9 * kDim, 1, SearchMode::Hnsw)[0], "chunk-9");
+    vector<string> replaced = search_ids(*index, vectors.data() + 7 * kDim, 2, SearchMode::BruteForce);
+    EXPECT_EQ(set<string>(replaced.begin(), replaced.end()), set<string>({"chunk-6", "chunk-7"}));
+}
+
+TEST_P(EmbeddingIndexTest, SaveAndLoadKeepSearchResults) {
+    auto index = make_index(GetParam(), 500, 5);
+    index->remove("chunk-3");
+    string path = save_to_temp(*index, "embedding_index_test.cvix");
+    auto loaded = EmbeddingIndex::load(path);
+    remove(path.c_str());
+
+    EXPECT_EQ(loaded->size(), 499u);
+    EXPECT_EQ(loaded->options().type, GetParam());
+    EXPECT_FALSE(loaded->contains("chunk-3"));
+    vector<float> queries = random_vectors(10, 6);
+    for (size_t q = 0; q < 10; ++q) {
+        for (SearchMode mode : {SearchMode::BruteForce, SearchMode::Hnsw}) {
+            EXPECT_EQ(index->search(queries.data() + q * kDim, 5, mode, 64, 1),
+                      loaded->search(queries.data() + q * kDim, 5, mode, 64, 1));
+        }
+    }
+
+    // A loaded index can still be modified
+    vector<float> extra = random_vectors(1, 7);
+    loaded->add(extra.data(), 1, {"extra"});
+    EXPECT_EQ(search_ids(*loaded, extra.data(), 1, SearchMode::BruteForce)[0], "extra");
+}
+
+INSTANTIATE_TEST_SUITE_P(VectorTypes, EmbeddingIndexTest,
+                         ::testing::Values(VectorType::Float16, VectorType::Int8));
+
+TEST(EmbeddingIndexFileTest, RejectsInvalidFiles) {
+    auto index = make_index(VectorType::Float16, 50, 8);
+    string path = save_to_temp(*index, "embedding_index_test_corrupt.cvix");
+    const string bytes = read_file(path);
+
+    string bad_magic = bytes;
+    bad_magic[0] ^= 0x20;
+    write_file(path, bad_magic);
+    EXPECT_THROW(EmbeddingIndex::load(path), runtime_error);
+
+    write_file(path, bytes + "x");
+    EXPECT_THROW(EmbeddingIndex::load(path), runtime_error);
+
+    for (size_t size : {size_t(0), size_t(10), size_t(64), bytes.size() / 2, bytes.size() - 1}) {
+        write_file(path, bytes.substr(0, size));
+        EXPECT_THROW(EmbeddingIndex::load(path), runtime_error) << "size=" << size;
+    }
+    remove(path.c_str());
+}
+
+// Index files may come from elsewhere, so flipped bytes must be rejected or
+// load an index that can be searched safely
+TEST(EmbeddingIndexFileTest, CorruptBytesAreRejectedOrSearchable) {
+    auto index = make_index(VectorType::Int8, 40, 9);
+    string path = save_to_temp(*index, "embedding_index_test_fuzz.cvix");
+    const string bytes = read_file(path);
+    vector<float> query = random_vectors(1, 10);
+
+    mt19937 rng(29);
+    for (int iteration = 0; iteration < 2000; ++iteration) {
+        string corrupt = bytes;
+        const int flips = 1 + static_cast<int>(rng() % 3);
+        for (int i = 0; i < flips; ++i) {
+            corrupt[rng() % corrupt.size()] ^= static_cast<char>(1 << (rng() % 8));
+        }
+        write_file(path, corrupt);
+        try {
+            auto loaded = EmbeddingIndex::load(path);
+            if (loaded->options().dim == kDim) {
+                loaded->search(query.data(), 5, SearchMode::BruteForce, 64, 1);
+                loaded->search(query.data(), 5, SearchMode::Hnsw, 64, 1);
+            }
+        } catch (const runtime_error&) {
+        }
+    }
+    remove(path.c_str());
+}
+
+TEST(EmbeddingIndexFileTest, RejectsInvalidArguments) {
+    EXPECT_THROW(EmbeddingIndex(EmbeddingIndexOptions{}), invalid_argument);
+    auto index = make_index(VectorType::Float16, 2, 11);
+    vector<float> vectors = random_vectors(2, 11);
+    EXPECT_THROW(index->add(vectors.data(), 2, {"a"}), invalid_argument);
+    EXPECT_THROW(index->add(vectors.data(), 2, {"a", "a"}), invalid_argument);
+    EXPECT_THROW(parse_search_mode("exact"), invalid_argument);
+}
@@ -0,0 +1,144 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "job_engine.h"
+
+using namespace std;
+
+namespace {
+
+// Holds the jobs that wait on it until it is opened
+class Gate {
+public:
+    Gate() : opened_(open_.get_future().share()) {}
+
+    void open() { open_.set_value(); }
+    void wait() const { opened_.wait(); }
+    bool is_open() const { return opened_.wait_for(chrono::seconds(0)) == future_status::ready; }
+
+private:
+    promise<void> open_;
+    shared_future<void> opened_;
+};
+
+void wait_until_running(const Job& job) {
+    while (job.status() == JobStatus::Pending) {
+        this_thread::yield();
+    }
+}
+
+JobBody count_runs(atomic<int>& runs) {
+    return [&runs](const CancelToken&) { ++runs; };
+}
+
+}  // namespace
+
+TEST(JobEngineTest, CancellingAPendingJobFreesItsSlot) {
+    JobEngine engine(1, 2);
+    Gate gate;
+    atomic<int> runs{0};
+
+    auto blocker = engine.submit([&gate](const CancelToken&) { gate.wait(); });
+    wait_until_running(*blocker);
+    auto queued = engine.submit(count_runs(runs));
+    EXPECT_EQ(queued->status(), JobStatus::Pending);
+    EXPECT_EQ(engine.in_flight(), 2u);
+
+    EXPECT_TRUE(queued->cancel());
+    EXPECT_EQ(queued->status(), JobStatus::Cancelled);
+    EXPECT_TRUE(queued->wait(chrono::seconds(0)));
+    EXPECT_FALSE(queued->cancel());
+    EXPECT_EQ(engine.in_flight(), 1u);
+
+    // The freed slot takes a new job without waiting
+    auto next = engine.submit(count_runs(runs), chrono::seconds(0));
+    gate.open();
+    ASSERT_TRUE(next->wait(chrono::seconds(10)));
+    ASSERT_TRUE(blocker->wait(chrono::seconds(10)));
+
+    EXPECT_EQ(next->status(), JobStatus::Done);
+    EXPECT_EQ(blocker->status(), JobStatus::Done);
+    EXPECT_EQ(runs.load(), 1);
+    engine.shutdown(false);
+    EXPECT_EQ(engine.in_flight(), 0u);
+}
+
+TEST(JobEngineTest, SubmitThrowsQueueFullUntilASlotFrees) {
+    JobEngine engine(1, 1);
+    Gate gate;
+    atomic<int> runs{0};
+
+    auto blocker = engine.submit([&gate](const CancelToken&) { gate.wait(); });
+    EXPECT_THROW(engine.submit(count_runs(runs), chrono::seconds(0)), QueueFull);
+    EXPECT_THROW(engine.submit(count_runs(runs), chrono::milliseconds(20)), QueueFull);
+    EXPECT_EQ(engine.in_flight(), 1u);
+
+    gate.open();
+    ASSERT_TRUE(blocker->wait(chrono::seconds(10)));
+    auto job = engine.submit(count_runs(runs), chrono::seconds(10));
+    ASSERT_TRUE(job->wait(chrono::seconds(10)));
+    EXPECT_EQ(job->status(), JobStatus::Done);
+    EXPECT_EQ(runs.load(), 1);
+}
+
+TEST(JobEngineTest, ShutdownWithCancelPendingCancelsEveryUnfinishedJob) {
+    JobEngine engine(1, 4);
+    Gate gate;
+    atomic<int> runs{0};
+
+    // Stops only at a cancellation point, never by the gate
+    auto running = engine.submit([&gate](const CancelToken& cancel) {
+        while (!gate.is_open()) {
+            cancel.throw_if_cancelled();
+            this_thread::sleep_for(chrono::milliseconds(1));
+        }
+    });
+    wait_until_running(*running);
+    vector<shared_ptr<Job>> queued;
+    for (int i = 0; i < 3; ++i) {
+        queued.push_back(engine.submit(count_runs(runs)));
+    }
+
+    engine.shutdown(true);
+
+    EXPECT_EQ(running->status(), JobStatus::Cancelled);
+    for (const auto& job : queued) {
+        EXPECT_EQ(job->status(), JobStatus::Cancelled);
+    }
+    EXPECT_EQ(runs.load(), 0);
+    EXPECT_EQ(engine.in_flight(), 0u);
+    EXPECT_THROW(engine.submit(count_runs(runs)), runtime_error);
+    gate.open();
+}
+
+TEST(JobEngineTest, ShutdownWithoutCancelRunsQueuedJobs) {
+    JobEngine engine(1, 4);
+    Gate gate;
+    atomic<int> runs{0};
+
+    auto blocker = engine.submit([&gate](const CancelToken&) { gate.wait(); });
+    vector<shared_ptr<Job>> queued;
+    for (int i = 0; i < 3; ++i) {
+        queued.push_back(engine.submit(count_runs(runs)));
+    }
+    thread opener([&gate] {
+        this_thread::sleep_for(chrono::milliseconds(20));
+        gate.open();
+    });
+
+    engine.shutdown(false);
+    opener.join();
+
+    EXPECT_EQ(blocker->status(), JobStatus::Done);
+    for (const auto& job : queued) {
+        EXPECT_EQ(job->status(), JobStatus::Done);
+    }
+    EXPECT_EQ(runs.load(), 3);
+}
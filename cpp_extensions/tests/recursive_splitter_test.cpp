@@ -0,0 +1,202 @@
+#include <gtest/gtest.h>
+
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "recursive_splitter.h"
+#include "text_span.h"
+
+using namespace std;
+
+namespace {
+
+/**
+ * Port of LangChain's RecursiveCharacterTextSplitter with its defaults
+ * (keep_separator=True, strip_whitespace=True, length_function=len), written
+ * against the Python source rather than the native engine so the two can be
+ * compared. Works on UTF-8 strings; lengths are counted in code points.
+ */
+class LangChainReference {
+public:
+    LangChainReference(size_t chunk_size, size_t chunk_overlap, vector<string> separators)
+        : chunk_size_(chunk_size), chunk_overlap_(chunk_overlap), separators_(move(separators)) {}
+
+    vector<string> split_text(const string& text) const { return split(text, 0); }
+
+private:
+    static size_t length(const string& s) {
+        size_t n = 0;
+        for (unsigned char c : s) {
+            n += (c & 0xC0) != 0x80;
+        }
+        return n;
+    }
+
+    // str.strip() for the ASCII whitespace the fuzz alphabet uses
+    static string strip(const string& s) {
+        const char* whitespace = " \t\n\r\v\f";
+        size_t first = s.find_first_not_of(whitespace);
+        if (first == string::npos) {
+            return "";
+        }
+        return s.substr(first, s.find_last_not_of(whitespace) - first + 1);
+    }
+
+    // _split_text_with_regex with keep_separator=True: each separator starts
+    // the piece that follows it, and empty pieces are dropped
+    static vector<string> split_keeping_separator(const string& text, const string& separator) {
+        vector<string> pieces;
+        if (separator.empty()) {
+            for (size_t pos = 0; pos < text.length();) {
+                size_t next = pos + 1;
+                while (next < text.length() && (static_cast<unsigned char>(text[next]) & 0xC0) == 0x80) {
+                    ++next;
+                }
+                pieces.push_back(text.substr(pos, next - pos));
+                pos = next;
+            }
+            return pieces;
+        }
+        size_t piece_start = 0;
+        for (size_t match = text.find(separator); match != string::npos;
+             match = text.find(separator, match + separator.length())) {
+            pieces.push_back(text.substr(piece_start, match - piece_start));
+            piece_start = match;
+        }
+        pieces.push_back(text.substr(piece_start));
+        vector<string> non_empty;
+        for (auto& piece : pieces) {
+            if (!piece.empty()) {
+                non_empty.push_back(move(piece));
+            }
+        }
+        return non_empty;
+    }
+
+    vector<string> split(const string& text, size_t first_separator) const {
+        string separator = separators_.back();
+        size_t next_separator = separators_.size();
+        for (size_t i = first_separator; i < separators_.size(); ++i) {
+            if (separators_[i].empty()) {
+                separator = separators_[i];
+                break;
+            }
+            if (text.find(separators_[i]) != string::npos) {
+                separator = separators_[i];
+                next_separator = i + 1;
+                break;
+            }
+        }
+
+        vector<string> final_chunks;
+        vector<string> good_splits;
+        for (const string& s : split_keeping_separator(text, separator)) {
+            if (length(s) < chunk_size_) {
+                good_splits.push_back(s);
+                continue;
+            }
+            if (!good_splits.empty()) {
+                merge_splits(good_splits, final_chunks);
+                good_splits.clear();
+            }
+            if (next_separator >= separators_.size()) {
+                final_chunks.push_back(s);
+            } else {
+                vector<string> nested = split(s, next_separator);
+                final_chunks.insert(final_chunks.end(), nested.begin(), nested.end());
+            }
+        }
+        if (!good_splits.empty()) {
+            merge_splits(good_splits, final_chunks);
+        }
+        return final_chunks;
+    }
+
+    // _merge_splits with an empty join separator, as keep_separator implies
+    void merge_splits(const vector<string>& splits, vector<string>& docs) const {
+        vector<string> current;
+        size_t total = 0;
+        auto join = [&]() {
+            string doc;
+            for (const auto& s : current) {
+                doc += s;
+            }
+            doc = strip(doc);
+            if (!doc.empty()) {
+                docs.push_back(doc);
+            }
+        };
+
+        for (const string& d : splits) {
+            size_t len = length(d);
+            if (total + len > chunk_size_ && !current.empty()) {
+                join();
+                while (total > chunk_overlap_ || (total + len > chunk_size_ && total > 0)) {
+                    total -= length(current.front());
+                    current.erase(current.begin());
+                }
+            }
+            current.push_back(d);
+            total += len;
+        }
+        join();
+    }
+
+    size_t chunk_size_;
+    size_t chunk_overlap_;
+    vector<string> separators_;
+};
+
+// Random documents over separators, whitespace runs and multi-byte text
+string random_document(mt19937& rng) {
+    static const vector<string> alphabet = {"a", "bb", "word", "\n", "\n\n", " ", "  ", "\t",
+                                            ". ", "x", "\xC3\xA9", "\xE6\x97\xA5\xE6\x9C\xAC",
+                                            "\xF0\x9F\x99\x82"};
+    string text;
+    size_t pieces = rng() % 120;
+    for (size_t i = 0; i < pieces; ++i) {
+        text += alphabet[rng() % alphabet.size()];
+    }
+    return text;
+}
+
+void expect_langchain_parity(const vector<string>& separators, uint32_t seed) {
+    mt19937 rng(seed);
+    for (int iteration = 0; iteration < 20000; ++iteration) {
+        string text = random_document(rng);
+        int chunk_size = 1 + static_cast<int>(rng() % 40);
+        int chunk_overlap = static_cast<int>(rng() % (chunk_size + 1));
+
+        vector<string> expected = LangChainReference(chunk_size, chunk_overlap, separators).split_text(text);
+        vector<string> actual =
+            materialize_spans(text, split_text_recursive_spans(text, chunk_size, chunk_overlap, separators));
+        ASSERT_EQ(actual, expected) << "chunk_size=" << chunk_size << " chunk_overlap=" << chunk_overlap
+                                    << " text=\"" << text << "\"";
+    }
+}
+
+}  // namespace
+
+// The default hierarchy runs through the compiled "recursive" configuration
+TEST(RecursiveSplitterTest, CompiledDefaultMatchesLangChain) {
+    expect_langchain_parity(default_recursive_separators(), 7);
+}
+
+// Any other hierarchy runs through the runtime splitter
+TEST(RecursiveSplitterTest, RuntimeSeparatorsMatchLangChain) {
+    expect_langchain_parity({"\n\n", ". ", " ", ""}, 11);
+    expect_langchain_parity({"\xE6\x97\xA5\xE6\x9C\xAC", "\n", ""}, 13);
+}
+
+// Without a final "" separator oversized pieces are kept whole
+TEST(RecursiveSplitterTest, RuntimeSeparatorsWithoutCharacterFallbackMatchLangChain) {
+    expect_langchain_parity({"\n", " "}, 17);
+}
+
+TEST(RecursiveSplitterTest, RejectsInvalidArguments) {
+    EXPECT_THROW(split_text_recursive_spans("text", 0, 0, default_recursive_separators()), invalid_argument);
+    EXPECT_THROW(split_text_recursive_spans("text", 10, 11, default_recursive_separators()), invalid_argument);
+    EXPECT_THROW(split_text_recursive_spans("text", 10, 0, {}), invalid_argument);
+}
@@ -0,0 +1,201 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "semantic_cache.h"
+
+using namespace std;
+
+namespace {
+
+constexpr size_t kDim = 32;
+
+// Unit vector along axis; distinct axes are orthogonal, so never hit each other
+vector<float> axis(size_t i) {
+    vector<float> query(kDim, 0.0f);
+    query[i % kDim] = 1.0f;
+    return query;
+}
+
+SemanticCacheOptions cache_options(VectorType type, size_t max_entries) {
+    SemanticCacheOptions options;
+    options.dim = kDim;
+    options.max_entries = max_entries;
+    options.type = type;
+    options.ttl = chrono::minutes(5);
+    return options;
+}
+
+void insert_axis(SemanticCache& cache, size_t i, const string& scope = "",
+                 chrono::nanoseconds ttl = chrono::nanoseconds(-1)) {
+    cache.insert(axis(i).data(), {"chunk-" + to_string(i)}, "payload-" + to_string(i), scope, ttl);
+    // Keeps the insert timestamps that order LRU eviction distinct
+    this_thread::sleep_for(chrono::milliseconds(2));
+}
+
+bool hits(SemanticCache& cache, size_t i, const string& scope = "") {
+    optional<SemanticCacheHit> hit = cache.lookup(axis(i).data(), scope);
+    return hit && hit->payload == "payload-" + to_string(i);
+}
+
+class SemanticCacheTest : public ::testing::TestWithParam<VectorType> {};
+
+}  // namespace
+
+TEST_P(SemanticCacheTest, HitsSimilarQueriesWithinTheirScope) {
+    SemanticCache cache(cache_options(GetParam(), 8));
+    insert_axis(cache, 0, "filter-a");
+
+    vector<float> rephrased = axis(0);
+    rephrased[1] = 0.1f;
+    optional<SemanticCacheHit> hit = cache.lookup(rephrased.data(), "filter-a");
+    ASSERT_TRUE(hit);
+    EXPECT_EQ(hit->chunk_ids, vector<string>({"chunk-0"}));
+    EXPECT_GT(hit->similarity, 0.95f);
+    EXPECT_FALSE(cache.lookup(rephrased.data(), "filter-b"));
+    EXPECT_FALSE(cache.lookup(axis(1).data(), "filter-a"));
+
+    // A near-identical query replaces the entry instead of adding one
+    cache.insert(rephrased.data(), {"chunk-new"}, "payload-new", "filter-a");
+    EXPECT_EQ(cache.size(), 1u);
+    EXPECT_EQ(cache.lookup(axis(0).data(), "filter-a")->payload, "payload-new");
+
+    insert_axis(cache, 2, "filter-b");
+    EXPECT_EQ(cache.invalidate("filter-a"), 1u);
+    EXPECT_EQ(cache.size(), 1u);
+    EXPECT_TRUE(hits(cache, 2, "filter-b"));
+}
+
+TEST_P(SemanticCacheTest, EvictsTheLeastRecentlyUsedEntry) {
+    SemanticCache cache(cache_options(GetParam(), 3));
+    SemanticCacheStats& stats = semantic_cache_stats();
+    for (size_t i = 0; i < 3; ++i) {
+        insert_axis(cache, i);
+    }
+    // Using entry 0 leaves entry 1 the least recently used
+    ASSERT_TRUE(hits(cache, 0));
+    this_thread::sleep_for(chrono::milliseconds(2));
+
+    const uint64_t evicted = stats.evicted.value();
+    insert_axis(cache, 3);
+    EXPECT_EQ(stats.evicted.value(), evicted + 1);
+    EXPECT_EQ(cache.size(), 3u);
+    EXPECT_TRUE(hits(cache, 0));
+    EXPECT_FALSE(hits(cache, 1));
+    EXPECT_TRUE(hits(cache, 2));
+    EXPECT_TRUE(hits(cache, 3));
+
+    // Lookups reorder the entries too: 0 is now the least recently used
+    this_thread::sleep_for(chrono::milliseconds(2));
+    ASSERT_TRUE(hits(cache, 3));
+    this_thread::sleep_for(chrono::milliseconds(2));
+    ASSERT_TRUE(hits(cache, 2));
+    this_thread::sleep_for(chrono::milliseconds(2));
+    insert_axis(cache, 4);
+    EXPECT_FALSE(hits(cache, 0));
+    EXPECT_TRUE(hits(cache, 2));
+    EXPECT_TRUE(hits(cache, 3));
+    EXPECT_TRUE(hits(cache, 4));
+}
+
+TEST_P(SemanticCacheTest, ReusesExpiredSlotsBeforeEvictingLiveEntries) {
+    SemanticCache cache(cache_options(GetParam(), 3));
+    SemanticCacheStats& stats = semantic_cache_stats();
+    insert_axis(cache, 0);
+    insert_axis(cache, 1);
+    // The most recently used entry, but short-lived
+    insert_axis(cache, 2, "", chrono::milliseconds(1));
+    this_thread::sleep_for(chrono::milliseconds(5));
+    EXPECT_FALSE(hits(cache, 2));
+    EXPECT_EQ(cache.size(), 2u);
+
+    const uint64_t evicted = stats.evicted.value();
+    const uint64_t expired = stats.expired.value();
+    insert_axis(cache, 3);
+    EXPECT_EQ(stats.evicted.value(), evicted);
+    EXPECT_EQ(stats.expired.value(), expired + 1);
+    EXPECT_TRUE(hits(cache, 0));
+    EXPECT_TRUE(hits(cache, 1));
+    EXPECT_TRUE(hits(cache, 3));
+}
+
+TEST_P(SemanticCacheTest, PurgeExpiredFreesTheirSlots) {
+    SemanticCache cache(cache_options(GetParam(), 2));
+    SemanticCacheStats& stats = semantic_cache_stats();
+    insert_axis(cache, 0);
+    insert_axis(cache, 1, "", chrono::milliseconds(1));
+    this_thread::sleep_for(chrono::milliseconds(5));
+    EXPECT_EQ(cache.purge_expired(), 1u);
+    EXPECT_EQ(cache.purge_expired(), 0u);
+    EXPECT_EQ(cache.size(), 1u);
+
+    // The purged slot is free again, so nothing live is evicted
+    const uint64_t evicted = stats.evicted.value();
+    const uint64_t expired = stats.expired.value();
+    insert_axis(cache, 2);
+    EXPECT_EQ(stats.evicted.value(), evicted);
+    EXPECT_EQ(stats.expired.value(), expired);
+    EXPECT_TRUE(hits(cache, 0));
+    EXPECT_TRUE(hits(cache, 2));
+}
+
+// Readers race inserts, evictions and clears. Entries are freed only once no
+// lookup can see them, so every hit reads a whole, consistent entry (and the
+// sanitizer builds catch any entry read after it was freed).
+TEST_P(SemanticCacheTest, LookupsNeverSeeReclaimedEntries) {
+    SemanticCache cache(cache_options(GetParam(), 4));
+    atomic<bool> stop{false};
+    atomic<size_t> torn{0};
+    atomic<size_t> lookups{0};
+
+    vector<thread> readers;
+    for (int t = 0; t < 4; ++t) {
+        readers.emplace_back([&, t] {
+            for (size_t i = static_cast<size_t>(t); !stop.load(); ++i) {
+                const size_t key = i % 8;
+                optional<SemanticCacheHit> hit = cache.lookup(axis(key).data(), "");
+                lookups.fetch_add(1);
+                if (hit && (hit->chunk_ids.size() != 1 || hit->payload != "payload-" + to_string(key) ||
+                            hit->chunk_ids[0] != "chunk-" + to_string(key))) {
+                    torn.fetch_add(1);
+                }
+            }
+        });
+    }
+
+    for (int round = 0; round < 2000; ++round) {
+        const size_t key = static_cast<size_t>(round) % 8;
+        cache.insert(axis(key).data(), {"chunk-" + to_string(key)}, "payload-" + to_string(key), "");
+        if (round % 97 == 0) {
+            cache.clear();
+        }
+        if (round % 31 == 0) {
+            cache.invalidate("");
+        }
+    }
+    // Let the readers overlap the writes before stopping them
+    while (lookups.load() < 1000) {
+        this_thread::yield();
+    }
+    stop.store(true);
+    for (thread& reader : readers) {
+        reader.join();
+    }
+    EXPECT_EQ(torn.load(), 0u);
+}
+
+TEST(SemanticCacheOptionsTest, RejectsEmptyCaches) {
+    SemanticCacheOptions options;
+    options.dim = 0;
+    EXPECT_THROW(SemanticCache{options}, invalid_argument);
+    options.dim = kDim;
+    options.max_entries = 0;
+    EXPECT_THROW(SemanticCache{options}, invalid_argument);
+}
+
+INSTANTIATE_TEST_SUITE_P(VectorTypes, SemanticCacheTest,
+                         ::testing::Values(VectorType::Float16, VectorType::Int8));
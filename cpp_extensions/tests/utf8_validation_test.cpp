@@ -0,0 +1,72 @@
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#include "utf8_validation.h"
+
+using namespace std;
+
+namespace {
+
+constexpr size_t kValid = string_view::npos;
+
+}  // namespace
+
+TEST(Utf8ValidationTest, AcceptsValidText) {
+    EXPECT_EQ(find_invalid_utf8(""), kValid);
+    EXPECT_EQ(find_invalid_utf8("plain ASCII text"), kValid);
+    EXPECT_EQ(find_invalid_utf8("caf\xC3\xA9 \xE6\x97\xA5\xE6\x9C\xAC \xF0\x9F\x99\x82"), kValid);
+    EXPECT_EQ(find_invalid_utf8("\xED\x9F\xBF"), kValid);      // U+D7FF, below the surrogates
+    EXPECT_EQ(find_invalid_utf8("\xEE\x80\x80"), kValid);      // U+E000, above them
+    EXPECT_EQ(find_invalid_utf8("\xF4\x8F\xBF\xBF"), kValid);  // U+10FFFF
+}
+
+TEST(Utf8ValidationTest, ReportsOffsetOfInvalidSequence) {
+    EXPECT_EQ(find_invalid_utf8("ab\x80"), 2u);               // stray continuation byte
+    EXPECT_EQ(find_invalid_utf8("a\xC0\xAF"), 1u);            // overlong two-byte form
+    EXPECT_EQ(find_invalid_utf8("\xE0\x80\xAF"), 0u);         // overlong three-byte form
+    EXPECT_EQ(find_invalid_utf8("\xF0\x80\x80\xAF"), 0u);     // overlong four-byte form
+    EXPECT_EQ(find_invalid_utf8("xx\xED\xA0\x80"), 2u);       // surrogate U+D800
+    EXPECT_EQ(find_invalid_utf8("\xF4\x90\x80\x80"), 0u);     // above U+10FFFF
+    EXPECT_EQ(find_invalid_utf8("ok\xF5\x80\x80\x80"), 2u);   // invalid lead byte
+    EXPECT_EQ(find_invalid_utf8("\xFF"), 0u);
+    EXPECT_EQ(find_invalid_utf8("\xC3" "A"), 0u);             // lead byte without continuation
+}
+
+TEST(Utf8ValidationTest, ReportsTruncatedSequenceAtEnd) {
+    EXPECT_EQ(find_invalid_utf8("abc\xE6\x97"), 3u);
+    EXPECT_EQ(find_invalid_utf8("\xC3"), 0u);
+    EXPECT_EQ(find_invalid_utf8("\xF0\x9F\x99"), 0u);
+}
+
+// Long inputs run through the vector kernel; an error at every position,
+// including across block boundaries, must be found at the right offset
+TEST(Utf8ValidationTest, FindsErrorsAtEveryOffsetOfLongText) {
+    const vector<string> characters = {"a", "\xC3\xA9", "\xE6\x97\xA5", "\xF0\x9F\x99\x82", " "};
+    string text;
+    vector<size_t> ascii_offsets;
+    for (size_t i = 0; text.size() < 300; ++i) {
+        const string& character = characters[(i * 7) % characters.size()];
+        if (character.size() == 1) {
+            ascii_offsets.push_back(text.size());
+        }
+        text += character;
+    }
+    ASSERT_EQ(find_invalid_utf8(text), kValid) << utf8_validator_backend();
+
+    for (size_t offset : ascii_offsets) {
+        string corrupted = text;
+        corrupted[offset] = '\x80';
+        EXPECT_EQ(find_invalid_utf8(corrupted), offset) << utf8_validator_backend();
+    }
+    // Truncating mid-sequence leaves the last lead byte dangling
+    for (size_t size = 1; size < text.size(); ++size) {
+        size_t start = size;
+        while (start > 0 && (static_cast<unsigned char>(text[start]) & 0xC0) == 0x80) {
+            --start;
+        }
+        size_t expected = start == size ? kValid : start;
+        EXPECT_EQ(find_invalid_utf8(string_view(text).substr(0, size)), expected) << "size " << size;
+    }
+}
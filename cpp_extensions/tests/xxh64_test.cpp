@@ -0,0 +1,41 @@
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <string>
+
+#include "xxh64.h"
+
+using namespace std;
+
+namespace {
+
+uint64_t xxh64_of(const string& text, uint64_t seed = 0) {
+    return xxh64(text.data(), text.size(), seed);
+}
+
+}  // namespace
+
+// Published values of the reference implementation, as python-xxhash reports them
+TEST(Xxh64Test, MatchesReferenceVectors) {
+    EXPECT_EQ(xxh64_of(""), 0xEF46DB3751D8E999ULL);
+    EXPECT_EQ(xxh64_of("a"), 0xD24EC4F1A98C6E5BULL);
+    EXPECT_EQ(xxh64_of("abc"), 0x44BC2CF5AD770999ULL);
+    EXPECT_EQ(xxh64_of("xxhash"), 0x32DD38952C4BC720ULL);
+    // Over 32 bytes, so the four-lane loop runs
+    EXPECT_EQ(xxh64_of("Nobody inspects the spammish repetition"), 0xFBCEA83C8A378BF1ULL);
+}
+
+TEST(Xxh64Test, MatchesSeededReferenceVector) {
+    EXPECT_EQ(xxh64_of("xxhash", 20141025), 0xB559B98D844E0635ULL);
+    EXPECT_NE(xxh64_of("xxhash", 1), xxh64_of("xxhash"));
+}
+
+// Input is read with unaligned loads
+TEST(Xxh64Test, DoesNotDependOnAlignment) {
+    const string text = "Nobody inspects the spammish repetition, not even twice over";
+    char buffer[128];
+    for (size_t offset = 0; offset < 8; ++offset) {
+        memcpy(buffer + offset, text.data(), text.size());
+        EXPECT_EQ(xxh64(buffer + offset, text.size(), 0), xxh64_of(text)) << "offset " << offset;
+    }
+}
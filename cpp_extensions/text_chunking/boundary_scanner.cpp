@@ -0,0 +1,369 @@
+#include "boundary_scanner.h"
+#include "multiversion.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#include <immintrin.h>
+#define COSMOS_SCANNER_X86 1
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define COSMOS_SCANNER_NEON 1
+#endif
+
+using namespace std;
+
+namespace {
+
+using ScanKernel = void (*)(const unsigned char* data, size_t block_count, BoundaryBlock* out);
+
+inline bool is_ascii_space(unsigned char c) {
+    return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+inline bool is_sentence_terminator(unsigned char c) {
+    return c == '.' || c == '!' || c == '?';
+}
+
+inline size_t count_leading_zeros(uint64_t bits) {
+#if defined(__GNUC__) || defined(__clang__)
+    return static_cast<size_t>(__builtin_clzll(bits));
+#else
+    size_t n = 0;
+    while (!(bits & (uint64_t(1) << 63))) {
+        bits <<= 1;
+        ++n;
+    }
+    return n;
+#endif
+}
+
+inline size_t popcount(uint64_t bits) {
+#if defined(__GNUC__) || defined(__clang__)
+    return static_cast<size_t>(__builtin_popcountll(bits));
+#else
+    size_t n = 0;
+    for (; bits; bits &= bits - 1) {
+        ++n;
+    }
+    return n;
+#endif
+}
+
+#if !defined(COSMOS_SCANNER_X86) && !defined(COSMOS_SCANNER_NEON)
+void scan_blocks_scalar(const unsigned char* data, size_t block_count, BoundaryBlock* out) {
+    for (size_t b = 0; b < block_count; ++b, data += 64) {
+        uint64_t newline = 0;
+        uint64_t sentence_end = 0;
+        uint64_t whitespace = 0;
+        for (size_t i = 0; i < 64; ++i) {
+            uint64_t bit = uint64_t(1) << i;
+            unsigned char c = data[i];
+            newline |= c == '\n' ? bit : 0;
+            sentence_end |= is_sentence_terminator(c) ? bit : 0;
+            whitespace |= is_ascii_space(c) ? bit : 0;
+        }
+        out[b].newline = newline;
+        out[b].sentence_end = sentence_end;
+        out[b].whitespace = whitespace;
+    }
+}
+#endif
+
+#ifdef COSMOS_SCANNER_X86
+void scan_blocks_sse2(const unsigned char* data, size_t block_count, BoundaryBlock* out) {
+    const __m128i newline = _mm_set1_epi8('\n');
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i tab = _mm_set1_epi8('\t');
+    const __m128i control_span = _mm_set1_epi8('\r' - '\t');
+    const __m128i period = _mm_set1_epi8('.');
+    const __m128i exclamation = _mm_set1_epi8('!');
+    const __m128i question = _mm_set1_epi8('?');
+
+    for (size_t b = 0; b < block_count; ++b, data += 64) {
+        uint64_t masks[3] = {0, 0, 0};
+        for (size_t lane = 0; lane < 4; ++lane) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + lane * 16));
+            __m128i is_newline = _mm_cmpeq_epi8(v, newline);
+            // '\t'..'\r' is a contiguous range: (c - '\t') <= 4 as unsigned bytes
+            __m128i offset = _mm_sub_epi8(v, tab);
+            __m128i is_control = _mm_cmpeq_epi8(_mm_min_epu8(offset, control_span), offset);
+            __m128i is_space = _mm_or_si128(_mm_cmpeq_epi8(v, space), is_control);
+            __m128i is_terminator = _mm_or_si128(
+                _mm_or_si128(_mm_cmpeq_epi8(v, period), _mm_cmpeq_epi8(v, exclamation)),
+                _mm_cmpeq_epi8(v, question));
+
+            unsigned shift = static_cast<unsigned>(lane * 16);
+            masks[0] |= uint64_t(static_cast<uint16_t>(_mm_movemask_epi8(is_newline))) << shift;
+            masks[1] |= uint64_t(static_cast<uint16_t>(_mm_movemask_epi8(is_terminator))) << shift;
+            masks[2] |= uint64_t(static_cast<uint16_t>(_mm_movemask_epi8(is_space))) << shift;
+        }
+        out[b].newline = masks[0];
+        out[b].sentence_end = masks[1];
+        out[b].whitespace = masks[2];
+    }
+}
+
+__attribute__((target("avx2")))
+void scan_blocks_avx2(const unsigned char* data, size_t block_count, BoundaryBlock* out) {
+    const __m256i newline = _mm256_set1_epi8('\n');
+    const __m256i space = _mm256_set1_epi8(' ');
+    const __m256i tab = _mm256_set1_epi8('\t');
+    const __m256i control_span = _mm256_set1_epi8('\r' - '\t');
+    const __m256i period = _mm256_set1_epi8('.');
+    const __m256i exclamation = _mm256_set1_epi8('!');
+    const __m256i question = _mm256_set1_epi8('?');
+
+    for (size_t b = 0; b < block_count; ++b, data += 64) {
+        uint64_t masks[3] = {0, 0, 0};
+        for (size_t lane = 0; lane < 2; ++lane) {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + lane * 32));
+            __m256i is_newline = _mm256_cmpeq_epi8(v, newline);
+            __m256i offset = _mm256_sub_epi8(v, tab);
+            __m256i is_control = _mm256_cmpeq_epi8(_mm256_min_epu8(offset, control_span), offset);
+            __m256i is_space = _mm256_or_si256(_mm256_cmpeq_epi8(v, space), is_control);
+            __m256i is_terminator = _mm256_or_si256(
+                _mm256_or_si256(_mm256_cmpeq_epi8(v, period), _mm256_cmpeq_epi8(v, exclamation)),
+                _mm256_cmpeq_epi8(v, question));
+
+            unsigned shift = static_cast<unsigned>(lane * 32);
+            masks[0] |= uint64_t(static_cast<uint32_t>(_mm256_movemask_epi8(is_newline))) << shift;
+            masks[1] |= uint64_t(static_cast<uint32_t>(_mm256_movemask_epi8(is_terminator))) << shift;
+            masks[2] |= uint64_t(static_cast<uint32_t>(_mm256_movemask_epi8(is_space))) << shift;
+        }
+        out[b].newline = masks[0];
+        out[b].sentence_end = masks[1];
+        out[b].whitespace = masks[2];
+    }
+}
+#endif
+
+#ifdef COSMOS_SCANNER_NEON
+inline uint64_t neon_movemask(uint8x16_t v) {
+    static const uint8_t weights[16] = {1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128};
+    uint8x16_t masked = vandq_u8(v, vld1q_u8(weights));
+    return uint64_t(vaddv_u8(vget_low_u8(masked))) | (uint64_t(vaddv_u8(vget_high_u8(masked))) << 8);
+}
+
+void scan_blocks_neon(const unsigned char* data, size_t block_count, BoundaryBlock* out) {
+    const uint8x16_t newline = vdupq_n_u8('\n');
+    const uint8x16_t space = vdupq_n_u8(' ');
+    const uint8x16_t tab = vdupq_n_u8('\t');
+    const uint8x16_t control_span = vdupq_n_u8('\r' - '\t');
+    const uint8x16_t period = vdupq_n_u8('.');
+    const uint8x16_t exclamation = vdupq_n_u8('!');
+    const uint8x16_t question = vdupq_n_u8('?');
+
+    for (size_t b = 0; b < block_count; ++b, data += 64) {
+        uint64_t masks[3] = {0, 0, 0};
+        for (size_t lane = 0; lane < 4; ++lane) {
+            uint8x16_t v = vld1q_u8(data + lane * 16);
+            uint8x16_t is_newline = vceqq_u8(v, newline);
+            uint8x16_t is_space = vorrq_u8(vceqq_u8(v, space), vcleq_u8(vsubq_u8(v, tab), control_span));
+            uint8x16_t is_terminator = vorrq_u8(vorrq_u8(vceqq_u8(v, period), vceqq_u8(v, exclamation)),
+                                                vceqq_u8(v, question));
+
+            unsigned shift = static_cast<unsigned>(lane * 16);
+            masks[0] |= neon_movemask(is_newline) << shift;
+            masks[1] |= neon_movemask(is_terminator) << shift;
+            masks[2] |= neon_movemask(is_space) << shift;
+        }
+        out[b].newline = masks[0];
+        out[b].sentence_end = masks[1];
+        out[b].whitespace = masks[2];
+    }
+}
+#endif
+
+// "\n\n" starts wherever a newline is followed by another newline,
+// including across block boundaries
+COSMOS_MULTIVERSIONED
+void mark_paragraphs(BoundaryBlock* blocks, size_t block_count) {
+    for (size_t b = 0; b < block_count; ++b) {
+        uint64_t next = b + 1 < block_count ? blocks[b + 1].newline & 1 : 0;
+        blocks[b].paragraph = blocks[b].newline & ((blocks[b].newline >> 1) | (next << 63));
+    }
+}
+
+// Word starts (non-whitespace after whitespace or the start of the text) in
+// [begin, end), a popcount per block; the caller clamps end to text_length
+COSMOS_MULTIVERSIONED
+size_t count_word_starts(const BoundaryBlock* blocks, size_t block_count, size_t text_length,
+                         size_t begin, size_t end) {
+    size_t words = 0;
+    for (size_t block = begin / 64; block * 64 < end; ++block) {
+        uint64_t whitespace = blocks[block].whitespace;
+        // Bytes past the end of the text are zero, so fold them into whitespace
+        if (block == block_count - 1 && text_length % 64) {
+            whitespace |= ~uint64_t(0) << (text_length % 64);
+        }
+        uint64_t previous = block > 0 ? blocks[block - 1].whitespace >> 63 : 1;
+        uint64_t starts = ~whitespace & ((whitespace << 1) | previous);
+
+        size_t lo = block * 64 < begin ? begin % 64 : 0;
+        size_t hi = (block + 1) * 64 > end ? end - block * 64 : 64;
+        uint64_t range = (hi == 64 ? ~uint64_t(0) : (uint64_t(1) << hi) - 1) & (~uint64_t(0) << lo);
+        words += popcount(starts & range);
+    }
+    return words;
+}
+
+struct SelectedKernel {
+    ScanKernel kernel;
+    const char* name;
+};
+
+SelectedKernel select_kernel() {
+#ifdef COSMOS_SCANNER_X86
+#if defined(__GNUC__) || defined(__clang__)
+    if (__builtin_cpu_supports("avx2")) {
+        return {scan_blocks_avx2, "avx2"};
+    }
+#endif
+    return {scan_blocks_sse2, "sse2"};
+#elif defined(COSMOS_SCANNER_NEON)
+    return {scan_blocks_neon, "neon"};
+#else
+    return {scan_blocks_scalar, "scalar"};
+#endif
+}
+
+const SelectedKernel& active_kernel() {
+    static const SelectedKernel selected = select_kernel();
+    return selected;
+}
+
+}  // namespace
+
+const char* boundary_scanner_backend() {
+    return active_kernel().name;
+}
+
+BoundaryIndex::BoundaryIndex(string_view text) : text_(text) {
+    size_t full_blocks = text.length() / 64;
+    size_t tail = text.length() % 64;
+    blocks_.resize(full_blocks + (tail ? 1 : 0));
+
+    ScanKernel kernel = active_kernel().kernel;
+    const unsigned char* data = reinterpret_cast<const unsigned char*>(text.data());
+    kernel(data, full_blocks, blocks_.data());
+
+    if (tail) {
+        // Scan the tail through a zero-padded copy; NUL is never a boundary
+        unsigned char padded[64] = {0};
+        memcpy(padded, data + full_blocks * 64, tail);
+        kernel(padded, 1, &blocks_[full_blocks]);
+    }
+
+    mark_paragraphs(blocks_.data(), blocks_.size());
+}
+
+size_t BoundaryIndex::find_set(uint64_t BoundaryBlock::*mask, size_t from, size_t end) const {
+    end = min(end, text_.length());
+    if (from >= end) {
+        return npos;
+    }
+
+    size_t block = from / 64;
+    uint64_t bits = blocks_[block].*mask & (~uint64_t(0) << (from % 64));
+    size_t last_block = (end - 1) / 64;
+    while (!bits) {
+        if (++block > last_block) {
+            return npos;
+        }
+        bits = blocks_[block].*mask;
+    }
+
+    size_t pos = block * 64 + count_trailing_zeros(bits);
+    return pos < end ? pos : npos;
+}
+
+size_t BoundaryIndex::rfind_set(uint64_t BoundaryBlock::*mask, size_t begin, size_t end) const {
+    end = min(end, text_.length());
+    if (begin >= end) {
+        return npos;
+    }
+
+    size_t block = (end - 1) / 64;
+    uint64_t bits = blocks_[block].*mask & (~uint64_t(0) >> (63 - (end - 1) % 64));
+    size_t first_block = begin / 64;
+    while (!bits) {
+        if (block-- == first_block) {
+            return npos;
+        }
+        bits = blocks_[block].*mask;
+    }
+
+    size_t pos = block * 64 + 63 - count_leading_zeros(bits);
+    return pos >= begin ? pos : npos;
+}
+
+size_t BoundaryIndex::find_paragraph(size_t from, size_t end) const {
+    // The second newline must also lie inside the range
+    size_t pos = find_set(&BoundaryBlock::paragraph, from, end);
+    return pos != npos && pos + 2 <= end ? pos : npos;
+}
+
+size_t BoundaryIndex::find_non_whitespace(size_t from, size_t end) const {
+    end = min(end, text_.length());
+    for (size_t pos = from; pos < end;) {
+        size_t block = pos / 64;
+        uint64_t bits = ~blocks_[block].whitespace & (~uint64_t(0) << (pos % 64));
+        if (bits) {
+            size_t found = block * 64 + count_trailing_zeros(bits);
+            return found < end ? found : npos;
+        }
+        pos = (block + 1) * 64;
+    }
+    return npos;
+}
+
+size_t BoundaryIndex::find_candidate(uint64_t BoundaryBlock::*mask, string_view separator,
+                                     size_t from, size_t end) const {
+    for (size_t pos = find_set(mask, from, end); pos != npos; pos = find_set(mask, pos + 1, end)) {
+        if (pos + separator.length() > end) {
+            return npos;
+        }
+        if (text_.compare(pos, separator.length(), separator) == 0) {
+            return pos;
+        }
+    }
+    return npos;
+}
+
+size_t BoundaryIndex::find(string_view separator, size_t from, size_t end) const {
+    end = min(end, text_.length());
+    if (separator.empty()) {
+        return from < end ? from : npos;
+    }
+
+    unsigned char first = static_cast<unsigned char>(separator[0]);
+    if (separator == "\n\n") {
+        return find_paragraph(from, end);
+    }
+    if (separator == "\n") {
+        return find_newline(from, end);
+    }
+    if (is_ascii_space(first)) {
+        return find_candidate(&BoundaryBlock::whitespace, separator, from, end);
+    }
+    if (is_sentence_terminator(first)) {
+        return find_candidate(&BoundaryBlock::sentence_end, separator, from, end);
+    }
+
+    if (from >= end) {
+        return npos;
+    }
+    size_t pos = text_.substr(from, end - from).find(separator);
+    return pos == string_view::npos ? npos : from + pos;
+}
+
+size_t BoundaryIndex::count_words(size_t begin, size_t end) const {
+    end = min(end, text_.length());
+    if (begin >= end) {
+        return 0;
+    }
+
+    return count_word_starts(blocks_.data(), blocks_.size(), text_.length(), begin, end);
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+/**
+ * Boundary classes for one 64-byte block of text. Bit i of each mask refers
+ * to byte (block_index * 64 + i) of the scanned buffer.
+ */
+struct BoundaryBlock {
+    uint64_t newline;       // '\n'
+    uint64_t paragraph;     // first byte of "\n\n"
+    uint64_t sentence_end;  // '.', '!', '?'
+    uint64_t whitespace;    // ' ', '\t', '\n', '\v', '\f', '\r'
+};
+
+inline size_t count_trailing_zeros(uint64_t bits) {
+#if defined(__GNUC__) || defined(__clang__)
+    return static_cast<size_t>(__builtin_ctzll(bits));
+#else
+    size_t n = 0;
+    while (!(bits & 1)) {
+        bits >>= 1;
+        ++n;
+    }
+    return n;
+#endif
+}
+
+/**
+ * Bitmask index of boundary positions, built with a single vectorized pass
+ * over the text (AVX2 or SSE2 on x86-64, NEON on AArch64, scalar otherwise;
+ * the fastest available kernel is picked at runtime).
+ *
+ * The index only borrows the text, which must outlive it.
+ */
+class BoundaryIndex {
+public:
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+    explicit BoundaryIndex(std::string_view text);
+
+    std::string_view text() const { return text_; }
+    const std::vector<BoundaryBlock>& blocks() const { return blocks_; }
+
+    size_t find_newline(size_t from, size_t end) const { return find_set(&BoundaryBlock::newline, from, end); }
+    size_t find_paragraph(size_t from, size_t end) const;
+    size_t find_sentence_end(size_t from, size_t end) const { return find_set(&BoundaryBlock::sentence_end, from, end); }
+    size_t find_whitespace(size_t from, size_t end) const { return find_set(&BoundaryBlock::whitespace, from, end); }
+    size_t find_non_whitespace(size_t from, size_t end) const;
+
+    /** Last whitespace byte inside [begin, end), or npos. */
+    size_t find_last_whitespace(size_t begin, size_t end) const { return rfind_set(&BoundaryBlock::whitespace, begin, end); }
+
+    /**
+     * Finds the first occurrence of separator fully inside [from, end).
+     * Separators starting with a classified byte are located through the
+     * masks; anything else falls back to string_view::find.
+     */
+    size_t find(std::string_view separator, size_t from, size_t end) const;
+
+    /**
+     * First position in [from, end) set in Mask for which match(pos) holds,
+     * or npos. Inline so that compiled chunking configurations walk the masks
+     * without a call per candidate.
+     */
+    template <uint64_t BoundaryBlock::*Mask, typename Match>
+    size_t find_matching(size_t from, size_t end, Match&& match) const {
+        end = end < text_.length() ? end : text_.length();
+        if (from >= end) {
+            return npos;
+        }
+        const size_t last_block = (end - 1) / 64;
+        size_t block = from / 64;
+        uint64_t bits = blocks_[block].*Mask & (~uint64_t(0) << (from % 64));
+        for (;;) {
+            for (; bits; bits &= bits - 1) {
+                const size_t pos = block * 64 + count_trailing_zeros(bits);
+                if (pos >= end) {
+                    return npos;
+                }
+                if (match(pos)) {
+                    return pos;
+                }
+            }
+            if (++block > last_block) {
+                return npos;
+            }
+            bits = blocks_[block].*Mask;
+        }
+    }
+
+    bool is_whitespace(size_t pos) const { return (blocks_[pos / 64].whitespace >> (pos % 64)) & 1; }
+
+    /**
+     * Counts whitespace-delimited words that start inside [begin, end).
+     */
+    size_t count_words(size_t begin, size_t end) const;
+
+private:
+    size_t find_set(uint64_t BoundaryBlock::*mask, size_t from, size_t end) const;
+    size_t rfind_set(uint64_t BoundaryBlock::*mask, size_t begin, size_t end) const;
+    size_t find_candidate(uint64_t BoundaryBlock::*mask, std::string_view separator, size_t from, size_t end) const;
+
+    std::string_view text_;
+    std::vector<BoundaryBlock> blocks_;
+};
+
+/**
+ * Name of the scanning kernel selected for this CPU ("avx2", "sse2", "neon" or "scalar").
+ */
+const char* boundary_scanner_backend();
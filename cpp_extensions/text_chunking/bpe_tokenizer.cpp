@@ -0,0 +1,489 @@
+#include "bpe_tokenizer.h"
+#include "mapped_file.h"
+#include "unicode_classes.h"
+#include "utf8.h"
+
+#include <algorithm>
+#include <mutex>
+#include <stdexcept>
+
+using namespace std;
+
+namespace {
+
+constexpr size_t npos = string_view::npos;
+
+struct CodePoint {
+    uint32_t value;
+    size_t length;
+    UnicodeClass cls;
+};
+
+inline CodePoint code_point_at(string_view text, size_t pos) {
+    size_t length = 1;
+    uint32_t cp = static_cast<unsigned char>(text[pos]);
+    if (cp >= 0x80) {
+        cp = decode_code_point(text, pos, length);
+    }
+    return {cp, length, classify_code_point(cp)};
+}
+
+inline bool is_newline(uint32_t cp) {
+    return cp == '\r' || cp == '\n';
+}
+
+// [^\r\n\p{L}\p{N}]
+inline bool is_word_prefix(const CodePoint& c) {
+    return !is_newline(c.value) && !is_letter_class(c.cls) && c.cls != UnicodeClass::Number;
+}
+
+// [^\s\p{L}\p{N}]
+inline bool is_punctuation(const CodePoint& c) {
+    return c.cls != UnicodeClass::Whitespace && !is_letter_class(c.cls) && c.cls != UnicodeClass::Number;
+}
+
+// o200k's [\p{Lu}\p{Lt}\p{Lm}\p{Lo}\p{M}]
+inline bool is_upper_set(const CodePoint& c) {
+    return c.cls == UnicodeClass::UppercaseLetter || c.cls == UnicodeClass::UncasedLetter ||
+           c.cls == UnicodeClass::Mark;
+}
+
+// o200k's [\p{Ll}\p{Lm}\p{Lo}\p{M}]
+inline bool is_lower_set(const CodePoint& c) {
+    return c.cls == UnicodeClass::LowercaseLetter || c.cls == UnicodeClass::UncasedLetter ||
+           c.cls == UnicodeClass::Mark;
+}
+
+template <typename Predicate>
+size_t run_end(string_view text, size_t pos, Predicate predicate) {
+    while (pos < text.length()) {
+        CodePoint c = code_point_at(text, pos);
+        if (!predicate(c)) {
+            break;
+        }
+        pos += c.length;
+    }
+    return pos;
+}
+
+inline char ascii_lower(char c) {
+    return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+// (?i:'s|'t|'re|'ve|'m|'ll|'d), shared by both encodings
+size_t match_contraction(string_view text, size_t pos) {
+    if (pos + 1 >= text.length() || text[pos] != '\'') {
+        return npos;
+    }
+    char a = ascii_lower(text[pos + 1]);
+    if (a == 's' || a == 't' || a == 'm' || a == 'd') {
+        return pos + 2;
+    }
+    if (pos + 2 < text.length()) {
+        char b = ascii_lower(text[pos + 2]);
+        if ((a == 'r' && b == 'e') || (a == 'v' && b == 'e') || (a == 'l' && b == 'l')) {
+            return pos + 3;
+        }
+    }
+    return npos;
+}
+
+// \s*[\r\n]+ | \s+(?!\S) | \s+
+size_t match_whitespace(string_view text, size_t pos) {
+    size_t end = pos;
+    size_t last_start = pos;
+    size_t newline_end = npos;
+    while (end < text.length()) {
+        CodePoint c = code_point_at(text, end);
+        if (c.cls != UnicodeClass::Whitespace) {
+            break;
+        }
+        if (is_newline(c.value)) {
+            newline_end = end + c.length;
+        }
+        last_start = end;
+        end += c.length;
+    }
+
+    if (newline_end != npos) {
+        return newline_end;
+    }
+    if (end == text.length() || last_start == pos) {
+        return end;
+    }
+    // Leave the last whitespace character to prefix the following word
+    return last_start;
+}
+
+// ` ?[^\s\p{L}\p{N}]+` followed by any of the trailing bytes
+size_t match_punctuation(string_view text, size_t pos, const CodePoint& first, string_view trailing) {
+    size_t start = first.value == ' ' ? pos + 1 : pos;
+    size_t end = run_end(text, start, is_punctuation);
+    if (end == start) {
+        return npos;
+    }
+    while (end < text.length() && trailing.find(text[end]) != npos) {
+        ++end;
+    }
+    return end;
+}
+
+size_t match_numbers(string_view text, size_t pos, size_t max_count) {
+    size_t end = pos;
+    for (size_t i = 0; i < max_count && end < text.length(); ++i) {
+        CodePoint c = code_point_at(text, end);
+        if (c.cls != UnicodeClass::Number) {
+            break;
+        }
+        end += c.length;
+    }
+    return end;
+}
+
+/**
+ * cl100k_base:
+ * '(?i:[sdmt]|ll|ve|re)|[^\r\n\p{L}\p{N}]?+\p{L}+|\p{N}{1,3}| ?[^\s\p{L}\p{N}]++[\r\n]*|\s*[\r\n]|\s+(?!\S)|\s+
+ */
+size_t next_cl100k_end(string_view text, size_t pos) {
+    size_t end = match_contraction(text, pos);
+    if (end != npos) {
+        return end;
+    }
+
+    CodePoint first = code_point_at(text, pos);
+    size_t letters = is_letter_class(first.cls) ? pos : is_word_prefix(first) ? pos + first.length : npos;
+    if (letters != npos) {
+        end = run_end(text, letters, [](const CodePoint& c) { return is_letter_class(c.cls); });
+        if (end > letters) {
+            return end;
+        }
+    }
+
+    if (first.cls == UnicodeClass::Number) {
+        return match_numbers(text, pos, 3);
+    }
+
+    end = match_punctuation(text, pos, first, "\r\n");
+    if (end != npos) {
+        return end;
+    }
+
+    if (first.cls == UnicodeClass::Whitespace) {
+        return match_whitespace(text, pos);
+    }
+    return pos + first.length;
+}
+
+// [\p{Lu}\p{Lt}\p{Lm}\p{Lo}\p{M}]*[\p{Ll}\p{Lm}\p{Lo}\p{M}]+ plus optional contraction
+size_t match_o200k_lower_word(string_view text, size_t pos) {
+    size_t upper_end = pos;
+    size_t last_uncased = npos;
+    while (upper_end < text.length()) {
+        CodePoint c = code_point_at(text, upper_end);
+        if (!is_upper_set(c)) {
+            break;
+        }
+        if (c.cls != UnicodeClass::UppercaseLetter) {
+            last_uncased = upper_end;
+        }
+        upper_end += c.length;
+    }
+
+    // Backtrack the greedy uppercase run to the longest prefix followed by a lowercase-set character
+    size_t lower_start = npos;
+    if (upper_end < text.length() && code_point_at(text, upper_end).cls == UnicodeClass::LowercaseLetter) {
+        lower_start = upper_end;
+    } else if (last_uncased != npos) {
+        lower_start = last_uncased;
+    } else {
+        return npos;
+    }
+
+    size_t end = run_end(text, lower_start, is_lower_set);
+    size_t contraction = match_contraction(text, end);
+    return contraction != npos ? contraction : end;
+}
+
+// [\p{Lu}\p{Lt}\p{Lm}\p{Lo}\p{M}]+[\p{Ll}\p{Lm}\p{Lo}\p{M}]* plus optional contraction
+size_t match_o200k_upper_word(string_view text, size_t pos) {
+    size_t upper_end = run_end(text, pos, is_upper_set);
+    if (upper_end == pos) {
+        return npos;
+    }
+    size_t end = run_end(text, upper_end, is_lower_set);
+    size_t contraction = match_contraction(text, end);
+    return contraction != npos ? contraction : end;
+}
+
+/**
+ * o200k_base:
+ * [^\r\n\p{L}\p{N}]?[\p{Lu}\p{Lt}\p{Lm}\p{Lo}\p{M}]*[\p{Ll}\p{Lm}\p{Lo}\p{M}]+(?i:'s|'t|'re|'ve|'m|'ll|'d)?
+ * |[^\r\n\p{L}\p{N}]?[\p{Lu}\p{Lt}\p{Lm}\p{Lo}\p{M}]+[\p{Ll}\p{Lm}\p{Lo}\p{M}]*(?i:'s|'t|'re|'ve|'m|'ll|'d)?
+ * |\p{N}{1,3}| ?[^\s\p{L}\p{N}]+[\r\n/]*|\s*[\r\n]+|\s+(?!\S)|\s+
+ */
+size_t next_o200k_end(string_view text, size_t pos) {
+    CodePoint first = code_point_at(text, pos);
+    bool has_prefix = is_word_prefix(first);
+
+    for (auto matcher : {match_o200k_lower_word, match_o200k_upper_word}) {
+        size_t end = npos;
+        if (has_prefix && pos + first.length < text.length()) {
+            end = matcher(text, pos + first.length);
+        }
+        if (end == npos) {
+            end = matcher(text, pos);
+        }
+        if (end != npos) {
+            return end;
+        }
+    }
+
+    if (first.cls == UnicodeClass::Number) {
+        return match_numbers(text, pos, 3);
+    }
+
+    size_t end = match_punctuation(text, pos, first, "\r\n/");
+    if (end != npos) {
+        return end;
+    }
+
+    if (first.cls == UnicodeClass::Whitespace) {
+        return match_whitespace(text, pos);
+    }
+    return pos + first.length;
+}
+
+bool base64_decode(string_view input, vector<char>& out) {
+    uint32_t buffer = 0;
+    int bits = 0;
+    for (char ch : input) {
+        int value;
+        if (ch >= 'A' && ch <= 'Z') value = ch - 'A';
+        else if (ch >= 'a' && ch <= 'z') value = ch - 'a' + 26;
+        else if (ch >= '0' && ch <= '9') value = ch - '0' + 52;
+        else if (ch == '+') value = 62;
+        else if (ch == '/') value = 63;
+        else if (ch == '=') break;
+        else return false;
+
+        buffer = (buffer << 6) | static_cast<uint32_t>(value);
+        bits += 6;
+        if (bits >= 8) {
+            bits -= 8;
+            out.push_back(static_cast<char>((buffer >> bits) & 0xFF));
+        }
+    }
+    return true;
+}
+
+bool parse_rank(string_view input, uint32_t& rank) {
+    if (input.empty()) {
+        return false;
+    }
+    uint64_t value = 0;
+    for (char ch : input) {
+        if (ch < '0' || ch > '9') {
+            return false;
+        }
+        value = value * 10 + static_cast<uint64_t>(ch - '0');
+        if (value >= UINT32_MAX) {
+            return false;
+        }
+    }
+    rank = static_cast<uint32_t>(value);
+    return true;
+}
+
+PretokenizerPattern pattern_for_encoding(const string& encoding_name) {
+    if (encoding_name == "cl100k_base") {
+        return PretokenizerPattern::Cl100k;
+    }
+    if (encoding_name == "o200k_base") {
+        return PretokenizerPattern::O200k;
+    }
+    throw invalid_argument("Unsupported encoding '" + encoding_name + "', expected cl100k_base or o200k_base");
+}
+
+}  // namespace
+
+size_t next_pretoken_end(string_view text, size_t pos, PretokenizerPattern pattern) {
+    return pattern == PretokenizerPattern::Cl100k ? next_cl100k_end(text, pos) : next_o200k_end(text, pos);
+}
+
+BpeEncoder::BpeEncoder(const string& ranks_path, PretokenizerPattern pattern, string name)
+    : name_(std::move(name)), pattern_(pattern) {
+    fill(begin(byte_ranks_), end(byte_ranks_), kNoRank);
+
+    MappedFile file(ranks_path);
+    string_view data = file.view();
+
+    // Decoded base64 is never longer than its encoding, so keys never move
+    token_bytes_.reserve(data.size());
+    ranks_.reserve(data.size() / 8);
+
+    size_t line_start = 0;
+    while (line_start < data.size()) {
+        size_t line_end = data.find('\n', line_start);
+        if (line_end == npos) {
+            line_end = data.size();
+        }
+        string_view line = data.substr(line_start, line_end - line_start);
+        line_start = line_end + 1;
+
+        if (!line.empty() && line.back() == '\r') {
+            line.remove_suffix(1);
+        }
+        if (line.empty()) {
+            continue;
+        }
+
+        size_t space = line.find(' ');
+        size_t offset = token_bytes_.size();
+        uint32_t rank = 0;
+        if (space == npos || !base64_decode(line.substr(0, space), token_bytes_) ||
+            !parse_rank(line.substr(space + 1), rank) || token_bytes_.size() == offset) {
+            throw runtime_error("Malformed BPE ranks file " + ranks_path + ": " + string(line));
+        }
+
+        string_view token(token_bytes_.data() + offset, token_bytes_.size() - offset);
+        ranks_.emplace(token, rank);
+        if (token.size() == 1) {
+            byte_ranks_[static_cast<unsigned char>(token[0])] = rank;
+        }
+    }
+
+    for (uint32_t rank : byte_ranks_) {
+        if (rank == kNoRank) {
+            throw runtime_error("BPE ranks file " + ranks_path + " does not cover all single bytes");
+        }
+    }
+}
+
+shared_ptr<const BpeEncoder> BpeEncoder::get(const string& ranks_path, const string& encoding_name) {
+    PretokenizerPattern pattern = pattern_for_encoding(encoding_name);
+
+    static mutex registry_mutex;
+    static unordered_map<string, shared_ptr<const BpeEncoder>> registry;
+
+    string key = encoding_name + '\n' + ranks_path;
+    lock_guard<mutex> lock(registry_mutex);
+    auto it = registry.find(key);
+    if (it != registry.end()) {
+        return it->second;
+    }
+
+    auto encoder = make_shared<const BpeEncoder>(ranks_path, pattern, encoding_name);
+    registry.emplace(key, encoder);
+    return encoder;
+}
+
+uint32_t BpeEncoder::rank_of(string_view bytes) const {
+    if (bytes.size() == 1) {
+        return byte_ranks_[static_cast<unsigned char>(bytes[0])];
+    }
+    auto it = ranks_.find(bytes);
+    return it == ranks_.end() ? kNoRank : it->second;
+}
+
+void BpeEncoder::byte_pair_merge(string_view piece, vector<pair<size_t, uint32_t>>& parts) const {
+    parts.clear();
+    parts.reserve(piece.size() + 1);
+
+    pair<uint32_t, size_t> min_rank(kNoRank, npos);
+    for (size_t i = 0; i + 1 < piece.size(); ++i) {
+        uint32_t rank = rank_of(piece.substr(i, 2));
+        if (rank < min_rank.first) {
+            min_rank = {rank, i};
+        }
+        parts.emplace_back(i, rank);
+    }
+    parts.emplace_back(piece.size() - 1, kNoRank);
+    parts.emplace_back(piece.size(), kNoRank);
+
+    auto get_rank = [&](size_t i) {
+        if (i + 3 < parts.size()) {
+            return rank_of(piece.substr(parts[i].first, parts[i + 3].first - parts[i].first));
+        }
+        return kNoRank;
+    };
+
+    while (min_rank.first != kNoRank) {
+        size_t i = min_rank.second;
+        if (i > 0) {
+            parts[i - 1].second = get_rank(i - 1);
+        }
+        parts[i].second = get_rank(i);
+        parts.erase(parts.begin() + static_cast<ptrdiff_t>(i) + 1);
+
+        min_rank = {kNoRank, npos};
+        for (size_t j = 0; j + 1 < parts.size(); ++j) {
+            if (parts[j].second < min_rank.first) {
+                min_rank = {parts[j].second, j};
+            }
+        }
+    }
+}
+
+size_t BpeEncoder::count_piece_tokens(string_view piece) const {
+    if (piece.empty()) {
+        return 0;
+    }
+    if (rank_of(piece) != kNoRank) {
+        return 1;
+    }
+
+    thread_local vector<pair<size_t, uint32_t>> parts;
+    byte_pair_merge(piece, parts);
+    return parts.size() - 1;
+}
+
+void BpeEncoder::piece_token_ends(string_view piece, vector<size_t>& ends) const {
+    ends.clear();
+    if (piece.empty()) {
+        return;
+    }
+    if (rank_of(piece) != kNoRank) {
+        ends.push_back(piece.size());
+        return;
+    }
+
+    thread_local vector<pair<size_t, uint32_t>> parts;
+    byte_pair_merge(piece, parts);
+    for (size_t i = 1; i < parts.size(); ++i) {
+        ends.push_back(parts[i].first);
+    }
+}
+
+size_t BpeEncoder::count_tokens(string_view text) const {
+    size_t tokens = 0;
+    for (size_t pos = 0; pos < text.size();) {
+        size_t end = next_pretoken_end(text, pos, pattern_);
+        tokens += count_piece_tokens(text.substr(pos, end - pos));
+        pos = end;
+    }
+    return tokens;
+}
+
+vector<uint32_t> BpeEncoder::encode(string_view text) const {
+    vector<uint32_t> tokens;
+    tokens.reserve(text.size() / 4 + 1);
+
+    vector<pair<size_t, uint32_t>> parts;
+    for (size_t pos = 0; pos < text.size();) {
+        size_t end = next_pretoken_end(text, pos, pattern_);
+        string_view piece = text.substr(pos, end - pos);
+        pos = end;
+
+        uint32_t rank = rank_of(piece);
+        if (rank != kNoRank) {
+            tokens.push_back(rank);
+            continue;
+        }
+
+        byte_pair_merge(piece, parts);
+        for (size_t i = 0; i + 1 < parts.size(); ++i) {
+            tokens.push_back(rank_of(piece.substr(parts[i].first, parts[i + 1].first - parts[i].first)));
+        }
+    }
+    return tokens;
+}
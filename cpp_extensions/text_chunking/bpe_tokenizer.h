@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Pre-tokenizer regexes of the tiktoken encodings we support, implemented
+ * as hand-written matchers.
+ */
+enum class PretokenizerPattern {
+    Cl100k,  // cl100k_base: text-embedding-3-*, gpt-4, gpt-3.5-turbo
+    O200k,   // o200k_base: gpt-4o family
+};
+
+/**
+ * Returns the end of the pre-tokenizer piece that starts at pos.
+ * BPE merges never cross piece boundaries, so pieces can be tokenized independently.
+ */
+size_t next_pretoken_end(std::string_view text, size_t pos, PretokenizerPattern pattern);
+
+/**
+ * tiktoken-compatible byte-pair encoder (encode_ordinary semantics: special
+ * tokens are treated as plain text).
+ *
+ * Instances are immutable once constructed, so a single encoder can be shared
+ * by any number of threads.
+ */
+class BpeEncoder {
+public:
+    /**
+     * Loads merge ranks from a .tiktoken file ("<base64 token> <rank>" per line).
+     * The file is memory-mapped and parsed in place.
+     */
+    BpeEncoder(const std::string& ranks_path, PretokenizerPattern pattern, std::string name);
+
+    /**
+     * Returns the process-wide encoder for (ranks_path, encoding_name), loading it on first use.
+     *
+     * @param ranks_path Path to the .tiktoken merge ranks file
+     * @param encoding_name "cl100k_base" or "o200k_base"; selects the pre-tokenizer
+     */
+    static std::shared_ptr<const BpeEncoder> get(const std::string& ranks_path, const std::string& encoding_name);
+
+    size_t count_tokens(std::string_view text) const;
+    std::vector<uint32_t> encode(std::string_view text) const;
+
+    /**
+     * Number of tokens a single pre-tokenizer piece encodes to.
+     */
+    size_t count_piece_tokens(std::string_view piece) const;
+
+    /**
+     * Byte offsets (relative to the piece) where the piece's tokens end.
+     */
+    void piece_token_ends(std::string_view piece, std::vector<size_t>& ends) const;
+
+    PretokenizerPattern pattern() const { return pattern_; }
+    const std::string& name() const { return name_; }
+    size_t vocab_size() const { return ranks_.size(); }
+
+private:
+    static constexpr uint32_t kNoRank = UINT32_MAX;
+
+    uint32_t rank_of(std::string_view bytes) const;
+
+    /**
+     * tiktoken's _byte_pair_merge: repeatedly merges the lowest-ranked adjacent pair.
+     * Fills parts with the start offset of every final token plus the piece length.
+     */
+    void byte_pair_merge(std::string_view piece, std::vector<std::pair<size_t, uint32_t>>& parts) const;
+
+    std::string name_;
+    PretokenizerPattern pattern_;
+    std::vector<char> token_bytes_;  // decoded token bytes; ranks_ keys point into it
+    std::unordered_map<std::string_view, uint32_t> ranks_;
+    uint32_t byte_ranks_[256];
+};
@@ -0,0 +1,147 @@
+#include "cdc_chunker.h"
+#include "boundary_scanner.h"
+#include "utf8.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+using namespace std;
+
+namespace {
+
+// Gear table: 256 pseudo-random words from splitmix64. The values are part
+// of the chunking definition; changing them moves every boundary.
+constexpr array<uint64_t, 256> make_gear_table() {
+    array<uint64_t, 256> table{};
+    uint64_t state = 0;
+    for (size_t i = 0; i < table.size(); ++i) {
+        state += 0x9E3779B97F4A7C15ULL;
+        uint64_t z = state;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        table[i] = z ^ (z >> 31);
+    }
+    return table;
+}
+
+constexpr array<uint64_t, 256> kGear = make_gear_table();
+
+// The Gear hash shifts left, so its high bits depend on the most recent
+// bytes; a cut happens when the top `bits` bits are all zero
+uint64_t high_bits_mask(int bits) {
+    bits = max(1, min(bits, 63));
+    return ~uint64_t(0) << (64 - bits);
+}
+
+int floor_log2(size_t value) {
+    int bits = 0;
+    while (value >>= 1) {
+        ++bits;
+    }
+    return bits;
+}
+
+/**
+ * Finds the raw content-defined cut for the chunk starting at start.
+ * Below avg_size a stricter mask is used and above it a looser one
+ * (normalized chunking), which narrows the chunk size distribution.
+ *
+ * @return Chunk length in bytes, in (min_size, max_length]
+ */
+size_t find_cut(string_view text, size_t start, size_t max_length, size_t min_size, size_t avg_size,
+                uint64_t strict_mask, uint64_t loose_mask) {
+    const size_t normal_length = min(avg_size, max_length);
+    uint64_t hash = 0;
+    size_t i = min_size;
+    for (; i < normal_length; ++i) {
+        hash = (hash << 1) + kGear[static_cast<unsigned char>(text[start + i])];
+        if (!(hash & strict_mask)) {
+            return i + 1;
+        }
+    }
+    for (; i < max_length; ++i) {
+        hash = (hash << 1) + kGear[static_cast<unsigned char>(text[start + i])];
+        if (!(hash & loose_mask)) {
+            return i + 1;
+        }
+    }
+    return max_length;
+}
+
+/**
+ * Moves a cut to the nearest end of a whitespace run inside [low, high],
+ * or to a UTF-8 character boundary if there is none.
+ */
+size_t snap_cut(const BoundaryIndex& index, size_t start, size_t cut, size_t low, size_t high) {
+    // A boundary sits right after a whitespace byte
+    size_t before = index.find_last_whitespace(low - 1, cut);
+    size_t after = index.find_whitespace(cut, high);
+
+    size_t boundary = BoundaryIndex::npos;
+    if (before != BoundaryIndex::npos && (after == BoundaryIndex::npos || cut - (before + 1) <= (after + 1) - cut)) {
+        boundary = before + 1;
+    } else if (after != BoundaryIndex::npos) {
+        boundary = after + 1;
+    }
+
+    if (boundary != BoundaryIndex::npos) {
+        // Keep the rest of the whitespace run with this chunk
+        size_t next_word = index.find_non_whitespace(boundary, high);
+        return next_word == BoundaryIndex::npos ? high : next_word;
+    }
+
+    // Back to the start of the character the cut falls inside; if that is the
+    // chunk start, the chunk holds a single character and ends after it
+    string_view text = index.text();
+    size_t snapped = cut;
+    while (snapped > start && snapped < text.length() && is_utf8_continuation(static_cast<unsigned char>(text[snapped]))) {
+        --snapped;
+    }
+    return snapped > start ? snapped : code_point_ceil(text, cut);
+}
+
+} // namespace
+
+vector<TextSpan> split_content_defined_spans(const BoundaryIndex& index, size_t min_size,
+                                             size_t avg_size, size_t max_size) {
+    if (min_size == 0) {
+        throw invalid_argument("min_size must be > 0");
+    }
+    if (avg_size < min_size || max_size < avg_size) {
+        throw invalid_argument("Expected min_size <= avg_size <= max_size, got " + to_string(min_size) + ", " +
+                               to_string(avg_size) + ", " + to_string(max_size));
+    }
+
+    const int bits = floor_log2(avg_size);
+    const uint64_t strict_mask = high_bits_mask(bits + 1);
+    const uint64_t loose_mask = high_bits_mask(bits - 1);
+
+    string_view text = index.text();
+    const size_t length = text.length();
+    vector<TextSpan> chunks;
+    chunks.reserve(length / avg_size + 1);
+
+    size_t start = 0;
+    while (start < length) {
+        const size_t remaining = length - start;
+        if (remaining <= min_size) {
+            chunks.push_back({start, length});
+            break;
+        }
+
+        const size_t max_length = min(remaining, max_size);
+        size_t end = start + find_cut(text, start, max_length, min_size, avg_size, strict_mask, loose_mask);
+        if (end < length) {
+            end = snap_cut(index, start, end, start + min_size, start + max_length);
+        }
+
+        chunks.push_back({start, end});
+        start = end;
+    }
+
+    return chunks;
+}
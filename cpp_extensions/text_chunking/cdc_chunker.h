@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "text_span.h"
+
+class BoundaryIndex;
+
+/**
+ * Content-defined chunking (FastCDC-style Gear rolling hash with normalized
+ * chunking). Cut points depend only on the bytes around them, so inserting
+ * or deleting text only moves the boundaries next to the edit; every other
+ * chunk keeps its exact content and therefore its content hash.
+ *
+ * Each cut found by the rolling hash is snapped to the nearest whitespace
+ * boundary (the end of a whitespace run) that keeps the chunk within
+ * [min_size, max_size]; without one it falls back to the nearest UTF-8
+ * character boundary. Chunks do not overlap and together cover the text.
+ *
+ * @param index Boundary index of the input text
+ * @param min_size Minimum chunk size in bytes (> 0); only the last chunk may be shorter
+ * @param avg_size Target average chunk size in bytes (>= min_size)
+ * @param max_size Maximum chunk size in bytes (>= avg_size); a chunk only
+ *                 exceeds it to hold one character longer than max_size
+ * @return [start, end) byte offsets of each chunk
+ */
+std::vector<TextSpan> split_content_defined_spans(const BoundaryIndex& index, size_t min_size,
+                                                  size_t avg_size, size_t max_size);
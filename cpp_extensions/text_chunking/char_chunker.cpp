@@ -0,0 +1,132 @@
+#include "char_chunker.h"
+#include "boundary_scanner.h"
+#include "utf8.h"
+
+#include <algorithm>
+
+using namespace std;
+
+/**
+ * Splits text on a separator and greedily merges the pieces into chunk spans.
+ * Every chunk is a contiguous region of the source (pieces joined with the
+ * separator they were split on), so merging and overlap only move offsets.
+ *
+ * @return false if the separator never occurs or produced no chunks
+ */
+static bool merge_separator_splits(const BoundaryIndex& index, string_view separator,
+                                   size_t chunk_size, size_t chunk_overlap,
+                                   vector<TextSpan>& chunks) {
+    string_view text = index.text();
+    size_t current_start = 0;
+    size_t current_end = 0;
+    bool has_splits = false;
+
+    auto add_split = [&](size_t split_start, size_t split_end) {
+        size_t current_length = current_end - current_start;
+
+        // Start new chunk if adding this split would exceed chunk_size
+        if (current_length > 0 &&
+            current_length + (split_end - split_start) + separator.length() > chunk_size) {
+            chunks.push_back({current_start, current_end});
+
+            // Handle overlap by keeping the tail of the emitted chunk, from
+            // the first whole character within chunk_overlap bytes of its end
+            if (chunk_overlap > 0 && current_length > chunk_overlap) {
+                current_start = code_point_ceil(text, current_end - chunk_overlap);
+            } else {
+                current_start = current_end;
+            }
+        }
+
+        if (current_end == current_start) {
+            current_start = split_start;
+        }
+        current_end = split_end;
+    };
+
+    size_t start_pos = 0;
+    size_t next_pos = 0;
+    while ((next_pos = index.find(separator, start_pos, text.length())) != BoundaryIndex::npos) {
+        has_splits = true;
+        add_split(start_pos, next_pos);
+        start_pos = next_pos + separator.length();
+    }
+
+    if (!has_splits) {
+        return false;
+    }
+
+    // Add the last piece
+    if (start_pos < text.length()) {
+        add_split(start_pos, text.length());
+    }
+
+    // Add final chunk
+    if (current_end > current_start) {
+        chunks.push_back({current_start, current_end});
+    }
+
+    return !chunks.empty();
+}
+
+/**
+ * Computes chunk boundaries without copying any text.
+ * This is a recursive character splitter implementation that mimics the behavior
+ * of RecursiveCharacterTextSplitter from LangChain.
+ *
+ * @param index Boundary index of the input text
+ * @param chunk_size The target size of each chunk (in characters)
+ * @param chunk_overlap The number of characters to overlap between chunks
+ * @return A vector of [start, end) byte offsets into the text
+ */
+vector<TextSpan> split_text_spans(const BoundaryIndex& index, int chunk_size, int chunk_overlap) {
+    string_view text = index.text();
+    vector<TextSpan> chunks;
+
+    // Return text as single chunk if it's already small enough
+    if (text.length() <= static_cast<size_t>(max(0, chunk_size))) {
+        chunks.push_back({0, text.length()});
+        return chunks;
+    }
+
+    // Reserve capacity for better performance
+    size_t step = static_cast<size_t>(max(1, chunk_size - chunk_overlap));
+    chunks.reserve(text.length() / step + 1);
+
+    size_t size = static_cast<size_t>(max(0, chunk_size));
+    size_t overlap = static_cast<size_t>(max(0, chunk_overlap));
+
+    // Try paragraph splitting first (double newlines), then single newlines
+    if (merge_separator_splits(index, "\n\n", size, overlap, chunks) ||
+        merge_separator_splits(index, "\n", size, overlap, chunks)) {
+        return chunks;
+    }
+
+    // Fall back to simple character-based chunks if all else fails. Window
+    // edges move back to code point starts, so no UTF-8 sequence is cut
+    // (for ASCII these are plain byte windows)
+    for (size_t i = 0; i < text.length();) {
+        size_t end = code_point_floor(text, min(i + size, text.length()));
+        if (end <= i) {
+            end = code_point_ceil(text, i + 1);
+        }
+        chunks.push_back({i, end});
+
+        size_t next = code_point_floor(text, i + step);
+        i = next > i ? next : code_point_ceil(text, i + 1);
+    }
+
+    return chunks;
+}
+
+/**
+ * Computes chunk boundaries without copying any text.
+ *
+ * @param text The input text to split
+ * @param chunk_size The target size of each chunk (in characters)
+ * @param chunk_overlap The number of characters to overlap between chunks
+ * @return A vector of [start, end) byte offsets into text
+ */
+vector<TextSpan> split_text_spans(string_view text, int chunk_size, int chunk_overlap) {
+    return split_text_spans(BoundaryIndex(text), chunk_size, chunk_overlap);
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <string_view>
+#include <vector>
+
+#include "text_span.h"
+
+class BoundaryIndex;
+
+/**
+ * The original split_text algorithm: greedily merges paragraphs, then lines,
+ * into chunks of at most chunk_size bytes with chunk_overlap bytes of
+ * overlap, falling back to fixed-size character windows.
+ *
+ * @param index Boundary index of the input text
+ * @param chunk_size The target size of each chunk (in characters)
+ * @param chunk_overlap The number of characters to overlap between chunks
+ * @return A vector of [start, end) byte offsets into the text
+ */
+std::vector<TextSpan> split_text_spans(const BoundaryIndex& index, int chunk_size, int chunk_overlap);
+
+/**
+ * Convenience overload that builds the boundary index itself.
+ */
+std::vector<TextSpan> split_text_spans(std::string_view text, int chunk_size, int chunk_overlap);
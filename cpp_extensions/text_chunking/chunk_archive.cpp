@@ -0,0 +1,435 @@
+#include "chunk_archive.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#include "mapped_file.h"
+
+using namespace std;
+
+namespace {
+
+const char kArchiveMagic[4] = {'C', 'C', 'H', 'A'};
+const uint32_t kArchiveVersion = 1;
+constexpr size_t kHeaderSize = 64;
+constexpr size_t kSectionAlignment = 8;
+constexpr uint32_t kNoValueCode = 0;
+
+struct ArchiveHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t chunk_count;
+    uint64_t offsets_offset;
+    uint64_t text_offset;
+    uint64_t text_size;
+    uint64_t columns_offset;
+    uint32_t column_count;
+    uint32_t has_ids;
+    uint64_t file_size;
+};
+static_assert(sizeof(ArchiveHeader) == kHeaderSize, "header must fill its slot");
+
+struct ColumnDescriptor {
+    uint32_t type;
+    uint32_t name_size;
+    uint64_t name_offset;
+    uint64_t values_offset;
+    uint64_t present_offset;  // 0 when every row has a value
+    uint64_t dictionary_offset;
+    uint64_t dictionary_size;
+    uint64_t strings_offset;
+    uint64_t strings_size;
+};
+static_assert(sizeof(ColumnDescriptor) == 64, "descriptors are 64 bytes");
+
+size_t value_size(ColumnType type) {
+    switch (type) {
+        case ColumnType::Int64:
+        case ColumnType::Float64:
+            return 8;
+        case ColumnType::Bool:
+            return 1;
+        case ColumnType::String:
+            return sizeof(uint32_t);
+    }
+    return 0;
+}
+
+bool valid_type(uint32_t type) {
+    return type >= static_cast<uint32_t>(ColumnType::Int64) && type <= static_cast<uint32_t>(ColumnType::String);
+}
+
+// Appends bytes at the next aligned offset; returns that offset
+uint64_t append_section(string& out, const void* data, size_t size) {
+    out.resize((out.size() + kSectionAlignment - 1) / kSectionAlignment * kSectionAlignment, '\0');
+    const uint64_t offset = out.size();
+    if (size > 0) {
+        out.append(static_cast<const char*>(data), size);
+    }
+    return offset;
+}
+
+[[noreturn]] void corrupt(const char* what) {
+    throw runtime_error(string("Corrupt chunk archive: ") + what);
+}
+
+}  // namespace
+
+const char* column_type_name(ColumnType type) {
+    switch (type) {
+        case ColumnType::Int64:
+            return "int64";
+        case ColumnType::Float64:
+            return "float64";
+        case ColumnType::Bool:
+            return "bool";
+        case ColumnType::String:
+            return "string";
+    }
+    return "unknown";
+}
+
+size_t ChunkArchiveBuilder::add_text(string_view text) {
+    text_.append(text.data(), text.size());
+    offsets_.push_back(text_.size());
+    return size() - 1;
+}
+
+void ChunkArchiveBuilder::add_texts(const PackedChunks& chunks) {
+    const string& bytes = chunks.bytes();
+    const uint64_t base = text_.size();
+    text_.append(bytes);
+    offsets_.reserve(offsets_.size() + chunks.size());
+    for (size_t i = 1; i < chunks.offsets().size(); ++i) {
+        offsets_.push_back(base + chunks.offsets()[i]);
+    }
+}
+
+ChunkArchiveBuilder::Column& ChunkArchiveBuilder::column(const string& name, ColumnType type, size_t row) {
+    if (row >= size()) {
+        throw out_of_range("Chunk row " + to_string(row) + " out of range");
+    }
+    auto found = column_index_.find(name);
+    if (found == column_index_.end()) {
+        found = column_index_.emplace(name, columns_.size()).first;
+        columns_.push_back(Column{name, type, {}, {}, {}, {}});
+    }
+    Column& result = columns_[found->second];
+    if (result.type == ColumnType::Int64 && type == ColumnType::Float64) {
+        for (size_t i = 0; i < result.values.size(); ++i) {
+            const double value = static_cast<double>(static_cast<int64_t>(result.values[i]));
+            memcpy(&result.values[i], &value, sizeof(value));
+        }
+        result.type = ColumnType::Float64;
+    } else if (result.type != type && !(result.type == ColumnType::Float64 && type == ColumnType::Int64)) {
+        throw invalid_argument("Metadata column '" + name + "' holds " + column_type_name(result.type) +
+                               " values, not " + column_type_name(type));
+    }
+    if (result.values.size() <= row) {
+        result.values.resize(size(), 0);
+        result.present.resize(size(), 0);
+    }
+    result.present[row] = 1;
+    return result;
+}
+
+void ChunkArchiveBuilder::set_id(size_t row, string_view id) {
+    if (row >= size()) {
+        throw out_of_range("Chunk row " + to_string(row) + " out of range");
+    }
+    if (!ids_) {
+        ids_ = make_unique<Column>(Column{"", ColumnType::String, {}, {}, {}, {}});
+    }
+    if (ids_->values.size() <= row) {
+        ids_->values.resize(size(), 0);
+        ids_->present.resize(size(), 0);
+    }
+    ids_->present[row] = 1;
+    set_code(*ids_, row, id);
+}
+
+void ChunkArchiveBuilder::set_int64(const string& name, size_t row, int64_t value) {
+    Column& target = column(name, ColumnType::Int64, row);
+    if (target.type == ColumnType::Float64) {
+        set_float64(name, row, static_cast<double>(value));
+        return;
+    }
+    target.values[row] = static_cast<uint64_t>(value);
+}
+
+void ChunkArchiveBuilder::set_float64(const string& name, size_t row, double value) {
+    Column& target = column(name, ColumnType::Float64, row);
+    memcpy(&target.values[row], &value, sizeof(value));
+}
+
+void ChunkArchiveBuilder::set_bool(const string& name, size_t row, bool value) {
+    column(name, ColumnType::Bool, row).values[row] = value ? 1 : 0;
+}
+
+void ChunkArchiveBuilder::set_string(const string& name, size_t row, string_view value) {
+    set_code(column(name, ColumnType::String, row), row, value);
+}
+
+void ChunkArchiveBuilder::set_code(Column& target, size_t row, string_view value) {
+    auto found = target.codes.find(value);
+    if (found == target.codes.end()) {
+        if (target.dictionary.size() >= UINT32_MAX) {
+            throw invalid_argument("Metadata column '" + target.name + "' has too many distinct values");
+        }
+        target.dictionary.emplace_back(value);
+        found = target.codes.emplace(target.dictionary.back(), static_cast<uint32_t>(target.dictionary.size() - 1))
+                    .first;
+    }
+    target.values[row] = found->second;
+}
+
+string ChunkArchiveBuilder::finish() const {
+    const size_t count = size();
+    vector<const Column*> columns;
+    if (ids_) {
+        columns.push_back(ids_.get());
+    }
+    for (const Column& column : columns_) {
+        columns.push_back(&column);
+    }
+
+    // Reserve every section and its padding, so the text is copied once
+    size_t capacity = kHeaderSize + offsets_.size() * sizeof(uint64_t) + text_.size() +
+                      columns.size() * sizeof(ColumnDescriptor) + 4 * kSectionAlignment;
+    for (const Column* column : columns) {
+        capacity += column->name.size() + count * (value_size(column->type) + 1) + 6 * kSectionAlignment;
+        for (const string& value : column->dictionary) {
+            capacity += value.size() + sizeof(uint64_t);
+        }
+    }
+    string out;
+    out.reserve(capacity);
+    out.resize(kHeaderSize, '\0');
+
+    ArchiveHeader header{};
+    memcpy(header.magic, kArchiveMagic, sizeof(kArchiveMagic));
+    header.version = kArchiveVersion;
+    header.chunk_count = count;
+    header.offsets_offset = append_section(out, offsets_.data(), offsets_.size() * sizeof(uint64_t));
+    header.text_offset = append_section(out, text_.data(), text_.size());
+    header.text_size = text_.size();
+    header.column_count = static_cast<uint32_t>(columns.size());
+    header.has_ids = ids_ ? 1 : 0;
+
+    // Descriptors are filled in once the sections after them are placed
+    vector<ColumnDescriptor> descriptors(columns.size());
+    header.columns_offset = append_section(out, descriptors.data(), descriptors.size() * sizeof(ColumnDescriptor));
+
+    vector<uint8_t> present;
+    vector<char> values;
+    for (size_t c = 0; c < columns.size(); ++c) {
+        const Column& column = *columns[c];
+        ColumnDescriptor& descriptor = descriptors[c];
+        descriptor.type = static_cast<uint32_t>(column.type);
+        descriptor.name_size = static_cast<uint32_t>(column.name.size());
+        descriptor.name_offset = append_section(out, column.name.data(), column.name.size());
+
+        // Rows added after the column's last value have none
+        const size_t item = value_size(column.type);
+        values.assign(count * item, 0);
+        for (size_t row = 0; row < column.values.size(); ++row) {
+            if (!column.present[row]) {
+                continue;
+            }
+            if (column.type == ColumnType::String) {
+                const uint32_t code = static_cast<uint32_t>(column.values[row]);
+                memcpy(values.data() + row * item, &code, item);
+            } else if (column.type == ColumnType::Bool) {
+                values[row] = static_cast<char>(column.values[row]);
+            } else {
+                memcpy(values.data() + row * item, &column.values[row], item);
+            }
+        }
+        descriptor.values_offset = append_section(out, values.data(), values.size());
+
+        present.assign(column.present.begin(), column.present.end());
+        present.resize(count, 0);
+        bool complete = true;
+        for (uint8_t flag : present) {
+            complete = complete && flag;
+        }
+        descriptor.present_offset = complete ? 0 : append_section(out, present.data(), present.size());
+
+        if (column.type == ColumnType::String) {
+            vector<uint64_t> dictionary{0};
+            dictionary.reserve(column.dictionary.size() + 1);
+            for (const string& value : column.dictionary) {
+                dictionary.push_back(dictionary.back() + value.size());
+            }
+            descriptor.dictionary_size = column.dictionary.size();
+            descriptor.dictionary_offset = append_section(out, dictionary.data(),
+                                                          dictionary.size() * sizeof(uint64_t));
+            descriptor.strings_size = dictionary.back();
+            descriptor.strings_offset = append_section(out, nullptr, 0);
+            for (const string& value : column.dictionary) {
+                out.append(value);
+            }
+        }
+    }
+
+    out.resize((out.size() + kSectionAlignment - 1) / kSectionAlignment * kSectionAlignment, '\0');
+    header.file_size = out.size();
+    memcpy(&out[0], &header, sizeof(header));
+    if (!descriptors.empty()) {
+        memcpy(&out[header.columns_offset], descriptors.data(), descriptors.size() * sizeof(ColumnDescriptor));
+    }
+    return out;
+}
+
+ChunkArchive::ChunkArchive(string bytes) : owned_(move(bytes)) {
+    data_ = owned_.data();
+    size_ = owned_.size();
+    open();
+}
+
+ChunkArchive::ChunkArchive(const char* data, size_t size, shared_ptr<const void> owner) {
+    // Column values are read as u64/f64/u32 in place
+    if (reinterpret_cast<uintptr_t>(data) % kSectionAlignment != 0) {
+        owned_.assign(data, size);
+        data_ = owned_.data();
+    } else {
+        owner_ = move(owner);
+        data_ = data;
+    }
+    size_ = size;
+    open();
+}
+
+unique_ptr<ChunkArchive> ChunkArchive::load(const string& path) {
+    auto mapped = make_shared<MappedFile>(path);
+    if (mapped->size() < sizeof(kArchiveMagic) || memcmp(mapped->data(), kArchiveMagic, sizeof(kArchiveMagic)) != 0) {
+        throw runtime_error(path + " is not a chunk archive");
+    }
+    const char* data = mapped->data();
+    const size_t size = mapped->size();
+    return make_unique<ChunkArchive>(data, size, move(mapped));
+}
+
+void ChunkArchive::save(const string& path) const {
+    // Write next to the target and rename, so readers never see a partial file
+    const string temp_path = path + ".tmp";
+    {
+        ofstream out(temp_path, ios::binary | ios::trunc);
+        if (!out) {
+            throw runtime_error("Failed to open " + temp_path + " for writing");
+        }
+        out.write(data_, static_cast<streamsize>(size_));
+        if (!out.flush()) {
+            throw runtime_error("Failed to write " + temp_path);
+        }
+    }
+    if (rename(temp_path.c_str(), path.c_str()) != 0) {
+        std::remove(temp_path.c_str());
+        throw runtime_error("Failed to replace " + path);
+    }
+}
+
+const ChunkColumn* ChunkArchive::find_column(string_view name) const {
+    for (const ChunkColumn& column : columns_) {
+        if (column.name() == name) {
+            return &column;
+        }
+    }
+    return nullptr;
+}
+
+void ChunkArchive::open() {
+    if (size_ < kHeaderSize) {
+        corrupt("truncated");
+    }
+    ArchiveHeader header;
+    memcpy(&header, data_, sizeof(header));
+    if (memcmp(header.magic, kArchiveMagic, sizeof(kArchiveMagic)) != 0) {
+        throw runtime_error("Not a chunk archive");
+    }
+    if (header.version != kArchiveVersion) {
+        throw runtime_error("Unsupported chunk archive version " + to_string(header.version));
+    }
+    if (header.file_size != size_) {
+        corrupt("truncated");
+    }
+
+    // Start of count items of item_size at offset, checked against the buffer
+    auto section = [&](uint64_t offset, uint64_t count, size_t item_size) {
+        if (offset % kSectionAlignment != 0 || offset < kHeaderSize || offset > size_ ||
+            count > (size_ - offset) / item_size) {
+            corrupt("section out of bounds");
+        }
+        return data_ + offset;
+    };
+
+    count_ = header.chunk_count;
+    if (count_ >= SIZE_MAX / sizeof(uint64_t)) {
+        corrupt("bad chunk count");
+    }
+    offsets_ = reinterpret_cast<const uint64_t*>(section(header.offsets_offset, count_ + 1, sizeof(uint64_t)));
+    text_ = section(header.text_offset, header.text_size, 1);
+    if (offsets_[0] != 0 || offsets_[count_] != header.text_size) {
+        corrupt("bad chunk offsets");
+    }
+    for (size_t row = 0; row < count_; ++row) {
+        if (offsets_[row + 1] < offsets_[row]) {
+            corrupt("bad chunk offsets");
+        }
+    }
+
+    if (header.has_ids > 1 || header.column_count < header.has_ids) {
+        corrupt("bad header");
+    }
+    const char* table = section(header.columns_offset, header.column_count, sizeof(ColumnDescriptor));
+    columns_.clear();
+    columns_.reserve(header.column_count);
+    for (uint32_t c = 0; c < header.column_count; ++c) {
+        ColumnDescriptor descriptor;
+        memcpy(&descriptor, table + c * sizeof(ColumnDescriptor), sizeof(descriptor));
+        if (!valid_type(descriptor.type)) {
+            corrupt("unknown column type");
+        }
+        ChunkColumn column;
+        column.type_ = static_cast<ColumnType>(descriptor.type);
+        column.name_ = string_view(section(descriptor.name_offset, descriptor.name_size, 1), descriptor.name_size);
+        column.values_ = section(descriptor.values_offset, count_, value_size(column.type_));
+        if (descriptor.present_offset != 0) {
+            column.present_ = reinterpret_cast<const uint8_t*>(section(descriptor.present_offset, count_, 1));
+        }
+
+        if (column.type_ == ColumnType::String) {
+            if (descriptor.dictionary_size >= UINT32_MAX) {
+                corrupt("bad dictionary");
+            }
+            column.dictionary_ = reinterpret_cast<const uint64_t*>(
+                section(descriptor.dictionary_offset, descriptor.dictionary_size + 1, sizeof(uint64_t)));
+            column.strings_ = section(descriptor.strings_offset, descriptor.strings_size, 1);
+            if (column.dictionary_[0] != 0 || column.dictionary_[descriptor.dictionary_size] != descriptor.strings_size) {
+                corrupt("bad dictionary");
+            }
+            for (size_t i = 0; i < descriptor.dictionary_size; ++i) {
+                if (column.dictionary_[i + 1] < column.dictionary_[i]) {
+                    corrupt("bad dictionary");
+                }
+            }
+            const uint32_t* codes = static_cast<const uint32_t*>(column.values_);
+            for (size_t row = 0; row < count_; ++row) {
+                if (column.present(row) ? codes[row] >= descriptor.dictionary_size : codes[row] != kNoValueCode) {
+                    corrupt("bad dictionary code");
+                }
+            }
+        }
+
+        if (c == 0 && header.has_ids) {
+            if (column.type_ != ColumnType::String) {
+                corrupt("bad id column");
+            }
+            ids_ = make_unique<ChunkColumn>(column);
+        } else {
+            columns_.push_back(column);
+        }
+    }
+}
@@ -0,0 +1,187 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "packed_chunks.h"
+
+enum class ColumnType : uint32_t {
+    Int64 = 1,
+    Float64 = 2,
+    Bool = 3,
+    String = 4,
+};
+
+/** "int64", "float64", "bool" or "string". */
+const char* column_type_name(ColumnType type);
+
+/**
+ * Accumulates chunks, their ids and typed metadata columns for a
+ * ChunkArchive. Columns are created by the first value set; a row that never
+ * gets a value of a column has none (metadata(i) omits the key). String
+ * columns are dictionary-encoded, so metadata repeated on every chunk of a
+ * document is stored once.
+ */
+class ChunkArchiveBuilder {
+public:
+    /** Appends a chunk; returns its row. */
+    size_t add_text(std::string_view text);
+
+    /** Appends every chunk of chunks. */
+    void add_texts(const PackedChunks& chunks);
+
+    size_t size() const { return offsets_.size() - 1; }
+
+    void set_id(size_t row, std::string_view id);
+
+    /**
+     * Sets a metadata value of a row added before.
+     *
+     * @throws std::invalid_argument if the column holds another type; an
+     *         int64 column takes float64 values by becoming float64
+     */
+    void set_int64(const std::string& column, size_t row, int64_t value);
+    void set_float64(const std::string& column, size_t row, double value);
+    void set_bool(const std::string& column, size_t row, bool value);
+    void set_string(const std::string& column, size_t row, std::string_view value);
+
+    /** Encodes the archive, see ChunkArchive for the layout. */
+    std::string finish() const;
+
+private:
+    struct Column {
+        std::string name;
+        ColumnType type;
+        std::vector<uint64_t> values;  // int64, float64 bits, bool or dictionary code per row
+        std::vector<uint8_t> present;
+        std::deque<std::string> dictionary;  // stable storage for the keys of codes
+        std::unordered_map<std::string_view, uint32_t> codes;
+    };
+
+    Column& column(const std::string& name, ColumnType type, size_t row);
+    void set_code(Column& column, size_t row, std::string_view value);
+
+    std::string text_;
+    std::vector<uint64_t> offsets_{0};
+    std::deque<Column> columns_;  // never relocated: codes keys view the dictionaries
+    std::unordered_map<std::string, size_t> column_index_;
+    std::unique_ptr<Column> ids_;
+};
+
+/**
+ * Read-only view of one metadata column of a ChunkArchive.
+ */
+class ChunkColumn {
+public:
+    std::string_view name() const { return name_; }
+    ColumnType type() const { return type_; }
+
+    bool present(size_t row) const { return !present_ || present_[row] != 0; }
+
+    /** Per-row presence flags, nullptr when every row has a value. */
+    const uint8_t* presence() const { return present_; }
+
+    /** Values of an int64, float64 or bool column, one per row (0 where absent). */
+    const void* values() const { return values_; }
+
+    int64_t int64(size_t row) const { return static_cast<const int64_t*>(values_)[row]; }
+    double float64(size_t row) const { return static_cast<const double*>(values_)[row]; }
+    bool boolean(size_t row) const { return static_cast<const uint8_t*>(values_)[row] != 0; }
+
+    /** Value of a string column; requires present(row). */
+    std::string_view string(size_t row) const {
+        const uint32_t code = static_cast<const uint32_t*>(values_)[row];
+        return std::string_view(strings_ + dictionary_[code], dictionary_[code + 1] - dictionary_[code]);
+    }
+
+private:
+    friend class ChunkArchive;
+
+    std::string_view name_;
+    ColumnType type_;
+    const void* values_ = nullptr;
+    const uint8_t* present_ = nullptr;
+    const uint64_t* dictionary_ = nullptr;
+    const char* strings_ = nullptr;
+};
+
+/**
+ * Versioned binary container of chunks: every chunk's UTF-8 text back to
+ * back in one blob with an offset table, optional chunk ids and typed
+ * metadata columns. Opening one validates the layout once and then reads
+ * every chunk and value in place, so an archive handed to another process
+ * (as bytes, a file or shared memory) costs a copy of its bytes rather than
+ * a string and dict per chunk.
+ *
+ * Layout, native byte order (all supported targets are little-endian), with
+ * every section 8-byte aligned: a 64-byte header, the chunk offsets (u64 per
+ * chunk plus one), the text blob, the 64-byte column descriptors (the id
+ * column first when there is one), then each column's name, values (int64,
+ * float64, u8 bool or u32 dictionary code per row), presence bytes when some
+ * rows lack a value, and for strings the dictionary offsets and bytes.
+ */
+class ChunkArchive {
+public:
+    /** Takes ownership of encoded archive bytes. @throws std::runtime_error if corrupt */
+    explicit ChunkArchive(std::string bytes);
+
+    /**
+     * Reads the archive in data, which owner keeps alive. Data that is not
+     * 8-byte aligned is copied first.
+     *
+     * @throws std::runtime_error if corrupt
+     */
+    ChunkArchive(const char* data, size_t size, std::shared_ptr<const void> owner);
+
+    ChunkArchive(const ChunkArchive&) = delete;
+    ChunkArchive& operator=(const ChunkArchive&) = delete;
+
+    /** Maps an archive written by save(). */
+    static std::unique_ptr<ChunkArchive> load(const std::string& path);
+
+    /** Writes the archive bytes to a temporary file renamed over path. */
+    void save(const std::string& path) const;
+
+    size_t size() const { return count_; }
+
+    std::string_view text(size_t row) const {
+        return std::string_view(text_ + offsets_[row], offsets_[row + 1] - offsets_[row]);
+    }
+
+    /** size() + 1 byte offsets into text_bytes(). */
+    const uint64_t* text_offsets() const { return offsets_; }
+    std::string_view text_bytes() const { return std::string_view(text_, offsets_[count_]); }
+
+    bool has_ids() const { return ids_ != nullptr; }
+
+    /** Chunk ids as a string column; requires has_ids(). */
+    const ChunkColumn& ids() const { return *ids_; }
+
+    const std::vector<ChunkColumn>& columns() const { return columns_; }
+
+    /** The column called name, nullptr if there is none. */
+    const ChunkColumn* find_column(std::string_view name) const;
+
+    /** The encoded archive. */
+    std::string_view bytes() const { return std::string_view(data_, size_); }
+
+private:
+    void open();
+
+    std::string owned_;
+    std::shared_ptr<const void> owner_;
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+
+    size_t count_ = 0;
+    const uint64_t* offsets_ = nullptr;
+    const char* text_ = nullptr;
+    std::vector<ChunkColumn> columns_;
+    std::unique_ptr<ChunkColumn> ids_;
+};
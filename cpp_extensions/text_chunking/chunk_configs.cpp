@@ -0,0 +1,57 @@
+#include "chunk_configs.h"
+#include "chunking_engine.h"
+
+using namespace std;
+
+namespace {
+
+using DefaultSeparators = SeparatorSet<ParagraphSeparator, LineSeparator, SpaceSeparator, CharacterSeparator>;
+using SentenceSeparators =
+    SeparatorSet<ParagraphSeparator, LineSeparator, SentenceSeparator, SpaceSeparator, CharacterSeparator>;
+using WordSeparators = SeparatorSet<ParagraphSeparator, LineSeparator, WhitespaceSeparator>;
+using TranscriptWordSeparators = SeparatorSet<SentenceSeparator, WhitespaceSeparator>;
+using TranscriptTokenSeparators = SeparatorSet<SentenceSeparator, SpaceSeparator, CharacterSeparator>;
+
+template <typename Separators, typename Unit>
+vector<TextSpan> split_without_encoder(string_view text, int chunk_size, int chunk_overlap) {
+    return chunk_overlap > 0 ? split_with_engine<Separators, Unit, true>(text, chunk_size, chunk_overlap, nullptr)
+                             : split_with_engine<Separators, Unit, false>(text, chunk_size, chunk_overlap, nullptr);
+}
+
+template <typename Separators, typename Unit>
+ChunkConfig make_config(string name) {
+    SpanSplitter span_splitter = nullptr;
+    if constexpr (!Unit::needs_encoder) {
+        span_splitter = &split_without_encoder<Separators, Unit>;
+    }
+    return ChunkConfig{move(name),
+                       Unit::name,
+                       Separators::names(),
+                       Unit::needs_encoder,
+                       &split_with_engine<Separators, Unit, true>,
+                       &split_with_engine<Separators, Unit, false>,
+                       span_splitter};
+}
+
+}  // namespace
+
+const vector<ChunkConfig>& chunk_configs() {
+    static const vector<ChunkConfig> configs = {
+        make_config<DefaultSeparators, CharUnit>("recursive"),
+        make_config<SentenceSeparators, CharUnit>("sentences"),
+        make_config<WordSeparators, WordUnit>("recursive_words"),
+        make_config<TranscriptWordSeparators, WordUnit>("transcript_words"),
+        make_config<DefaultSeparators, TokenUnit>("recursive_tokens"),
+        make_config<TranscriptTokenSeparators, TokenUnit>("transcript_tokens"),
+    };
+    return configs;
+}
+
+const ChunkConfig* find_chunk_config(string_view name) {
+    for (const ChunkConfig& config : chunk_configs()) {
+        if (config.name == name) {
+            return &config;
+        }
+    }
+    return nullptr;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "chunking_methods.h"
+#include "text_span.h"
+
+class BpeEncoder;
+
+/**
+ * Splitter of a chunk configuration; encoder is required when the
+ * configuration counts tokens and ignored otherwise.
+ */
+using ConfigSplitter = std::vector<TextSpan> (*)(std::string_view text, int chunk_size, int chunk_overlap,
+                                                 const BpeEncoder* encoder);
+
+/**
+ * A prebuilt ChunkingEngine configuration. Each one is compiled twice, with
+ * and without overlap, and split() picks the variant from chunk_overlap.
+ */
+struct ChunkConfig {
+    std::string name;
+    std::string unit;  // "chars", "words" or "tokens"
+    std::vector<std::string> separators;  // most significant first; "whitespace" is any ASCII whitespace byte
+    bool needs_encoder;
+    ConfigSplitter overlapping;
+    ConfigSplitter disjoint;
+    SpanSplitter span_splitter;  // split() without an encoder, nullptr if needs_encoder
+
+    std::vector<TextSpan> split(std::string_view text, int chunk_size, int chunk_overlap,
+                                const BpeEncoder* encoder = nullptr) const {
+        return (chunk_overlap > 0 ? overlapping : disjoint)(text, chunk_size, chunk_overlap, encoder);
+    }
+};
+
+/**
+ * The prebuilt configurations:
+ *   "recursive"         - "\n\n", "\n", " ", "" in characters (split_text_recursive's defaults)
+ *   "sentences"         - "\n\n", "\n", ". ", " ", "" in characters, periods ending their sentence
+ *   "recursive_words"   - "\n\n", "\n", whitespace in words, never cutting inside a word
+ *   "transcript_words"  - ". ", whitespace in words, for normalized transcripts, which have no line breaks
+ *   "recursive_tokens"  - "\n\n", "\n", " ", "" in BPE tokens
+ *   "transcript_tokens" - ". ", " ", "" in BPE tokens
+ */
+const std::vector<ChunkConfig>& chunk_configs();
+
+/** The configuration called name, nullptr if there is none. */
+const ChunkConfig* find_chunk_config(std::string_view name);
@@ -0,0 +1,318 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <vector>
+
+#include "boundary_scanner.h"
+#include "bpe_tokenizer.h"
+#include "text_span.h"
+#include "utf8.h"
+
+// Separator levels: name is the separator as chunk_configs() lists it,
+// length the bytes a match covers and cut where in a match the text is cut,
+// so the separator starts the next piece (cut 0), as in
+// RecursiveCharacterTextSplitter, or partly ends the previous one
+
+/** "\n\n", located through the paragraph mask. */
+struct ParagraphSeparator {
+    static constexpr std::string_view name = "\n\n";
+    static constexpr size_t length = 2;
+    static constexpr size_t cut = 0;
+    static size_t find(const BoundaryIndex& index, size_t from, size_t end) {
+        return index.find_matching<&BoundaryBlock::paragraph>(from, end, [end](size_t pos) { return pos + 2 <= end; });
+    }
+};
+
+/** "\n", located through the newline mask. */
+struct LineSeparator {
+    static constexpr std::string_view name = "\n";
+    static constexpr size_t length = 1;
+    static constexpr size_t cut = 0;
+    static size_t find(const BoundaryIndex& index, size_t from, size_t end) {
+        return index.find_matching<&BoundaryBlock::newline>(from, end, [](size_t) { return true; });
+    }
+};
+
+/** ". ", sentence-end candidates followed by a space; the period stays with its sentence. */
+struct SentenceSeparator {
+    static constexpr std::string_view name = ". ";
+    static constexpr size_t length = 2;
+    static constexpr size_t cut = 1;
+    static size_t find(const BoundaryIndex& index, size_t from, size_t end) {
+        const std::string_view source = index.text();
+        return index.find_matching<&BoundaryBlock::sentence_end>(from, end, [source, end](size_t pos) {
+            return pos + 2 <= end && source[pos] == '.' && source[pos + 1] == ' ';
+        });
+    }
+};
+
+/** " ", whitespace candidates that are a space. */
+struct SpaceSeparator {
+    static constexpr std::string_view name = " ";
+    static constexpr size_t length = 1;
+    static constexpr size_t cut = 0;
+    static size_t find(const BoundaryIndex& index, size_t from, size_t end) {
+        const std::string_view source = index.text();
+        return index.find_matching<&BoundaryBlock::whitespace>(from, end, [source](size_t pos) {
+            return source[pos] == ' ';
+        });
+    }
+};
+
+/** Any ASCII whitespace byte, so word-sized pieces never hold two words. */
+struct WhitespaceSeparator {
+    static constexpr std::string_view name = "whitespace";
+    static constexpr size_t length = 1;
+    static constexpr size_t cut = 0;
+    static size_t find(const BoundaryIndex& index, size_t from, size_t end) {
+        return index.find_matching<&BoundaryBlock::whitespace>(from, end, [](size_t) { return true; });
+    }
+};
+
+/** "", splitting into code points; must be the last level of a set. */
+struct CharacterSeparator {
+    static constexpr std::string_view name = "";
+    static constexpr size_t length = 0;
+    static constexpr size_t cut = 0;
+};
+
+/** Separator hierarchy, most significant first. */
+template <typename... Levels>
+struct SeparatorSet {
+    static constexpr size_t size = sizeof...(Levels);
+    static_assert(size > 0, "a separator set needs at least one level");
+
+    template <size_t Level>
+    using level = std::tuple_element_t<Level, std::tuple<Levels...>>;
+
+    static std::vector<std::string> names() { return {std::string(Levels::name)...}; }
+};
+
+/** Chunk sizes in Unicode code points, as RecursiveCharacterTextSplitter counts them. */
+struct CharUnit {
+    static constexpr const char* name = "chars";
+    static constexpr bool needs_encoder = false;
+
+    CharUnit(const BoundaryIndex&, const BpeEncoder*) {}
+
+    size_t measure(std::string_view text, size_t start, size_t end) const {
+        return code_point_length(text.substr(start, end - start));
+    }
+};
+
+/** Chunk sizes in whitespace-delimited words starting inside the piece. */
+struct WordUnit {
+    static constexpr const char* name = "words";
+    static constexpr bool needs_encoder = false;
+
+    WordUnit(const BoundaryIndex& index, const BpeEncoder*) : index_(index) {}
+
+    size_t measure(std::string_view, size_t start, size_t end) const { return index_.count_words(start, end); }
+
+    const BoundaryIndex& index_;
+};
+
+/** Chunk sizes in BPE tokens of an encoder, summed over pieces. */
+struct TokenUnit {
+    static constexpr const char* name = "tokens";
+    static constexpr bool needs_encoder = true;
+
+    TokenUnit(const BoundaryIndex&, const BpeEncoder* encoder) : encoder_(*encoder) {}
+
+    size_t measure(std::string_view text, size_t start, size_t end) const {
+        return encoder_.count_tokens(text.substr(start, end - start));
+    }
+
+    const BpeEncoder& encoder_;
+};
+
+/**
+ * Trims Python whitespace (str.strip()) off both ends of a span.
+ */
+inline TextSpan strip_whitespace_span(std::string_view text, TextSpan span) {
+    size_t length = 0;
+    while (span.start < span.end && is_python_whitespace(decode_code_point(text, span.start, length))) {
+        span.start += length;
+    }
+    while (span.end > span.start) {
+        size_t last = span.end - 1;
+        while (last > span.start && is_utf8_continuation(static_cast<unsigned char>(text[last]))) {
+            --last;
+        }
+        if (!is_python_whitespace(decode_code_point(text, last, length)) || last + length != span.end) {
+            break;
+        }
+        span.end = last;
+    }
+    return span;
+}
+
+/**
+ * The split_text_recursive_spans algorithm compiled for one configuration:
+ * the separator hierarchy, the unit chunk sizes are measured in and whether
+ * chunks overlap are template parameters, so each configuration gets its own
+ * inner loops with the separator searches and length measure inlined and no
+ * per-piece policy branches. With CharUnit and the default separators it
+ * produces the same chunks as split_text_recursive_spans. Without Overlap,
+ * chunk_overlap is ignored and merging restarts after every emitted chunk.
+ *
+ * chunk_configs.h registers the prebuilt configurations.
+ */
+template <typename Separators, typename Unit, bool Overlap>
+class ChunkingEngine {
+public:
+    ChunkingEngine(const BoundaryIndex& index, const Unit& unit, size_t chunk_size, size_t chunk_overlap,
+                   std::vector<TextSpan>& chunks)
+        : index_(index), text_(index.text()), unit_(unit), chunk_size_(chunk_size),
+          chunk_overlap_(chunk_overlap), chunks_(chunks) {}
+
+    void split(size_t start, size_t end) { split_level<0>(start, end); }
+
+private:
+    struct Piece {
+        size_t start;
+        size_t end;
+        size_t length;  // in Unit
+    };
+
+    // Cuts [start, end) at the first level from Level on that occurs in it
+    template <size_t Level>
+    void split_level(size_t start, size_t end) {
+        std::vector<Piece> good_pieces;
+        if constexpr (Level == Separators::size) {
+            // No separator occurs: the piece stays whole
+            handle_piece<Level>(good_pieces, start, end);
+        } else {
+            using Separator = typename Separators::template level<Level>;
+            if constexpr (Separator::length == 0) {
+                static_assert(Level + 1 == Separators::size, "CharacterSeparator must be the last level");
+                for (size_t pos = start; pos < end;) {
+                    size_t next = pos + 1;
+                    while (next < end && is_utf8_continuation(static_cast<unsigned char>(text_[next]))) {
+                        ++next;
+                    }
+                    handle_piece<Separators::size>(good_pieces, pos, next);
+                    pos = next;
+                }
+            } else {
+                size_t match = Separator::find(index_, start, end);
+                if (match == BoundaryIndex::npos) {
+                    split_level<Level + 1>(start, end);
+                    return;
+                }
+                size_t piece_start = start;
+                for (; match != BoundaryIndex::npos; match = Separator::find(index_, match + Separator::length, end)) {
+                    handle_piece<Level + 1>(good_pieces, piece_start, match + Separator::cut);
+                    piece_start = match + Separator::cut;
+                }
+                handle_piece<Level + 1>(good_pieces, piece_start, end);
+            }
+        }
+        if (!good_pieces.empty()) {
+            merge(good_pieces);
+        }
+    }
+
+    template <size_t Next>
+    void handle_piece(std::vector<Piece>& good_pieces, size_t start, size_t end) {
+        if (start == end) {
+            return;
+        }
+        const size_t length = unit_.measure(text_, start, end);
+        if (length < chunk_size_) {
+            good_pieces.push_back({start, end, length});
+            return;
+        }
+        if (!good_pieces.empty()) {
+            merge(good_pieces);
+            good_pieces.clear();
+        }
+        if constexpr (Next >= Separators::size) {
+            chunks_.push_back({start, end});
+        } else {
+            split_level<Next>(start, end);
+        }
+    }
+
+    void emit(size_t start, size_t end) {
+        TextSpan span = strip_whitespace_span(text_, {start, end});
+        if (span.end > span.start) {
+            chunks_.push_back(span);
+        }
+    }
+
+    // Greedily packs adjacent pieces into chunks of at most chunk_size units,
+    // carrying up to chunk_overlap units of trailing pieces into the next one
+    void merge(const std::vector<Piece>& pieces) {
+        size_t first = 0;
+        size_t total = 0;
+        for (size_t i = 0; i < pieces.size(); ++i) {
+            const size_t length = pieces[i].length;
+            if (total + length > chunk_size_ && i > first) {
+                emit(pieces[first].start, pieces[i - 1].end);
+                if constexpr (Overlap) {
+                    while (total > chunk_overlap_ || (total + length > chunk_size_ && total > 0)) {
+                        total -= pieces[first].length;
+                        ++first;
+                    }
+                } else {
+                    first = i;
+                    total = 0;
+                }
+            }
+            total += length;
+        }
+        if (pieces.size() > first) {
+            emit(pieces[first].start, pieces.back().end);
+        }
+    }
+
+    const BoundaryIndex& index_;
+    std::string_view text_;
+    Unit unit_;
+    size_t chunk_size_;
+    size_t chunk_overlap_;
+    std::vector<TextSpan>& chunks_;
+};
+
+/**
+ * Splits text with one configuration; encoder is required for TokenUnit and
+ * ignored otherwise.
+ *
+ * @throws std::invalid_argument for sizes split_text_recursive_spans rejects
+ */
+template <typename Separators, typename Unit, bool Overlap>
+std::vector<TextSpan> split_with_engine(std::string_view text, int chunk_size, int chunk_overlap,
+                                        const BpeEncoder* encoder) {
+    if (chunk_size <= 0) {
+        throw std::invalid_argument("chunk_size must be > 0, got " + std::to_string(chunk_size));
+    }
+    if (chunk_overlap < 0) {
+        throw std::invalid_argument("chunk_overlap must be >= 0, got " + std::to_string(chunk_overlap));
+    }
+    if (chunk_overlap > chunk_size) {
+        throw std::invalid_argument("Got a larger chunk overlap (" + std::to_string(chunk_overlap) +
+                                    ") than chunk size (" + std::to_string(chunk_size) + "), should be smaller.");
+    }
+    if constexpr (Unit::needs_encoder) {
+        if (!encoder) {
+            throw std::invalid_argument(std::string("Chunking in ") + Unit::name + " requires an encoder");
+        }
+    }
+
+    std::vector<TextSpan> chunks;
+    if (text.empty()) {
+        return chunks;
+    }
+    chunks.reserve(text.length() / static_cast<size_t>(std::max(1, chunk_size - chunk_overlap)) + 1);
+    BoundaryIndex index(text);
+    const Unit unit(index, encoder);
+    ChunkingEngine<Separators, Unit, Overlap>(index, unit, chunk_size, chunk_overlap, chunks)
+        .split(0, text.length());
+    return chunks;
+}
@@ -0,0 +1,39 @@
+#include "chunking_methods.h"
+#include "boundary_scanner.h"
+#include "char_chunker.h"
+#include "chunk_configs.h"
+#include "recursive_splitter.h"
+#include "unicode_chunker.h"
+#include "word_chunker.h"
+
+#include <stdexcept>
+
+using namespace std;
+
+SpanSplitter span_splitter_for_method(const string& method) {
+    if (method == "recursive") {
+        return [](string_view text, int chunk_size, int chunk_overlap) {
+            return split_text_recursive_spans(text, chunk_size, chunk_overlap, default_recursive_separators());
+        };
+    }
+    if (method == "chars") {
+        return [](string_view text, int chunk_size, int chunk_overlap) {
+            return split_text_spans(text, chunk_size, chunk_overlap);
+        };
+    }
+    if (method == "words") {
+        return [](string_view text, int chunk_size, int chunk_overlap) {
+            return split_words_spans(BoundaryIndex(text), chunk_size, chunk_overlap);
+        };
+    }
+    if (method == "unicode") {
+        return [](string_view text, int chunk_size, int chunk_overlap) {
+            return split_unicode_spans(text, chunk_size, chunk_overlap, CutBoundary::Grapheme, true);
+        };
+    }
+    if (const ChunkConfig* config = find_chunk_config(method); config && config->span_splitter) {
+        return config->span_splitter;
+    }
+    throw invalid_argument("Unknown chunking method '" + method +
+                           "', expected recursive, chars, words, unicode or a chunk config without tokens");
+}
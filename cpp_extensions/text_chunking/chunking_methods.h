@@ -0,0 +1,24 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "text_span.h"
+
+/**
+ * A chunking algorithm selected by name, as used by the batch and pipeline
+ * entry points.
+ */
+using SpanSplitter = std::vector<TextSpan> (*)(std::string_view text, int chunk_size, int chunk_overlap);
+
+/**
+ * Looks up a chunking method:
+ *   "recursive" - split_text_recursive_spans with the default separators
+ *   "chars"     - split_text_spans (the original split_text)
+ *   "words"     - split_words_spans (split_text_with_word_count)
+ *   "unicode"   - split_unicode_spans at grapheme boundaries with sentence segmentation
+ * or any chunk_configs() entry that does not count tokens. Throws
+ * invalid_argument for anything else.
+ */
+SpanSplitter span_splitter_for_method(const std::string& method);
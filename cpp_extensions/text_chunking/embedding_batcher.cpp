@@ -0,0 +1,130 @@
+#include "embedding_batcher.h"
+
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+
+using namespace std;
+
+namespace {
+
+// Max-tree over the remaining token capacity of the open batches, to find
+// the first batch an input fits in logarithmic time. Batches that hold the
+// maximum number of inputs report a capacity of -1.
+class CapacityTree {
+public:
+    explicit CapacityTree(size_t max_batches) {
+        leaves_ = 1;
+        while (leaves_ < max_batches) {
+            leaves_ *= 2;
+        }
+        nodes_.assign(2 * leaves_, -1);
+    }
+
+    void set(size_t batch, int64_t capacity) {
+        size_t node = leaves_ + batch;
+        nodes_[node] = capacity;
+        for (node /= 2; node >= 1; node /= 2) {
+            nodes_[node] = max(nodes_[2 * node], nodes_[2 * node + 1]);
+        }
+    }
+
+    // Leftmost batch with at least tokens capacity, or SIZE_MAX
+    size_t first_fit(int64_t tokens) const {
+        if (nodes_[1] < tokens) {
+            return SIZE_MAX;
+        }
+        size_t node = 1;
+        while (node < leaves_) {
+            node = nodes_[2 * node] >= tokens ? 2 * node : 2 * node + 1;
+        }
+        return node - leaves_;
+    }
+
+private:
+    size_t leaves_;
+    vector<int64_t> nodes_;
+};
+
+}  // namespace
+
+BatchPacking parse_batch_packing(const string& name) {
+    if (name == "ordered") {
+        return BatchPacking::Ordered;
+    }
+    if (name == "first_fit_decreasing") {
+        return BatchPacking::FirstFitDecreasing;
+    }
+    throw invalid_argument("Unknown packing '" + name + "', expected ordered or first_fit_decreasing");
+}
+
+EmbeddingBatches pack_embedding_batches(vector<uint32_t> token_counts, const EmbeddingBatchLimits& limits,
+                                        BatchPacking packing) {
+    if (limits.max_request_tokens == 0 || limits.max_request_inputs == 0 || limits.max_input_tokens == 0) {
+        throw invalid_argument("Embedding batch limits must be positive");
+    }
+    const size_t max_input = min(limits.max_input_tokens, limits.max_request_tokens);
+
+    EmbeddingBatches result;
+    result.token_counts = move(token_counts);
+    const vector<uint32_t>& counts = result.token_counts;
+
+    vector<uint32_t> order;
+    order.reserve(counts.size());
+    for (uint32_t i = 0; i < counts.size(); ++i) {
+        if (counts[i] == 0 || counts[i] > max_input) {
+            result.rejected.push_back(i);
+        } else {
+            order.push_back(i);
+        }
+    }
+
+    if (packing == BatchPacking::Ordered) {
+        for (uint32_t i : order) {
+            if (result.batches.empty() || result.batches.back().size() == limits.max_request_inputs ||
+                result.batch_tokens.back() + counts[i] > limits.max_request_tokens) {
+                result.batches.emplace_back();
+                result.batch_tokens.push_back(0);
+            }
+            result.batches.back().push_back(i);
+            result.batch_tokens.back() += counts[i];
+        }
+        return result;
+    }
+
+    stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return counts[a] > counts[b]; });
+    CapacityTree capacity(order.size());
+    for (uint32_t i : order) {
+        size_t batch = capacity.first_fit(counts[i]);
+        if (batch == SIZE_MAX) {
+            batch = result.batches.size();
+            result.batches.emplace_back();
+            result.batch_tokens.push_back(0);
+        }
+        result.batches[batch].push_back(i);
+        result.batch_tokens[batch] += counts[i];
+        capacity.set(batch, result.batches[batch].size() == limits.max_request_inputs
+                                ? -1
+                                : static_cast<int64_t>(limits.max_request_tokens - result.batch_tokens[batch]));
+    }
+
+    // Restore reading order within and across batches
+    for (vector<uint32_t>& batch : result.batches) {
+        sort(batch.begin(), batch.end());
+    }
+    vector<size_t> by_first(result.batches.size());
+    iota(by_first.begin(), by_first.end(), 0);
+    sort(by_first.begin(), by_first.end(),
+         [&](size_t a, size_t b) { return result.batches[a][0] < result.batches[b][0]; });
+    vector<vector<uint32_t>> batches;
+    vector<uint64_t> batch_tokens;
+    batches.reserve(by_first.size());
+    batch_tokens.reserve(by_first.size());
+    for (size_t b : by_first) {
+        batches.push_back(move(result.batches[b]));
+        batch_tokens.push_back(result.batch_tokens[b]);
+    }
+    result.batches = move(batches);
+    result.batch_tokens = move(batch_tokens);
+    return result;
+}
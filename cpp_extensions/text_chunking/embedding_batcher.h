@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * Limits of one embedding request. The defaults are OpenAI's for the
+ * text-embedding-3 models.
+ */
+struct EmbeddingBatchLimits {
+    size_t max_request_tokens = 300000;
+    size_t max_request_inputs = 2048;
+    size_t max_input_tokens = 8191;
+};
+
+enum class BatchPacking {
+    Ordered,             // consecutive inputs fill a request before the next one starts
+    FirstFitDecreasing,  // largest inputs first, each into the first request it fits
+};
+
+/**
+ * Parses "ordered" or "first_fit_decreasing"; throws invalid_argument for anything else.
+ */
+BatchPacking parse_batch_packing(const std::string& name);
+
+/**
+ * Inputs grouped into embedding requests. Every input is in exactly one
+ * batch or in rejected.
+ */
+struct EmbeddingBatches {
+    std::vector<std::vector<uint32_t>> batches;  // input indices, ascending within a batch
+    std::vector<uint64_t> batch_tokens;          // token total of every batch
+    std::vector<uint32_t> rejected;              // empty inputs and inputs over max_input_tokens
+    std::vector<uint32_t> token_counts;          // tokens of every input
+};
+
+/**
+ * Packs inputs with the given token counts into as few requests as the
+ * packing allows, none over limits. "Ordered" packing is optimal among
+ * packings that keep inputs contiguous; first-fit decreasing usually needs
+ * fewer requests and lists batches by their first input. Inputs no request
+ * can carry (empty, or over max_input_tokens or max_request_tokens) are
+ * rejected so the caller can re-split them.
+ *
+ * @throws std::invalid_argument if a limit is zero
+ */
+EmbeddingBatches pack_embedding_batches(std::vector<uint32_t> token_counts, const EmbeddingBatchLimits& limits,
+                                        BatchPacking packing);
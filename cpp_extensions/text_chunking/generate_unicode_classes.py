@@ -0,0 +1,83 @@
+"""Generate unicode_class_table.inc, the range table of unicode_classes.cpp.
+
+    python generate_unicode_classes.py [UnicodeData.txt] > unicode_class_table.inc
+
+Reads general categories from a UnicodeData.txt of the Unicode Character
+Database, or from Python's unicodedata module without one. Code points not
+listed in the table (unassigned ones included) are Other; ASCII and
+White_Space are handled in code.
+"""
+import sys
+import unicodedata
+
+CLASSES = {
+    "Lu": "Upper", "Lt": "Upper", "Ll": "Lower", "Lm": "Letter", "Lo": "Letter",
+    "Mn": "Mark", "Mc": "Mark", "Me": "Mark", "Nd": "Number", "Nl": "Number", "No": "Number",
+}
+# Shortest run of alternating upper and lowercase code points folded into one range
+MIN_ALTERNATING_RUN = 4
+
+
+def categories_from_file(path):
+    categories = ["Cn"] * 0x110000
+    range_start = None
+    with open(path, encoding="utf-8") as f:
+        for line in f:
+            fields = line.split(";")
+            cp, name, category = int(fields[0], 16), fields[1], fields[2]
+            if name.endswith(", First>"):
+                range_start = cp
+                continue
+            first = range_start if name.endswith(", Last>") else cp
+            range_start = None
+            for c in range(first, cp + 1):
+                categories[c] = category
+    return categories, "the given UnicodeData.txt"
+
+
+def categories_from_module():
+    categories = [unicodedata.category(chr(cp)) for cp in range(0x110000)]
+    return categories, f"UnicodeData {unicodedata.unidata_version}"
+
+
+def class_runs(categories):
+    runs = []
+    for cp in range(0x80, 0x110000):
+        cls = CLASSES.get(categories[cp], "Other")
+        if runs and runs[-1][2] == cls:
+            runs[-1][1] = cp
+        else:
+            runs.append([cp, cp, cls])
+    return runs
+
+
+def fold_alternating(runs):
+    folded = []
+    i = 0
+    while i < len(runs):
+        j = i
+        while (j < len(runs) and runs[j][0] == runs[j][1] and runs[j][2] in ("Upper", "Lower") and
+               (j == i or runs[j][2] != runs[j - 1][2])):
+            j += 1
+        if j - i >= MIN_ALTERNATING_RUN:
+            first = runs[i][0]
+            upper_even = (runs[i][2] == "Upper") == (first % 2 == 0)
+            folded.append([first, runs[j - 1][1], "UpperEven" if upper_even else "UpperOdd"])
+            i = j
+        else:
+            folded.append(runs[i])
+            i += 1
+    return folded
+
+
+def main():
+    categories, source = categories_from_file(sys.argv[1]) if len(sys.argv) > 1 else categories_from_module()
+    ranges = [r for r in fold_alternating(class_runs(categories)) if r[2] != "Other"]
+    print(f"// Generated by generate_unicode_classes.py from {source}; do not edit.")
+    print("// Sorted, non-overlapping {first, last, class} ranges of code points >= U+0080.")
+    for i in range(0, len(ranges), 4):
+        print(" ".join(f"{{0x{first:04X}, 0x{last:04X}, {cls}}}," for first, last, cls in ranges[i:i + 4]))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,17 @@
+#include "packed_chunks.h"
+
+using namespace std;
+
+PackedChunks::PackedChunks(string_view text, const vector<TextSpan>& spans) {
+    size_t total = 0;
+    for (const TextSpan& span : spans) {
+        total += static_cast<size_t>(span.end - span.start);
+    }
+
+    bytes_.reserve(total);
+    offsets_.reserve(spans.size() + 1);
+    for (const TextSpan& span : spans) {
+        bytes_.append(text.data() + span.start, static_cast<size_t>(span.end - span.start));
+        offsets_.push_back(bytes_.size());
+    }
+}
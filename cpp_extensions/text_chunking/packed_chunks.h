@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "text_span.h"
+
+/**
+ * Chunks stored back to back in one contiguous buffer; chunk i is
+ * bytes()[offsets()[i], offsets()[i + 1]). Overlapping chunks each hold their
+ * own copy of the overlap, so every chunk is contiguous.
+ *
+ * Building it takes two allocations however many chunks there are, where
+ * materialize_spans allocates a string per chunk; long-lived workers that
+ * chunk millions of small texts avoid the allocator churn and fragmentation.
+ */
+class PackedChunks {
+public:
+    PackedChunks() = default;
+
+    /** Copies each span of text into the buffer, in span order. */
+    PackedChunks(std::string_view text, const std::vector<TextSpan>& spans);
+
+    size_t size() const { return offsets_.size() - 1; }
+    bool empty() const { return size() == 0; }
+
+    std::string_view operator[](size_t index) const {
+        return std::string_view(bytes_.data() + offsets_[index],
+                                static_cast<size_t>(offsets_[index + 1] - offsets_[index]));
+    }
+
+    const std::string& bytes() const { return bytes_; }
+
+    /** size() + 1 offsets, starting at 0 and ending at bytes().size(). */
+    const std::vector<uint64_t>& offsets() const { return offsets_; }
+
+private:
+    std::string bytes_;
+    std::vector<uint64_t> offsets_{0};
+};
@@ -0,0 +1,177 @@
+#include "recursive_splitter.h"
+#include "boundary_scanner.h"
+#include "chunk_configs.h"
+#include "chunking_engine.h"
+#include "utf8.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+using namespace std;
+
+const vector<string>& default_recursive_separators() {
+    static const vector<string> separators = {"\n\n", "\n", " ", ""};
+    return separators;
+}
+
+namespace {
+
+struct Piece {
+    size_t start;
+    size_t end;
+    size_t length;  // in code points
+};
+
+class RecursiveSplitter {
+public:
+    RecursiveSplitter(const BoundaryIndex& index, size_t chunk_size, size_t chunk_overlap,
+                      const vector<string>& separators, vector<TextSpan>& chunks)
+        : index_(index), text_(index.text()), chunk_size_(chunk_size), chunk_overlap_(chunk_overlap),
+          separators_(separators), chunks_(chunks) {}
+
+    void split(size_t start, size_t end, size_t first_separator) {
+        // Use the first separator that occurs in this piece; "" always matches
+        size_t chosen = separators_.size() - 1;
+        size_t next_separator = separators_.size();
+        size_t first_match = BoundaryIndex::npos;
+        for (size_t i = first_separator; i < separators_.size(); ++i) {
+            if (separators_[i].empty()) {
+                chosen = i;
+                break;
+            }
+            first_match = index_.find(separators_[i], start, end);
+            if (first_match != BoundaryIndex::npos) {
+                chosen = i;
+                next_separator = i + 1;
+                break;
+            }
+        }
+
+        const string& separator = separators_[chosen];
+        vector<Piece> good_pieces;
+
+        auto handle_piece = [&](size_t piece_start, size_t piece_end) {
+            if (piece_start == piece_end) {
+                return;
+            }
+            size_t length = code_point_length(text_.substr(piece_start, piece_end - piece_start));
+            if (length < chunk_size_) {
+                good_pieces.push_back({piece_start, piece_end, length});
+                return;
+            }
+
+            if (!good_pieces.empty()) {
+                merge(good_pieces);
+                good_pieces.clear();
+            }
+            if (next_separator >= separators_.size()) {
+                chunks_.push_back({piece_start, piece_end});
+            } else {
+                split(piece_start, piece_end, next_separator);
+            }
+        };
+
+        if (separator.empty()) {
+            // Split into individual code points
+            for (size_t pos = start; pos < end;) {
+                size_t next = pos + 1;
+                while (next < end && is_utf8_continuation(static_cast<unsigned char>(text_[next]))) {
+                    ++next;
+                }
+                handle_piece(pos, next);
+                pos = next;
+            }
+        } else if (first_match == BoundaryIndex::npos) {
+            handle_piece(start, end);
+        } else {
+            // Each separator stays attached to the start of the piece that follows it
+            size_t piece_start = start;
+            for (size_t match = first_match; match != BoundaryIndex::npos;
+                 match = index_.find(separator, match + separator.length(), end)) {
+                handle_piece(piece_start, match);
+                piece_start = match;
+            }
+            handle_piece(piece_start, end);
+        }
+
+        if (!good_pieces.empty()) {
+            merge(good_pieces);
+        }
+    }
+
+private:
+    void emit(size_t start, size_t end) {
+        TextSpan span = strip_whitespace_span(text_, {start, end});
+        if (span.end > span.start) {
+            chunks_.push_back(span);
+        }
+    }
+
+    /**
+     * Greedily packs adjacent pieces into chunks of at most chunk_size characters,
+     * carrying up to chunk_overlap characters of trailing pieces into the next chunk.
+     */
+    void merge(const vector<Piece>& pieces) {
+        size_t first = 0;
+        size_t total = 0;
+
+        for (size_t i = 0; i < pieces.size(); ++i) {
+            size_t length = pieces[i].length;
+            if (total + length > chunk_size_) {
+                if (i > first) {
+                    emit(pieces[first].start, pieces[i - 1].end);
+                    while (total > chunk_overlap_ || (total + length > chunk_size_ && total > 0)) {
+                        total -= pieces[first].length;
+                        ++first;
+                    }
+                }
+            }
+            total += length;
+        }
+
+        if (pieces.size() > first) {
+            emit(pieces[first].start, pieces.back().end);
+        }
+    }
+
+    const BoundaryIndex& index_;
+    string_view text_;
+    size_t chunk_size_;
+    size_t chunk_overlap_;
+    const vector<string>& separators_;
+    vector<TextSpan>& chunks_;
+};
+
+}  // namespace
+
+vector<TextSpan> split_text_recursive_spans(string_view text, int chunk_size, int chunk_overlap,
+                                            const vector<string>& separators) {
+    if (chunk_size <= 0) {
+        throw invalid_argument("chunk_size must be > 0, got " + to_string(chunk_size));
+    }
+    if (chunk_overlap < 0) {
+        throw invalid_argument("chunk_overlap must be >= 0, got " + to_string(chunk_overlap));
+    }
+    if (chunk_overlap > chunk_size) {
+        throw invalid_argument("Got a larger chunk overlap (" + to_string(chunk_overlap) +
+                               ") than chunk size (" + to_string(chunk_size) + "), should be smaller.");
+    }
+    if (separators.empty()) {
+        throw invalid_argument("separators must not be empty");
+    }
+
+    // The default hierarchy runs through its compiled configuration
+    if (separators == default_recursive_separators()) {
+        return find_chunk_config("recursive")->split(text, chunk_size, chunk_overlap);
+    }
+
+    vector<TextSpan> chunks;
+    if (text.empty()) {
+        return chunks;
+    }
+
+    chunks.reserve(text.length() / static_cast<size_t>(max(1, chunk_size - chunk_overlap)) + 1);
+    BoundaryIndex index(text);
+    RecursiveSplitter(index, chunk_size, chunk_overlap, separators, chunks).split(0, text.length(), 0);
+    return chunks;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "text_span.h"
+
+/**
+ * The separator hierarchy used by LangChain's RecursiveCharacterTextSplitter:
+ * paragraph, line, word, and finally individual characters ("").
+ */
+const std::vector<std::string>& default_recursive_separators();
+
+/**
+ * Recursively splits text the same way as LangChain's RecursiveCharacterTextSplitter
+ * (keep_separator=True, strip_whitespace=True, length measured in characters).
+ *
+ * The first separator present in a piece is used to cut it; pieces that are still
+ * at least chunk_size characters long are split again with the remaining
+ * separators, and the rest are greedily merged with overlap. Only oversized
+ * pieces are rescanned, so well-formed text is tokenized in a single pass.
+ *
+ * @param text UTF-8 text to split
+ * @param chunk_size Maximum chunk length in Unicode code points
+ * @param chunk_overlap Number of code points to overlap between chunks
+ * @param separators Separator hierarchy, most significant first; "" splits into characters
+ * @return [start, end) byte offsets of each chunk into text
+ */
+std::vector<TextSpan> split_text_recursive_spans(std::string_view text, int chunk_size, int chunk_overlap,
+                                                 const std::vector<std::string>& separators);
@@ -1,198 +1,1086 @@
 #include <pybind11/pybind11.h>
 #include <pybind11/stl.h>
+#include <pybind11/numpy.h>
 #include <string>
+#include <string_view>
 #include <vector>
-#include <regex>
-#include <iostream>
-#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+
+#include "text_span.h"
+#include "recursive_splitter.h"
+#include "boundary_scanner.h"
+#include "word_chunker.h"
+#include "bpe_tokenizer.h"
+#include "token_chunker.h"
+#include "cdc_chunker.h"
+#include "unicode_chunker.h"
+#include "utf8_validation.h"
+#include "char_chunker.h"
+#include "chunking_methods.h"
+#include "chunk_configs.h"
+#include "packed_chunks.h"
+#include "chunk_archive.h"
+#include "transcript_chunker.h"
+#include "embedding_batcher.h"
+#include "thread_pool.h"
+#include "stats.h"
+#include "bindings.h"
 
 namespace py = pybind11;
 using namespace std;
 
 /**
- * Splits text into chunks of specified size with overlap.
- * This is a recursive character splitter implementation that mimics the behavior
- * of RecursiveCharacterTextSplitter from LangChain.
- * 
- * @param text The input text to split
- * @param chunk_size The target size of each chunk (in characters)
- * @param chunk_overlap The number of characters to overlap between chunks
- * @return A vector of text chunks
+ * Metrics reported by text_chunker.get_stats(): "utf8" times borrowing the
+ * UTF-8 bytes of the input, "split" the native chunking (including packing,
+ * for split_text_packed), "marshal" building the Python chunk objects,
+ * "batch" token counting and packing of embedding requests and "archive"
+ * encoding and validating ChunkArchive buffers.
  */
-vector<string> split_text(const string& text, int chunk_size, int chunk_overlap) {
-    vector<string> chunks;
-    
-    // Return text as single chunk if it's already small enough
-    if (text.length() <= static_cast<size_t>(chunk_size)) {
-        chunks.push_back(text);
-        return chunks;
+struct ChunkerStats {
+    StatCounter& calls = stat_counter("text_chunker", "calls");
+    StatCounter& bytes = stat_counter("text_chunker", "bytes");
+    StatCounter& chunks = stat_counter("text_chunker", "chunks");
+    StatHistogram& utf8 = stat_histogram("text_chunker", "utf8");
+    StatHistogram& split = stat_histogram("text_chunker", "split");
+    StatHistogram& marshal = stat_histogram("text_chunker", "marshal");
+    StatHistogram& batch = stat_histogram("text_chunker", "batch");
+    StatHistogram& archive = stat_histogram("text_chunker", "archive");
+};
+
+static ChunkerStats& chunker_stats() {
+    static ChunkerStats stats;
+    return stats;
+}
+
+/**
+ * Word-count variant of split_text_spans: chunks hold exactly chunk_size_words
+ * whitespace-delimited words and overlap by chunk_overlap_words words.
+ */
+vector<TextSpan> split_text_spans_with_word_count(string_view text, int chunk_size_words, int chunk_overlap_words) {
+    return split_words_spans(BoundaryIndex(text), chunk_size_words, chunk_overlap_words);
+}
+
+/**
+ * Borrows the UTF-8 bytes of a Python str or bytes-like object without copying.
+ * For str the view points at CPython's cached UTF-8 representation, which
+ * lives as long as the string object itself; for bytes-like objects the
+ * buffer export is held (which also blocks resizing) until this is destroyed.
+ */
+struct BorrowedText {
+    explicit BorrowedText(const py::object& text) {
+        ScopedTimer timer(chunker_stats().utf8);
+        if (PyUnicode_Check(text.ptr())) {
+            Py_ssize_t size = 0;
+            const char* data = PyUnicode_AsUTF8AndSize(text.ptr(), &size);
+            if (!data) {
+                throw py::error_already_set();
+            }
+            view = string_view(data, static_cast<size_t>(size));
+            return;
+        }
+
+        buffer = py::reinterpret_borrow<py::buffer>(text).request();
+        view = string_view(static_cast<const char*>(buffer.ptr), static_cast<size_t>(buffer.size * buffer.itemsize));
     }
-    
-    // Reserve capacity for better performance
-    size_t estimated_chunks = text.length() / max(1, chunk_size - chunk_overlap) + 1;
-    chunks.reserve(estimated_chunks);
-    
-    // Split by separator - trying double newlines first
-    vector<string> splits;
-    
-    size_t start_pos = 0;
-    size_t next_pos = 0;
-    const string double_newline = "\n\n";
-    
-    // Try paragraph splitting first (double newlines)
-    bool has_paragraph_splits = false;
-    while ((next_pos = text.find(double_newline, start_pos)) != string::npos) {
-        has_paragraph_splits = true;
-        splits.push_back(text.substr(start_pos, next_pos - start_pos));
-        start_pos = next_pos + double_newline.length();
+
+    string_view view;
+    py::buffer_info buffer;
+};
+
+/**
+ * Hands a span vector to NumPy as a read-only (n, 2) uint64 array.
+ * The array takes ownership of the vector's storage, so no copy is made.
+ */
+static py::array_t<uint64_t> spans_to_array(vector<TextSpan>&& spans) {
+    auto* owned = new vector<TextSpan>(std::move(spans));
+    py::capsule owner(owned, [](void* p) { delete static_cast<vector<TextSpan>*>(p); });
+
+    py::array_t<uint64_t> result(
+        {static_cast<py::ssize_t>(owned->size()), static_cast<py::ssize_t>(2)},
+        {static_cast<py::ssize_t>(sizeof(TextSpan)), static_cast<py::ssize_t>(sizeof(uint64_t))},
+        reinterpret_cast<const uint64_t*>(owned->data()),
+        owner
+    );
+    result.attr("setflags")(py::arg("write") = false);
+    return result;
+}
+
+/**
+ * Content-defined chunking: boundaries come from a rolling hash of the text
+ * and snap to whitespace, so they survive edits elsewhere in the document.
+ *
+ * @param min_size Minimum chunk size in bytes
+ * @param avg_size Target average chunk size in bytes
+ * @param max_size Maximum chunk size in bytes
+ * @return Non-overlapping spans covering the whole text
+ */
+vector<TextSpan> split_text_spans_content_defined(string_view text, size_t min_size, size_t avg_size, size_t max_size) {
+    return split_content_defined_spans(BoundaryIndex(text), min_size, avg_size, max_size);
+}
+
+/**
+ * Builds a list of str straight from spans of the source text, so no
+ * std::string is allocated per chunk on the way. Requires the GIL.
+ */
+static py::list spans_to_list(string_view text, const vector<TextSpan>& spans) {
+    ScopedTimer timer(chunker_stats().marshal);
+    py::list chunks(spans.size());
+    for (size_t i = 0; i < spans.size(); ++i) {
+        PyObject* chunk = PyUnicode_DecodeUTF8(text.data() + spans[i].start,
+                                               static_cast<Py_ssize_t>(spans[i].end - spans[i].start), nullptr);
+        if (!chunk) {
+            throw py::error_already_set();
+        }
+        PyList_SET_ITEM(chunks.ptr(), static_cast<Py_ssize_t>(i), chunk);
     }
-    
-    // Add the last piece
-    if (has_paragraph_splits && start_pos < text.length()) {
-        splits.push_back(text.substr(start_pos));
+    return chunks;
+}
+
+/**
+ * Runs a splitter over one text, recording it in the "split" histogram and
+ * the call, byte and chunk counters. The result is spans or chunk strings.
+ */
+template <typename Splitter>
+static auto run_split(string_view text, Splitter&& splitter) {
+    ChunkerStats& stats = chunker_stats();
+    ScopedTimer timer(stats.split);
+    auto result = splitter(text);
+    stats.calls.add();
+    stats.bytes.add(text.size());
+    stats.chunks.add(result.size());
+    return result;
+}
+
+/**
+ * Runs a span-producing splitter over borrowed text with the GIL released.
+ */
+template <typename Splitter>
+static py::array_t<uint64_t> split_spans_without_gil(const py::object& text, Splitter&& splitter) {
+    BorrowedText borrowed(text);
+    vector<TextSpan> spans;
+    {
+        py::gil_scoped_release release;
+        spans = run_split(borrowed.view, splitter);
     }
-    
-    // Merge small paragraph splits into chunks
-    if (has_paragraph_splits) {
-        string current_chunk;
-        current_chunk.reserve(chunk_size + chunk_overlap);
-        
-        for (const auto& split : splits) {
-            // Start new chunk if adding this split would exceed chunk_size
-            if (!current_chunk.empty() && 
-                current_chunk.length() + split.length() + double_newline.length() > static_cast<size_t>(chunk_size)) {
-                chunks.push_back(current_chunk);
-                
-                // Handle overlap
-                if (chunk_overlap > 0 && current_chunk.length() > static_cast<size_t>(chunk_overlap)) {
-                    current_chunk = current_chunk.substr(current_chunk.length() - chunk_overlap);
-                } else {
-                    current_chunk.clear();
-                }
-            }
-            
-            if (current_chunk.empty()) {
-                current_chunk = split;
-            } else {
-                current_chunk += double_newline + split;
-            }
-        }
-        
-        // Add final chunk
-        if (!current_chunk.empty()) {
-            chunks.push_back(current_chunk);
+    return spans_to_array(std::move(spans));
+}
+
+/**
+ * Runs a span-producing splitter over borrowed text with the GIL released
+ * and returns the chunks as a list of str.
+ */
+template <typename Splitter>
+static py::list split_chunks_without_gil(const py::object& text, Splitter&& splitter) {
+    BorrowedText borrowed(text);
+    vector<TextSpan> spans;
+    {
+        py::gil_scoped_release release;
+        spans = run_split(borrowed.view, splitter);
+    }
+    return spans_to_list(borrowed.view, spans);
+}
+
+/**
+ * Splits many texts at once on the shared thread pool. The texts are
+ * borrowed rather than copied.
+ *
+ * @param texts Sequence of str or bytes-like objects
+ * @param method "recursive" (split_text_recursive), "chars" (split_text), "words" (split_text_with_word_count)
+ *               or "unicode" (split_text_unicode with the defaults)
+ * @param num_threads Maximum threads to use, 0 for all available
+ * @return List of chunk lists in input order
+ */
+py::list split_texts(const vector<py::object>& texts, int chunk_size, int chunk_overlap,
+                     const string& method, size_t num_threads) {
+    SpanSplitter splitter = span_splitter_for_method(method);
+
+    vector<BorrowedText> borrowed;
+    borrowed.reserve(texts.size());
+    for (const py::object& text : texts) {
+        borrowed.emplace_back(text);
+    }
+
+    vector<vector<TextSpan>> spans(borrowed.size());
+    {
+        py::gil_scoped_release release;
+        shared_thread_pool().parallel_for(borrowed.size(), [&](size_t i) {
+            spans[i] = run_split(borrowed[i].view, [&](string_view text) {
+                return splitter(text, chunk_size, chunk_overlap);
+            });
+        }, num_threads);
+    }
+
+    py::list results(borrowed.size());
+    for (size_t i = 0; i < borrowed.size(); ++i) {
+        PyList_SET_ITEM(results.ptr(), static_cast<Py_ssize_t>(i),
+                        spans_to_list(borrowed[i].view, spans[i]).release().ptr());
+    }
+    return results;
+}
+
+/**
+ * Splits text and packs every chunk into one contiguous buffer, see
+ * PackedChunks. Chunks become Python str only when indexed.
+ *
+ * @param method "recursive", "chars", "words" or "unicode", see span_splitter_for_method
+ */
+PackedChunks split_text_packed(const py::object& text, int chunk_size, int chunk_overlap, const string& method) {
+    SpanSplitter splitter = span_splitter_for_method(method);
+    BorrowedText borrowed(text);
+    py::gil_scoped_release release;
+    return run_split(borrowed.view, [&](string_view view) {
+        return PackedChunks(view, splitter(view, chunk_size, chunk_overlap));
+    });
+}
+
+/**
+ * The prebuilt chunk configuration called name.
+ */
+static const ChunkConfig& chunk_config(const string& name) {
+    if (const ChunkConfig* config = find_chunk_config(name)) {
+        return *config;
+    }
+    string names;
+    for (const ChunkConfig& config : chunk_configs()) {
+        names += (names.empty() ? "" : ", ") + config.name;
+    }
+    throw invalid_argument("Unknown chunk config '" + name + "', expected one of " + names);
+}
+
+/**
+ * Normalizes caption segments into one transcript and chunks it, keeping the
+ * time range of every chunk, see normalize_transcript and
+ * time_transcript_chunks.
+ *
+ * @param texts Caption text of every segment, str or bytes-like objects
+ * @param starts Start time in seconds of every segment
+ * @param durations Duration in seconds of every segment
+ * @param method "recursive", "chars", "words" or "unicode" (see span_splitter_for_method),
+ *               or "tokens" to count BPE tokens of encoder
+ */
+TranscriptChunks split_transcript(const vector<py::object>& texts,
+                                  const py::array_t<double, py::array::c_style | py::array::forcecast>& starts,
+                                  const py::array_t<double, py::array::c_style | py::array::forcecast>& durations,
+                                  int chunk_size, int chunk_overlap, const string& method, const BpeEncoder* encoder,
+                                  bool remove_annotations) {
+    if (starts.ndim() != 1 || durations.ndim() != 1 || static_cast<size_t>(starts.shape(0)) != texts.size() ||
+        static_cast<size_t>(durations.shape(0)) != texts.size()) {
+        throw invalid_argument("texts, starts and durations must have the same length");
+    }
+    SpanSplitter splitter = nullptr;
+    if (method == "tokens") {
+        if (!encoder) {
+            throw invalid_argument("method 'tokens' requires an encoder");
         }
-        
-        if (!chunks.empty()) {
-            return chunks;
+    } else {
+        splitter = span_splitter_for_method(method);
+    }
+
+    vector<BorrowedText> borrowed;
+    borrowed.reserve(texts.size());
+    for (const py::object& text : texts) {
+        borrowed.emplace_back(text);
+    }
+    vector<string_view> segments;
+    segments.reserve(borrowed.size());
+    for (const BorrowedText& text : borrowed) {
+        segments.push_back(text.view);
+    }
+
+    py::gil_scoped_release release;
+    NormalizedTranscript transcript = normalize_transcript(segments, remove_annotations);
+    vector<TextSpan> spans = run_split(transcript.text, [&](string_view view) {
+        return splitter ? splitter(view, chunk_size, chunk_overlap)
+                        : split_tokens_spans(*encoder, view, chunk_size, chunk_overlap);
+    });
+    return time_transcript_chunks(move(transcript), starts.data(), durations.data(), move(spans));
+}
+
+static py::str transcript_chunk_str(const TranscriptChunks& chunks, size_t index) {
+    const TextSpan& span = chunks.spans[index];
+    return py::str(chunks.text.data() + span.start, span.end - span.start);
+}
+
+/**
+ * Counts the tokens of every text on the shared thread pool, then packs the
+ * texts into embedding requests, see pack_embedding_batches.
+ *
+ * @param texts Sequence of str or bytes-like objects, e.g. the chunks of a document
+ * @param packing "ordered" or "first_fit_decreasing"
+ * @param num_threads Maximum threads to use for token counting, 0 for all available
+ */
+EmbeddingBatches pack_texts_for_embedding(const vector<py::object>& texts, const BpeEncoder& encoder,
+                                          const EmbeddingBatchLimits& limits, const string& packing,
+                                          size_t num_threads) {
+    BatchPacking mode = parse_batch_packing(packing);
+    // Validate the limits before counting anything
+    pack_embedding_batches({}, limits, mode);
+
+    vector<BorrowedText> borrowed;
+    borrowed.reserve(texts.size());
+    for (const py::object& text : texts) {
+        borrowed.emplace_back(text);
+    }
+
+    py::gil_scoped_release release;
+    ScopedTimer timer(chunker_stats().batch);
+    vector<uint32_t> token_counts(borrowed.size());
+    shared_thread_pool().parallel_for(borrowed.size(), [&](size_t i) {
+        size_t tokens = encoder.count_tokens(borrowed[i].view);
+        token_counts[i] = static_cast<uint32_t>(min<size_t>(tokens, UINT32_MAX));
+    }, num_threads);
+    return pack_embedding_batches(move(token_counts), limits, mode);
+}
+
+static EmbeddingBatchLimits embedding_limits(size_t max_request_tokens, size_t max_request_inputs,
+                                             size_t max_input_tokens) {
+    EmbeddingBatchLimits limits;
+    limits.max_request_tokens = max_request_tokens;
+    limits.max_request_inputs = max_request_inputs;
+    limits.max_input_tokens = max_input_tokens;
+    return limits;
+}
+
+static py::str packed_chunk_str(const PackedChunks& chunks, size_t index) {
+    string_view chunk = chunks[index];
+    return py::str(chunk.data(), chunk.size());
+}
+
+/**
+ * Python index into a sequence of count items, negative from the end.
+ */
+static size_t checked_index(py::ssize_t index, size_t count, const char* what) {
+    const py::ssize_t size = static_cast<py::ssize_t>(count);
+    if (index < 0) {
+        index += size;
+    }
+    if (index < 0 || index >= size) {
+        throw py::index_error(string(what) + " index out of range");
+    }
+    return static_cast<size_t>(index);
+}
+
+/**
+ * Stores one Python metadata value of a chunk; None leaves it without one.
+ */
+static void set_metadata_value(ChunkArchiveBuilder& builder, const py::handle& key, size_t row,
+                               const py::handle& value) {
+    if (!PyUnicode_Check(key.ptr())) {
+        throw invalid_argument("Metadata keys must be str");
+    }
+    const string name = key.cast<string>();
+    PyObject* object = value.ptr();
+    if (object == Py_None) {
+        return;
+    }
+    if (PyBool_Check(object)) {
+        builder.set_bool(name, row, object == Py_True);
+    } else if (PyLong_Check(object)) {
+        builder.set_int64(name, row, value.cast<int64_t>());
+    } else if (PyFloat_Check(object)) {
+        builder.set_float64(name, row, PyFloat_AS_DOUBLE(object));
+    } else if (PyUnicode_Check(object)) {
+        Py_ssize_t size = 0;
+        const char* data = PyUnicode_AsUTF8AndSize(object, &size);
+        if (!data) {
+            throw py::error_already_set();
         }
+        builder.set_string(name, row, string_view(data, static_cast<size_t>(size)));
+    } else {
+        throw invalid_argument("Metadata '" + name + "' must be str, int, float, bool or None, not " +
+                               Py_TYPE(object)->tp_name);
     }
-    
-    // If paragraph splitting didn't work well, try by single newlines
-    splits.clear();
-    start_pos = 0;
-    next_pos = 0;
-    const string single_newline = "\n";
-    
-    bool has_newline_splits = false;
-    while ((next_pos = text.find(single_newline, start_pos)) != string::npos) {
-        has_newline_splits = true;
-        splits.push_back(text.substr(start_pos, next_pos - start_pos));
-        start_pos = next_pos + single_newline.length();
+}
+
+/**
+ * Encodes chunks, optional ids and metadata into a ChunkArchive.
+ *
+ * @param texts PackedChunks, or a sequence of str or bytes-like objects
+ * @param metadata None, one dict shared by every chunk, or a dict per chunk
+ * @param ids None or a str per chunk
+ */
+static unique_ptr<ChunkArchive> build_chunk_archive(const py::object& texts, const py::object& metadata,
+                                                    const py::object& ids) {
+    ScopedTimer timer(chunker_stats().archive);
+    ChunkArchiveBuilder builder;
+    if (py::isinstance<PackedChunks>(texts)) {
+        builder.add_texts(texts.cast<const PackedChunks&>());
+    } else {
+        for (const py::handle& text : texts) {
+            builder.add_text(BorrowedText(py::reinterpret_borrow<py::object>(text)).view);
+        }
     }
-    
-    if (has_newline_splits && start_pos < text.length()) {
-        splits.push_back(text.substr(start_pos));
+    const size_t count = builder.size();
+
+    if (!ids.is_none()) {
+        const py::sequence sequence = ids.cast<py::sequence>();
+        if (sequence.size() != count) {
+            throw invalid_argument("Expected one id per chunk");
+        }
+        for (size_t row = 0; row < count; ++row) {
+            builder.set_id(row, BorrowedText(sequence[row]).view);
+        }
     }
-    
-    // Process single newline splits
-    if (has_newline_splits) {
-        string current_chunk;
-        current_chunk.reserve(chunk_size + chunk_overlap);
-        
-        for (const auto& split : splits) {
-            if (!current_chunk.empty() && 
-                current_chunk.length() + split.length() + single_newline.length() > static_cast<size_t>(chunk_size)) {
-                chunks.push_back(current_chunk);
-                
-                if (chunk_overlap > 0 && current_chunk.length() > static_cast<size_t>(chunk_overlap)) {
-                    current_chunk = current_chunk.substr(current_chunk.length() - chunk_overlap);
-                } else {
-                    current_chunk.clear();
-                }
-            }
-            
-            if (current_chunk.empty()) {
-                current_chunk = split;
-            } else {
-                current_chunk += single_newline + split;
+
+    if (py::isinstance<py::dict>(metadata)) {
+        const py::dict shared = metadata.cast<py::dict>();
+        for (size_t row = 0; row < count; ++row) {
+            for (const auto& item : shared) {
+                set_metadata_value(builder, item.first, row, item.second);
             }
         }
-        
-        if (!current_chunk.empty()) {
-            chunks.push_back(current_chunk);
+    } else if (!metadata.is_none()) {
+        const py::sequence sequence = metadata.cast<py::sequence>();
+        if (sequence.size() != count) {
+            throw invalid_argument("Expected one metadata dict per chunk");
         }
-        
-        if (!chunks.empty()) {
-            return chunks;
+        for (size_t row = 0; row < count; ++row) {
+            const py::object entry = sequence[row];
+            if (!py::isinstance<py::dict>(entry)) {
+                throw invalid_argument("Expected one metadata dict per chunk");
+            }
+            for (const auto& item : entry.cast<py::dict>()) {
+                set_metadata_value(builder, item.first, row, item.second);
+            }
         }
     }
-    
-    // Fall back to simple character-based chunks if all else fails
-    chunks.clear();
-    chunks.reserve((text.length() / (chunk_size - chunk_overlap)) + 1);
-    
-    for (size_t i = 0; i < text.length(); i += chunk_size - chunk_overlap) {
-        size_t end = min(i + chunk_size, text.length());
-        chunks.push_back(text.substr(i, end - i));
+
+    string bytes;
+    {
+        py::gil_scoped_release release;
+        bytes = builder.finish();
     }
-    
-    return chunks;
+    return make_unique<ChunkArchive>(move(bytes));
 }
 
 /**
- * Overloaded version with default parameters that supports word-based chunking 
- * similar to the Python implementation
+ * Keeps the Python object behind a ChunkArchive's buffer alive; released
+ * with the GIL held.
  */
-vector<string> split_text_with_word_count(const string& text, int chunk_size_words, int chunk_overlap_words) {
-    // Estimate average word length from sample
-    size_t sample_size = min(text.length(), static_cast<size_t>(500));
-    string sample = text.substr(0, sample_size);
-    
-    size_t word_count = 0;
-    bool in_word = false;
-    
-    for (char c : sample) {
-        if (isspace(c)) {
-            in_word = false;
-        } else if (!in_word) {
-            in_word = true;
-            word_count++;
+struct ArchiveBufferOwner {
+    py::object object;
+    py::buffer_info info;
+};
+
+/**
+ * Opens an archive in place in a bytes-like object (bytes, mmap,
+ * multiprocessing.shared_memory buffers), referencing rather than copying it.
+ */
+static unique_ptr<ChunkArchive> open_chunk_archive(const py::buffer& buffer) {
+    ScopedTimer timer(chunker_stats().archive);
+    auto* owned = new ArchiveBufferOwner{buffer, buffer.request()};
+    shared_ptr<const void> owner(owned, [](ArchiveBufferOwner* owner) {
+        py::gil_scoped_acquire gil;
+        delete owner;
+    });
+    const py::buffer_info& info = owned->info;
+    if (info.ndim > 1 || (info.ndim == 1 && info.strides[0] != info.itemsize)) {
+        throw invalid_argument("Expected a contiguous buffer");
+    }
+    return make_unique<ChunkArchive>(static_cast<const char*>(info.ptr),
+                                     static_cast<size_t>(info.size * info.itemsize), move(owner));
+}
+
+static py::object column_value(const ChunkColumn& column, size_t row) {
+    if (!column.present(row)) {
+        return py::none();
+    }
+    switch (column.type()) {
+        case ColumnType::Int64:
+            return py::int_(column.int64(row));
+        case ColumnType::Float64:
+            return py::float_(column.float64(row));
+        case ColumnType::Bool:
+            return py::bool_(column.boolean(row));
+        case ColumnType::String: {
+            string_view value = column.string(row);
+            return py::str(value.data(), value.size());
         }
     }
-    
-    // Use average word length or default to 6 if sample has no words
-    int avg_word_length = word_count > 0 ? static_cast<int>(sample_size / word_count) + 1 : 6;
-    
-    // Convert to character counts
-    int chunk_size_chars = chunk_size_words * avg_word_length;
-    int chunk_overlap_chars = chunk_overlap_words * avg_word_length;
-    
-    return split_text(text, chunk_size_chars, chunk_overlap_chars);
+    return py::none();
+}
+
+static const ChunkColumn& archive_column(const ChunkArchive& archive, const string& name) {
+    const ChunkColumn* column = archive.find_column(name);
+    if (!column) {
+        throw py::key_error(name);
+    }
+    return *column;
 }
 
-PYBIND11_MODULE(text_chunker, m) {
+/**
+ * Read-only NumPy view of count items at data, kept alive by self.
+ */
+template <typename T>
+static py::array_t<T> archive_array(const py::object& self, const void* data, size_t count) {
+    py::array_t<T> result({static_cast<py::ssize_t>(count)}, {static_cast<py::ssize_t>(sizeof(T))},
+                          static_cast<const T*>(data), self);
+    // The archive may be a read-only mapping
+    result.attr("setflags")(py::arg("write") = false);
+    return result;
+}
+
+void register_text_chunker(py::module_& m) {
     m.doc() = "C++ implementation of text chunking for improved performance";
     
-    m.def("split_text", &split_text, 
+    m.def("split_text",
+        [](const py::object& text, int chunk_size, int chunk_overlap) {
+            return split_chunks_without_gil(text, [&](string_view view) {
+                return split_text_spans(view, chunk_size, chunk_overlap);
+            });
+        },
         py::arg("text"), 
         py::arg("chunk_size"), 
         py::arg("chunk_overlap"),
         "Split text into chunks (character-based)");
     
-    m.def("split_text_with_word_count", &split_text_with_word_count, 
+    m.def("split_text_with_word_count",
+        [](const py::object& text, int chunk_size_words, int chunk_overlap_words) {
+            return split_chunks_without_gil(text, [&](string_view view) {
+                return split_text_spans_with_word_count(view, chunk_size_words, chunk_overlap_words);
+            });
+        },
         py::arg("text"), 
         py::arg("chunk_size_words"), 
         py::arg("chunk_overlap_words"),
         "Split text into chunks based on word counts");
+
+    m.def("split_text_spans",
+        [](const py::object& text, int chunk_size, int chunk_overlap) {
+            return split_spans_without_gil(text, [&](string_view view) {
+                return split_text_spans(view, chunk_size, chunk_overlap);
+            });
+        },
+        py::arg("text"),
+        py::arg("chunk_size"),
+        py::arg("chunk_overlap"),
+        "Compute chunk boundaries as an (n, 2) uint64 array of [start, end) UTF-8 byte offsets");
+
+    m.def("split_text_spans_with_word_count",
+        [](const py::object& text, int chunk_size_words, int chunk_overlap_words) {
+            return split_spans_without_gil(text, [&](string_view view) {
+                return split_text_spans_with_word_count(view, chunk_size_words, chunk_overlap_words);
+            });
+        },
+        py::arg("text"),
+        py::arg("chunk_size_words"),
+        py::arg("chunk_overlap_words"),
+        "Compute word-count based chunk boundaries as an (n, 2) uint64 array of byte offsets");
+
+    m.def("split_text_content_defined",
+        [](const py::object& text, size_t min_size, size_t avg_size, size_t max_size) {
+            return split_chunks_without_gil(text, [&](string_view view) {
+                return split_text_spans_content_defined(view, min_size, avg_size, max_size);
+            });
+        },
+        py::arg("text"),
+        py::arg("min_size"),
+        py::arg("avg_size"),
+        py::arg("max_size"),
+        "Split text at content-defined (rolling hash) boundaries snapped to whitespace; sizes in bytes");
+
+    m.def("split_text_spans_content_defined",
+        [](const py::object& text, size_t min_size, size_t avg_size, size_t max_size) {
+            return split_spans_without_gil(text, [&](string_view view) {
+                return split_text_spans_content_defined(view, min_size, avg_size, max_size);
+            });
+        },
+        py::arg("text"),
+        py::arg("min_size"),
+        py::arg("avg_size"),
+        py::arg("max_size"),
+        "Compute content-defined chunk boundaries as an (n, 2) uint64 array of byte offsets");
+
+    m.def("split_text_recursive",
+        [](const py::object& text, int chunk_size, int chunk_overlap, const vector<string>& separators) {
+            return split_chunks_without_gil(text, [&](string_view view) {
+                return split_text_recursive_spans(view, chunk_size, chunk_overlap, separators);
+            });
+        },
+        py::arg("text"),
+        py::arg("chunk_size"),
+        py::arg("chunk_overlap"),
+        py::arg("separators") = default_recursive_separators(),
+        "Split text exactly like LangChain's RecursiveCharacterTextSplitter (character-based)");
+
+    m.def("split_text_recursive_spans",
+        [](const py::object& text, int chunk_size, int chunk_overlap, const vector<string>& separators) {
+            return split_spans_without_gil(text, [&](string_view view) {
+                return split_text_recursive_spans(view, chunk_size, chunk_overlap, separators);
+            });
+        },
+        py::arg("text"),
+        py::arg("chunk_size"),
+        py::arg("chunk_overlap"),
+        py::arg("separators") = default_recursive_separators(),
+        "Compute recursive splitter chunk boundaries as an (n, 2) uint64 array of byte offsets");
+
+    m.def("split_text_unicode",
+        [](const py::object& text, int chunk_size, int chunk_overlap, const string& boundary, bool sentences) {
+            CutBoundary cut = parse_cut_boundary(boundary);
+            return split_chunks_without_gil(text, [&](string_view view) {
+                return split_unicode_spans(view, chunk_size, chunk_overlap, cut, sentences);
+            });
+        },
+        py::arg("text"),
+        py::arg("chunk_size"),
+        py::arg("chunk_overlap"),
+        py::arg("boundary") = "grapheme",
+        py::arg("sentences") = true,
+        "Split text into chunks of at most chunk_size characters, cut only at grapheme (or code_point) boundaries "
+        "and preferring paragraph, line, sentence and word breaks; raises ValueError for invalid UTF-8");
+
+    m.def("split_text_unicode_spans",
+        [](const py::object& text, int chunk_size, int chunk_overlap, const string& boundary, bool sentences) {
+            CutBoundary cut = parse_cut_boundary(boundary);
+            return split_spans_without_gil(text, [&](string_view view) {
+                return split_unicode_spans(view, chunk_size, chunk_overlap, cut, sentences);
+            });
+        },
+        py::arg("text"),
+        py::arg("chunk_size"),
+        py::arg("chunk_overlap"),
+        py::arg("boundary") = "grapheme",
+        py::arg("sentences") = true,
+        "Compute UTF-8-aware chunk boundaries as an (n, 2) uint64 array of byte offsets");
+
+    py::class_<BpeEncoder, shared_ptr<BpeEncoder>>(m, "BpeEncoder",
+        "tiktoken-compatible BPE encoder; immutable and safe to share between threads")
+        .def("count_tokens",
+            [](const BpeEncoder& encoder, const py::object& text) {
+                BorrowedText borrowed(text);
+                py::gil_scoped_release release;
+                return encoder.count_tokens(borrowed.view);
+            },
+            py::arg("text"),
+            "Count the tokens text encodes to")
+        .def("encode",
+            [](const BpeEncoder& encoder, const py::object& text) {
+                BorrowedText borrowed(text);
+                py::gil_scoped_release release;
+                return encoder.encode(borrowed.view);
+            },
+            py::arg("text"),
+            "Encode text to token ids, treating special tokens as plain text")
+        .def_property_readonly("name", &BpeEncoder::name)
+        .def_property_readonly("vocab_size", &BpeEncoder::vocab_size);
+
+    m.def("load_bpe_encoder",
+        [](const string& ranks_path, const string& encoding_name) {
+            return const_pointer_cast<BpeEncoder>(BpeEncoder::get(ranks_path, encoding_name));
+        },
+        py::arg("ranks_path"),
+        py::arg("encoding_name") = "cl100k_base",
+        "Load (or reuse the cached) encoder for a .tiktoken ranks file; encoding_name is cl100k_base or o200k_base");
+
+    m.def("split_text_with_token_count",
+        [](const py::object& text, int chunk_size_tokens, int chunk_overlap_tokens, const BpeEncoder& encoder) {
+            return split_chunks_without_gil(text, [&](string_view view) {
+                return split_tokens_spans(encoder, view, chunk_size_tokens, chunk_overlap_tokens);
+            });
+        },
+        py::arg("text"),
+        py::arg("chunk_size_tokens"),
+        py::arg("chunk_overlap_tokens"),
+        py::arg("encoder"),
+        "Split text into chunks based on BPE token counts");
+
+    m.def("split_text_spans_with_token_count",
+        [](const py::object& text, int chunk_size_tokens, int chunk_overlap_tokens, const BpeEncoder& encoder) {
+            return split_spans_without_gil(text, [&](string_view view) {
+                return split_tokens_spans(encoder, view, chunk_size_tokens, chunk_overlap_tokens);
+            });
+        },
+        py::arg("text"),
+        py::arg("chunk_size_tokens"),
+        py::arg("chunk_overlap_tokens"),
+        py::arg("encoder"),
+        "Compute token-count based chunk boundaries as an (n, 2) uint64 array of byte offsets");
+
+    m.def("chunk_configs",
+        [] {
+            py::list configs;
+            for (const ChunkConfig& config : chunk_configs()) {
+                py::dict entry;
+                entry["name"] = config.name;
+                entry["unit"] = config.unit;
+                entry["separators"] = config.separators;
+                entry["needs_encoder"] = config.needs_encoder;
+                configs.append(entry);
+            }
+            return configs;
+        },
+        "The prebuilt chunking configurations: name, unit (chars, words or tokens), separators and needs_encoder");
+
+    m.def("split_text_config",
+        [](const py::object& text, const string& config, int chunk_size, int chunk_overlap,
+           const BpeEncoder* encoder) {
+            const ChunkConfig& chunker = chunk_config(config);
+            return split_chunks_without_gil(text, [&](string_view view) {
+                return chunker.split(view, chunk_size, chunk_overlap, encoder);
+            });
+        },
+        py::arg("text"),
+        py::arg("config"),
+        py::arg("chunk_size"),
+        py::arg("chunk_overlap"),
+        py::arg("encoder") = nullptr,
+        "Split text with a prebuilt configuration from chunk_configs(); token configurations need an encoder");
+
+    m.def("split_text_config_spans",
+        [](const py::object& text, const string& config, int chunk_size, int chunk_overlap,
+           const BpeEncoder* encoder) {
+            const ChunkConfig& chunker = chunk_config(config);
+            return split_spans_without_gil(text, [&](string_view view) {
+                return chunker.split(view, chunk_size, chunk_overlap, encoder);
+            });
+        },
+        py::arg("text"),
+        py::arg("config"),
+        py::arg("chunk_size"),
+        py::arg("chunk_overlap"),
+        py::arg("encoder") = nullptr,
+        "Compute chunk boundaries of a prebuilt configuration as an (n, 2) uint64 array of byte offsets");
+
+    m.def("split_texts", &split_texts,
+        py::arg("texts"),
+        py::arg("chunk_size"),
+        py::arg("chunk_overlap"),
+        py::arg("method") = "recursive",
+        py::arg("num_threads") = 0,
+        "Split a list of texts in parallel; method is recursive, chars, words or unicode");
+
+    const EmbeddingBatchLimits default_limits;
+
+    py::class_<EmbeddingBatches>(m, "EmbeddingBatches",
+        "Inputs grouped into embedding requests; every input is in exactly one batch or in rejected")
+        .def_readonly("batches", &EmbeddingBatches::batches,
+            "Input indices of every request, ascending within a request")
+        .def_readonly("batch_tokens", &EmbeddingBatches::batch_tokens, "Token total of every request")
+        .def_readonly("rejected", &EmbeddingBatches::rejected,
+            "Indices of empty inputs and inputs over max_input_tokens, which no request can carry")
+        .def_readonly("token_counts", &EmbeddingBatches::token_counts, "Tokens of every input")
+        .def("__len__", [](const EmbeddingBatches& plan) { return plan.batches.size(); })
+        .def("__repr__", [](const EmbeddingBatches& plan) {
+            return "<EmbeddingBatches batches=" + to_string(plan.batches.size()) + " inputs=" +
+                   to_string(plan.token_counts.size()) + " rejected=" + to_string(plan.rejected.size()) + ">";
+        });
+
+    m.def("pack_embedding_batches",
+        [](const vector<py::object>& texts, const BpeEncoder& encoder, size_t max_request_tokens,
+           size_t max_request_inputs, size_t max_input_tokens, const string& packing, size_t num_threads) {
+            EmbeddingBatchLimits limits = embedding_limits(max_request_tokens, max_request_inputs, max_input_tokens);
+            return pack_texts_for_embedding(texts, encoder, limits, packing, num_threads);
+        },
+        py::arg("texts"),
+        py::arg("encoder"),
+        py::arg("max_request_tokens") = default_limits.max_request_tokens,
+        py::arg("max_request_inputs") = default_limits.max_request_inputs,
+        py::arg("max_input_tokens") = default_limits.max_input_tokens,
+        py::arg("packing") = "ordered",
+        py::arg("num_threads") = 0,
+        "Count the tokens of every text and group the texts into embedding requests within the token and input "
+        "limits; packing is ordered or first_fit_decreasing");
+
+    m.def("pack_token_counts",
+        [](vector<uint32_t> token_counts, size_t max_request_tokens, size_t max_request_inputs,
+           size_t max_input_tokens, const string& packing) {
+            EmbeddingBatchLimits limits = embedding_limits(max_request_tokens, max_request_inputs, max_input_tokens);
+            BatchPacking mode = parse_batch_packing(packing);
+            py::gil_scoped_release release;
+            ScopedTimer timer(chunker_stats().batch);
+            return pack_embedding_batches(move(token_counts), limits, mode);
+        },
+        py::arg("token_counts"),
+        py::arg("max_request_tokens") = default_limits.max_request_tokens,
+        py::arg("max_request_inputs") = default_limits.max_request_inputs,
+        py::arg("max_input_tokens") = default_limits.max_input_tokens,
+        py::arg("packing") = "ordered",
+        "Group inputs with precomputed token counts into embedding requests, see pack_embedding_batches");
+
+    py::class_<PackedChunks>(m, "PackedChunks", py::buffer_protocol(),
+        "Chunks packed into one contiguous UTF-8 buffer; the buffer protocol exposes the bytes")
+        .def_buffer([](const PackedChunks& chunks) {
+            return py::buffer_info(
+                const_cast<char*>(chunks.bytes().data()),
+                1,
+                py::format_descriptor<uint8_t>::format(),
+                1,
+                {static_cast<py::ssize_t>(chunks.bytes().size())},
+                {static_cast<py::ssize_t>(1)},
+                true
+            );
+        })
+        .def("__len__", &PackedChunks::size)
+        .def("__getitem__",
+            [](const PackedChunks& chunks, py::ssize_t index) {
+                return packed_chunk_str(chunks, checked_index(index, chunks.size(), "chunk"));
+            },
+            py::arg("index"))
+        .def("tolist",
+            [](const PackedChunks& chunks) {
+                ScopedTimer timer(chunker_stats().marshal);
+                py::list result(chunks.size());
+                for (size_t i = 0; i < chunks.size(); ++i) {
+                    PyList_SET_ITEM(result.ptr(), static_cast<Py_ssize_t>(i), packed_chunk_str(chunks, i).release().ptr());
+                }
+                return result;
+            },
+            "All chunks as a list of str")
+        .def_property_readonly("offsets",
+            [](const py::object& self) {
+                const PackedChunks& chunks = self.cast<const PackedChunks&>();
+                // A view that keeps the PackedChunks alive. Read-only, since
+                // __getitem__ and tolist slice the buffer by these offsets.
+                py::array_t<uint64_t> result(
+                    {static_cast<py::ssize_t>(chunks.offsets().size())},
+                    {static_cast<py::ssize_t>(sizeof(uint64_t))},
+                    chunks.offsets().data(),
+                    self
+                );
+                result.attr("setflags")(py::arg("write") = false);
+                return result;
+            },
+            "Read-only uint64 array of len(self) + 1 byte offsets; chunk i is bytes[offsets[i]:offsets[i + 1]]")
+        .def_property_readonly("nbytes", [](const PackedChunks& chunks) { return chunks.bytes().size(); });
+
+    py::class_<ChunkArchive>(m, "ChunkArchive", py::buffer_protocol(),
+        "Versioned binary container of chunks, their ids and typed metadata columns; the buffer protocol "
+        "exposes the encoded bytes, and chunks and values are read in place")
+        .def(py::init(&build_chunk_archive),
+            py::arg("texts"), py::arg("metadata") = py::none(), py::arg("ids") = py::none(),
+            "Encode chunks (PackedChunks or a sequence of str) with one metadata dict shared by every chunk "
+            "or one per chunk, and optional ids; metadata values are str, int, float, bool or None")
+        .def_static("from_buffer", &open_chunk_archive, py::arg("buffer"),
+            "Open the archive in a bytes-like object without copying it (unless misaligned)")
+        .def_static("load", &ChunkArchive::load,
+            py::call_guard<py::gil_scoped_release>(),
+            py::arg("path"), "Map an archive written by save()")
+        .def("save", &ChunkArchive::save,
+            py::call_guard<py::gil_scoped_release>(),
+            py::arg("path"), "Write the archive to a file")
+        .def_buffer([](const ChunkArchive& archive) {
+            return py::buffer_info(
+                const_cast<char*>(archive.bytes().data()),
+                1,
+                py::format_descriptor<uint8_t>::format(),
+                1,
+                {static_cast<py::ssize_t>(archive.bytes().size())},
+                {static_cast<py::ssize_t>(1)},
+                true
+            );
+        })
+        .def("__len__", &ChunkArchive::size)
+        .def("__getitem__",
+            [](const ChunkArchive& archive, py::ssize_t index) {
+                string_view text = archive.text(checked_index(index, archive.size(), "chunk"));
+                return py::str(text.data(), text.size());
+            },
+            py::arg("index"), "Text of a chunk")
+        .def("tolist",
+            [](const ChunkArchive& archive) {
+                ScopedTimer timer(chunker_stats().marshal);
+                py::list result(archive.size());
+                for (size_t i = 0; i < archive.size(); ++i) {
+                    string_view text = archive.text(i);
+                    PyList_SET_ITEM(result.ptr(), static_cast<Py_ssize_t>(i),
+                                    py::str(text.data(), text.size()).release().ptr());
+                }
+                return result;
+            },
+            "All chunk texts as a list of str")
+        .def("id",
+            [](const ChunkArchive& archive, py::ssize_t index) {
+                const size_t row = checked_index(index, archive.size(), "chunk");
+                return archive.has_ids() ? column_value(archive.ids(), row) : py::none();
+            },
+            py::arg("index"), "Id of a chunk, None if it has none")
+        .def("ids",
+            [](const ChunkArchive& archive) -> py::object {
+                if (!archive.has_ids()) {
+                    return py::none();
+                }
+                py::list result(archive.size());
+                for (size_t i = 0; i < archive.size(); ++i) {
+                    PyList_SET_ITEM(result.ptr(), static_cast<Py_ssize_t>(i),
+                                    column_value(archive.ids(), i).release().ptr());
+                }
+                return result;
+            },
+            "Every chunk id as a list, None if the archive has no ids")
+        .def("metadata",
+            [](const ChunkArchive& archive, py::ssize_t index) {
+                const size_t row = checked_index(index, archive.size(), "chunk");
+                py::dict result;
+                for (const ChunkColumn& column : archive.columns()) {
+                    if (column.present(row)) {
+                        result[py::str(column.name().data(), column.name().size())] = column_value(column, row);
+                    }
+                }
+                return result;
+            },
+            py::arg("index"), "Metadata dict of a chunk")
+        .def("column",
+            [](const py::object& self, const string& name) -> py::object {
+                const ChunkArchive& archive = self.cast<const ChunkArchive&>();
+                const ChunkColumn& column = archive_column(archive, name);
+                switch (column.type()) {
+                    case ColumnType::Int64:
+                        return archive_array<int64_t>(self, column.values(), archive.size());
+                    case ColumnType::Float64:
+                        return archive_array<double>(self, column.values(), archive.size());
+                    case ColumnType::Bool:
+                        return archive_array<bool>(self, column.values(), archive.size());
+                    case ColumnType::String:
+                        break;
+                }
+                py::list result(archive.size());
+                for (size_t i = 0; i < archive.size(); ++i) {
+                    PyList_SET_ITEM(result.ptr(), static_cast<Py_ssize_t>(i), column_value(column, i).release().ptr());
+                }
+                return result;
+            },
+            py::arg("name"),
+            "A metadata column: a read-only int64, float64 or bool array viewing the archive (0 where a chunk "
+            "has no value), or a list of str and None")
+        .def("present",
+            [](const py::object& self, const string& name) -> py::object {
+                const ChunkArchive& archive = self.cast<const ChunkArchive&>();
+                const ChunkColumn& column = archive_column(archive, name);
+                if (!column.presence()) {
+                    return py::module_::import("numpy").attr("ones")(archive.size(), py::arg("dtype") = "bool");
+                }
+                return archive_array<bool>(self, column.presence(), archive.size());
+            },
+            py::arg("name"), "Bool array of the chunks that have a value in a metadata column")
+        .def_property_readonly("columns",
+            [](const ChunkArchive& archive) {
+                py::dict result;
+                for (const ChunkColumn& column : archive.columns()) {
+                    result[py::str(column.name().data(), column.name().size())] = column_type_name(column.type());
+                }
+                return result;
+            },
+            "Metadata column names mapped to 'int64', 'float64', 'bool' or 'string'")
+        .def_property_readonly("has_ids", &ChunkArchive::has_ids)
+        .def_property_readonly("text_offsets",
+            [](const py::object& self) {
+                const ChunkArchive& archive = self.cast<const ChunkArchive&>();
+                return archive_array<uint64_t>(self, archive.text_offsets(), archive.size() + 1);
+            },
+            "uint64 array of len(self) + 1 offsets into text_bytes")
+        .def_property_readonly("text_bytes",
+            [](const py::object& self) {
+                const ChunkArchive& archive = self.cast<const ChunkArchive&>();
+                return archive_array<uint8_t>(self, archive.text_bytes().data(), archive.text_bytes().size());
+            },
+            "uint8 array of every chunk's UTF-8 text back to back")
+        .def_property_readonly("nbytes", [](const ChunkArchive& archive) { return archive.bytes().size(); })
+        .def(py::pickle(
+            [](const ChunkArchive& archive) {
+                return py::bytes(archive.bytes().data(), archive.bytes().size());
+            },
+            [](const py::bytes& state) {
+                return make_unique<ChunkArchive>(string(state));
+            }));
+
+    m.def("split_text_packed", &split_text_packed,
+        py::arg("text"),
+        py::arg("chunk_size"),
+        py::arg("chunk_overlap"),
+        py::arg("method") = "recursive",
+        "Split text into a PackedChunks buffer; method is recursive, chars, words or unicode");
+
+    py::class_<TranscriptChunks>(m, "TranscriptChunks",
+        "Chunks of a normalized transcript with the start and end time in seconds of each")
+        .def("__len__", [](const TranscriptChunks& chunks) { return chunks.spans.size(); })
+        .def("__getitem__",
+            [](const TranscriptChunks& chunks, py::ssize_t index) {
+                const size_t i = checked_index(index, chunks.spans.size(), "chunk");
+                return py::make_tuple(transcript_chunk_str(chunks, i), chunks.start_times[i], chunks.end_times[i]);
+            },
+            py::arg("index"),
+            "(text, start, end) of a chunk")
+        .def("tolist",
+            [](const TranscriptChunks& chunks) { return spans_to_list(chunks.text, chunks.spans); },
+            "All chunks as a list of str")
+        .def_property_readonly("starts",
+            [](const py::object& self) {
+                const TranscriptChunks& chunks = self.cast<const TranscriptChunks&>();
+                py::array_t<double> result({static_cast<py::ssize_t>(chunks.start_times.size())},
+                                           {static_cast<py::ssize_t>(sizeof(double))}, chunks.start_times.data(),
+                                           self);
+                result.attr("setflags")(py::arg("write") = false);
+                return result;
+            },
+            "Read-only float64 array of chunk start times in seconds")
+        .def_property_readonly("ends",
+            [](const py::object& self) {
+                const TranscriptChunks& chunks = self.cast<const TranscriptChunks&>();
+                py::array_t<double> result({static_cast<py::ssize_t>(chunks.end_times.size())},
+                                           {static_cast<py::ssize_t>(sizeof(double))}, chunks.end_times.data(),
+                                           self);
+                result.attr("setflags")(py::arg("write") = false);
+                return result;
+            },
+            "Read-only float64 array of chunk end times in seconds")
+        .def_property_readonly("spans",
+            [](const py::object& self) {
+                const TranscriptChunks& chunks = self.cast<const TranscriptChunks&>();
+                // Read-only: __getitem__ and tolist slice text by these offsets
+                py::array_t<uint64_t> result(
+                    {static_cast<py::ssize_t>(chunks.spans.size()), static_cast<py::ssize_t>(2)},
+                    {static_cast<py::ssize_t>(sizeof(TextSpan)), static_cast<py::ssize_t>(sizeof(uint64_t))},
+                    reinterpret_cast<const uint64_t*>(chunks.spans.data()),
+                    self);
+                result.attr("setflags")(py::arg("write") = false);
+                return result;
+            },
+            "Read-only (n, 2) uint64 array of chunk byte offsets into text")
+        .def_property_readonly("text",
+            [](const TranscriptChunks& chunks) { return py::str(chunks.text.data(), chunks.text.size()); },
+            "The normalized transcript");
+
+    m.def("split_transcript", &split_transcript,
+        py::arg("texts"),
+        py::arg("starts"),
+        py::arg("durations"),
+        py::arg("chunk_size"),
+        py::arg("chunk_overlap"),
+        py::arg("method") = "words",
+        py::arg("encoder") = nullptr,
+        py::arg("remove_annotations") = true,
+        "Normalize transcript segments (parallel texts, starts and durations) and chunk them with their time "
+        "ranges; method is recursive, chars, words, unicode or tokens (with an encoder)");
+
+    m.def("normalize_transcript",
+        [](const vector<py::object>& texts, bool remove_annotations) {
+            vector<BorrowedText> borrowed(texts.begin(), texts.end());
+            vector<string_view> segments;
+            segments.reserve(borrowed.size());
+            for (const BorrowedText& text : borrowed) {
+                segments.push_back(text.view);
+            }
+            string normalized;
+            {
+                py::gil_scoped_release release;
+                normalized = normalize_transcript(segments, remove_annotations).text;
+            }
+            return py::str(normalized.data(), normalized.size());
+        },
+        py::arg("texts"),
+        py::arg("remove_annotations") = true,
+        "Join transcript segments into one text with caption markup, entities and whitespace normalized");
+
+    m.def("boundary_scanner_backend", &boundary_scanner_backend,
+        "Name of the SIMD kernel used for boundary scanning on this CPU");
+
+    m.def("utf8_validator_backend", &utf8_validator_backend,
+        "Name of the SIMD kernel used for UTF-8 validation on this CPU");
+
+    // Create the metrics up front so get_stats() lists them before first use
+    chunker_stats();
+    register_stats_api(m, "text_chunker");
 } 
\ No newline at end of file
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * A chunk expressed as a half-open [start, end) byte range into the source text.
+ * Laid out as two uint64 values so a vector of spans can be handed to NumPy
+ * as an (n, 2) array without copying.
+ */
+struct TextSpan {
+    uint64_t start;
+    uint64_t end;
+};
+static_assert(sizeof(TextSpan) == 2 * sizeof(uint64_t), "TextSpan must be densely packed");
+
+/**
+ * Copies each span out of the source text into its own string.
+ */
+inline std::vector<std::string> materialize_spans(std::string_view text, const std::vector<TextSpan>& spans) {
+    std::vector<std::string> chunks;
+    chunks.reserve(spans.size());
+    for (const auto& span : spans) {
+        chunks.emplace_back(text.substr(span.start, span.end - span.start));
+    }
+    return chunks;
+}
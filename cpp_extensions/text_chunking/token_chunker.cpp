@@ -0,0 +1,101 @@
+#include "token_chunker.h"
+#include "bpe_tokenizer.h"
+#include "utf8.h"
+
+#include <deque>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+namespace {
+
+struct TokenUnit {
+    size_t start;
+    size_t end;
+    size_t tokens;
+};
+
+/**
+ * Greedy packer over a stream of units; keeps only the units of the chunk being built.
+ */
+class TokenWindow {
+public:
+    TokenWindow(size_t chunk_size, size_t chunk_overlap, vector<TextSpan>& chunks)
+        : chunk_size_(chunk_size), chunk_overlap_(chunk_overlap), chunks_(chunks) {}
+
+    void add(const TokenUnit& unit) {
+        if (!window_.empty() && window_tokens_ + unit.tokens > chunk_size_) {
+            chunks_.push_back({window_.front().start, window_.back().end});
+
+            // Keep at most chunk_overlap tokens, and leave room for the incoming unit
+            while (!window_.empty() &&
+                   (window_tokens_ > chunk_overlap_ || window_tokens_ + unit.tokens > chunk_size_)) {
+                window_tokens_ -= window_.front().tokens;
+                window_.pop_front();
+            }
+        }
+        window_.push_back(unit);
+        window_tokens_ += unit.tokens;
+    }
+
+    // Every emitted chunk is followed by a new unit, so the window always holds unemitted text
+    void finish() {
+        if (!window_.empty()) {
+            chunks_.push_back({window_.front().start, window_.back().end});
+        }
+    }
+
+private:
+    size_t chunk_size_;
+    size_t chunk_overlap_;
+    vector<TextSpan>& chunks_;
+    deque<TokenUnit> window_;
+    size_t window_tokens_ = 0;
+};
+
+}  // namespace
+
+vector<TextSpan> split_tokens_spans(const BpeEncoder& encoder, string_view text,
+                                    int chunk_size_tokens, int chunk_overlap_tokens) {
+    if (chunk_size_tokens <= 0) {
+        throw invalid_argument("chunk_size_tokens must be > 0, got " + to_string(chunk_size_tokens));
+    }
+    if (chunk_overlap_tokens < 0 || chunk_overlap_tokens >= chunk_size_tokens) {
+        throw invalid_argument("chunk_overlap_tokens must be in [0, chunk_size_tokens), got " +
+                               to_string(chunk_overlap_tokens));
+    }
+
+    const size_t size = static_cast<size_t>(chunk_size_tokens);
+    vector<TextSpan> chunks;
+    TokenWindow window(size, static_cast<size_t>(chunk_overlap_tokens), chunks);
+    vector<size_t> token_ends;
+
+    for (size_t pos = 0; pos < text.size();) {
+        size_t end = next_pretoken_end(text, pos, encoder.pattern());
+        string_view piece = text.substr(pos, end - pos);
+        size_t tokens = encoder.count_piece_tokens(piece);
+
+        if (tokens <= size) {
+            window.add({pos, end, tokens});
+        } else {
+            // Oversized piece: emit runs of tokens that end on a character boundary
+            encoder.piece_token_ends(piece, token_ends);
+            size_t unit_start = pos;
+            size_t unit_tokens = 0;
+            for (size_t token_end : token_ends) {
+                ++unit_tokens;
+                size_t absolute = pos + token_end;
+                if (absolute == end || !is_utf8_continuation(static_cast<unsigned char>(text[absolute]))) {
+                    window.add({unit_start, absolute, unit_tokens});
+                    unit_start = absolute;
+                    unit_tokens = 0;
+                }
+            }
+        }
+        pos = end;
+    }
+
+    window.finish();
+    return chunks;
+}
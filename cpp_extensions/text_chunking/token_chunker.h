@@ -0,0 +1,22 @@
+#pragma once
+
+#include <string_view>
+#include <vector>
+
+#include "text_span.h"
+
+class BpeEncoder;
+
+/**
+ * Splits text into chunks of at most chunk_size_tokens BPE tokens, as counted
+ * by the given encoder, with up to chunk_overlap_tokens tokens shared between
+ * consecutive chunks.
+ *
+ * Chunks are cut at pre-tokenizer piece boundaries, so the token count of a
+ * chunk equals the sum of its pieces' counts. Pieces longer than a whole
+ * chunk are cut between tokens, at the nearest UTF-8 character boundary.
+ *
+ * @return [start, end) byte offsets of each chunk into text
+ */
+std::vector<TextSpan> split_tokens_spans(const BpeEncoder& encoder, std::string_view text,
+                                         int chunk_size_tokens, int chunk_overlap_tokens);
@@ -0,0 +1,333 @@
+#include "transcript_chunker.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+
+#include "utf8.h"
+
+using namespace std;
+
+namespace {
+
+// Bracketed cues longer than this are kept as text: "[Music]" is a cue,
+// a bracket that never closes within a caption line is not
+constexpr size_t kMaxAnnotationBytes = 64;
+
+bool is_ascii_space(unsigned char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v';
+}
+
+// Whitespace beyond ASCII that captions carry: NBSP, the U+2000 spaces,
+// line and paragraph separators, narrow and ideographic spaces
+bool is_unicode_space(uint32_t cp) {
+    return cp == 0x85 || cp == 0xA0 || cp == 0x1680 || (cp >= 0x2000 && cp <= 0x200A) || cp == 0x2028 ||
+           cp == 0x2029 || cp == 0x202F || cp == 0x205F || cp == 0x3000;
+}
+
+// Zero-width characters that only split words when an editor inserts them.
+// ZWJ and ZWNJ stay, they shape emoji and scripts.
+bool is_zero_width(uint32_t cp) {
+    return cp == 0x200B || cp == 0x2060 || cp == 0xFEFF;
+}
+
+bool is_music_note(uint32_t cp) {
+    return cp >= 0x266A && cp <= 0x266C;
+}
+
+void encode_code_point(string& out, uint32_t cp) {
+    if (cp == 0 || cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF)) {
+        cp = 0xFFFD;
+    }
+    if (cp < 0x80) {
+        out += static_cast<char>(cp);
+    } else if (cp < 0x800) {
+        out += static_cast<char>(0xC0 | (cp >> 6));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    } else if (cp < 0x10000) {
+        out += static_cast<char>(0xE0 | (cp >> 12));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    } else {
+        out += static_cast<char>(0xF0 | (cp >> 18));
+        out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    }
+}
+
+// End of a markup tag or cue timestamp opened at text[pos] == '<', npos when
+// the '<' is literal text ("a < b")
+size_t tag_end(string_view text, size_t pos) {
+    if (pos + 1 >= text.size()) {
+        return string_view::npos;
+    }
+    const unsigned char next = static_cast<unsigned char>(text[pos + 1]);
+    if (next != '/' && !isalnum(next)) {
+        return string_view::npos;
+    }
+    for (size_t i = pos + 1; i < text.size(); ++i) {
+        if (text[i] == '>') {
+            return i;
+        }
+        if (text[i] == '<') {
+            break;
+        }
+    }
+    return string_view::npos;
+}
+
+// Decodes the entity at text[pos] == '&' into cp; returns its length, 0 if
+// it is not one
+size_t decode_entity(string_view text, size_t pos, uint32_t& cp) {
+    const size_t semicolon = text.find(';', pos + 1);
+    if (semicolon == string_view::npos || semicolon - pos > 10) {
+        return 0;
+    }
+    const string_view name = text.substr(pos + 1, semicolon - pos - 1);
+    if (name.size() >= 2 && name[0] == '#') {
+        const bool hex = name[1] == 'x' || name[1] == 'X';
+        const size_t digits = hex ? 2 : 1;
+        if (digits >= name.size()) {
+            return 0;
+        }
+        uint32_t value = 0;
+        for (size_t i = digits; i < name.size(); ++i) {
+            const unsigned char c = static_cast<unsigned char>(name[i]);
+            uint32_t digit;
+            if (c >= '0' && c <= '9') {
+                digit = c - '0';
+            } else if (hex && (c | 0x20) >= 'a' && (c | 0x20) <= 'f') {
+                digit = (c | 0x20) - 'a' + 10;
+            } else {
+                return 0;
+            }
+            value = min<uint32_t>(value * (hex ? 16 : 10) + digit, 0x110000);
+        }
+        cp = value;
+    } else if (name == "amp") {
+        cp = '&';
+    } else if (name == "lt") {
+        cp = '<';
+    } else if (name == "gt") {
+        cp = '>';
+    } else if (name == "quot") {
+        cp = '"';
+    } else if (name == "apos") {
+        cp = '\'';
+    } else if (name == "nbsp") {
+        cp = 0xA0;
+    } else {
+        return 0;
+    }
+    return semicolon - pos + 1;
+}
+
+// End of a ">>" speaker-change marker at text[pos], npos if there is none.
+// Captions often carry it escaped as "&gt;&gt;".
+size_t speaker_marker_end(string_view text, size_t pos) {
+    size_t count = 0;
+    while (pos < text.size()) {
+        if (text[pos] == '>') {
+            pos += 1;
+        } else if (text.substr(pos, 4) == "&gt;") {
+            pos += 4;
+        } else {
+            break;
+        }
+        ++count;
+    }
+    return count >= 2 ? pos : string_view::npos;
+}
+
+// Appends normalized text, emitting a pending separator only before the
+// next visible character so runs of whitespace and dropped artifacts never
+// leave double or trailing spaces
+class CaptionWriter {
+public:
+    explicit CaptionWriter(string& out) : out_(out) {}
+
+    void begin_segment() {
+        separate();
+        segment_start_ = string::npos;
+    }
+
+    TextSpan end_segment() const {
+        if (segment_start_ == string::npos) {
+            return TextSpan{out_.size(), out_.size()};
+        }
+        return TextSpan{segment_start_, out_.size()};
+    }
+
+    void separate() { pending_space_ = !out_.empty(); }
+
+    bool at_word_start() const { return out_.empty() || pending_space_ || segment_start_ == string::npos; }
+
+    void append(string_view bytes) {
+        start_visible();
+        out_.append(bytes);
+    }
+
+    void append_code_point(uint32_t cp) {
+        start_visible();
+        encode_code_point(out_, cp);
+    }
+
+private:
+    void start_visible() {
+        if (pending_space_) {
+            out_ += ' ';
+            pending_space_ = false;
+        }
+        if (segment_start_ == string::npos) {
+            segment_start_ = out_.size();
+        }
+    }
+
+    string& out_;
+    bool pending_space_ = false;
+    size_t segment_start_ = string::npos;
+};
+
+// Plain bytes are copied in runs; everything else goes through the slow path
+bool is_plain_ascii(unsigned char c) {
+    return c > ' ' && c < 0x7F && c != '<' && c != '&' && c != '[' && c != '>';
+}
+
+void normalize_segment(string_view text, bool remove_annotations, CaptionWriter& writer) {
+    size_t pos = 0;
+    while (pos < text.size()) {
+        const unsigned char c = static_cast<unsigned char>(text[pos]);
+        if (is_plain_ascii(c)) {
+            size_t end = pos + 1;
+            while (end < text.size() && is_plain_ascii(static_cast<unsigned char>(text[end]))) {
+                ++end;
+            }
+            writer.append(text.substr(pos, end - pos));
+            pos = end;
+            continue;
+        }
+
+        if (c < 0x80) {
+            size_t marker_end;
+            if (remove_annotations && (c == '>' || c == '&') && writer.at_word_start() &&
+                (marker_end = speaker_marker_end(text, pos)) != string_view::npos) {
+                writer.separate();
+                pos = marker_end;
+            } else if (c <= ' ' || c == 0x7F) {
+                writer.separate();
+                ++pos;
+            } else if (c == '<') {
+                const size_t end = tag_end(text, pos);
+                if (end != string_view::npos) {
+                    pos = end + 1;
+                } else {
+                    writer.append(text.substr(pos, 1));
+                    ++pos;
+                }
+            } else if (c == '&') {
+                uint32_t cp = 0;
+                const size_t length = decode_entity(text, pos, cp);
+                if (length == 0) {
+                    writer.append(text.substr(pos, 1));
+                    ++pos;
+                    continue;
+                }
+                if (cp < 0x80 && is_ascii_space(static_cast<unsigned char>(cp))) {
+                    writer.separate();
+                } else if (is_unicode_space(cp)) {
+                    writer.separate();
+                } else if (!is_zero_width(cp)) {
+                    writer.append_code_point(cp);
+                }
+                pos += length;
+            } else if (c == '[') {
+                const size_t close = text.find_first_of("[]", pos + 1);
+                if (remove_annotations && close != string_view::npos && text[close] == ']' &&
+                    close - pos < kMaxAnnotationBytes) {
+                    writer.separate();
+                    pos = close + 1;
+                } else {
+                    writer.append(text.substr(pos, 1));
+                    ++pos;
+                }
+            } else {  // '>'
+                writer.append(text.substr(pos, 1));
+                ++pos;
+            }
+            continue;
+        }
+
+        size_t length = 0;
+        const uint32_t cp = decode_code_point(text, pos, length);
+        if (is_unicode_space(cp) || (remove_annotations && is_music_note(cp))) {
+            writer.separate();
+        } else if (!is_zero_width(cp)) {
+            writer.append(text.substr(pos, length));
+        }
+        pos += length;
+    }
+}
+
+}  // namespace
+
+NormalizedTranscript normalize_transcript(const vector<string_view>& segments, bool remove_annotations) {
+    NormalizedTranscript transcript;
+    size_t total = 0;
+    for (string_view segment : segments) {
+        total += segment.size() + 1;
+    }
+    transcript.text.reserve(total);
+    transcript.segments.reserve(segments.size());
+
+    CaptionWriter writer(transcript.text);
+    for (string_view segment : segments) {
+        writer.begin_segment();
+        normalize_segment(segment, remove_annotations, writer);
+        transcript.segments.push_back(writer.end_segment());
+    }
+    return transcript;
+}
+
+TranscriptChunks time_transcript_chunks(NormalizedTranscript transcript, const double* starts,
+                                        const double* durations, vector<TextSpan> spans) {
+    // Segments that kept some text, in text order
+    vector<size_t> timed;
+    timed.reserve(transcript.segments.size());
+    for (size_t i = 0; i < transcript.segments.size(); ++i) {
+        if (transcript.segments[i].end > transcript.segments[i].start) {
+            timed.push_back(i);
+        }
+    }
+
+    TranscriptChunks chunks;
+    chunks.start_times.reserve(spans.size());
+    chunks.end_times.reserve(spans.size());
+    for (const TextSpan& span : spans) {
+        if (timed.empty()) {
+            chunks.start_times.push_back(0.0);
+            chunks.end_times.push_back(0.0);
+            continue;
+        }
+        // First segment ending after the chunk starts, last one starting before it ends
+        auto first = partition_point(timed.begin(), timed.end(), [&](size_t i) {
+            return transcript.segments[i].end <= span.start;
+        });
+        auto last = partition_point(timed.begin(), timed.end(), [&](size_t i) {
+            return transcript.segments[i].start < span.end;
+        });
+        if (last == timed.begin()) {
+            last = timed.begin() + 1;
+        }
+        --last;
+        if (first == timed.end() || first > last) {
+            first = last;
+        }
+        chunks.start_times.push_back(starts[*first]);
+        chunks.end_times.push_back(starts[*last] + durations[*last]);
+    }
+
+    chunks.text = move(transcript.text);
+    chunks.spans = move(spans);
+    return chunks;
+}
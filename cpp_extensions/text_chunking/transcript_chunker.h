@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "text_span.h"
+
+/**
+ * Caption segments joined into one clean text, with the byte range each
+ * segment ended up at.
+ */
+struct NormalizedTranscript {
+    std::string text;
+    std::vector<TextSpan> segments;  // one per input segment; empty for segments that normalized to nothing
+};
+
+/**
+ * Normalizes caption segments in one pass and joins them with single spaces:
+ * markup tags and inline cue timestamps ("<i>", "<00:00:01.500>") are
+ * dropped, HTML entities decoded, every run of whitespace (including NBSP,
+ * zero-width characters and line breaks) collapsed to one space, and the
+ * text trimmed. With remove_annotations, bracketed cues such as "[Music]" or
+ * "[Applause]", music notes and ">>" speaker-change markers are dropped too.
+ */
+NormalizedTranscript normalize_transcript(const std::vector<std::string_view>& segments,
+                                          bool remove_annotations = true);
+
+/**
+ * Chunks of a normalized transcript with the time range each one covers.
+ */
+struct TranscriptChunks {
+    std::string text;                 // the normalized transcript
+    std::vector<TextSpan> spans;      // [start, end) byte offsets into text
+    std::vector<double> start_times;  // seconds, start of the segment the chunk starts in
+    std::vector<double> end_times;    // seconds, end of the segment the chunk ends in
+};
+
+/**
+ * Attaches timestamps to chunk spans of transcript.text. Chunks that touch
+ * no segment's text get the times of the nearest segment before them, or
+ * of the first segment.
+ *
+ * @param starts Start time in seconds of every input segment
+ * @param durations Duration in seconds of every input segment
+ */
+TranscriptChunks time_transcript_chunks(NormalizedTranscript transcript, const double* starts,
+                                        const double* durations, std::vector<TextSpan> spans);
@@ -0,0 +1,354 @@
+#include "unicode_chunker.h"
+#include "unicode_classes.h"
+#include "utf8.h"
+#include "utf8_validation.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+using namespace std;
+
+namespace {
+
+// Grapheme_Cluster_Break values that affect the rules implemented here
+enum class GraphemeKind : uint8_t {
+    Other,
+    CR,
+    LF,
+    Control,
+    Extend,  // also SpacingMark, which joins the same way
+    ZWJ,
+    RegionalIndicator,
+    L,
+    V,
+    T,
+    LV,
+    LVT,
+    Pictographic,  // Extended_Pictographic
+};
+
+bool in_range(uint32_t cp, uint32_t first, uint32_t last) {
+    return cp >= first && cp <= last;
+}
+
+bool is_pictographic(uint32_t cp) {
+    return cp == 0x00A9 || cp == 0x00AE || cp == 0x203C || cp == 0x2049 || cp == 0x2122 || cp == 0x2139 ||
+           in_range(cp, 0x2194, 0x21AA) || in_range(cp, 0x231A, 0x23FF) || cp == 0x24C2 ||
+           in_range(cp, 0x25AA, 0x25FE) || in_range(cp, 0x2600, 0x27BF) || in_range(cp, 0x2934, 0x2935) ||
+           in_range(cp, 0x2B05, 0x2B55) || cp == 0x3030 || cp == 0x303D || cp == 0x3297 || cp == 0x3299 ||
+           in_range(cp, 0x1F000, 0x1FAFF) || in_range(cp, 0x1FC00, 0x1FFFD);
+}
+
+GraphemeKind grapheme_kind(uint32_t cp) {
+    if (cp < 0x80) {
+        return cp == '\r' ? GraphemeKind::CR : cp == '\n' ? GraphemeKind::LF
+             : cp < 0x20 || cp == 0x7F ? GraphemeKind::Control : GraphemeKind::Other;
+    }
+    if (cp == 0x200D) {
+        return GraphemeKind::ZWJ;
+    }
+    // Format characters other than ZWNJ/ZWJ, and line/paragraph separators
+    if (cp <= 0x9F || cp == 0x00AD || cp == 0x061C || cp == 0x180E || cp == 0x200B || in_range(cp, 0x200E, 0x200F) ||
+        in_range(cp, 0x2028, 0x202E) || in_range(cp, 0x2060, 0x206F) || cp == 0xFEFF || in_range(cp, 0xFFF0, 0xFFFB)) {
+        return GraphemeKind::Control;
+    }
+    if (in_range(cp, 0x1100, 0x11FF) || in_range(cp, 0xA960, 0xA97C) || in_range(cp, 0xAC00, 0xD7FB)) {
+        if (in_range(cp, 0xAC00, 0xD7A3)) {
+            return (cp - 0xAC00) % 28 == 0 ? GraphemeKind::LV : GraphemeKind::LVT;
+        }
+        if (cp <= 0x115F || in_range(cp, 0xA960, 0xA97C)) {
+            return GraphemeKind::L;
+        }
+        if (cp <= 0x11A7 || in_range(cp, 0xD7B0, 0xD7C6)) {
+            return GraphemeKind::V;
+        }
+        if (cp <= 0x11FF || in_range(cp, 0xD7CB, 0xD7FB)) {
+            return GraphemeKind::T;
+        }
+        return GraphemeKind::Other;
+    }
+    if (in_range(cp, 0x1F1E6, 0x1F1FF)) {
+        return GraphemeKind::RegionalIndicator;
+    }
+    // ZWNJ, emoji skin tone modifiers, tags and half-width kana voicing marks extend
+    if (cp == 0x200C || in_range(cp, 0x1F3FB, 0x1F3FF) || in_range(cp, 0xE0020, 0xE007F) ||
+        in_range(cp, 0xFF9E, 0xFF9F) || classify_code_point(cp) == UnicodeClass::Mark) {
+        return GraphemeKind::Extend;
+    }
+    return is_pictographic(cp) ? GraphemeKind::Pictographic : GraphemeKind::Other;
+}
+
+/**
+ * Whether the cluster ending in a code point of kind previous continues with
+ * one of kind next. pictographic tracks an Extended_Pictographic Extend* ZWJ?
+ * prefix and regional_indicators the length of the current run of them.
+ */
+bool joins(GraphemeKind previous, GraphemeKind next, bool pictographic, size_t regional_indicators) {
+    using K = GraphemeKind;
+    if (previous == K::CR) {
+        return next == K::LF;
+    }
+    if (previous == K::LF || previous == K::Control || next == K::CR || next == K::LF || next == K::Control) {
+        return false;
+    }
+    if (previous == K::L) {
+        return next == K::L || next == K::V || next == K::LV || next == K::LVT || next == K::Extend || next == K::ZWJ;
+    }
+    if ((previous == K::LV || previous == K::V) && (next == K::V || next == K::T)) {
+        return true;
+    }
+    if ((previous == K::LVT || previous == K::T) && next == K::T) {
+        return true;
+    }
+    if (next == K::Extend || next == K::ZWJ) {
+        return true;
+    }
+    if (previous == K::ZWJ && next == K::Pictographic) {
+        return pictographic;
+    }
+    return previous == K::RegionalIndicator && next == K::RegionalIndicator && regional_indicators % 2 == 1;
+}
+
+bool is_line_break(uint32_t cp) {
+    return cp == '\n' || cp == '\r' || cp == 0x0B || cp == 0x0C || cp == 0x85 || cp == 0x2028 || cp == 0x2029;
+}
+
+// Closing punctuation that may follow a terminator within the same sentence
+bool is_sentence_closer(uint32_t cp) {
+    switch (cp) {
+        case ')': case ']': case '}': case '"': case '\'':
+        case 0x00BB: case 0x2019: case 0x201D: case 0x203A:
+        case 0x300D: case 0x300F: case 0x3011: case 0x300B: case 0x3009: case 0x3015: case 0x3017:
+        case 0x3019: case 0x301B: case 0xFF09: case 0xFF3D: case 0xFF5D: case 0xFF63: case 0xFF02: case 0xFF07:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// Preference of a cut position; higher is better
+enum BreakLevel : uint8_t {
+    kAnyBreak,
+    kWordBreak,
+    kSentenceBreak,
+    kLineBreak,
+    kParagraphBreak,
+};
+
+constexpr size_t kNoCut = static_cast<size_t>(-1);
+
+struct CutPoint {
+    size_t offset;       // byte offset into the text
+    size_t code_points;  // code points from the chunk start
+    uint8_t level;       // BreakLevel of cutting here
+    bool after_space;    // the unit ending here is whitespace
+};
+
+size_t skip_whitespace(string_view text, size_t pos) {
+    while (pos < text.length()) {
+        size_t length;
+        if (!is_unicode_whitespace(decode_code_point(text, pos, length))) {
+            break;
+        }
+        pos += length;
+    }
+    return pos;
+}
+
+}  // namespace
+
+CutBoundary parse_cut_boundary(const string& name) {
+    if (name == "grapheme") {
+        return CutBoundary::Grapheme;
+    }
+    if (name == "code_point") {
+        return CutBoundary::CodePoint;
+    }
+    throw invalid_argument("Unknown cut boundary '" + name + "', expected grapheme or code_point");
+}
+
+size_t next_grapheme_boundary(string_view text, size_t pos, size_t& code_points) {
+    // Nothing extends an ASCII character, and only LF extends CR
+    code_points = 1;
+    unsigned char lead = static_cast<unsigned char>(text[pos]);
+    if (lead < 0x80 && lead != '\r' && (pos + 1 == text.length() || static_cast<unsigned char>(text[pos + 1]) < 0x80)) {
+        return pos + 1;
+    }
+
+    size_t length;
+    GraphemeKind previous = grapheme_kind(decode_code_point(text, pos, length));
+    size_t end = pos + length;
+    bool pictographic = previous == GraphemeKind::Pictographic;
+    size_t regional_indicators = previous == GraphemeKind::RegionalIndicator ? 1 : 0;
+
+    while (end < text.length()) {
+        GraphemeKind next = grapheme_kind(decode_code_point(text, end, length));
+        if (!joins(previous, next, pictographic, regional_indicators)) {
+            break;
+        }
+        pictographic = next == GraphemeKind::Pictographic ||
+                       (pictographic && (next == GraphemeKind::Extend || next == GraphemeKind::ZWJ));
+        regional_indicators += next == GraphemeKind::RegionalIndicator ? 1 : 0;
+        previous = next;
+        end += length;
+        ++code_points;
+    }
+    return end;
+}
+
+SentenceTerminal sentence_terminal(uint32_t cp) {
+    switch (cp) {
+        case '.': case '!': case '?':
+        case 0x2026:                                  // horizontal ellipsis
+        case 0x203C: case 0x2047: case 0x2048: case 0x2049:
+            return SentenceTerminal::Spaced;
+        case 0x3002: case 0xFF0E: case 0xFF01: case 0xFF1F: case 0xFF61:  // CJK full stop, full/half-width forms
+        case 0x061F: case 0x06D4:                     // Arabic question mark, Arabic/Urdu full stop
+        case 0x0964: case 0x0965:                     // Devanagari danda, double danda
+        case 0x0589:                                  // Armenian full stop
+        case 0x1362: case 0x1367: case 0x1368:        // Ethiopic full stop, question and paragraph marks
+        case 0x104A: case 0x104B:                     // Myanmar section marks
+            return SentenceTerminal::Standalone;
+        default:
+            return SentenceTerminal::None;
+    }
+}
+
+vector<TextSpan> split_unicode_spans(string_view text, int chunk_size, int chunk_overlap,
+                                     CutBoundary boundary, bool sentences) {
+    if (chunk_size <= 0) {
+        throw invalid_argument("chunk_size must be > 0, got " + to_string(chunk_size));
+    }
+    if (chunk_overlap < 0 || chunk_overlap >= chunk_size) {
+        throw invalid_argument("chunk_overlap must be in [0, chunk_size), got " + to_string(chunk_overlap));
+    }
+    size_t invalid = find_invalid_utf8(text);
+    if (invalid != string_view::npos) {
+        throw invalid_argument("Text is not valid UTF-8 at byte offset " + to_string(invalid));
+    }
+
+    const size_t size = static_cast<size_t>(chunk_size);
+    const size_t overlap = static_cast<size_t>(chunk_overlap);
+    const size_t min_fill = max<size_t>(1, size / 2);
+
+    vector<TextSpan> chunks;
+    // Every unit boundary of the current window, starting with the chunk start
+    vector<CutPoint> cuts;
+    cuts.reserve(size + 1);
+
+    size_t start = skip_whitespace(text, 0);
+    while (start < text.length()) {
+        cuts.assign(1, {start, 0, kAnyBreak, false});
+        size_t pos = start;
+        size_t code_points = 0;
+        // Cut before the last line break, while only whitespace has followed it
+        size_t line_break = kNoCut;
+        bool previous_cr = false;
+        // Cut just past a terminator (and any closers), awaiting what follows
+        size_t pending_sentence = kNoCut;
+        bool pending_standalone = false;
+
+        while (pos < text.length()) {
+            size_t unit_code_points = 1;
+            size_t unit_length;
+            size_t next;
+            uint32_t cp = decode_code_point(text, pos, unit_length);
+            if (boundary == CutBoundary::Grapheme) {
+                next = next_grapheme_boundary(text, pos, unit_code_points);
+            } else {
+                next = pos + unit_length;
+            }
+            if (code_points > 0 && code_points + unit_code_points > size) {
+                break;
+            }
+
+            const size_t here = cuts.size() - 1;
+            const bool space = is_unicode_whitespace(cp);
+            if (space) {
+                CutPoint& cut = cuts[here];
+                cut.level = max<uint8_t>(cut.level, kWordBreak);
+                // The LF of a CR LF split into code points does not start another line
+                if (is_line_break(cp) && !(cp == '\n' && previous_cr)) {
+                    cut.level = max<uint8_t>(cut.level, cp == 0x2029 ? kParagraphBreak : kLineBreak);
+                    if (line_break != kNoCut) {
+                        cuts[line_break].level = kParagraphBreak;
+                    } else {
+                        line_break = here;
+                    }
+                }
+                if (pending_sentence != kNoCut) {
+                    cuts[pending_sentence].level = max<uint8_t>(cuts[pending_sentence].level, kSentenceBreak);
+                    pending_sentence = kNoCut;
+                }
+            } else {
+                line_break = kNoCut;
+                SentenceTerminal terminal = sentences ? sentence_terminal(cp) : SentenceTerminal::None;
+                if (terminal != SentenceTerminal::None) {
+                    pending_sentence = here + 1;
+                    pending_standalone = pending_standalone || terminal == SentenceTerminal::Standalone;
+                } else if (pending_sentence != kNoCut && is_sentence_closer(cp)) {
+                    pending_sentence = here + 1;
+                } else {
+                    if (pending_sentence != kNoCut && pending_standalone) {
+                        cuts[pending_sentence].level = max<uint8_t>(cuts[pending_sentence].level, kSentenceBreak);
+                    }
+                    pending_sentence = kNoCut;
+                    pending_standalone = false;
+                }
+            }
+            previous_cr = cp == '\r' && next - pos == 1;
+
+            code_points += unit_code_points;
+            pos = next;
+            cuts.push_back({pos, code_points, kAnyBreak, space});
+        }
+
+        size_t cut = cuts.size() - 1;
+        if (pos < text.length()) {
+            if (pending_sentence != kNoCut && pending_standalone) {
+                cuts[pending_sentence].level = max<uint8_t>(cuts[pending_sentence].level, kSentenceBreak);
+            }
+            // Take the latest cut of the best class that keeps the chunk at least half full
+            for (int level = kParagraphBreak; level > kAnyBreak; --level) {
+                size_t best = 0;
+                for (size_t i = cuts.size() - 1; i > 0; --i) {
+                    if (cuts[i].level >= level) {
+                        best = i;
+                        break;
+                    }
+                }
+                if (best && cuts[best].code_points >= min_fill) {
+                    cut = best;
+                    break;
+                }
+            }
+        }
+
+        size_t end = cut;
+        while (end > 0 && cuts[end].after_space) {
+            --end;
+        }
+        if (cuts[end].offset > start) {
+            chunks.push_back({start, cuts[end].offset});
+        }
+        if (cuts[cut].offset >= text.length()) {
+            break;
+        }
+
+        size_t next_start = cut;
+        if (overlap > 0 && cuts[end].code_points > overlap) {
+            // First unit inside the overlap, moved forward to a word start if one follows
+            size_t first = 1;
+            while (cuts[first].code_points < cuts[end].code_points - overlap) {
+                ++first;
+            }
+            size_t word = first;
+            while (word < end && !cuts[word].after_space) {
+                ++word;
+            }
+            next_start = word < end ? word : first;
+        }
+        start = skip_whitespace(text, cuts[next_start].offset);
+    }
+    return chunks;
+}
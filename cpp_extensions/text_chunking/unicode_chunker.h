@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "text_span.h"
+
+/**
+ * The smallest unit a UTF-8-aware chunk may be cut at.
+ */
+enum class CutBoundary {
+    CodePoint,  // never inside a UTF-8 sequence
+    Grapheme,   // never inside an extended grapheme cluster (a user-perceived character)
+};
+
+/**
+ * Parses "code_point" or "grapheme"; throws invalid_argument for anything else.
+ */
+CutBoundary parse_cut_boundary(const std::string& name);
+
+/**
+ * Finds the end of the extended grapheme cluster starting at pos, following
+ * the UAX #29 rules for CR LF, controls, combining marks and ZWJ, Hangul
+ * syllables, emoji ZWJ sequences and regional indicator pairs. Prepend
+ * characters and Indic conjuncts are not joined.
+ *
+ * @param text Valid UTF-8 text
+ * @param pos Byte offset of a cluster start
+ * @param code_points Receives the number of code points in the cluster
+ * @return Byte offset just past the cluster
+ */
+size_t next_grapheme_boundary(std::string_view text, size_t pos, size_t& code_points);
+
+/**
+ * Sentence-ending punctuation. Latin-style terminators (. ! ? and their
+ * variants) only end a sentence when followed by whitespace; the full-width
+ * CJK, Arabic/Urdu, Devanagari, Armenian, Ethiopic and Myanmar ones also
+ * end it directly, since those scripts do not always space sentences.
+ */
+enum class SentenceTerminal : uint8_t { None, Spaced, Standalone };
+
+SentenceTerminal sentence_terminal(uint32_t cp);
+
+/**
+ * UTF-8-aware splitter. Chunks hold at most chunk_size code points (one
+ * oversized grapheme cluster becomes a chunk of its own) and are cut, in
+ * order of preference, at a paragraph break, a line break, a sentence end
+ * (if sentences is set), whitespace, and finally at any boundary of the
+ * chosen kind, as long as the chunk stays at least half full. Leading and
+ * trailing whitespace is trimmed from every chunk, and consecutive chunks
+ * overlap by up to chunk_overlap code points, starting at a word where possible.
+ *
+ * @param text UTF-8 text; validated up front
+ * @param chunk_size Maximum chunk length in Unicode code points
+ * @param chunk_overlap Code points to overlap between consecutive chunks
+ * @param boundary Smallest unit chunks may be cut at
+ * @param sentences Whether to prefer sentence ends over plain whitespace
+ * @return [start, end) byte offsets of each chunk into text
+ * @throws std::invalid_argument for invalid UTF-8 (reporting the byte offset) or parameters
+ */
+std::vector<TextSpan> split_unicode_spans(std::string_view text, int chunk_size, int chunk_overlap,
+                                          CutBoundary boundary, bool sentences);
@@ -0,0 +1,73 @@
+#include "unicode_classes.h"
+#include "utf8.h"
+
+#include <algorithm>
+#include <iterator>
+
+namespace {
+
+// Pseudo-classes for blocks where case alternates between adjacent code points
+enum RangeClass : uint8_t {
+    Upper,
+    Lower,
+    Letter,
+    Mark,
+    Number,
+    Other,
+    UpperEven,  // even code points uppercase, odd lowercase
+    UpperOdd,   // odd code points uppercase, even lowercase
+};
+
+struct Range {
+    uint32_t first;
+    uint32_t last;
+    RangeClass cls;
+};
+
+// Code points >= U+0080 not covered here are Other
+const Range kRanges[] = {
+#include "unicode_class_table.inc"
+};
+
+UnicodeClass ascii_class(uint32_t cp) {
+    if (cp >= 'A' && cp <= 'Z') {
+        return UnicodeClass::UppercaseLetter;
+    }
+    if (cp >= 'a' && cp <= 'z') {
+        return UnicodeClass::LowercaseLetter;
+    }
+    if (cp >= '0' && cp <= '9') {
+        return UnicodeClass::Number;
+    }
+    return UnicodeClass::Other;
+}
+
+}  // namespace
+
+UnicodeClass classify_code_point(uint32_t cp) {
+    if (is_unicode_whitespace(cp)) {
+        return UnicodeClass::Whitespace;
+    }
+    if (cp < 0x80) {
+        return ascii_class(cp);
+    }
+
+    const Range* end = std::end(kRanges);
+    const Range* it = std::upper_bound(std::begin(kRanges), end, cp,
+                                       [](uint32_t value, const Range& r) { return value < r.first; });
+    if (it == std::begin(kRanges) || cp > (it - 1)->last) {
+        return UnicodeClass::Other;
+    }
+
+    switch ((it - 1)->cls) {
+        case Upper: return UnicodeClass::UppercaseLetter;
+        case Lower: return UnicodeClass::LowercaseLetter;
+        case Letter: return UnicodeClass::UncasedLetter;
+        case Mark: return UnicodeClass::Mark;
+        case Number: return UnicodeClass::Number;
+        case UpperEven: return cp % 2 == 0 ? UnicodeClass::UppercaseLetter : UnicodeClass::LowercaseLetter;
+        case UpperOdd: return cp % 2 == 1 ? UnicodeClass::UppercaseLetter : UnicodeClass::LowercaseLetter;
+        case Other: break;
+    }
+    return UnicodeClass::Other;
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstdint>
+
+/**
+ * Coarse Unicode general-category classes, enough to reproduce the
+ * \p{L} / \p{N} / \p{M} / case distinctions used by BPE pre-tokenizers and
+ * sentence segmentation.
+ *
+ * The ranges are generated from UnicodeData.txt by
+ * generate_unicode_classes.py, so classes follow the general category of
+ * every code point; unassigned code points are Other.
+ */
+enum class UnicodeClass : uint8_t {
+    UppercaseLetter,  // Lu, Lt
+    LowercaseLetter,  // Ll
+    UncasedLetter,    // Lm, Lo
+    Mark,             // Mn, Mc, Me
+    Number,           // Nd, Nl, No
+    Whitespace,       // White_Space property
+    Other,            // punctuation, symbols, controls, format, private use
+};
+
+UnicodeClass classify_code_point(uint32_t cp);
+
+inline bool is_letter_class(UnicodeClass c) {
+    return c == UnicodeClass::UppercaseLetter || c == UnicodeClass::LowercaseLetter ||
+           c == UnicodeClass::UncasedLetter;
+}
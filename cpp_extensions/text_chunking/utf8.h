@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+inline bool is_utf8_continuation(unsigned char c) {
+    return (c & 0xC0) == 0x80;
+}
+
+/**
+ * Counts Unicode code points, matching Python's len() on the decoded string.
+ */
+inline size_t code_point_length(std::string_view text) {
+    size_t length = 0;
+    for (unsigned char c : text) {
+        length += !is_utf8_continuation(c);
+    }
+    return length;
+}
+
+/**
+ * Moves pos back to the start of the code point it falls inside; the end of
+ * the text is returned unchanged.
+ */
+inline size_t code_point_floor(std::string_view text, size_t pos) {
+    while (pos > 0 && pos < text.length() && is_utf8_continuation(static_cast<unsigned char>(text[pos]))) {
+        --pos;
+    }
+    return pos;
+}
+
+/**
+ * Moves pos forward to the next code point start (or the end of the text).
+ */
+inline size_t code_point_ceil(std::string_view text, size_t pos) {
+    while (pos < text.length() && is_utf8_continuation(static_cast<unsigned char>(text[pos]))) {
+        ++pos;
+    }
+    return pos;
+}
+
+/**
+ * Decodes the code point starting at text[pos]. Malformed sequences decode
+ * to U+FFFD with a length of one byte, so callers always make progress.
+ */
+inline uint32_t decode_code_point(std::string_view text, size_t pos, size_t& length) {
+    unsigned char lead = static_cast<unsigned char>(text[pos]);
+    size_t expected = lead < 0x80 ? 1 : (lead >> 5) == 0x6 ? 2 : (lead >> 4) == 0xE ? 3 : (lead >> 3) == 0x1E ? 4 : 0;
+    if (expected == 0 || pos + expected > text.length()) {
+        length = 1;
+        return 0xFFFD;
+    }
+
+    uint32_t cp = expected == 1 ? lead : lead & (0x7F >> expected);
+    for (size_t i = 1; i < expected; ++i) {
+        unsigned char c = static_cast<unsigned char>(text[pos + i]);
+        if (!is_utf8_continuation(c)) {
+            length = 1;
+            return 0xFFFD;
+        }
+        cp = (cp << 6) | (c & 0x3F);
+    }
+    length = expected;
+    return cp;
+}
+
+/**
+ * Mirrors str.isspace(), which is what Python's str.strip() removes.
+ */
+inline bool is_python_whitespace(uint32_t cp) {
+    return (cp >= 0x09 && cp <= 0x0D) || (cp >= 0x1C && cp <= 0x20) || cp == 0x85 || cp == 0xA0 ||
+           cp == 0x1680 || (cp >= 0x2000 && cp <= 0x200A) || cp == 0x2028 || cp == 0x2029 ||
+           cp == 0x202F || cp == 0x205F || cp == 0x3000;
+}
+
+/**
+ * The Unicode White_Space property, which is what \s matches in Rust/PCRE
+ * Unicode regexes. Unlike str.isspace() it excludes U+001C..U+001F.
+ */
+inline bool is_unicode_whitespace(uint32_t cp) {
+    return (cp >= 0x09 && cp <= 0x0D) || cp == 0x20 || cp == 0x85 || cp == 0xA0 ||
+           cp == 0x1680 || (cp >= 0x2000 && cp <= 0x200A) || cp == 0x2028 || cp == 0x2029 ||
+           cp == 0x202F || cp == 0x205F || cp == 0x3000;
+}
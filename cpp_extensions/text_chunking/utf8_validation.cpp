@@ -0,0 +1,312 @@
+#include "utf8_validation.h"
+#include "utf8.h"
+
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#include <immintrin.h>
+#define COSMOS_UTF8_X86 1
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define COSMOS_UTF8_NEON 1
+#endif
+
+using namespace std;
+
+namespace {
+
+/**
+ * Scans for invalid UTF-8 and returns an offset at or before the first
+ * error (the start of the vector block it was detected in), or length if
+ * the data is valid.
+ */
+using ValidateKernel = size_t (*)(const unsigned char* data, size_t length);
+
+/**
+ * Exact scalar validator starting at a code point boundary.
+ *
+ * @return Offset of the first invalid sequence, or length
+ */
+size_t find_invalid_scalar(const unsigned char* data, size_t length, size_t pos) {
+    while (pos < length) {
+        // Skip ASCII a word at a time
+        uint64_t word;
+        if (pos + sizeof(word) <= length) {
+            memcpy(&word, data + pos, sizeof(word));
+            if (!(word & 0x8080808080808080ULL)) {
+                pos += sizeof(word);
+                continue;
+            }
+        }
+
+        unsigned char lead = data[pos];
+        if (lead < 0x80) {
+            ++pos;
+            continue;
+        }
+
+        // Valid range of the second byte narrows for E0, ED, F0 and F4
+        size_t continuation_bytes;
+        unsigned char low = 0x80;
+        unsigned char high = 0xBF;
+        if (lead >= 0xC2 && lead <= 0xDF) {
+            continuation_bytes = 1;
+        } else if (lead >= 0xE0 && lead <= 0xEF) {
+            continuation_bytes = 2;
+            low = lead == 0xE0 ? 0xA0 : 0x80;
+            high = lead == 0xED ? 0x9F : 0xBF;
+        } else if (lead >= 0xF0 && lead <= 0xF4) {
+            continuation_bytes = 3;
+            low = lead == 0xF0 ? 0x90 : 0x80;
+            high = lead == 0xF4 ? 0x8F : 0xBF;
+        } else {
+            return pos;
+        }
+
+        if (length - pos <= continuation_bytes || data[pos + 1] < low || data[pos + 1] > high) {
+            return pos;
+        }
+        for (size_t i = 2; i <= continuation_bytes; ++i) {
+            if (!is_utf8_continuation(data[pos + i])) {
+                return pos;
+            }
+        }
+        pos += continuation_bytes + 1;
+    }
+    return length;
+}
+
+size_t validate_scalar(const unsigned char* data, size_t length) {
+    return find_invalid_scalar(data, length, 0);
+}
+
+// Error classes of the lookup algorithm; a byte pair is invalid when the
+// three table lookups below share a set bit
+constexpr uint8_t kTooShort = 1 << 0;     // lead byte followed by a lead or ASCII byte
+constexpr uint8_t kTooLong = 1 << 1;      // ASCII followed by a continuation
+constexpr uint8_t kOverlong3 = 1 << 2;    // E0 80..9F
+constexpr uint8_t kTooLarge = 1 << 3;     // F4 90..BF, F5..FF
+constexpr uint8_t kSurrogate = 1 << 4;    // ED A0..BF
+constexpr uint8_t kOverlong2 = 1 << 5;    // C0, C1
+constexpr uint8_t kTooLarge1000 = 1 << 6; // F5..FF 80..8F
+constexpr uint8_t kOverlong4 = 1 << 6;    // F0 80..8F
+constexpr uint8_t kTwoConts = 1 << 7;     // continuation following a continuation
+constexpr uint8_t kCarry = kTooShort | kTooLong | kTwoConts;
+
+// Indexed by the high nibble of the previous byte
+alignas(16) const uint8_t kByte1High[16] = {
+    kTooLong, kTooLong, kTooLong, kTooLong, kTooLong, kTooLong, kTooLong, kTooLong,
+    kTwoConts, kTwoConts, kTwoConts, kTwoConts,
+    kTooShort | kOverlong2,
+    kTooShort,
+    kTooShort | kOverlong3 | kSurrogate,
+    kTooShort | kTooLarge | kTooLarge1000 | kOverlong4,
+};
+
+// Indexed by the low nibble of the previous byte
+alignas(16) const uint8_t kByte1Low[16] = {
+    kCarry | kOverlong3 | kOverlong2 | kOverlong4,
+    kCarry | kOverlong2,
+    kCarry,
+    kCarry,
+    kCarry | kTooLarge,
+    kCarry | kTooLarge | kTooLarge1000,
+    kCarry | kTooLarge | kTooLarge1000,
+    kCarry | kTooLarge | kTooLarge1000,
+    kCarry | kTooLarge | kTooLarge1000,
+    kCarry | kTooLarge | kTooLarge1000,
+    kCarry | kTooLarge | kTooLarge1000,
+    kCarry | kTooLarge | kTooLarge1000,
+    kCarry | kTooLarge | kTooLarge1000,
+    kCarry | kTooLarge | kTooLarge1000 | kSurrogate,
+    kCarry | kTooLarge | kTooLarge1000,
+    kCarry | kTooLarge | kTooLarge1000,
+};
+
+// Indexed by the high nibble of the current byte
+alignas(16) const uint8_t kByte2High[16] = {
+    kTooShort, kTooShort, kTooShort, kTooShort, kTooShort, kTooShort, kTooShort, kTooShort,
+    kTooLong | kOverlong2 | kTwoConts | kOverlong3 | kTooLarge1000 | kOverlong4,
+    kTooLong | kOverlong2 | kTwoConts | kOverlong3 | kTooLarge,
+    kTooLong | kOverlong2 | kTwoConts | kSurrogate | kTooLarge,
+    kTooLong | kOverlong2 | kTwoConts | kSurrogate | kTooLarge,
+    kTooShort, kTooShort, kTooShort, kTooShort,
+};
+
+// A block ending in one of the last three positions with a lead byte at
+// least this large still expects continuation bytes
+alignas(32) const uint8_t kIncompleteMax[32] = {
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 0xEF, 0xDF, 0xBF,
+};
+
+#ifdef COSMOS_UTF8_X86
+__attribute__((target("avx2")))
+inline __m256i broadcast_table(const uint8_t* table) {
+    return _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(table)));
+}
+
+// The 32 bytes ending N bytes before the end of input
+template <int N>
+__attribute__((target("avx2")))
+inline __m256i previous_bytes(__m256i input, __m256i previous_input) {
+    return _mm256_alignr_epi8(input, _mm256_permute2x128_si256(previous_input, input, 0x21), 16 - N);
+}
+
+__attribute__((target("avx2")))
+size_t validate_avx2(const unsigned char* data, size_t length) {
+    const __m256i byte1_high = broadcast_table(kByte1High);
+    const __m256i byte1_low = broadcast_table(kByte1Low);
+    const __m256i byte2_high = broadcast_table(kByte2High);
+    const __m256i incomplete_max = _mm256_load_si256(reinterpret_cast<const __m256i*>(kIncompleteMax));
+    const __m256i low_nibble = _mm256_set1_epi8(0x0F);
+    const __m256i high_bit = _mm256_set1_epi8(static_cast<char>(0x80));
+
+    __m256i previous_input = _mm256_setzero_si256();
+    __m256i previous_incomplete = _mm256_setzero_si256();
+    unsigned char padded[32];
+
+    for (size_t pos = 0; pos < length; pos += 32) {
+        __m256i input;
+        if (pos + 32 <= length) {
+            input = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + pos));
+        } else {
+            // Zero padding is ASCII, so a truncated final sequence is reported as too short
+            memset(padded, 0, sizeof(padded));
+            memcpy(padded, data + pos, length - pos);
+            input = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(padded));
+        }
+
+        // A sequence left open by the previous block is caught by the
+        // lookups below, or here if this block is all ASCII
+        __m256i error;
+        if (!_mm256_movemask_epi8(input)) {
+            error = previous_incomplete;
+            previous_incomplete = _mm256_setzero_si256();
+        } else {
+            __m256i prev1 = previous_bytes<1>(input, previous_input);
+            __m256i special_cases = _mm256_and_si256(
+                _mm256_and_si256(
+                    _mm256_shuffle_epi8(byte1_high, _mm256_and_si256(_mm256_srli_epi16(prev1, 4), low_nibble)),
+                    _mm256_shuffle_epi8(byte1_low, _mm256_and_si256(prev1, low_nibble))),
+                _mm256_shuffle_epi8(byte2_high, _mm256_and_si256(_mm256_srli_epi16(input, 4), low_nibble)));
+
+            // Third and fourth bytes of a sequence must be continuations, and nothing else may be
+            __m256i third = _mm256_subs_epu8(previous_bytes<2>(input, previous_input), _mm256_set1_epi8(0xE0 - 0x80));
+            __m256i fourth = _mm256_subs_epu8(previous_bytes<3>(input, previous_input), _mm256_set1_epi8(0xF0 - 0x80));
+            __m256i must_continue = _mm256_and_si256(_mm256_or_si256(third, fourth), high_bit);
+            error = _mm256_xor_si256(must_continue, special_cases);
+            previous_incomplete = _mm256_subs_epu8(input, incomplete_max);
+        }
+
+        if (!_mm256_testz_si256(error, error)) {
+            return pos;
+        }
+        previous_input = input;
+    }
+
+    if (!_mm256_testz_si256(previous_incomplete, previous_incomplete)) {
+        return (length - 1) / 32 * 32;
+    }
+    return length;
+}
+#endif
+
+#ifdef COSMOS_UTF8_NEON
+size_t validate_neon(const unsigned char* data, size_t length) {
+    const uint8x16_t byte1_high = vld1q_u8(kByte1High);
+    const uint8x16_t byte1_low = vld1q_u8(kByte1Low);
+    const uint8x16_t byte2_high = vld1q_u8(kByte2High);
+    const uint8x16_t incomplete_max = vld1q_u8(kIncompleteMax + 16);
+    const uint8x16_t low_nibble = vdupq_n_u8(0x0F);
+
+    uint8x16_t previous_input = vdupq_n_u8(0);
+    uint8x16_t previous_incomplete = vdupq_n_u8(0);
+    unsigned char padded[16];
+
+    for (size_t pos = 0; pos < length; pos += 16) {
+        uint8x16_t input;
+        if (pos + 16 <= length) {
+            input = vld1q_u8(data + pos);
+        } else {
+            memset(padded, 0, sizeof(padded));
+            memcpy(padded, data + pos, length - pos);
+            input = vld1q_u8(padded);
+        }
+
+        uint8x16_t error;
+        if (vmaxvq_u8(input) < 0x80) {
+            error = previous_incomplete;
+            previous_incomplete = vdupq_n_u8(0);
+        } else {
+            uint8x16_t prev1 = vextq_u8(previous_input, input, 15);
+            uint8x16_t special_cases = vandq_u8(
+                vandq_u8(vqtbl1q_u8(byte1_high, vshrq_n_u8(prev1, 4)),
+                         vqtbl1q_u8(byte1_low, vandq_u8(prev1, low_nibble))),
+                vqtbl1q_u8(byte2_high, vshrq_n_u8(input, 4)));
+
+            uint8x16_t third = vqsubq_u8(vextq_u8(previous_input, input, 14), vdupq_n_u8(0xE0 - 0x80));
+            uint8x16_t fourth = vqsubq_u8(vextq_u8(previous_input, input, 13), vdupq_n_u8(0xF0 - 0x80));
+            uint8x16_t must_continue = vandq_u8(vorrq_u8(third, fourth), vdupq_n_u8(0x80));
+            error = veorq_u8(must_continue, special_cases);
+            previous_incomplete = vqsubq_u8(input, incomplete_max);
+        }
+
+        if (vmaxvq_u8(error)) {
+            return pos;
+        }
+        previous_input = input;
+    }
+
+    if (vmaxvq_u8(previous_incomplete)) {
+        return (length - 1) / 16 * 16;
+    }
+    return length;
+}
+#endif
+
+struct SelectedKernel {
+    ValidateKernel kernel;
+    const char* name;
+};
+
+SelectedKernel select_kernel() {
+#if defined(COSMOS_UTF8_X86) && (defined(__GNUC__) || defined(__clang__))
+    if (__builtin_cpu_supports("avx2")) {
+        return {validate_avx2, "avx2"};
+    }
+#elif defined(COSMOS_UTF8_NEON)
+    return {validate_neon, "neon"};
+#endif
+    return {validate_scalar, "scalar"};
+}
+
+const SelectedKernel& active_kernel() {
+    static const SelectedKernel selected = select_kernel();
+    return selected;
+}
+
+}  // namespace
+
+const char* utf8_validator_backend() {
+    return active_kernel().name;
+}
+
+size_t find_invalid_utf8(string_view text) {
+    const unsigned char* data = reinterpret_cast<const unsigned char*>(text.data());
+    size_t detected = active_kernel().kernel(data, text.length());
+    if (detected >= text.length()) {
+        return string_view::npos;
+    }
+
+    // The error may involve a sequence that started up to three bytes
+    // before the flagged block; everything earlier is valid, so back up to
+    // a lead byte and locate it exactly
+    size_t pos = detected >= 3 ? detected - 3 : 0;
+    while (pos > 0 && is_utf8_continuation(data[pos])) {
+        --pos;
+    }
+    size_t invalid = find_invalid_scalar(data, text.length(), pos);
+    return invalid < text.length() ? invalid : string_view::npos;
+}
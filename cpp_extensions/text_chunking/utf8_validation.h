@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+
+/**
+ * Strict UTF-8 validation (RFC 3629: no overlong forms, surrogates or code
+ * points above U+10FFFF), vectorized with the lookup-table algorithm of
+ * Keiser and Lemire (AVX2 on x86-64, NEON on AArch64, scalar otherwise;
+ * selected at runtime).
+ *
+ * @return Byte offset of the first invalid or truncated sequence, or
+ *         std::string_view::npos if the whole text is valid
+ */
+size_t find_invalid_utf8(std::string_view text);
+
+inline bool is_valid_utf8(std::string_view text) {
+    return find_invalid_utf8(text) == std::string_view::npos;
+}
+
+/**
+ * Name of the validation kernel selected for this CPU ("avx2", "neon" or "scalar").
+ */
+const char* utf8_validator_backend();
@@ -0,0 +1,51 @@
+#include "word_chunker.h"
+#include "boundary_scanner.h"
+
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+vector<TextSpan> split_words_spans(const BoundaryIndex& index, int chunk_size_words, int chunk_overlap_words) {
+    if (chunk_size_words <= 0) {
+        throw invalid_argument("chunk_size_words must be > 0, got " + to_string(chunk_size_words));
+    }
+    if (chunk_overlap_words < 0 || chunk_overlap_words >= chunk_size_words) {
+        throw invalid_argument("chunk_overlap_words must be in [0, chunk_size_words), got " +
+                               to_string(chunk_overlap_words));
+    }
+
+    const size_t size = static_cast<size_t>(chunk_size_words);
+    const size_t step = size - static_cast<size_t>(chunk_overlap_words);
+    const size_t length = index.text().length();
+
+    // Ring buffer holding the start offsets of the last `size` words
+    vector<size_t> word_starts(size);
+    vector<TextSpan> chunks;
+
+    size_t word_count = 0;
+    size_t chunk_first_word = 0;
+    size_t last_word_end = 0;
+
+    for (size_t pos = index.find_non_whitespace(0, length); pos != BoundaryIndex::npos;
+         pos = index.find_non_whitespace(last_word_end, length)) {
+        size_t end = index.find_whitespace(pos, length);
+        last_word_end = end == BoundaryIndex::npos ? length : end;
+        word_starts[word_count % size] = pos;
+
+        if (word_count == chunk_first_word + size - 1) {
+            chunks.push_back({word_starts[chunk_first_word % size], last_word_end});
+            chunk_first_word += step;
+        }
+        ++word_count;
+    }
+
+    // Emit the trailing partial chunk unless its words were all covered already
+    bool has_unemitted_words = chunks.empty() ? word_count > 0
+                                              : word_count > chunk_first_word - step + size;
+    if (has_unemitted_words) {
+        chunks.push_back({word_starts[chunk_first_word % size], last_word_end});
+    }
+
+    return chunks;
+}
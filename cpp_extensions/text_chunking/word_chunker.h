@@ -0,0 +1,25 @@
+#pragma once
+
+#include <string_view>
+#include <vector>
+
+#include "text_span.h"
+
+class BoundaryIndex;
+
+/**
+ * Splits text into chunks of exactly chunk_size_words whitespace-delimited words,
+ * each starting chunk_size_words - chunk_overlap_words words after the previous
+ * one. The final chunk may be shorter.
+ *
+ * Words are located in a single pass over the boundary index, which itself
+ * takes O(n) memory (four bit masks per 64 bytes, about n/2 bytes). Beyond
+ * it, only the start offsets of the current window of words are kept, so the
+ * per-window state is constant in the document's length.
+ *
+ * @param index Boundary index of the input text
+ * @param chunk_size_words Number of words per chunk (> 0)
+ * @param chunk_overlap_words Number of words shared by consecutive chunks (< chunk_size_words)
+ * @return [start, end) byte offsets from the first word's start to the last word's end
+ */
+std::vector<TextSpan> split_words_spans(const BoundaryIndex& index, int chunk_size_words, int chunk_overlap_words);
@@ -0,0 +1,528 @@
+#include "embedding_index.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_set>
+
+#include "thread_pool.h"
+
+using namespace std;
+
+namespace {
+
+// File layout, native byte order (all supported targets are little-endian):
+// 64-byte header, rows (row_count * stride, 64-byte aligned in the file so a
+// mapping keeps them aligned), int8 scales (float per row, int8 only),
+// deleted flags (byte per row), id offsets (u64 per row plus one), id bytes,
+// then the graph if has_graph is set.
+const char kIndexMagic[4] = {'C', 'V', 'I', 'X'};
+const uint32_t kIndexVersion = 1;
+constexpr size_t kHeaderSize = 64;
+constexpr size_t kRowAlignment = 64;
+
+struct FileHeader {
+    char magic[4];
+    uint32_t version;
+    uint8_t type;
+    uint8_t normalize;
+    uint8_t has_graph;
+    uint8_t reserved[5];
+    uint64_t dim;
+    uint64_t row_count;
+    uint64_t stride;
+};
+static_assert(sizeof(FileHeader) <= kHeaderSize, "header must fit its slot");
+
+// Below this many live rows a scan is as fast as walking the graph
+constexpr size_t kAutoGraphMinRows = 2048;
+
+// Rows per brute force task
+constexpr size_t kScanBlockRows = 4096;
+
+size_t round_up(size_t value, size_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+// Appends (score, row) to a min-heap of the k best
+void push_top_k(vector<pair<float, uint32_t>>& heap, size_t k, float score, uint32_t row) {
+    auto worse = [](const pair<float, uint32_t>& a, const pair<float, uint32_t>& b) { return a > b; };
+    if (heap.size() < k) {
+        heap.emplace_back(score, row);
+        push_heap(heap.begin(), heap.end(), worse);
+    } else if (score > heap.front().first) {
+        pop_heap(heap.begin(), heap.end(), worse);
+        heap.back() = {score, row};
+        push_heap(heap.begin(), heap.end(), worse);
+    }
+}
+
+class Reader {
+public:
+    Reader(const char* data, size_t size) : data_(data), size_(size) {}
+
+    const char* take(size_t bytes) {
+        if (size_ - offset_ < bytes) {
+            throw runtime_error("Corrupt vector index file: truncated");
+        }
+        const char* out = data_ + offset_;
+        offset_ += bytes;
+        return out;
+    }
+
+    // Bytes for count items of item_size, guarding the multiplication
+    const char* take_array(size_t count, size_t item_size) {
+        if (count > (size_ - offset_) / item_size) {
+            throw runtime_error("Corrupt vector index file: truncated");
+        }
+        return take(count * item_size);
+    }
+
+    size_t offset() const { return offset_; }
+    size_t remaining() const { return size_ - offset_; }
+    void skip(size_t bytes) { take(bytes); }
+
+private:
+    const char* data_;
+    size_t size_;
+    size_t offset_ = 0;
+};
+
+}  // namespace
+
+VectorIndexStats& vector_index_stats() {
+    static VectorIndexStats stats;
+    return stats;
+}
+
+SearchMode parse_search_mode(const string& name) {
+    if (name == "auto") {
+        return SearchMode::Auto;
+    }
+    if (name == "brute_force") {
+        return SearchMode::BruteForce;
+    }
+    if (name == "hnsw") {
+        return SearchMode::Hnsw;
+    }
+    throw invalid_argument("Unknown search mode '" + name + "', expected auto, brute_force or hnsw");
+}
+
+struct EmbeddingIndex::EncodedQuery {
+    vector<float> values;    // float16 rows
+    vector<int8_t> codes;    // int8 rows
+    float scale = 0.0f;
+};
+
+EmbeddingIndex::EmbeddingIndex(const EmbeddingIndexOptions& options) : options_(options) {
+    if (options_.dim == 0) {
+        throw invalid_argument("Vector dimension must be positive");
+    }
+    stride_ = round_up(options_.dim * vector_type_size(options_.type), kRowAlignment);
+    padded_dim_ = stride_ / vector_type_size(options_.type);
+    if (options_.hnsw_m > 0) {
+        graph_ = make_unique<HnswGraph>(options_.hnsw_m, options_.ef_construction);
+    }
+}
+
+EmbeddingIndex::~EmbeddingIndex() {
+    free(owned_);
+}
+
+size_t EmbeddingIndex::size() const {
+    shared_lock<shared_mutex> lock(mutex_);
+    return rows_by_id_.size();
+}
+
+size_t EmbeddingIndex::removed() const {
+    shared_lock<shared_mutex> lock(mutex_);
+    return row_count_ - rows_by_id_.size();
+}
+
+bool EmbeddingIndex::contains(const string& id) const {
+    shared_lock<shared_mutex> lock(mutex_);
+    return rows_by_id_.count(id) > 0;
+}
+
+EmbeddingIndex::EncodedQuery EmbeddingIndex::encode_query(const float* query) const {
+    EncodedQuery encoded;
+    encoded.values.assign(query, query + options_.dim);
+    if (options_.normalize) {
+        normalize_vector(encoded.values.data(), options_.dim);
+    }
+    encoded.values.resize(padded_dim_, 0.0f);
+    if (options_.type == VectorType::Int8) {
+        encoded.codes.resize(padded_dim_);
+        encoded.scale = encode_int8(encoded.values.data(), padded_dim_, encoded.codes.data());
+    }
+    return encoded;
+}
+
+// A stored row as a query, used to link it into the graph
+void EmbeddingIndex::row_query(size_t row, EncodedQuery& out) const {
+    if (options_.type == VectorType::Float16) {
+        out.values.resize(padded_dim_);
+        decode_float16(reinterpret_cast<const uint16_t*>(row_data(row)), padded_dim_, out.values.data());
+    } else {
+        const int8_t* codes = reinterpret_cast<const int8_t*>(row_data(row));
+        out.codes.assign(codes, codes + padded_dim_);
+        out.scale = scales_[row];
+    }
+}
+
+float EmbeddingIndex::score(const EncodedQuery& query, size_t row) const {
+    if (options_.type == VectorType::Float16) {
+        return dot_float16(query.values.data(), reinterpret_cast<const uint16_t*>(row_data(row)), padded_dim_);
+    }
+    return static_cast<float>(dot_int8(query.codes.data(), reinterpret_cast<const int8_t*>(row_data(row)),
+                                       padded_dim_)) *
+           query.scale * scales_[row];
+}
+
+void EmbeddingIndex::reserve_rows(size_t rows) {
+    if (rows <= capacity_) {
+        return;
+    }
+    const size_t capacity = max({rows, capacity_ * 2, size_t{16}});
+    char* grown = static_cast<char*>(aligned_alloc(kRowAlignment, capacity * stride_));
+    if (!grown) {
+        throw bad_alloc();
+    }
+    if (row_count_ > 0) {
+        memcpy(grown, rows_, row_count_ * stride_);
+    }
+    free(owned_);
+    owned_ = grown;
+    rows_ = owned_;
+    capacity_ = capacity;
+}
+
+// Copies mapped rows so they can be modified
+void EmbeddingIndex::make_writable() {
+    if (!mapped_) {
+        return;
+    }
+    reserve_rows(max<size_t>(row_count_, 1));
+    mapped_.reset();
+}
+
+void EmbeddingIndex::append_row(const float* vector, const string& id) {
+    const size_t row = row_count_;
+    EncodedQuery encoded = encode_query(vector);
+    char* out = owned_ + row * stride_;
+    memset(out, 0, stride_);
+    if (options_.type == VectorType::Float16) {
+        encode_float16(encoded.values.data(), options_.dim, reinterpret_cast<uint16_t*>(out));
+        scales_.push_back(1.0f);
+    } else {
+        memcpy(out, encoded.codes.data(), options_.dim);
+        scales_.push_back(encoded.scale);
+    }
+    deleted_.push_back(0);
+    ids_.push_back(id);
+    rows_by_id_[id] = static_cast<uint32_t>(row);
+    ++row_count_;
+}
+
+void EmbeddingIndex::link_row(size_t row) {
+    EncodedQuery query;
+    row_query(row, query);
+    EncodedQuery decoded;
+    size_t decoded_row = SIZE_MAX;
+    // Pruning compares one node against several in a row, so keep it decoded
+    auto between = [&](uint32_t a, uint32_t b) {
+        if (a != decoded_row) {
+            row_query(a, decoded);
+            decoded_row = a;
+        }
+        return score(decoded, b);
+    };
+    graph_->insert([&](uint32_t node) { return score(query, node); }, between);
+}
+
+void EmbeddingIndex::add(const float* vectors, size_t count, const vector<string>& ids) {
+    if (ids.size() != count) {
+        throw invalid_argument("Got " + to_string(ids.size()) + " ids for " + to_string(count) + " vectors");
+    }
+    unordered_set<string> seen;
+    for (const string& id : ids) {
+        if (!seen.insert(id).second) {
+            throw invalid_argument("Duplicate id '" + id + "'");
+        }
+    }
+    for (size_t i = 0; i < count * options_.dim; ++i) {
+        if (!isfinite(vectors[i])) {
+            throw invalid_argument("Vectors must be finite");
+        }
+    }
+
+    VectorIndexStats& stats = vector_index_stats();
+    ScopedTimer timer(stats.add);
+    unique_lock<shared_mutex> lock(mutex_);
+    make_writable();
+    reserve_rows(row_count_ + count);
+    for (size_t i = 0; i < count; ++i) {
+        auto existing = rows_by_id_.find(ids[i]);
+        if (existing != rows_by_id_.end()) {
+            deleted_[existing->second] = 1;
+            rows_by_id_.erase(existing);
+        }
+        append_row(vectors + i * options_.dim, ids[i]);
+        if (graph_) {
+            link_row(row_count_ - 1);
+        }
+    }
+    stats.added.add(count);
+}
+
+bool EmbeddingIndex::remove(const string& id) {
+    unique_lock<shared_mutex> lock(mutex_);
+    auto existing = rows_by_id_.find(id);
+    if (existing == rows_by_id_.end()) {
+        return false;
+    }
+    // Flags live outside the row data, so a mapped index stays mapped
+    deleted_[existing->second] = 1;
+    rows_by_id_.erase(existing);
+    return true;
+}
+
+void EmbeddingIndex::compact() {
+    unique_lock<shared_mutex> lock(mutex_);
+    if (rows_by_id_.size() == row_count_) {
+        return;
+    }
+    make_writable();
+    size_t kept = 0;
+    for (size_t row = 0; row < row_count_; ++row) {
+        if (deleted_[row]) {
+            continue;
+        }
+        if (kept != row) {
+            memcpy(owned_ + kept * stride_, owned_ + row * stride_, stride_);
+            scales_[kept] = scales_[row];
+            ids_[kept] = move(ids_[row]);
+        }
+        rows_by_id_[ids_[kept]] = static_cast<uint32_t>(kept);
+        ++kept;
+    }
+    row_count_ = kept;
+    scales_.resize(kept);
+    ids_.resize(kept);
+    deleted_.assign(kept, 0);
+
+    if (graph_) {
+        graph_ = make_unique<HnswGraph>(graph_->m(), graph_->ef_construction());
+        for (size_t row = 0; row < row_count_; ++row) {
+            link_row(row);
+        }
+    }
+}
+
+vector<pair<uint32_t, float>> EmbeddingIndex::brute_force(const EncodedQuery& query, size_t k,
+                                                          size_t num_threads) const {
+    const size_t blocks = (row_count_ + kScanBlockRows - 1) / kScanBlockRows;
+    vector<vector<pair<float, uint32_t>>> block_best(blocks);
+    shared_thread_pool().parallel_for(
+        blocks,
+        [&](size_t block) {
+            vector<pair<float, uint32_t>>& heap = block_best[block];
+            heap.reserve(k + 1);
+            const size_t end = min(row_count_, (block + 1) * kScanBlockRows);
+            for (size_t row = block * kScanBlockRows; row < end; ++row) {
+                if (!deleted_[row]) {
+                    push_top_k(heap, k, score(query, row), static_cast<uint32_t>(row));
+                }
+            }
+        },
+        num_threads);
+
+    vector<pair<float, uint32_t>> merged;
+    for (const vector<pair<float, uint32_t>>& heap : block_best) {
+        for (const pair<float, uint32_t>& entry : heap) {
+            push_top_k(merged, k, entry.first, entry.second);
+        }
+    }
+    sort(merged.begin(), merged.end(), greater<pair<float, uint32_t>>());
+    vector<pair<uint32_t, float>> out;
+    out.reserve(merged.size());
+    for (const pair<float, uint32_t>& entry : merged) {
+        out.emplace_back(entry.second, entry.first);
+    }
+    return out;
+}
+
+vector<pair<string, float>> EmbeddingIndex::search(const float* query, size_t k, SearchMode mode, size_t ef,
+                                                   size_t num_threads) const {
+    VectorIndexStats& stats = vector_index_stats();
+    ScopedTimer timer(stats.search);
+    stats.searches.add();
+    const EncodedQuery encoded = encode_query(query);
+
+    shared_lock<shared_mutex> lock(mutex_);
+    if (mode == SearchMode::Hnsw && !graph_) {
+        throw invalid_argument("Index was built without a graph (hnsw_m=0)");
+    }
+    const bool use_graph = graph_ && (mode == SearchMode::Hnsw ||
+                                      (mode == SearchMode::Auto && rows_by_id_.size() >= kAutoGraphMinRows));
+
+    vector<pair<uint32_t, float>> best;
+    if (k > 0 && !rows_by_id_.empty()) {
+        if (use_graph) {
+            uint64_t scored = 0;
+            best = graph_->search(
+                [&](uint32_t node) {
+                    ++scored;
+                    return score(encoded, node);
+                },
+                k, ef, [&](uint32_t node) { return !deleted_[node]; });
+            stats.scored.add(scored);
+        } else {
+            best = brute_force(encoded, k, num_threads);
+            stats.scored.add(rows_by_id_.size());
+        }
+    }
+
+    vector<pair<string, float>> out;
+    out.reserve(best.size());
+    for (const pair<uint32_t, float>& entry : best) {
+        out.emplace_back(ids_[entry.first], entry.second);
+    }
+    return out;
+}
+
+void EmbeddingIndex::save(const string& path) const {
+    VectorIndexStats& stats = vector_index_stats();
+    ScopedTimer timer(stats.save);
+
+    // Write next to the target and rename, so readers never see a partial file
+    const string temp_path = path + ".tmp";
+    {
+        ofstream out(temp_path, ios::binary | ios::trunc);
+        if (!out) {
+            throw runtime_error("Failed to open " + temp_path + " for writing");
+        }
+
+        shared_lock<shared_mutex> lock(mutex_);
+        char header_bytes[kHeaderSize] = {};
+        FileHeader header{};
+        memcpy(header.magic, kIndexMagic, sizeof(kIndexMagic));
+        header.version = kIndexVersion;
+        header.type = static_cast<uint8_t>(options_.type);
+        header.normalize = options_.normalize ? 1 : 0;
+        header.has_graph = graph_ ? 1 : 0;
+        header.dim = options_.dim;
+        header.row_count = row_count_;
+        header.stride = stride_;
+        memcpy(header_bytes, &header, sizeof(header));
+        out.write(header_bytes, sizeof(header_bytes));
+
+        out.write(rows_, static_cast<streamsize>(row_count_ * stride_));
+        if (options_.type == VectorType::Int8) {
+            out.write(reinterpret_cast<const char*>(scales_.data()),
+                      static_cast<streamsize>(row_count_ * sizeof(float)));
+        }
+        out.write(reinterpret_cast<const char*>(deleted_.data()), static_cast<streamsize>(row_count_));
+        uint64_t offset = 0;
+        out.write(reinterpret_cast<const char*>(&offset), sizeof(offset));
+        for (const string& id : ids_) {
+            offset += id.size();
+            out.write(reinterpret_cast<const char*>(&offset), sizeof(offset));
+        }
+        for (const string& id : ids_) {
+            out.write(id.data(), static_cast<streamsize>(id.size()));
+        }
+        if (graph_) {
+            string graph;
+            graph_->write(graph);
+            out.write(graph.data(), static_cast<streamsize>(graph.size()));
+        }
+
+        if (!out.flush()) {
+            throw runtime_error("Failed to write " + temp_path);
+        }
+    }
+    if (rename(temp_path.c_str(), path.c_str()) != 0) {
+        std::remove(temp_path.c_str());
+        throw runtime_error("Failed to replace " + path);
+    }
+}
+
+unique_ptr<EmbeddingIndex> EmbeddingIndex::load(const string& path) {
+    VectorIndexStats& stats = vector_index_stats();
+    ScopedTimer timer(stats.load);
+
+    auto mapped = make_unique<MappedFile>(path);
+    Reader reader(mapped->data(), mapped->size());
+    FileHeader header;
+    memcpy(&header, reader.take(kHeaderSize), sizeof(header));
+    if (memcmp(header.magic, kIndexMagic, sizeof(kIndexMagic)) != 0) {
+        throw runtime_error(path + " is not a vector index");
+    }
+    if (header.version != kIndexVersion) {
+        throw runtime_error("Unsupported vector index version " + to_string(header.version) + " in " + path);
+    }
+    if (header.type != static_cast<uint8_t>(VectorType::Float16) &&
+        header.type != static_cast<uint8_t>(VectorType::Int8)) {
+        throw runtime_error("Corrupt vector index file: unknown vector type");
+    }
+
+    EmbeddingIndexOptions options;
+    options.type = static_cast<VectorType>(header.type);
+    options.dim = header.dim;
+    options.normalize = header.normalize != 0;
+    options.hnsw_m = 0;
+    if (options.dim == 0 || options.dim > (SIZE_MAX >> 4) ||
+        header.stride != round_up(options.dim * vector_type_size(options.type), kRowAlignment) ||
+        header.row_count > UINT32_MAX) {
+        throw runtime_error("Corrupt vector index file: bad header");
+    }
+    auto index = make_unique<EmbeddingIndex>(options);
+    const size_t rows = header.row_count;
+
+    index->rows_ = reader.take_array(rows, index->stride_);
+    if (options.type == VectorType::Int8) {
+        const char* scales = reader.take_array(rows, sizeof(float));
+        index->scales_.resize(rows);
+        memcpy(index->scales_.data(), scales, rows * sizeof(float));
+    } else {
+        index->scales_.assign(rows, 1.0f);
+    }
+    const char* deleted = reader.take_array(rows, 1);
+    index->deleted_.assign(deleted, deleted + rows);
+
+    vector<uint64_t> offsets(rows + 1);
+    memcpy(offsets.data(), reader.take_array(rows + 1, sizeof(uint64_t)), offsets.size() * sizeof(uint64_t));
+    // Offsets must ascend before any id is read, or one could point past the id bytes
+    if (offsets[0] != 0 || offsets[rows] > reader.remaining() || !is_sorted(offsets.begin(), offsets.end())) {
+        throw runtime_error("Corrupt vector index file: bad id table");
+    }
+    const char* id_bytes = reader.take(offsets[rows]);
+    index->ids_.reserve(rows);
+    index->rows_by_id_.reserve(rows);
+    for (size_t row = 0; row < rows; ++row) {
+        index->ids_.emplace_back(id_bytes + offsets[row], offsets[row + 1] - offsets[row]);
+        if (!index->deleted_[row] && !index->rows_by_id_.emplace(index->ids_.back(), row).second) {
+            throw runtime_error("Corrupt vector index file: duplicate id");
+        }
+    }
+
+    if (header.has_graph) {
+        index->graph_ = make_unique<HnswGraph>(2, 2);
+        reader.skip(index->graph_->read(mapped->data() + reader.offset(), reader.remaining(), rows));
+        index->options_.hnsw_m = index->graph_->m();
+        index->options_.ef_construction = index->graph_->ef_construction();
+    }
+    if (reader.remaining() != 0) {
+        throw runtime_error("Corrupt vector index file: trailing data");
+    }
+
+    index->row_count_ = rows;
+    index->mapped_ = move(mapped);
+    return index;
+}
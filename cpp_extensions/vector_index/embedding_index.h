@@ -0,0 +1,152 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "hnsw_graph.h"
+#include "mapped_file.h"
+#include "stats.h"
+#include "vector_kernels.h"
+
+/**
+ * Metrics reported by vector_index.get_stats(). "scored" counts vectors
+ * compared against a query, by brute force or while walking the graph.
+ */
+struct VectorIndexStats {
+    StatCounter& added = stat_counter("vector_index", "added");
+    StatCounter& searches = stat_counter("vector_index", "searches");
+    StatCounter& scored = stat_counter("vector_index", "scored");
+    StatHistogram& add = stat_histogram("vector_index", "add");
+    StatHistogram& search = stat_histogram("vector_index", "search");
+    StatHistogram& save = stat_histogram("vector_index", "save");
+    StatHistogram& load = stat_histogram("vector_index", "load");
+};
+
+VectorIndexStats& vector_index_stats();
+
+struct EmbeddingIndexOptions {
+    size_t dim = 0;
+    VectorType type = VectorType::Float16;
+    bool normalize = true;         // store unit vectors, so scores are cosine similarities
+    size_t hnsw_m = 16;            // graph links per node, 0 for brute force only
+    size_t ef_construction = 200;  // candidate list size while linking a node
+};
+
+enum class SearchMode {
+    Auto,        // graph once the index is large enough to benefit, else brute force
+    BruteForce,  // exact, scans every vector
+    Hnsw,        // approximate graph search
+};
+
+/**
+ * Parses "auto", "brute_force" or "hnsw"; throws invalid_argument for anything else.
+ */
+SearchMode parse_search_mode(const std::string& name);
+
+/**
+ * In-process store of id-tagged embeddings with inner product search, for
+ * local or offline use without a vector database.
+ *
+ * Vectors are stored as float16 or int8 rows padded to 64 bytes and scored
+ * with the SIMD kernels of vector_kernels.h. Queries stay float32 against
+ * float16 rows and are quantized like the rows for int8. Adding an existing
+ * id replaces its vector; removed and replaced rows are skipped by searches
+ * until compact() drops them.
+ *
+ * Searches run concurrently with each other; add, remove and compact take
+ * the index exclusively. A loaded index scores straight from the mapped
+ * file until its first modification.
+ */
+class EmbeddingIndex {
+public:
+    /** @throws std::invalid_argument if dim is 0 */
+    explicit EmbeddingIndex(const EmbeddingIndexOptions& options);
+    ~EmbeddingIndex();
+
+    EmbeddingIndex(const EmbeddingIndex&) = delete;
+    EmbeddingIndex& operator=(const EmbeddingIndex&) = delete;
+
+    const EmbeddingIndexOptions& options() const { return options_; }
+
+    /** Live vectors. */
+    size_t size() const;
+
+    /** Removed and replaced rows that compact() would drop. */
+    size_t removed() const;
+    bool contains(const std::string& id) const;
+
+    /**
+     * Adds count float32 vectors of options().dim values each, row-major.
+     *
+     * @throws std::invalid_argument if ids.size() != count or an id repeats
+     */
+    void add(const float* vectors, size_t count, const std::vector<std::string>& ids);
+
+    /** @return Whether id was present */
+    bool remove(const std::string& id);
+
+    /** Drops removed rows and rebuilds the graph over the live ones. */
+    void compact();
+
+    /**
+     * Best k live vectors for a float32 query of options().dim values.
+     * Brute force splits the rows over up to num_threads threads of the
+     * shared pool (0 for all).
+     *
+     * @param ef Graph search candidate list size, raised to k if smaller
+     * @return (id, score) pairs, best first
+     */
+    std::vector<std::pair<std::string, float>> search(const float* query, size_t k, SearchMode mode, size_t ef,
+                                                      size_t num_threads) const;
+
+    /** Writes the index to path, replacing any existing file. */
+    void save(const std::string& path) const;
+
+    /**
+     * Maps an index written by save().
+     *
+     * @throws std::runtime_error if the file is not a valid index
+     */
+    static std::unique_ptr<EmbeddingIndex> load(const std::string& path);
+
+private:
+    struct EncodedQuery;
+
+    EncodedQuery encode_query(const float* query) const;
+    void row_query(size_t row, EncodedQuery& out) const;
+    float score(const EncodedQuery& query, size_t row) const;
+    const char* row_data(size_t row) const { return rows_ + row * stride_; }
+
+    void reserve_rows(size_t rows);
+    void make_writable();
+    void append_row(const float* vector, const std::string& id);
+    void link_row(size_t row);
+
+    std::vector<std::pair<uint32_t, float>> brute_force(const EncodedQuery& query, size_t k,
+                                                        size_t num_threads) const;
+
+    EmbeddingIndexOptions options_;
+    size_t stride_;      // bytes per row, a multiple of 64
+    size_t padded_dim_;  // elements per row; rows and encoded queries are zero past dim
+
+    // Rows point into owned_ (64-byte aligned) or mapped_
+    char* owned_ = nullptr;
+    size_t capacity_ = 0;
+    std::unique_ptr<MappedFile> mapped_;
+    const char* rows_ = nullptr;
+    size_t row_count_ = 0;
+
+    std::vector<float> scales_;  // int8 dequantization scale per row
+    std::vector<uint8_t> deleted_;
+    std::vector<std::string> ids_;
+    std::unordered_map<std::string, uint32_t> rows_by_id_;
+    std::unique_ptr<HnswGraph> graph_;
+
+    mutable std::shared_mutex mutex_;
+};
@@ -0,0 +1,289 @@
+#include "hnsw_graph.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <queue>
+#include <stdexcept>
+
+using namespace std;
+
+namespace {
+
+constexpr int kMaxLayer = 32;
+
+// Visited marks for search_layer. A node is visited when its tag equals the
+// current generation, so clearing is O(1) between searches.
+class VisitedSet {
+public:
+    void reset(size_t size) {
+        if (tags_.size() < size) {
+            tags_.resize(size, 0);
+        }
+        if (++generation_ == 0) {
+            fill(tags_.begin(), tags_.end(), 0);
+            generation_ = 1;
+        }
+    }
+
+    // Marks node, returning whether it was already visited
+    bool test_and_set(uint32_t node) {
+        if (tags_[node] == generation_) {
+            return true;
+        }
+        tags_[node] = generation_;
+        return false;
+    }
+
+private:
+    vector<uint32_t> tags_;
+    uint32_t generation_ = 0;
+};
+
+VisitedSet& thread_visited_set() {
+    thread_local VisitedSet visited;
+    return visited;
+}
+
+template <typename T>
+void append_pod(string& out, T value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+template <typename T>
+T read_pod(const char* data, size_t size, size_t& offset) {
+    if (size - offset < sizeof(T)) {
+        throw runtime_error("Corrupt vector index file: graph truncated");
+    }
+    T value;
+    memcpy(&value, data + offset, sizeof(T));
+    offset += sizeof(T);
+    return value;
+}
+
+}  // namespace
+
+HnswGraph::HnswGraph(size_t m, size_t ef_construction, uint64_t seed)
+    : m_(max<size_t>(m, 2)),
+      ef_construction_(max(ef_construction, m_)),
+      level_scale_(1.0 / log(static_cast<double>(m_))),
+      rng_(seed) {}
+
+uint32_t HnswGraph::greedy_closest(const QuerySimilarity& similarity, uint32_t entry, float entry_similarity,
+                                   int layer, float* best_similarity) const {
+    uint32_t best = entry;
+    float best_score = entry_similarity;
+    for (bool improved = true; improved;) {
+        improved = false;
+        for (uint32_t neighbor : links_[best][layer]) {
+            float score = similarity(neighbor);
+            if (score > best_score) {
+                best_score = score;
+                best = neighbor;
+                improved = true;
+            }
+        }
+    }
+    *best_similarity = best_score;
+    return best;
+}
+
+vector<HnswGraph::Candidate> HnswGraph::search_layer(const QuerySimilarity& similarity, uint32_t entry,
+                                                     float entry_similarity, size_t ef, int layer) const {
+    VisitedSet& visited = thread_visited_set();
+    visited.reset(links_.size());
+    visited.test_and_set(entry);
+
+    // Frontier ordered best first; results ordered worst first so the tail drops off
+    priority_queue<Candidate> frontier;
+    priority_queue<Candidate, vector<Candidate>, greater<Candidate>> results;
+    frontier.emplace(entry_similarity, entry);
+    results.emplace(entry_similarity, entry);
+
+    while (!frontier.empty()) {
+        Candidate current = frontier.top();
+        if (results.size() >= ef && current.first < results.top().first) {
+            break;
+        }
+        frontier.pop();
+        for (uint32_t neighbor : links_[current.second][layer]) {
+            if (visited.test_and_set(neighbor)) {
+                continue;
+            }
+            float score = similarity(neighbor);
+            if (results.size() < ef || score > results.top().first) {
+                frontier.emplace(score, neighbor);
+                results.emplace(score, neighbor);
+                if (results.size() > ef) {
+                    results.pop();
+                }
+            }
+        }
+    }
+
+    vector<Candidate> out;
+    out.reserve(results.size());
+    while (!results.empty()) {
+        out.push_back(results.top());
+        results.pop();
+    }
+    reverse(out.begin(), out.end());
+    return out;
+}
+
+// Malkov's heuristic: keep a candidate only if it is closer to the base node
+// than to every neighbour kept so far, which preserves links across clusters.
+vector<uint32_t> HnswGraph::select_neighbors(vector<Candidate> candidates, size_t max_links,
+                                             const NodeSimilarity& between) const {
+    sort(candidates.begin(), candidates.end(), greater<Candidate>());
+    vector<uint32_t> selected;
+    selected.reserve(max_links);
+    for (const Candidate& candidate : candidates) {
+        if (selected.size() == max_links) {
+            break;
+        }
+        bool diverse = true;
+        for (uint32_t kept : selected) {
+            if (between(candidate.second, kept) > candidate.first) {
+                diverse = false;
+                break;
+            }
+        }
+        if (diverse) {
+            selected.push_back(candidate.second);
+        }
+    }
+    return selected;
+}
+
+void HnswGraph::insert(const QuerySimilarity& to_node, const NodeSimilarity& between) {
+    const uint32_t node = static_cast<uint32_t>(links_.size());
+    uniform_real_distribution<double> unit(numeric_limits<double>::min(), 1.0);
+    const int level = min(kMaxLayer, static_cast<int>(-log(unit(rng_)) * level_scale_));
+    links_.emplace_back(level + 1);
+
+    if (max_layer_ < 0) {
+        entry_point_ = node;
+        max_layer_ = level;
+        return;
+    }
+
+    uint32_t entry = entry_point_;
+    float entry_similarity = to_node(entry);
+    for (int layer = max_layer_; layer > level; --layer) {
+        entry = greedy_closest(to_node, entry, entry_similarity, layer, &entry_similarity);
+    }
+
+    for (int layer = min(level, max_layer_); layer >= 0; --layer) {
+        const size_t max_links = layer == 0 ? 2 * m_ : m_;
+        vector<Candidate> candidates = search_layer(to_node, entry, entry_similarity, ef_construction_, layer);
+        entry = candidates.front().second;
+        entry_similarity = candidates.front().first;
+
+        links_[node][layer] = select_neighbors(candidates, m_, between);
+        for (uint32_t neighbor : links_[node][layer]) {
+            vector<uint32_t>& back = links_[neighbor][layer];
+            back.push_back(node);
+            if (back.size() > max_links) {
+                vector<Candidate> pool;
+                pool.reserve(back.size());
+                for (uint32_t other : back) {
+                    pool.emplace_back(between(neighbor, other), other);
+                }
+                back = select_neighbors(move(pool), max_links, between);
+            }
+        }
+    }
+
+    if (level > max_layer_) {
+        entry_point_ = node;
+        max_layer_ = level;
+    }
+}
+
+vector<pair<uint32_t, float>> HnswGraph::search(const QuerySimilarity& similarity, size_t k, size_t ef,
+                                                const function<bool(uint32_t)>& accept) const {
+    vector<pair<uint32_t, float>> out;
+    if (max_layer_ < 0 || k == 0) {
+        return out;
+    }
+    uint32_t entry = entry_point_;
+    float entry_similarity = similarity(entry);
+    for (int layer = max_layer_; layer > 0; --layer) {
+        entry = greedy_closest(similarity, entry, entry_similarity, layer, &entry_similarity);
+    }
+    for (const Candidate& candidate : search_layer(similarity, entry, entry_similarity, max(ef, k), 0)) {
+        if (accept(candidate.second)) {
+            out.emplace_back(candidate.second, candidate.first);
+            if (out.size() == k) {
+                break;
+            }
+        }
+    }
+    return out;
+}
+
+// Layout: m, ef_construction, entry point, max layer (int32), then per node
+// its level count (uint8) and per level a link count (uint16) and the links.
+void HnswGraph::write(string& out) const {
+    append_pod<uint32_t>(out, static_cast<uint32_t>(m_));
+    append_pod<uint32_t>(out, static_cast<uint32_t>(ef_construction_));
+    append_pod<uint32_t>(out, entry_point_);
+    append_pod<int32_t>(out, max_layer_);
+    for (const vector<vector<uint32_t>>& layers : links_) {
+        append_pod<uint8_t>(out, static_cast<uint8_t>(layers.size()));
+        for (const vector<uint32_t>& neighbors : layers) {
+            append_pod<uint16_t>(out, static_cast<uint16_t>(neighbors.size()));
+            out.append(reinterpret_cast<const char*>(neighbors.data()), neighbors.size() * sizeof(uint32_t));
+        }
+    }
+}
+
+size_t HnswGraph::read(const char* data, size_t size, size_t node_count) {
+    size_t offset = 0;
+    m_ = max<uint32_t>(read_pod<uint32_t>(data, size, offset), 2);
+    ef_construction_ = max<size_t>(read_pod<uint32_t>(data, size, offset), m_);
+    level_scale_ = 1.0 / log(static_cast<double>(m_));
+    entry_point_ = read_pod<uint32_t>(data, size, offset);
+    max_layer_ = read_pod<int32_t>(data, size, offset);
+    if (max_layer_ > kMaxLayer || (node_count == 0) != (max_layer_ < 0) ||
+        (node_count > 0 && entry_point_ >= node_count)) {
+        throw runtime_error("Corrupt vector index file: bad graph header");
+    }
+
+    links_.assign(node_count, {});
+    for (size_t node = 0; node < node_count; ++node) {
+        const size_t levels = read_pod<uint8_t>(data, size, offset);
+        if (levels == 0 || static_cast<int>(levels) - 1 > max_layer_) {
+            throw runtime_error("Corrupt vector index file: bad node level");
+        }
+        links_[node].resize(levels);
+        for (vector<uint32_t>& neighbors : links_[node]) {
+            const size_t count = read_pod<uint16_t>(data, size, offset);
+            if ((size - offset) / sizeof(uint32_t) < count) {
+                throw runtime_error("Corrupt vector index file: graph truncated");
+            }
+            neighbors.resize(count);
+            // An empty vector's data() may be null, which memcpy does not allow
+            if (count != 0) {
+                memcpy(neighbors.data(), data + offset, count * sizeof(uint32_t));
+            }
+            offset += count * sizeof(uint32_t);
+        }
+    }
+    // Links must point at nodes that exist on that layer
+    for (const vector<vector<uint32_t>>& layers : links_) {
+        for (size_t layer = 0; layer < layers.size(); ++layer) {
+            for (uint32_t neighbor : layers[layer]) {
+                if (neighbor >= node_count || links_[neighbor].size() <= layer) {
+                    throw runtime_error("Corrupt vector index file: bad graph link");
+                }
+            }
+        }
+    }
+    if (node_count > 0 && static_cast<int>(links_[entry_point_].size()) - 1 != max_layer_) {
+        throw runtime_error("Corrupt vector index file: bad entry point");
+    }
+    return offset;
+}
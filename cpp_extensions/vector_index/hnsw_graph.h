@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * Hierarchical navigable small world graph (Malkov & Yashunin) over nodes
+ * 0..size()-1, for maximum-similarity search. The graph stores only links;
+ * similarities come from callbacks, so it works with any vector encoding.
+ *
+ * Not thread-safe for insertion; concurrent searches are safe.
+ */
+class HnswGraph {
+public:
+    using QuerySimilarity = std::function<float(uint32_t node)>;
+    using NodeSimilarity = std::function<float(uint32_t a, uint32_t b)>;
+
+    /**
+     * @param m Links per node on the upper layers (2 * m on layer 0)
+     * @param ef_construction Candidate list size while inserting
+     * @param seed Seed of the level generator
+     */
+    HnswGraph(size_t m, size_t ef_construction, uint64_t seed = 0x5eed);
+
+    size_t size() const { return links_.size(); }
+    size_t m() const { return m_; }
+    size_t ef_construction() const { return ef_construction_; }
+
+    /**
+     * Links node size() into the graph.
+     *
+     * @param to_node Similarity of the new node to an existing node
+     * @param between Similarity of two existing nodes, used to prune links
+     */
+    void insert(const QuerySimilarity& to_node, const NodeSimilarity& between);
+
+    /**
+     * Best k nodes by similarity, searching layer 0 with ef candidates.
+     *
+     * @param accept Nodes for which it returns false are traversed but not returned
+     * @return (node, similarity) pairs, most similar first
+     */
+    std::vector<std::pair<uint32_t, float>> search(const QuerySimilarity& similarity, size_t k, size_t ef,
+                                                   const std::function<bool(uint32_t)>& accept) const;
+
+    /** Appends the graph to out, see read. */
+    void write(std::string& out) const;
+
+    /**
+     * Reads a graph written by write for node_count nodes; throws
+     * runtime_error if the data is truncated or inconsistent.
+     *
+     * @return Bytes consumed
+     */
+    size_t read(const char* data, size_t size, size_t node_count);
+
+private:
+    using Candidate = std::pair<float, uint32_t>;  // similarity, node
+
+    uint32_t greedy_closest(const QuerySimilarity& similarity, uint32_t entry, float entry_similarity,
+                            int layer, float* best_similarity) const;
+    std::vector<Candidate> search_layer(const QuerySimilarity& similarity, uint32_t entry, float entry_similarity,
+                                        size_t ef, int layer) const;
+    std::vector<uint32_t> select_neighbors(std::vector<Candidate> candidates, size_t max_links,
+                                           const NodeSimilarity& between) const;
+
+    size_t m_;
+    size_t ef_construction_;
+    double level_scale_;
+    std::mt19937_64 rng_;
+    // links_[node][layer] are the node's neighbours on that layer
+    std::vector<std::vector<std::vector<uint32_t>>> links_;
+    uint32_t entry_point_ = 0;
+    int max_layer_ = -1;
+};
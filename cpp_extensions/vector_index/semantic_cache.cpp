@@ -0,0 +1,306 @@
+#include "semantic_cache.h"
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <stdexcept>
+#include <thread>
+
+using namespace std;
+
+namespace {
+
+constexpr size_t kReaderStripes = 16;
+constexpr size_t kRowAlignment = 64;
+
+size_t reader_stripe() {
+    thread_local const size_t stripe = hash<thread::id>()(this_thread::get_id()) % kReaderStripes;
+    return stripe;
+}
+
+}  // namespace
+
+SemanticCacheStats& semantic_cache_stats() {
+    static SemanticCacheStats stats;
+    return stats;
+}
+
+struct SemanticCache::Entry {
+    vector<uint8_t> row;  // padded_dim_ encoded values
+    float scale = 1.0f;   // int8 dequantization scale
+    uint64_t scope_hash = 0;
+    string scope;
+    vector<string> chunk_ids;
+    string payload;
+    int64_t created_ns = 0;
+    int64_t expires_ns = 0;
+};
+
+struct SemanticCache::EncodedQuery {
+    vector<float> values;  // normalized, zero-padded to padded_dim_
+    vector<int8_t> codes;  // int8 caches
+    float scale = 0.0f;
+};
+
+// Marks the calling thread as reading slots. Entries a writer takes out of
+// their slots are freed only after the epoch flips and every guard of the
+// previous epoch is gone; re-checking the epoch after announcing ensures a
+// guard is either seen by the flip or only sees slots written before it.
+class SemanticCache::ReadGuard {
+public:
+    explicit ReadGuard(const SemanticCache& cache) : stripe_(cache.readers_[reader_stripe()]) {
+        for (;;) {
+            epoch_ = cache.epoch_.load() & 1;
+            stripe_.active[epoch_].fetch_add(1);
+            if ((cache.epoch_.load() & 1) == epoch_) {
+                break;
+            }
+            stripe_.active[epoch_].fetch_sub(1);
+        }
+    }
+
+    ~ReadGuard() { stripe_.active[epoch_].fetch_sub(1); }
+
+    ReadGuard(const ReadGuard&) = delete;
+    ReadGuard& operator=(const ReadGuard&) = delete;
+
+private:
+    ReaderStripe& stripe_;
+    uint32_t epoch_;
+};
+
+SemanticCache::SemanticCache(const SemanticCacheOptions& options) : options_(options) {
+    if (options_.dim == 0) {
+        throw invalid_argument("Vector dimension must be positive");
+    }
+    if (options_.max_entries == 0) {
+        throw invalid_argument("max_entries must be positive");
+    }
+    const size_t element = vector_type_size(options_.type);
+    padded_dim_ = (options_.dim * element + kRowAlignment - 1) / kRowAlignment * kRowAlignment / element;
+    slots_ = make_unique<atomic<Entry*>[]>(options_.max_entries);
+    last_used_ = make_unique<atomic<int64_t>[]>(options_.max_entries);
+    for (size_t slot = 0; slot < options_.max_entries; ++slot) {
+        slots_[slot].store(nullptr);
+        last_used_[slot].store(0);
+    }
+    readers_ = make_unique<ReaderStripe[]>(kReaderStripes);
+}
+
+SemanticCache::~SemanticCache() {
+    for (size_t slot = 0; slot < options_.max_entries; ++slot) {
+        delete slots_[slot].load();
+    }
+}
+
+int64_t SemanticCache::now_ns() const {
+    return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+SemanticCache::EncodedQuery SemanticCache::encode(const float* query) const {
+    EncodedQuery encoded;
+    encoded.values.assign(query, query + options_.dim);
+    normalize_vector(encoded.values.data(), options_.dim);
+    encoded.values.resize(padded_dim_, 0.0f);
+    if (options_.type == VectorType::Int8) {
+        encoded.codes.resize(padded_dim_);
+        encoded.scale = encode_int8(encoded.values.data(), padded_dim_, encoded.codes.data());
+    }
+    return encoded;
+}
+
+float SemanticCache::score(const EncodedQuery& query, const Entry& entry) const {
+    if (options_.type == VectorType::Float16) {
+        return dot_float16(query.values.data(), reinterpret_cast<const uint16_t*>(entry.row.data()), padded_dim_);
+    }
+    return static_cast<float>(dot_int8(query.codes.data(), reinterpret_cast<const int8_t*>(entry.row.data()),
+                                       padded_dim_)) *
+           query.scale * entry.scale;
+}
+
+long SemanticCache::best_slot(const EncodedQuery& query, uint64_t scope_hash, const string& scope, int64_t now,
+                              float* similarity, const Entry** best_entry) const {
+    long best = -1;
+    *best_entry = nullptr;
+    float best_score = -2.0f;
+    for (size_t slot = 0; slot < options_.max_entries; ++slot) {
+        const Entry* entry = slots_[slot].load();
+        if (!entry || entry->expires_ns <= now || entry->scope_hash != scope_hash || entry->scope != scope) {
+            continue;
+        }
+        const float value = score(query, *entry);
+        if (value > best_score) {
+            best_score = value;
+            best = static_cast<long>(slot);
+            *best_entry = entry;
+        }
+    }
+    *similarity = best_score;
+    return best;
+}
+
+size_t SemanticCache::size() const {
+    ReadGuard guard(*this);
+    const int64_t now = now_ns();
+    size_t live = 0;
+    for (size_t slot = 0; slot < options_.max_entries; ++slot) {
+        const Entry* entry = slots_[slot].load();
+        live += entry && entry->expires_ns > now;
+    }
+    return live;
+}
+
+optional<SemanticCacheHit> SemanticCache::lookup(const float* query, const string& scope, float threshold) {
+    SemanticCacheStats& stats = semantic_cache_stats();
+    ScopedTimer timer(stats.lookup);
+    if (threshold < 0.0f) {
+        threshold = options_.threshold;
+    }
+    const EncodedQuery encoded = encode(query);
+    const uint64_t scope_hash = hash<string>()(scope);
+
+    ReadGuard guard(*this);
+    const int64_t now = now_ns();
+    float similarity;
+    const Entry* entry;
+    const long slot = best_slot(encoded, scope_hash, scope, now, &similarity, &entry);
+    if (slot < 0 || similarity < threshold) {
+        stats.misses.add();
+        return nullopt;
+    }
+    // The entry may have left its slot since; the guard keeps it alive
+    last_used_[slot].store(now, memory_order_relaxed);
+    stats.hits.add();
+
+    SemanticCacheHit hit;
+    hit.chunk_ids = entry->chunk_ids;
+    hit.payload = entry->payload;
+    hit.similarity = similarity;
+    hit.age = chrono::nanoseconds(now - entry->created_ns);
+    return hit;
+}
+
+void SemanticCache::insert(const float* query, vector<string> chunk_ids, string payload, const string& scope,
+                           chrono::nanoseconds ttl) {
+    SemanticCacheStats& stats = semantic_cache_stats();
+    if (ttl.count() < 0) {
+        ttl = options_.ttl;
+    }
+    const EncodedQuery encoded = encode(query);
+    auto entry = make_unique<Entry>();
+    entry->row.resize(padded_dim_ * vector_type_size(options_.type));
+    if (options_.type == VectorType::Float16) {
+        encode_float16(encoded.values.data(), padded_dim_, reinterpret_cast<uint16_t*>(entry->row.data()));
+    } else {
+        memcpy(entry->row.data(), encoded.codes.data(), padded_dim_);
+        entry->scale = encoded.scale;
+    }
+    entry->scope_hash = hash<string>()(scope);
+    entry->scope = scope;
+    entry->chunk_ids = move(chunk_ids);
+    entry->payload = move(payload);
+
+    lock_guard<mutex> lock(write_mutex_);
+    const int64_t now = now_ns();
+    entry->created_ns = now;
+    entry->expires_ns = now + min<int64_t>(ttl.count(), INT64_MAX - now);
+
+    // A near-duplicate question takes over its entry, else a free slot, an
+    // expired one, or the least recently used
+    float similarity;
+    const Entry* duplicate;
+    long slot = best_slot(encoded, entry->scope_hash, scope, now, &similarity, &duplicate);
+    if (slot < 0 || similarity < options_.threshold) {
+        slot = -1;
+        bool victim_expired = false;
+        int64_t victim_used = INT64_MAX;
+        for (size_t candidate = 0; candidate < options_.max_entries; ++candidate) {
+            const Entry* current = slots_[candidate].load();
+            if (!current) {
+                slot = static_cast<long>(candidate);
+                victim_expired = false;
+                break;
+            }
+            const bool expired = current->expires_ns <= now;
+            if (victim_expired && !expired) {
+                continue;
+            }
+            const int64_t used = last_used_[candidate].load(memory_order_relaxed);
+            if ((expired && !victim_expired) || used < victim_used) {
+                slot = static_cast<long>(candidate);
+                victim_expired = expired;
+                victim_used = used;
+            }
+        }
+        if (slots_[slot].load()) {
+            (victim_expired ? stats.expired : stats.evicted).add();
+        }
+    }
+
+    last_used_[slot].store(now, memory_order_relaxed);
+    vector<Entry*> retired;
+    if (Entry* previous = slots_[slot].exchange(entry.release())) {
+        retired.push_back(previous);
+    }
+    stats.inserts.add();
+    reclaim(retired);
+}
+
+void SemanticCache::reclaim(vector<Entry*>& retired) {
+    if (retired.empty()) {
+        return;
+    }
+    // Guards that entered before the flip may still hold retired entries
+    const uint32_t previous = epoch_.fetch_add(1) & 1;
+    for (size_t stripe = 0; stripe < kReaderStripes; ++stripe) {
+        while (readers_[stripe].active[previous].load() != 0) {
+            this_thread::yield();
+        }
+    }
+    for (Entry* entry : retired) {
+        delete entry;
+    }
+    retired.clear();
+}
+
+size_t SemanticCache::invalidate(const string& scope) {
+    const uint64_t scope_hash = hash<string>()(scope);
+    lock_guard<mutex> lock(write_mutex_);
+    vector<Entry*> retired;
+    for (size_t slot = 0; slot < options_.max_entries; ++slot) {
+        const Entry* entry = slots_[slot].load();
+        if (entry && entry->scope_hash == scope_hash && entry->scope == scope) {
+            retired.push_back(slots_[slot].exchange(nullptr));
+        }
+    }
+    const size_t dropped = retired.size();
+    reclaim(retired);
+    return dropped;
+}
+
+void SemanticCache::clear() {
+    lock_guard<mutex> lock(write_mutex_);
+    vector<Entry*> retired;
+    for (size_t slot = 0; slot < options_.max_entries; ++slot) {
+        if (Entry* entry = slots_[slot].exchange(nullptr)) {
+            retired.push_back(entry);
+        }
+    }
+    reclaim(retired);
+}
+
+size_t SemanticCache::purge_expired() {
+    lock_guard<mutex> lock(write_mutex_);
+    const int64_t now = now_ns();
+    vector<Entry*> retired;
+    for (size_t slot = 0; slot < options_.max_entries; ++slot) {
+        const Entry* entry = slots_[slot].load();
+        if (entry && entry->expires_ns <= now) {
+            retired.push_back(slots_[slot].exchange(nullptr));
+        }
+    }
+    const size_t purged = retired.size();
+    semantic_cache_stats().expired.add(purged);
+    reclaim(retired);
+    return purged;
+}
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "stats.h"
+#include "vector_kernels.h"
+
+/**
+ * Metrics of the semantic cache, reported by vector_index.get_stats().
+ * "evicted" counts live entries dropped for space, "expired" entries whose
+ * TTL ran out before they were replaced.
+ */
+struct SemanticCacheStats {
+    StatCounter& hits = stat_counter("vector_index", "cache_hits");
+    StatCounter& misses = stat_counter("vector_index", "cache_misses");
+    StatCounter& inserts = stat_counter("vector_index", "cache_inserts");
+    StatCounter& evicted = stat_counter("vector_index", "cache_evicted");
+    StatCounter& expired = stat_counter("vector_index", "cache_expired");
+    StatHistogram& lookup = stat_histogram("vector_index", "cache_lookup");
+};
+
+SemanticCacheStats& semantic_cache_stats();
+
+struct SemanticCacheOptions {
+    size_t dim = 0;
+    size_t max_entries = 1024;
+    float threshold = 0.95f;  // minimum cosine similarity of a hit
+    std::chrono::nanoseconds ttl = std::chrono::minutes(5);
+    VectorType type = VectorType::Float16;
+};
+
+struct SemanticCacheHit {
+    std::vector<std::string> chunk_ids;
+    std::string payload;
+    float similarity = 0.0f;
+    std::chrono::nanoseconds age{0};
+};
+
+/**
+ * Cache of retrieval results keyed by query embedding: a lookup hits when a
+ * stored query of the same scope (e.g. the serialized metadata filter) is
+ * at least threshold similar, so rephrasings of a question share one entry.
+ *
+ * Lookups are lock-free. Each slot holds an immutable entry behind an
+ * atomic pointer, and replaced entries are freed only once every lookup
+ * that could still see them has finished. Inserts serialize on a mutex;
+ * when the cache is full they reuse an expired slot, else the least
+ * recently used one. Embeddings are normalized and stored with the
+ * vector_index row encoding and kernels.
+ */
+class SemanticCache {
+public:
+    /** @throws std::invalid_argument if dim or max_entries is 0 */
+    explicit SemanticCache(const SemanticCacheOptions& options);
+    ~SemanticCache();
+
+    SemanticCache(const SemanticCache&) = delete;
+    SemanticCache& operator=(const SemanticCache&) = delete;
+
+    const SemanticCacheOptions& options() const { return options_; }
+
+    /** Unexpired entries. */
+    size_t size() const;
+
+    /**
+     * Most similar unexpired entry of scope for a float32 query of
+     * options().dim values, if it reaches threshold (options().threshold
+     * when negative).
+     */
+    std::optional<SemanticCacheHit> lookup(const float* query, const std::string& scope, float threshold = -1.0f);
+
+    /**
+     * Stores a result for query in scope. An entry of the same scope at least
+     * options().threshold similar is replaced rather than duplicated.
+     *
+     * @param ttl Lifetime of the entry, options().ttl when negative
+     */
+    void insert(const float* query, std::vector<std::string> chunk_ids, std::string payload, const std::string& scope,
+                std::chrono::nanoseconds ttl = std::chrono::nanoseconds(-1));
+
+    /** Drops the entries of scope. */
+    size_t invalidate(const std::string& scope);
+
+    /** Drops every entry. */
+    void clear();
+
+    /** Frees the slots of expired entries; returns how many. */
+    size_t purge_expired();
+
+private:
+    struct Entry;
+    struct EncodedQuery;
+    class ReadGuard;
+
+    // One reader count per epoch, padded to its own cache line
+    struct alignas(64) ReaderStripe {
+        std::atomic<uint64_t> active[2] = {};
+    };
+
+    EncodedQuery encode(const float* query) const;
+    float score(const EncodedQuery& query, const Entry& entry) const;
+    int64_t now_ns() const;
+
+    // Best unexpired slot of scope for query and its entry, -1 if none;
+    // requires a ReadGuard or write_mutex_
+    long best_slot(const EncodedQuery& query, uint64_t scope_hash, const std::string& scope, int64_t now,
+                   float* similarity, const Entry** best_entry) const;
+
+    // Frees entries taken out of their slots once no lookup can still see
+    // them; requires write_mutex_
+    void reclaim(std::vector<Entry*>& retired);
+
+    SemanticCacheOptions options_;
+    size_t padded_dim_;
+    std::unique_ptr<std::atomic<Entry*>[]> slots_;
+    std::unique_ptr<std::atomic<int64_t>[]> last_used_;
+
+    std::atomic<uint32_t> epoch_{0};
+    std::unique_ptr<ReaderStripe[]> readers_;
+    std::mutex write_mutex_;
+};
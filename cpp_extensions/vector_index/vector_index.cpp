@@ -0,0 +1,169 @@
+#include <pybind11/numpy.h>
+#include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#include "embedding_index.h"
+#include "semantic_cache.h"
+#include "vector_kernels.h"
+#include "bindings.h"
+
+namespace py = pybind11;
+using namespace std;
+
+using FloatArray = py::array_t<float, py::array::c_style | py::array::forcecast>;
+
+/**
+ * Number of dim-sized vectors in a (n, dim) array, or 1 for a (dim,) array.
+ */
+static size_t vector_count(const FloatArray& vectors, size_t dim) {
+    if (vectors.ndim() == 1 && static_cast<size_t>(vectors.shape(0)) == dim) {
+        return 1;
+    }
+    if (vectors.ndim() == 2 && static_cast<size_t>(vectors.shape(1)) == dim) {
+        return static_cast<size_t>(vectors.shape(0));
+    }
+    throw invalid_argument("Expected vectors of dimension " + to_string(dim));
+}
+
+/**
+ * Converts a cache TTL in seconds.
+ */
+static chrono::nanoseconds to_ttl(double seconds) {
+    if (seconds < 0) {
+        throw invalid_argument("ttl must not be negative");
+    }
+    // Far enough to never expire, close enough not to overflow the clock
+    return chrono::nanoseconds(static_cast<int64_t>(min(seconds, 1e9) * 1e9));
+}
+
+void register_vector_index(py::module_& m) {
+    m.doc() = "Local float16/int8 embedding index with SIMD brute force and HNSW search";
+
+    py::class_<EmbeddingIndex>(m, "VectorIndex")
+        .def(py::init([](size_t dim, const string& dtype, bool normalize, size_t hnsw_m, size_t ef_construction) {
+            EmbeddingIndexOptions options;
+            options.dim = dim;
+            options.type = parse_vector_type(dtype);
+            options.normalize = normalize;
+            options.hnsw_m = hnsw_m;
+            options.ef_construction = ef_construction;
+            return make_unique<EmbeddingIndex>(options);
+        }), py::arg("dim"), py::arg("dtype") = "float16", py::arg("normalize") = true,
+            py::arg("hnsw_m") = 16, py::arg("ef_construction") = 200,
+            "Empty index of dim-dimensional vectors stored as 'float16' or 'int8'; "
+            "hnsw_m=0 disables the graph")
+        .def("add", [](EmbeddingIndex& index, const vector<string>& ids, const FloatArray& vectors) {
+            const size_t count = vector_count(vectors, index.options().dim);
+            py::gil_scoped_release release;
+            index.add(vectors.data(), count, ids);
+        }, py::arg("ids"), py::arg("vectors"),
+            "Add float32 vectors of shape (len(ids), dim); existing ids are replaced")
+        .def("remove", &EmbeddingIndex::remove,
+            py::call_guard<py::gil_scoped_release>(),
+            py::arg("id"), "Remove a vector; returns whether the id was present")
+        .def("compact", &EmbeddingIndex::compact,
+            py::call_guard<py::gil_scoped_release>(),
+            "Drop removed vectors and rebuild the graph")
+        .def("search", [](const EmbeddingIndex& index, const FloatArray& query, size_t k, const string& mode,
+                          size_t ef, size_t num_threads) {
+            if (vector_count(query, index.options().dim) != 1) {
+                throw invalid_argument("Expected one query vector");
+            }
+            const SearchMode search_mode = parse_search_mode(mode);
+            py::gil_scoped_release release;
+            return index.search(query.data(), k, search_mode, ef, num_threads);
+        }, py::arg("query"), py::arg("k") = 10, py::arg("mode") = "auto", py::arg("ef") = 64,
+            py::arg("num_threads") = 1,
+            "Best k (id, score) pairs for a float32 query; mode is 'auto', 'brute_force' or 'hnsw'")
+        .def("save", &EmbeddingIndex::save,
+            py::call_guard<py::gil_scoped_release>(),
+            py::arg("path"), "Write the index to a file")
+        .def_static("load", &EmbeddingIndex::load,
+            py::call_guard<py::gil_scoped_release>(),
+            py::arg("path"), "Map an index written by save()")
+        .def("__len__", &EmbeddingIndex::size)
+        .def("__contains__", &EmbeddingIndex::contains)
+        .def_property_readonly("removed", &EmbeddingIndex::removed,
+            "Removed and replaced vectors still stored until compact()")
+        .def_property_readonly("dim", [](const EmbeddingIndex& index) { return index.options().dim; })
+        .def_property_readonly("dtype", [](const EmbeddingIndex& index) {
+            return vector_type_name(index.options().type);
+        })
+        .def_property_readonly("normalize", [](const EmbeddingIndex& index) { return index.options().normalize; });
+
+    py::class_<SemanticCacheHit>(m, "CacheHit")
+        .def_readonly("chunk_ids", &SemanticCacheHit::chunk_ids)
+        .def_readonly("payload", &SemanticCacheHit::payload)
+        .def_readonly("similarity", &SemanticCacheHit::similarity, "Cosine similarity to the cached query")
+        .def_property_readonly("age", [](const SemanticCacheHit& hit) {
+            return chrono::duration<double>(hit.age).count();
+        }, "Seconds since the entry was stored");
+
+    py::class_<SemanticCache>(m, "SemanticCache")
+        .def(py::init([](size_t dim, size_t max_entries, float threshold, double ttl, const string& dtype) {
+            SemanticCacheOptions options;
+            options.dim = dim;
+            options.max_entries = max_entries;
+            options.threshold = threshold;
+            options.ttl = to_ttl(ttl);
+            options.type = parse_vector_type(dtype);
+            return make_unique<SemanticCache>(options);
+        }), py::arg("dim"), py::arg("max_entries") = 1024, py::arg("threshold") = 0.95f,
+            py::arg("ttl") = 300.0, py::arg("dtype") = "float16",
+            "Cache of up to max_entries retrieval results keyed by dim-dimensional query embeddings; "
+            "lookups hit at cosine similarity >= threshold within ttl seconds")
+        .def("lookup", [](SemanticCache& cache, const FloatArray& query, const string& scope,
+                          const py::object& threshold) -> py::object {
+            if (vector_count(query, cache.options().dim) != 1) {
+                throw invalid_argument("Expected one query vector");
+            }
+            const float minimum = threshold.is_none() ? -1.0f : threshold.cast<float>();
+            optional<SemanticCacheHit> hit;
+            {
+                py::gil_scoped_release release;
+                hit = cache.lookup(query.data(), scope, minimum);
+            }
+            return hit ? py::cast(move(*hit)) : py::none();
+        }, py::arg("query"), py::arg("scope") = "", py::arg("threshold") = py::none(),
+            "CacheHit of the most similar entry stored under scope, or None")
+        .def("insert", [](SemanticCache& cache, const FloatArray& query, vector<string> chunk_ids,
+                          string payload, const string& scope, const py::object& ttl) {
+            if (vector_count(query, cache.options().dim) != 1) {
+                throw invalid_argument("Expected one query vector");
+            }
+            // None keeps the cache default
+            const chrono::nanoseconds lifetime = ttl.is_none() ? chrono::nanoseconds(-1) : to_ttl(ttl.cast<double>());
+            py::gil_scoped_release release;
+            cache.insert(query.data(), move(chunk_ids), move(payload), scope, lifetime);
+        }, py::arg("query"), py::arg("chunk_ids"), py::arg("payload") = "", py::arg("scope") = "",
+            py::arg("ttl") = py::none(),
+            "Store the result of a query; replaces a near-identical query of the same scope")
+        .def("invalidate", &SemanticCache::invalidate,
+            py::call_guard<py::gil_scoped_release>(),
+            py::arg("scope"), "Drop the entries of scope; returns how many")
+        .def("clear", &SemanticCache::clear, py::call_guard<py::gil_scoped_release>())
+        .def("purge_expired", &SemanticCache::purge_expired,
+            py::call_guard<py::gil_scoped_release>(),
+            "Free the slots of expired entries; returns how many")
+        .def("__len__", &SemanticCache::size)
+        .def_property_readonly("dim", [](const SemanticCache& cache) { return cache.options().dim; })
+        .def_property_readonly("threshold", [](const SemanticCache& cache) { return cache.options().threshold; })
+        .def_property_readonly("max_entries", [](const SemanticCache& cache) {
+            return cache.options().max_entries;
+        });
+
+    m.def("kernel_backend", &vector_kernel_backend,
+        "Name of the SIMD kernels selected for this CPU ('avx512', 'avx2', 'neon' or 'scalar')");
+
+    // Create the metrics up front so get_stats() lists them before first use
+    vector_index_stats();
+    semantic_cache_stats();
+    register_stats_api(m, "vector_index");
+}
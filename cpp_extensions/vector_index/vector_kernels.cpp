@@ -0,0 +1,355 @@
+#include "vector_kernels.h"
+#include "multiversion.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#include <immintrin.h>
+#define COSMOS_VECTOR_X86 1
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define COSMOS_VECTOR_NEON 1
+#endif
+
+using namespace std;
+
+VectorType parse_vector_type(const string& name) {
+    if (name == "float16") {
+        return VectorType::Float16;
+    }
+    if (name == "int8") {
+        return VectorType::Int8;
+    }
+    throw invalid_argument("Unknown vector dtype '" + name + "', expected float16 or int8");
+}
+
+const char* vector_type_name(VectorType type) {
+    return type == VectorType::Float16 ? "float16" : "int8";
+}
+
+uint16_t float_to_half(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    const uint16_t sign = static_cast<uint16_t>((bits >> 16) & 0x8000);
+    uint32_t magnitude = bits & 0x7fffffff;
+
+    if (magnitude >= 0x7f800000) {  // infinity or NaN (kept quiet)
+        return sign | 0x7c00 | (magnitude > 0x7f800000 ? 0x200 : 0);
+    }
+    if (magnitude >= 0x477ff000) {  // rounds to 65520 or more
+        return sign | 0x7c00;
+    }
+    if (magnitude < 0x38800000) {  // below 2^-14: subnormal or zero; scaling by 2^24 is exact
+        float scaled;
+        memcpy(&scaled, &magnitude, sizeof(scaled));
+        return sign | static_cast<uint16_t>(nearbyint(scaled * 16777216.0f));
+    }
+    // Round the 23-bit mantissa to 10 bits, ties to even, then rebias the exponent
+    magnitude += 0xfff + ((magnitude >> 13) & 1);
+    magnitude -= 112u << 23;
+    return sign | static_cast<uint16_t>(magnitude >> 13);
+}
+
+float half_to_float(uint16_t half) {
+    const uint32_t sign = static_cast<uint32_t>(half & 0x8000) << 16;
+    const uint32_t exponent = (half >> 10) & 0x1f;
+    const uint32_t mantissa = half & 0x3ff;
+    uint32_t bits;
+    if (exponent == 0x1f) {
+        bits = sign | 0x7f800000 | (mantissa << 13);
+    } else if (exponent == 0) {
+        float value = static_cast<float>(mantissa) * (1.0f / 16777216.0f);
+        memcpy(&bits, &value, sizeof(bits));
+        bits |= sign;
+    } else {
+        bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+    }
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+COSMOS_MULTIVERSIONED
+void normalize_vector(float* vector, size_t dim) {
+    double norm = 0.0;
+    for (size_t i = 0; i < dim; ++i) {
+        norm += static_cast<double>(vector[i]) * vector[i];
+    }
+    if (norm > 0.0) {
+        const float inverse = static_cast<float>(1.0 / sqrt(norm));
+        for (size_t i = 0; i < dim; ++i) {
+            vector[i] *= inverse;
+        }
+    }
+}
+
+COSMOS_MULTIVERSIONED
+void encode_float16(const float* vector, size_t dim, uint16_t* out) {
+    for (size_t i = 0; i < dim; ++i) {
+        out[i] = float_to_half(vector[i]);
+    }
+}
+
+COSMOS_MULTIVERSIONED
+float encode_int8(const float* vector, size_t dim, int8_t* out) {
+    float max_abs = 0.0f;
+    for (size_t i = 0; i < dim; ++i) {
+        max_abs = max(max_abs, fabs(vector[i]));
+    }
+    if (max_abs == 0.0f) {
+        memset(out, 0, dim);
+        return 0.0f;
+    }
+    const float inverse = 127.0f / max_abs;
+    for (size_t i = 0; i < dim; ++i) {
+        long q = lrintf(vector[i] * inverse);
+        out[i] = static_cast<int8_t>(min(127L, max(-127L, q)));
+    }
+    return max_abs / 127.0f;
+}
+
+namespace {
+
+using Float16Kernel = float (*)(const float* query, const uint16_t* row, size_t dim);
+using Int8Kernel = int32_t (*)(const int8_t* a, const int8_t* b, size_t dim);
+using DecodeKernel = void (*)(const uint16_t* row, size_t dim, float* out);
+
+void decode_float16_scalar(const uint16_t* row, size_t dim, float* out) {
+    for (size_t i = 0; i < dim; ++i) {
+        out[i] = half_to_float(row[i]);
+    }
+}
+
+float dot_float16_scalar(const float* query, const uint16_t* row, size_t dim) {
+    float sum = 0.0f;
+    for (size_t i = 0; i < dim; ++i) {
+        sum += query[i] * half_to_float(row[i]);
+    }
+    return sum;
+}
+
+// The kernel of x86 CPUs without AVX2, where the x86-64-v2 clone vectorizes
+// it with SSE4.1
+COSMOS_MULTIVERSIONED
+int32_t dot_int8_scalar(const int8_t* a, const int8_t* b, size_t dim) {
+    int32_t sum = 0;
+    for (size_t i = 0; i < dim; ++i) {
+        sum += static_cast<int32_t>(a[i]) * static_cast<int32_t>(b[i]);
+    }
+    return sum;
+}
+
+#ifdef COSMOS_VECTOR_X86
+__attribute__((target("avx2,fma,f16c")))
+float dot_float16_avx2(const float* query, const uint16_t* row, size_t dim) {
+    __m256 acc0 = _mm256_setzero_ps();
+    __m256 acc1 = _mm256_setzero_ps();
+    __m256 acc2 = _mm256_setzero_ps();
+    __m256 acc3 = _mm256_setzero_ps();
+    size_t i = 0;
+    for (; i + 32 <= dim; i += 32) {
+        const __m128i* halves = reinterpret_cast<const __m128i*>(row + i);
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(query + i), _mm256_cvtph_ps(_mm_loadu_si128(halves)), acc0);
+        acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(query + i + 8), _mm256_cvtph_ps(_mm_loadu_si128(halves + 1)), acc1);
+        acc2 = _mm256_fmadd_ps(_mm256_loadu_ps(query + i + 16), _mm256_cvtph_ps(_mm_loadu_si128(halves + 2)), acc2);
+        acc3 = _mm256_fmadd_ps(_mm256_loadu_ps(query + i + 24), _mm256_cvtph_ps(_mm_loadu_si128(halves + 3)), acc3);
+    }
+    for (; i + 8 <= dim; i += 8) {
+        __m128i halves = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i));
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(query + i), _mm256_cvtph_ps(halves), acc0);
+    }
+    if (i < dim) {
+        // Zero-padded rather than scalar: scalar code after 256-bit
+        // operations pays an AVX-SSE transition penalty per instruction
+        float query_tail[8] = {};
+        uint16_t row_tail[8] = {};
+        memcpy(query_tail, query + i, (dim - i) * sizeof(float));
+        memcpy(row_tail, row + i, (dim - i) * sizeof(uint16_t));
+        __m128i halves = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row_tail));
+        acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(query_tail), _mm256_cvtph_ps(halves), acc1);
+    }
+    __m256 acc = _mm256_add_ps(_mm256_add_ps(acc0, acc1), _mm256_add_ps(acc2, acc3));
+    __m128 sum = _mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1));
+    sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+    sum = _mm_add_ss(sum, _mm_movehdup_ps(sum));
+    return _mm_cvtss_f32(sum);
+}
+
+// |a| * (b with a's sign) turns the signed products into the unsigned x
+// signed form of maddubs; inputs are in [-127, 127], so pairs never saturate
+__attribute__((target("avx2")))
+int32_t dot_int8_avx2(const int8_t* a, const int8_t* b, size_t dim) {
+    const __m256i ones = _mm256_set1_epi16(1);
+    __m256i acc = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 32 <= dim; i += 32) {
+        __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+        __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+        __m256i pairs = _mm256_maddubs_epi16(_mm256_sign_epi8(va, va), _mm256_sign_epi8(vb, va));
+        acc = _mm256_add_epi32(acc, _mm256_madd_epi16(pairs, ones));
+    }
+    if (i < dim) {
+        int8_t a_tail[32] = {};
+        int8_t b_tail[32] = {};
+        memcpy(a_tail, a + i, dim - i);
+        memcpy(b_tail, b + i, dim - i);
+        __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a_tail));
+        __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b_tail));
+        __m256i pairs = _mm256_maddubs_epi16(_mm256_sign_epi8(va, va), _mm256_sign_epi8(vb, va));
+        acc = _mm256_add_epi32(acc, _mm256_madd_epi16(pairs, ones));
+    }
+    __m128i sum = _mm_add_epi32(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtsi128_si32(sum);
+}
+
+__attribute__((target("avx,f16c")))
+void decode_float16_f16c(const uint16_t* row, size_t dim, float* out) {
+    size_t i = 0;
+    for (; i + 8 <= dim; i += 8) {
+        _mm256_storeu_ps(out + i, _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i))));
+    }
+    if (i < dim) {
+        uint16_t row_tail[8] = {};
+        float out_tail[8];
+        memcpy(row_tail, row + i, (dim - i) * sizeof(uint16_t));
+        _mm256_storeu_ps(out_tail, _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(row_tail))));
+        memcpy(out + i, out_tail, (dim - i) * sizeof(float));
+    }
+}
+
+__attribute__((target("avx512f")))
+float dot_float16_avx512(const float* query, const uint16_t* row, size_t dim) {
+    __m512 acc0 = _mm512_setzero_ps();
+    __m512 acc1 = _mm512_setzero_ps();
+    size_t i = 0;
+    for (; i + 32 <= dim; i += 32) {
+        const __m256i* halves = reinterpret_cast<const __m256i*>(row + i);
+        acc0 = _mm512_fmadd_ps(_mm512_loadu_ps(query + i), _mm512_cvtph_ps(_mm256_loadu_si256(halves)), acc0);
+        acc1 = _mm512_fmadd_ps(_mm512_loadu_ps(query + i + 16), _mm512_cvtph_ps(_mm256_loadu_si256(halves + 1)), acc1);
+    }
+    for (; i + 16 <= dim; i += 16) {
+        __m256i halves = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row + i));
+        acc0 = _mm512_fmadd_ps(_mm512_loadu_ps(query + i), _mm512_cvtph_ps(halves), acc0);
+    }
+    if (i < dim) {
+        const __mmask16 mask = static_cast<__mmask16>((1u << (dim - i)) - 1);
+        uint16_t row_tail[16] = {};
+        memcpy(row_tail, row + i, (dim - i) * sizeof(uint16_t));
+        __m256i halves = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row_tail));
+        acc1 = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(mask, query + i), _mm512_cvtph_ps(halves), acc1);
+    }
+    return _mm512_reduce_add_ps(_mm512_add_ps(acc0, acc1));
+}
+
+__attribute__((target("avx512f,avx512bw")))
+int32_t dot_int8_avx512(const int8_t* a, const int8_t* b, size_t dim) {
+    __m512i acc = _mm512_setzero_si512();
+    size_t i = 0;
+    for (; i + 32 <= dim; i += 32) {
+        __m512i va = _mm512_cvtepi8_epi16(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i)));
+        __m512i vb = _mm512_cvtepi8_epi16(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i)));
+        acc = _mm512_add_epi32(acc, _mm512_madd_epi16(va, vb));
+    }
+    if (i < dim) {
+        int8_t a_tail[32] = {};
+        int8_t b_tail[32] = {};
+        memcpy(a_tail, a + i, dim - i);
+        memcpy(b_tail, b + i, dim - i);
+        __m512i va = _mm512_cvtepi8_epi16(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(a_tail)));
+        __m512i vb = _mm512_cvtepi8_epi16(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(b_tail)));
+        acc = _mm512_add_epi32(acc, _mm512_madd_epi16(va, vb));
+    }
+    return _mm512_reduce_add_epi32(acc);
+}
+#endif
+
+#ifdef COSMOS_VECTOR_NEON
+float dot_float16_neon(const float* query, const uint16_t* row, size_t dim) {
+    float32x4_t acc0 = vdupq_n_f32(0.0f);
+    float32x4_t acc1 = vdupq_n_f32(0.0f);
+    size_t i = 0;
+    for (; i + 8 <= dim; i += 8) {
+        float16x8_t halves = vreinterpretq_f16_u16(vld1q_u16(row + i));
+        acc0 = vfmaq_f32(acc0, vld1q_f32(query + i), vcvt_f32_f16(vget_low_f16(halves)));
+        acc1 = vfmaq_f32(acc1, vld1q_f32(query + i + 4), vcvt_high_f32_f16(halves));
+    }
+    float result = vaddvq_f32(vaddq_f32(acc0, acc1));
+    for (; i < dim; ++i) {
+        result += query[i] * half_to_float(row[i]);
+    }
+    return result;
+}
+
+void decode_float16_neon(const uint16_t* row, size_t dim, float* out) {
+    size_t i = 0;
+    for (; i + 4 <= dim; i += 4) {
+        vst1q_f32(out + i, vcvt_f32_f16(vreinterpret_f16_u16(vld1_u16(row + i))));
+    }
+    decode_float16_scalar(row + i, dim - i, out + i);
+}
+
+int32_t dot_int8_neon(const int8_t* a, const int8_t* b, size_t dim) {
+    int32x4_t acc = vdupq_n_s32(0);
+    size_t i = 0;
+    for (; i + 16 <= dim; i += 16) {
+        int8x16_t va = vld1q_s8(a + i);
+        int8x16_t vb = vld1q_s8(b + i);
+        acc = vpadalq_s16(acc, vmull_s8(vget_low_s8(va), vget_low_s8(vb)));
+        acc = vpadalq_s16(acc, vmull_high_s8(va, vb));
+    }
+    int32_t result = vaddvq_s32(acc);
+    for (; i < dim; ++i) {
+        result += static_cast<int32_t>(a[i]) * static_cast<int32_t>(b[i]);
+    }
+    return result;
+}
+#endif
+
+struct SelectedKernels {
+    Float16Kernel float16;
+    Int8Kernel int8;
+    DecodeKernel decode;
+    const char* name;
+};
+
+SelectedKernels select_kernels() {
+#if defined(COSMOS_VECTOR_X86) && (defined(__GNUC__) || defined(__clang__))
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw")) {
+        return {dot_float16_avx512, dot_int8_avx512, decode_float16_f16c, "avx512"};
+    }
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") && __builtin_cpu_supports("f16c")) {
+        return {dot_float16_avx2, dot_int8_avx2, decode_float16_f16c, "avx2"};
+    }
+#elif defined(COSMOS_VECTOR_NEON)
+    return {dot_float16_neon, dot_int8_neon, decode_float16_neon, "neon"};
+#endif
+    return {dot_float16_scalar, dot_int8_scalar, decode_float16_scalar, "scalar"};
+}
+
+const SelectedKernels& active_kernels() {
+    static const SelectedKernels selected = select_kernels();
+    return selected;
+}
+
+}  // namespace
+
+float dot_float16(const float* query, const uint16_t* row, size_t dim) {
+    return active_kernels().float16(query, row, dim);
+}
+
+int32_t dot_int8(const int8_t* a, const int8_t* b, size_t dim) {
+    return active_kernels().int8(a, b, dim);
+}
+
+void decode_float16(const uint16_t* row, size_t dim, float* out) {
+    active_kernels().decode(row, dim, out);
+}
+
+const char* vector_kernel_backend() {
+    return active_kernels().name;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * Element type of the stored vectors.
+ */
+enum class VectorType : uint8_t {
+    Float16 = 1,  // IEEE half precision, scored against a float32 query
+    Int8 = 2,     // symmetric per-vector quantization to [-127, 127] plus one float scale
+};
+
+/**
+ * Parses "float16" or "int8"; throws invalid_argument for anything else.
+ */
+VectorType parse_vector_type(const std::string& name);
+const char* vector_type_name(VectorType type);
+
+/** Bytes per element. */
+inline size_t vector_type_size(VectorType type) {
+    return type == VectorType::Float16 ? 2 : 1;
+}
+
+/** Round-to-nearest-even conversions between float32 and IEEE float16 bits. */
+uint16_t float_to_half(float value);
+float half_to_float(uint16_t bits);
+
+/**
+ * Scales vector to unit length in place; all-zero vectors are left as they are.
+ * This and the encoders are built per ISA level (see multiversion.h).
+ */
+void normalize_vector(float* vector, size_t dim);
+
+void encode_float16(const float* vector, size_t dim, uint16_t* out);
+
+/**
+ * Quantizes vector to out[i] = round(vector[i] / scale), scale = max|vector| / 127.
+ *
+ * @return scale, 0 for an all-zero vector
+ */
+float encode_int8(const float* vector, size_t dim, int8_t* out);
+
+/**
+ * Kernels vectorized with AVX-512, AVX2 (+FMA, F16C) or NEON and selected
+ * at runtime; the CPU's best kernels are used for every call.
+ */
+void decode_float16(const uint16_t* row, size_t dim, float* out);
+float dot_float16(const float* query, const uint16_t* row, size_t dim);
+int32_t dot_int8(const int8_t* a, const int8_t* b, size_t dim);
+
+/**
+ * Name of the kernels selected for this CPU ("avx512", "avx2", "neon" or "scalar").
+ */
+const char* vector_kernel_backend();